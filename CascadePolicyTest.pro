@@ -0,0 +1,19 @@
+QT += core testlib
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath testcase
+CONFIG -= app_bundle
+CONFIG += c++11
+
+TEMPLATE = app
+
+SOURCES += \
+    cascadepolicy_test.cpp \
+    cascadepolicy.cpp \
+    latextoomml.cpp \
+    responsepostprocessor.cpp
+
+HEADERS += \
+    cascadepolicy.h \
+    latextoomml.h \
+    responsepostprocessor.h
@@ -9,7 +9,9 @@ TEMPLATE = app
 
 SOURCES += \
     configmanager_test.cpp \
-    configmanager.cpp
+    configmanager.cpp \
+    generationoptions.cpp
 
 HEADERS += \
-    configmanager.h
+    configmanager.h \
+    generationoptions.h
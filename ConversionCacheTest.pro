@@ -0,0 +1,19 @@
+QT += core concurrent testlib
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath testcase
+CONFIG -= app_bundle
+CONFIG += c++11
+
+TEMPLATE = app
+
+SOURCES += \
+    conversioncache_test.cpp \
+    conversioncache.cpp \
+    docxwriter.cpp \
+    latextoomml.cpp
+
+HEADERS += \
+    conversioncache.h \
+    docxwriter.h \
+    latextoomml.h
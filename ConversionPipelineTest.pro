@@ -0,0 +1,21 @@
+QT += core concurrent testlib
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath testcase
+CONFIG -= app_bundle
+CONFIG += c++11
+
+TEMPLATE = app
+
+SOURCES += \
+    conversionpipeline_test.cpp \
+    conversionpipeline.cpp \
+    conversioncache.cpp \
+    docxwriter.cpp \
+    latextoomml.cpp
+
+HEADERS += \
+    conversionpipeline.h \
+    conversioncache.h \
+    docxwriter.h \
+    latextoomml.h
@@ -0,0 +1,17 @@
+QT += core testlib
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath testcase
+CONFIG -= app_bundle
+CONFIG += c++11
+
+TEMPLATE = app
+
+SOURCES += \
+    docxwriter_test.cpp \
+    docxwriter.cpp \
+    latextoomml.cpp
+
+HEADERS += \
+    docxwriter.h \
+    latextoomml.h
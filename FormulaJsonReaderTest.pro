@@ -0,0 +1,21 @@
+QT += core testlib
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath testcase
+CONFIG -= app_bundle
+CONFIG += c++11
+
+TEMPLATE = app
+
+SOURCES += \
+    formulajsonreader_test.cpp \
+    formulajsonreader.cpp \
+    inferencebackend.cpp \
+    ollamabackend.cpp \
+    openaibackend.cpp
+
+HEADERS += \
+    formulajsonreader.h \
+    inferencebackend.h \
+    ollamabackend.h \
+    openaibackend.h
@@ -1,4 +1,4 @@
-QT       += core gui network widgets
+QT       += core gui network widgets sql concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -19,17 +19,86 @@ SOURCES += \
     main.cpp \
     mainwindow.cpp \
     ollamaclient.cpp \
+    ollamatransport.cpp \
+    inferencebackend.cpp \
+    ollamabackend.cpp \
+    openaibackend.cpp \
+    llamaengine.cpp \
+    hardwareinfo.cpp \
+    runtimeoptions.cpp \
+    tuningcalibrator.cpp \
+    recognitionscheduler.cpp \
+    jobjournal.cpp \
+    responsepostprocessor.cpp \
+    formulajsonreader.cpp \
+    generationoptions.cpp \
+    layoutanalyzer.cpp \
+    cascadepolicy.cpp \
+    imageencoder.cpp \
+    historystore.cpp \
+    historypanel.cpp \
+    pandocprobe.cpp \
+    latextoomml.cpp \
+    docxwriter.cpp \
+    conversioncache.cpp \
+    conversionpipeline.cpp \
     screenshotoverlay.cpp \
+    capturebackend.cpp \
+    inkmap.cpp \
+    regionwatcher.cpp \
     configmanager.cpp \
     settingsdialog.cpp
 
 HEADERS += \
     mainwindow.h \
     ollamaclient.h \
+    ollamatransport.h \
+    inferencebackend.h \
+    ollamabackend.h \
+    openaibackend.h \
+    llamaengine.h \
+    hardwareinfo.h \
+    runtimeoptions.h \
+    tuningcalibrator.h \
+    recognitionscheduler.h \
+    jobjournal.h \
+    responsepostprocessor.h \
+    formulajsonreader.h \
+    generationoptions.h \
+    layoutanalyzer.h \
+    cascadepolicy.h \
+    imageencoder.h \
+    historystore.h \
+    historypanel.h \
+    pandocprobe.h \
+    latextoomml.h \
+    docxwriter.h \
+    conversioncache.h \
+    conversionpipeline.h \
     screenshotoverlay.h \
+    capturebackend.h \
+    inkmap.h \
+    regionwatcher.h \
     configmanager.h \
     settingsdialog.h
 
+# X11 下的 MIT-SHM 截图后端：qmake CONFIG+=xcb_shm（需要 libxcb、libxcb-shm 开发包）
+xcb_shm {
+    DEFINES += HAVE_XCB_SHM
+    SOURCES += xcbcapturebackend.cpp
+    HEADERS += xcbcapturebackend.h
+    LIBS += -lxcb -lxcb-shm
+}
+
+# 进程内推理后端（ollama.api = "llama"）：qmake CONFIG+=llama LLAMA_PREFIX=<llama.cpp 安装目录>
+# 需要构建了 mtmd（多模态投影）库的 llama.cpp
+llama {
+    DEFINES += HAVE_LLAMA
+    isEmpty(LLAMA_PREFIX): LLAMA_PREFIX = /usr/local
+    INCLUDEPATH += $$LLAMA_PREFIX/include
+    LIBS += -L$$LLAMA_PREFIX/lib -lmtmd -lllama -lggml -lggml-base
+}
+
 FORMS += \
     mainwindow.ui \
     settingsdialog.ui
@@ -0,0 +1,15 @@
+QT += core testlib
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath testcase
+CONFIG -= app_bundle
+CONFIG += c++11
+
+TEMPLATE = app
+
+SOURCES += \
+    generationoptions_test.cpp \
+    generationoptions.cpp
+
+HEADERS += \
+    generationoptions.h
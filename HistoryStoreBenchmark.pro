@@ -0,0 +1,16 @@
+QT += core gui sql testlib
+
+CONFIG += qt console warn_on depend_includepath testcase
+CONFIG -= app_bundle
+CONFIG += c++11
+
+TEMPLATE = app
+
+SOURCES += \
+    historystore_benchmark.cpp \
+    historystore.cpp \
+    imageencoder.cpp
+
+HEADERS += \
+    historystore.h \
+    imageencoder.h
@@ -0,0 +1,57 @@
+QT += core gui widgets network testlib
+
+CONFIG += qt console warn_on depend_includepath testcase
+CONFIG -= app_bundle
+CONFIG += c++11
+
+TEMPLATE = app
+
+SOURCES += \
+    imagecapture_benchmark.cpp \
+    ollamaclient.cpp \
+    ollamatransport.cpp \
+    inferencebackend.cpp \
+    ollamabackend.cpp \
+    openaibackend.cpp \
+    llamaengine.cpp \
+    hardwareinfo.cpp \
+    runtimeoptions.cpp \
+    responsepostprocessor.cpp \
+    formulajsonreader.cpp \
+    generationoptions.cpp \
+    layoutanalyzer.cpp \
+    cascadepolicy.cpp \
+    latextoomml.cpp \
+    imageencoder.cpp \
+    screenshotoverlay.cpp \
+    capturebackend.cpp \
+    inkmap.cpp
+
+HEADERS += \
+    ollamaclient.h \
+    ollamatransport.h \
+    inferencebackend.h \
+    ollamabackend.h \
+    openaibackend.h \
+    llamaengine.h \
+    hardwareinfo.h \
+    runtimeoptions.h \
+    responsepostprocessor.h \
+    formulajsonreader.h \
+    generationoptions.h \
+    layoutanalyzer.h \
+    cascadepolicy.h \
+    latextoomml.h \
+    imageencoder.h \
+    screenshotoverlay.h \
+    capturebackend.h \
+    inkmap.h \
+    benchmarkutils.h
+
+# X11 下的 MIT-SHM 截图后端：qmake CONFIG+=xcb_shm（需要 libxcb、libxcb-shm 开发包）
+xcb_shm {
+    DEFINES += HAVE_XCB_SHM
+    SOURCES += xcbcapturebackend.cpp
+    HEADERS += xcbcapturebackend.h
+    LIBS += -lxcb -lxcb-shm
+}
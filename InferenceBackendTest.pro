@@ -0,0 +1,23 @@
+QT += core testlib
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath testcase
+CONFIG -= app_bundle
+CONFIG += c++11
+
+TEMPLATE = app
+
+SOURCES += \
+    inferencebackend_test.cpp \
+    inferencebackend.cpp \
+    ollamabackend.cpp \
+    openaibackend.cpp \
+    formulajsonreader.cpp \
+    generationoptions.cpp
+
+HEADERS += \
+    inferencebackend.h \
+    ollamabackend.h \
+    openaibackend.h \
+    formulajsonreader.h \
+    generationoptions.h
@@ -0,0 +1,15 @@
+QT += core gui testlib
+
+CONFIG += qt console warn_on depend_includepath testcase
+CONFIG -= app_bundle
+CONFIG += c++11
+
+TEMPLATE = app
+
+SOURCES += \
+    inkmap_test.cpp \
+    inkmap.cpp
+
+HEADERS += \
+    inkmap.h \
+    benchmarkutils.h
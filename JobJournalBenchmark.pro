@@ -0,0 +1,16 @@
+QT += core gui concurrent testlib
+
+CONFIG += qt console warn_on depend_includepath testcase
+CONFIG -= app_bundle
+CONFIG += c++11
+
+TEMPLATE = app
+
+SOURCES += \
+    jobjournal_benchmark.cpp \
+    jobjournal.cpp \
+    imageencoder.cpp
+
+HEADERS += \
+    jobjournal.h \
+    imageencoder.h
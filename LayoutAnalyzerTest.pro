@@ -0,0 +1,15 @@
+QT += core gui testlib
+
+CONFIG += qt console warn_on depend_includepath testcase
+CONFIG -= app_bundle
+CONFIG += c++11
+
+TEMPLATE = app
+
+SOURCES += \
+    layoutanalyzer_test.cpp \
+    layoutanalyzer.cpp
+
+HEADERS += \
+    layoutanalyzer.h \
+    benchmarkutils.h
@@ -0,0 +1,60 @@
+QT += core gui widgets network concurrent testlib
+
+CONFIG += qt console warn_on depend_includepath testcase
+CONFIG -= app_bundle
+CONFIG += c++11
+
+TEMPLATE = app
+
+SOURCES += \
+    ollamaclient_benchmark.cpp \
+    ollamaclient.cpp \
+    ollamatransport.cpp \
+    inferencebackend.cpp \
+    ollamabackend.cpp \
+    openaibackend.cpp \
+    llamaengine.cpp \
+    hardwareinfo.cpp \
+    runtimeoptions.cpp \
+    tuningcalibrator.cpp \
+    recognitionscheduler.cpp \
+    jobjournal.cpp \
+    responsepostprocessor.cpp \
+    formulajsonreader.cpp \
+    generationoptions.cpp \
+    layoutanalyzer.cpp \
+    cascadepolicy.cpp \
+    latextoomml.cpp \
+    imageencoder.cpp \
+    mockollamaserver.cpp
+
+HEADERS += \
+    ollamaclient.h \
+    ollamatransport.h \
+    inferencebackend.h \
+    ollamabackend.h \
+    openaibackend.h \
+    llamaengine.h \
+    hardwareinfo.h \
+    runtimeoptions.h \
+    tuningcalibrator.h \
+    recognitionscheduler.h \
+    jobjournal.h \
+    responsepostprocessor.h \
+    formulajsonreader.h \
+    generationoptions.h \
+    layoutanalyzer.h \
+    cascadepolicy.h \
+    latextoomml.h \
+    imageencoder.h \
+    mockollamaserver.h \
+    benchmarkutils.h
+
+# 进程内推理后端（ollama.api = "llama"）：qmake CONFIG+=llama LLAMA_PREFIX=<llama.cpp 安装目录>
+# 需要构建了 mtmd（多模态投影）库的 llama.cpp
+llama {
+    DEFINES += HAVE_LLAMA
+    isEmpty(LLAMA_PREFIX): LLAMA_PREFIX = /usr/local
+    INCLUDEPATH += $$LLAMA_PREFIX/include
+    LIBS += -L$$LLAMA_PREFIX/lib -lmtmd -lllama -lggml -lggml-base
+}
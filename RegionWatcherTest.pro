@@ -0,0 +1,17 @@
+QT += core gui testlib
+
+CONFIG += qt console warn_on depend_includepath testcase
+CONFIG -= app_bundle
+CONFIG += c++11
+
+TEMPLATE = app
+
+SOURCES += \
+    regionwatcher_test.cpp \
+    regionwatcher.cpp \
+    capturebackend.cpp
+
+HEADERS += \
+    regionwatcher.h \
+    capturebackend.h \
+    benchmarkutils.h
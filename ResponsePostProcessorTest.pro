@@ -0,0 +1,15 @@
+QT += core testlib
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath testcase
+CONFIG -= app_bundle
+CONFIG += c++11
+
+TEMPLATE = app
+
+SOURCES += \
+    responsepostprocessor_test.cpp \
+    responsepostprocessor.cpp
+
+HEADERS += \
+    responsepostprocessor.h
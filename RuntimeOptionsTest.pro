@@ -0,0 +1,17 @@
+QT += core network testlib
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath testcase
+CONFIG -= app_bundle
+CONFIG += c++11
+
+TEMPLATE = app
+
+SOURCES += \
+    runtimeoptions_test.cpp \
+    runtimeoptions.cpp \
+    hardwareinfo.cpp
+
+HEADERS += \
+    runtimeoptions.h \
+    hardwareinfo.h
@@ -0,0 +1,57 @@
+#ifndef BENCHMARKUTILS_H
+#define BENCHMARKUTILS_H
+
+#include <QImage>
+#include <QPainter>
+#include <QFont>
+#include <QSize>
+#include <QStringList>
+
+// 基准测试共用的辅助函数：离屏渲染合成的公式图像
+namespace BenchmarkUtils {
+
+// 在白底上逐行绘制公式文本，尽量接近真实截图（抗锯齿文字、留白、多行）
+// variant 用于生成内容不同的图像，避免编码器或缓存对相同输入的特殊处理
+inline QImage renderFormulaImage(const QSize &size, int variant = 0)
+{
+    static const QStringList formulas = {
+        QString::fromUtf8("E = mc² + ∑ᵢ pᵢ²/2mᵢ"),
+        QString::fromUtf8("∫₀^∞ e^(−x²) dx = √π / 2"),
+        QString::fromUtf8("f(x) = a₀ + ∑ₙ (aₙ cos nx + bₙ sin nx)"),
+        QString::fromUtf8("∇ × B = μ₀J + μ₀ε₀ ∂E/∂t"),
+        QString::fromUtf8("lim_{n→∞} (1 + 1/n)ⁿ = e"),
+        QString::fromUtf8("det(A − λI) = 0"),
+    };
+
+    QImage image(size, QImage::Format_RGB32);
+    image.fill(Qt::white);
+
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setRenderHint(QPainter::TextAntialiasing);
+    painter.setPen(Qt::black);
+
+    // 字号随图像高度缩放，保证小图也至少有一行完整公式
+    const int lineHeight = qBound(20, size.height() / 6, 96);
+    QFont font("Serif");
+    font.setPixelSize(qMax(12, lineHeight * 2 / 3));
+    painter.setFont(font);
+
+    const int margin = qMin(lineHeight / 2, size.width() / 10);
+    int line = 0;
+    for (int y = margin + lineHeight; y <= size.height() - margin / 2; y += lineHeight, ++line) {
+        const QString &text = formulas.at((line + variant) % formulas.size());
+        int x = margin;
+        // 宽图上横向重复，模拟整页推导
+        while (x < size.width() - margin) {
+            painter.drawText(x, y, text);
+            x += painter.fontMetrics().horizontalAdvance(text) + lineHeight;
+        }
+    }
+    painter.end();
+    return image;
+}
+
+} // namespace BenchmarkUtils
+
+#endif // BENCHMARKUTILS_H
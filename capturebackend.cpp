@@ -0,0 +1,69 @@
+#include "capturebackend.h"
+#include <QGuiApplication>
+#include <QPainter>
+#include <QPixmap>
+#include <QScreen>
+#include <QDebug>
+#ifdef HAVE_XCB_SHM
+#include "xcbcapturebackend.h"
+#endif
+
+CaptureBackend *CaptureBackend::create(const QString &preference)
+{
+#ifdef HAVE_XCB_SHM
+    if (preference != "qt" && QGuiApplication::platformName() == "xcb") {
+        XcbShmCaptureBackend *backend = new XcbShmCaptureBackend;
+        if (backend->isValid()) {
+            return backend;
+        }
+        delete backend;
+        qWarning() << "MIT-SHM capture unavailable, falling back to QScreen::grabWindow";
+    }
+#else
+    if (preference == "xcb-shm") {
+        qWarning() << "xcb-shm capture backend not compiled in (qmake CONFIG+=xcb_shm), using QScreen::grabWindow";
+    }
+#endif
+    return new QtCaptureBackend;
+}
+
+QString QtCaptureBackend::name() const
+{
+    return "qt";
+}
+
+QImage QtCaptureBackend::grab(const QRect &region)
+{
+    const QList<QScreen *> screens = QGuiApplication::screens();
+
+    // 常见情况：区域在一块屏幕内，直接抓取
+    for (QScreen *screen : screens) {
+        if (screen->geometry().contains(region)) {
+            const QRect local = region.translated(-screen->geometry().topLeft());
+            return screen->grabWindow(0, local.x(), local.y(), local.width(), local.height()).toImage();
+        }
+    }
+
+    // 跨多块屏幕：逐屏抓取后拼接，屏幕之间的空隙为黑色
+    QScreen *primary = QGuiApplication::primaryScreen();
+    if (!primary || region.isEmpty()) {
+        return QImage();
+    }
+    const qreal dpr = primary->devicePixelRatio();
+    QImage result(region.size() * dpr, QImage::Format_RGB32);
+    result.setDevicePixelRatio(dpr);
+    result.fill(Qt::black);
+
+    QPainter painter(&result);
+    for (QScreen *screen : screens) {
+        const QRect part = screen->geometry() & region;
+        if (part.isEmpty()) {
+            continue;
+        }
+        const QRect local = part.translated(-screen->geometry().topLeft());
+        const QPixmap pixmap = screen->grabWindow(0, local.x(), local.y(), local.width(), local.height());
+        painter.drawPixmap(QRect(part.topLeft() - region.topLeft(), part.size()), pixmap);
+    }
+    painter.end();
+    return result;
+}
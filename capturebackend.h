@@ -0,0 +1,31 @@
+#ifndef CAPTUREBACKEND_H
+#define CAPTUREBACKEND_H
+
+#include <QImage>
+#include <QRect>
+#include <QString>
+
+// 截图后端：从虚拟桌面抓取一块区域。
+// 区域使用 Qt 的逻辑坐标（与 QScreen::geometry 一致）；返回的图像为设备像素大小并带 devicePixelRatio
+class CaptureBackend
+{
+public:
+    virtual ~CaptureBackend() = default;
+
+    virtual QString name() const = 0;
+    // 失败时返回空图像
+    virtual QImage grab(const QRect &region) = 0;
+
+    // preference："auto"（优先 xcb-shm，不可用时退回 qt）、"qt" 或 "xcb-shm"；调用方拥有返回的对象
+    static CaptureBackend *create(const QString &preference);
+};
+
+// 默认后端：QScreen::grabWindow(0)，所有平台可用
+class QtCaptureBackend : public CaptureBackend
+{
+public:
+    QString name() const override;
+    QImage grab(const QRect &region) override;
+};
+
+#endif // CAPTUREBACKEND_H
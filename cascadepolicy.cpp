@@ -0,0 +1,109 @@
+#include "cascadepolicy.h"
+#include "latextoomml.h"
+
+int CascadePolicy::latexChars(const QString &markdown)
+{
+    int count = 0;
+    for (const QChar &c : markdown) {
+        if (c != QLatin1Char('$') && !c.isSpace()) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+CascadePolicy::Verdict CascadePolicy::check(const Settings &settings, const ResponsePostProcessor::Result &cleaned,
+                                            const QSize &crop, double confidence, const QString &doneReason)
+{
+    Verdict verdict;
+    verdict.accept = false;
+
+    if (!cleaned.valid) {
+        verdict.reason = cleaned.error;
+        return verdict;
+    }
+    if (doneReason == "length") {
+        verdict.reason = "output truncated at num_predict";
+        return verdict;
+    }
+
+    // 每个公式都要能被转换器解析，转换失败说明小模型写出了残缺的 LaTeX
+    int formulas = 0;
+    for (const LatexToOmml::Segment &segment : LatexToOmml::splitMarkdown(cleaned.markdown)) {
+        if (segment.kind == LatexToOmml::Segment::Text) {
+            continue;
+        }
+        ++formulas;
+        QString error;
+        if (LatexToOmml::convert(segment.content, segment.kind == LatexToOmml::Segment::DisplayMath, &error).isEmpty()) {
+            verdict.reason = "LaTeX parse failed: " + error;
+            return verdict;
+        }
+    }
+    if (formulas == 0) {
+        verdict.reason = "no formula in output";
+        return verdict;
+    }
+
+    const int chars = latexChars(cleaned.markdown);
+    const double kpixels = qMax(1.0, crop.width() * crop.height() / 1000.0);
+    if (chars > settings.maxCharsPerKPixel * kpixels) {
+        verdict.reason = QString("output too long for crop (%1 chars for %2x%3)")
+                             .arg(chars).arg(crop.width()).arg(crop.height());
+        return verdict;
+    }
+    if (chars < settings.minCharsPerKPixel * kpixels) {
+        verdict.reason = QString("output too short for crop (%1 chars for %2x%3)")
+                             .arg(chars).arg(crop.width()).arg(crop.height());
+        return verdict;
+    }
+
+    if (confidence >= 0 && confidence < settings.minConfidence) {
+        verdict.reason = QString("low confidence %1").arg(confidence);
+        return verdict;
+    }
+
+    verdict.accept = true;
+    return verdict;
+}
+
+void CascadePolicy::Stats::recordAccepted(qint64 fastMs)
+{
+    ++fastAccepted;
+    fastAcceptedMs += fastMs;
+}
+
+void CascadePolicy::Stats::recordEscalated(qint64 fastMs, qint64 fullMs)
+{
+    ++escalated;
+    fastWastedMs += fastMs;
+    this->fullMs += fullMs;
+}
+
+int CascadePolicy::Stats::total() const
+{
+    return fastAccepted + escalated;
+}
+
+double CascadePolicy::Stats::fastHitRate() const
+{
+    return total() > 0 ? double(fastAccepted) / total() : 0.0;
+}
+
+qint64 CascadePolicy::Stats::savedMs() const
+{
+    if (escalated == 0) {
+        return 0;
+    }
+    const double fullAverage = double(fullMs) / escalated;
+    return qint64(fastAccepted * fullAverage) - fastAcceptedMs - fastWastedMs;
+}
+
+QString CascadePolicy::Stats::summary() const
+{
+    return QString("fast %1/%2 (%3%), full %4/%2, saved %5 ms")
+        .arg(fastAccepted).arg(total())
+        .arg(fastHitRate() * 100, 0, 'f', 1)
+        .arg(escalated)
+        .arg(savedMs());
+}
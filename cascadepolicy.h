@@ -0,0 +1,57 @@
+#ifndef CASCADEPOLICY_H
+#define CASCADEPOLICY_H
+
+#include <QSize>
+#include <QString>
+#include "responsepostprocessor.h"
+
+// 分级识别：先用小模型（或量化模型）识别，输出通过廉价检查即采用，
+// 否则同一张图交给配置的大模型。多数截图只有一两个简单公式，小模型足够，
+// 省下大模型的预填充和解码时间
+class CascadePolicy
+{
+public:
+    struct Settings
+    {
+        bool enabled = false;
+        QString fastModel = "qwen2.5vl:3b";
+        double minConfidence = 0.5;      // 结构化输出中任一公式置信度低于该值即升级
+        double maxCharsPerKPixel = 24;   // 每千像素的 LaTeX 字符数上限，超过多半是重复或幻觉
+        double minCharsPerKPixel = 0.02; // 下限，很大的截图只给出一两个字符多半漏识别
+    };
+
+    struct Verdict
+    {
+        bool accept = true;
+        QString reason;  // 升级原因（英文，用于日志和 RecognitionMetrics::escalationReason）
+    };
+
+    // 检查小模型的输出：配对检查、逐个公式的 LaTeX 解析、输出长度与选区面积、置信度（-1 表示未知）
+    static Verdict check(const Settings &settings, const ResponsePostProcessor::Result &cleaned,
+                         const QSize &crop, double confidence, const QString &doneReason);
+    // 公式中的有效字符数（不计定界符和空白）
+    static int latexChars(const QString &markdown);
+
+    // 各级命中率与节省的时间
+    struct Stats
+    {
+        int fastAccepted = 0;       // 小模型的结果被采用
+        int escalated = 0;          // 升级到大模型
+        qint64 fastAcceptedMs = 0;  // 被采用的小模型请求耗时之和
+        qint64 fastWastedMs = 0;    // 升级前花在小模型上的时间之和
+        qint64 fullMs = 0;          // 升级后大模型请求耗时之和
+
+        void recordAccepted(qint64 fastMs);
+        void recordEscalated(qint64 fastMs, qint64 fullMs);
+
+        int total() const;
+        double fastHitRate() const;
+        // 以升级请求的大模型平均耗时作为“全部交给大模型”的基线：
+        // 小模型被采用的请求省下的时间，减去升级请求白花在小模型上的时间。
+        // 升级的多是较难的截图，基线偏高，结果偏乐观；还没有升级过时没有基线，返回 0
+        qint64 savedMs() const;
+        QString summary() const;
+    };
+};
+
+#endif // CASCADEPOLICY_H
@@ -0,0 +1,109 @@
+#include <QTest>
+#include "cascadepolicy.h"
+
+Q_DECLARE_METATYPE(ResponsePostProcessor::Result)
+
+class CascadePolicyTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // 测试小模型输出的检查
+    void testCheck_data();
+    void testCheck();
+
+    // 测试置信度阈值
+    void testConfidence();
+
+    // 测试命中率与节省时间的统计
+    void testStats();
+
+private:
+    static ResponsePostProcessor::Result cleaned(const QString &markdown);
+};
+
+// 配对检查已通过的输出，用来单独测试后面的各项检查
+ResponsePostProcessor::Result CascadePolicyTest::cleaned(const QString &markdown)
+{
+    ResponsePostProcessor::Result result;
+    result.markdown = markdown;
+    return result;
+}
+
+void CascadePolicyTest::testCheck_data()
+{
+    QTest::addColumn<ResponsePostProcessor::Result>("result");
+    QTest::addColumn<QSize>("crop");
+    QTest::addColumn<QString>("doneReason");
+    QTest::addColumn<bool>("accept");
+    QTest::addColumn<QString>("reason");
+
+    QTest::newRow("simple") << cleaned("$$x^2 + 1$$") << QSize(200, 60) << "stop" << true << "";
+    QTest::newRow("unbalanced") << ResponsePostProcessor::process("$$\\frac{a}{b$$") << QSize(200, 60)
+                                << "stop" << false << "unclosed '{'";
+    QTest::newRow("truncated") << cleaned("$$x^2 + 1$$") << QSize(200, 60) << "length"
+                               << false << "output truncated";
+    QTest::newRow("parse failure") << cleaned("$$\\frac{a}$$") << QSize(200, 60) << "stop"
+                                   << false << "LaTeX parse failed";
+    QTest::newRow("no formula") << cleaned("No formula is visible in the image.") << QSize(200, 60)
+                                << "stop" << false << "no formula";
+    // 40×20 的选区最多容纳 24 个字符
+    QTest::newRow("too long") << cleaned("$$" + QString("a+").repeated(30) + "a$$") << QSize(40, 20)
+                              << "stop" << false << "output too long";
+    // 4000×2000 的选区至少应有 160 个字符
+    QTest::newRow("too short") << cleaned("$$x$$") << QSize(4000, 2000) << "stop"
+                               << false << "output too short";
+}
+
+void CascadePolicyTest::testCheck()
+{
+    QFETCH(ResponsePostProcessor::Result, result);
+    QFETCH(QSize, crop);
+    QFETCH(QString, doneReason);
+    QFETCH(bool, accept);
+    QFETCH(QString, reason);
+
+    const CascadePolicy::Verdict verdict = CascadePolicy::check(CascadePolicy::Settings(), result, crop, -1, doneReason);
+    QCOMPARE(verdict.accept, accept);
+    QVERIFY2(verdict.reason.startsWith(reason), qPrintable(verdict.reason));
+}
+
+void CascadePolicyTest::testConfidence()
+{
+    CascadePolicy::Settings settings;
+    settings.minConfidence = 0.6;
+    const ResponsePostProcessor::Result result = cleaned("$\\alpha + \\beta$");
+
+    QVERIFY(CascadePolicy::check(settings, result, QSize(200, 60), -1, "stop").accept);
+    QVERIFY(CascadePolicy::check(settings, result, QSize(200, 60), 0.9, "stop").accept);
+    const CascadePolicy::Verdict low = CascadePolicy::check(settings, result, QSize(200, 60), 0.3, "stop");
+    QVERIFY(!low.accept);
+    QVERIFY(low.reason.startsWith("low confidence"));
+}
+
+void CascadePolicyTest::testStats()
+{
+    CascadePolicy::Stats stats;
+    QCOMPARE(stats.savedMs(), qint64(0));
+    QCOMPARE(stats.fastHitRate(), 0.0);
+
+    for (int i = 0; i < 6; ++i) {
+        stats.recordAccepted(50);
+    }
+    // 还没有升级过，没有大模型的基线
+    QCOMPARE(stats.savedMs(), qint64(0));
+
+    for (int i = 0; i < 3; ++i) {
+        stats.recordEscalated(50, 300);
+    }
+    QCOMPARE(stats.total(), 9);
+    QCOMPARE(stats.fastAccepted, 6);
+    QCOMPARE(stats.escalated, 3);
+    QVERIFY(qAbs(stats.fastHitRate() - 2.0 / 3.0) < 1e-9);
+    // 6 × 300 − 6 × 50 − 3 × 50
+    QCOMPARE(stats.savedMs(), qint64(1350));
+    QVERIFY(stats.summary().contains("saved 1350 ms"));
+}
+
+QTEST_MAIN(CascadePolicyTest)
+#include "cascadepolicy_test.moc"
@@ -1,4 +1,5 @@
 #include "configmanager.h"
+#include "generationoptions.h"
 #include <QFile>
 #include <QDir>
 #include <QStandardPaths>
@@ -35,6 +36,8 @@ void ConfigManager::initializeDefaults()
     ollama["url"] = "http://localhost:11434/api/generate";
     ollama["modelName"] = "qwen2.5vl:7b";
     ollama["timeout"] = 30;
+    ollama["outputMode"] = "markdown";
+    ollama["api"] = "ollama";
     defaults["ollama"] = ollama;
 
     QJsonObject ui;
@@ -65,8 +68,102 @@ void ConfigManager::initializeDefaults()
     advanced["autoRetry"] = true;
     advanced["retryAttempts"] = 3;
     advanced["retryDelayMs"] = 1000;
+    advanced["reaskOnInvalid"] = true;
     defaults["advanced"] = advanced;
 
+    QJsonObject upload;
+    upload["codec"] = "png";
+    upload["pngCompression"] = -1;
+    upload["jpegQuality"] = 90;
+    upload["webpQuality"] = 100;
+    upload["maxUploadKB"] = 1024;
+    upload["autoAllowWebp"] = false;
+    defaults["upload"] = upload;
+
+    QJsonObject cache;
+    cache["conversionMemoryKB"] = 8192;
+    cache["conversionDiskEnabled"] = true;
+    cache["precomputeFormats"] = QJsonArray({"omml-html", "docx"});
+    cache["precomputeDebounceMs"] = 800;
+    defaults["cache"] = cache;
+
+    QJsonObject generation;
+    generation["mode"] = "auto";
+    generation["numPredict"] = 0;
+    generation["numCtx"] = 0;
+    generation["temperature"] = 0.0;
+    generation["stop"] = QJsonArray::fromStringList(GenerationOptions::defaultStop());
+    defaults["generation"] = generation;
+
+    QJsonObject layout;
+    layout["enabled"] = true;
+    layout["minHeight"] = 240;
+    layout["minGapPx"] = 10;
+    layout["maxSegments"] = 8;
+    defaults["layout"] = layout;
+
+    QJsonObject transport;
+    transport["keepAlive"] = true;
+    transport["http2"] = true;
+    transport["tlsSessionReuse"] = true;
+    transport["preconnect"] = true;
+    defaults["transport"] = transport;
+
+    QJsonObject capture;
+    capture["backend"] = "auto";
+    capture["snap"] = true;
+    defaults["capture"] = capture;
+
+    QJsonObject watch;
+    watch["intervalMs"] = 500;
+    watch["maxIntervalMs"] = 4000;
+    watch["hashThreshold"] = 6;
+    watch["changeFraction"] = 0.01;
+    defaults["watch"] = watch;
+
+    QJsonObject cascade;
+    cascade["enabled"] = false;
+    cascade["fastModel"] = "qwen2.5vl:3b";
+    cascade["minConfidence"] = 0.5;
+    cascade["maxCharsPerKPixel"] = 24.0;
+    cascade["minCharsPerKPixel"] = 0.02;
+    defaults["cascade"] = cascade;
+
+    QJsonObject llama;
+    llama["modelPath"] = "";
+    llama["mmprojPath"] = "";
+    llama["threads"] = 0;
+    llama["mmap"] = true;
+    llama["contextSize"] = 4096;
+    llama["gpuLayers"] = 0;
+    defaults["llama"] = llama;
+
+    QJsonObject tuning;
+    tuning["enabled"] = true;
+    tuning["numThread"] = 0;
+    tuning["numBatch"] = 0;
+    tuning["useMmap"] = true;
+    tuning["useMlock"] = false;
+    tuning["endpoints"] = QJsonObject();
+    defaults["tuning"] = tuning;
+
+    QJsonObject scheduler;
+    scheduler["interactiveLimit"] = 2;
+    scheduler["backgroundLimit"] = 1;
+    scheduler["bulkLimit"] = 2;
+    scheduler["deferBulk"] = true;
+    scheduler["preemptBulk"] = false;
+    scheduler["cancelSuperseded"] = true;
+    defaults["scheduler"] = scheduler;
+
+    QJsonObject queue;
+    queue["enabled"] = true;
+    queue["syncIntervalMs"] = 20;
+    queue["syncBatch"] = 256;
+    queue["healthIntervalMs"] = 5000;
+    queue["maxRetries"] = 5;
+    defaults["queue"] = queue;
+
     configData = defaults;
 }
 
@@ -205,6 +302,22 @@ bool ConfigManager::validateConfig() const
         qWarning() << "ollama.timeout must be > 0";
         return false;
     }
+    // 输出模式（可选，旧版本配置文件中没有此项）
+    if (ollama.contains("outputMode")) {
+        QStringList validModes = {"markdown", "json"};
+        if (!validModes.contains(ollama["outputMode"].toString())) {
+            qWarning() << "Invalid ollama.outputMode value:" << ollama["outputMode"].toString();
+            return false;
+        }
+    }
+    // 接口格式（可选）
+    if (ollama.contains("api")) {
+        QStringList validApis = {"ollama", "openai", "llama"};
+        if (!validApis.contains(ollama["api"].toString())) {
+            qWarning() << "Invalid ollama.api value:" << ollama["api"].toString();
+            return false;
+        }
+    }
 
     // 验证 UI 配置
     QJsonObject ui = configData["ui"].toObject();
@@ -287,6 +400,357 @@ bool ConfigManager::validateConfig() const
         return false;
     }
 
+    // 验证上传编码配置（可选，旧版本配置文件中没有此节）
+    if (configData.contains("upload")) {
+        if (!configData["upload"].isObject()) {
+            qWarning() << "Config key is not an object: upload";
+            return false;
+        }
+        QJsonObject upload = configData["upload"].toObject();
+        QStringList validCodecs = {"png", "jpeg", "webp", "auto"};
+        if (upload.contains("codec") && !validCodecs.contains(upload["codec"].toString())) {
+            qWarning() << "Invalid upload.codec value:" << upload["codec"].toString();
+            return false;
+        }
+        if (upload.contains("pngCompression")) {
+            int level = upload["pngCompression"].toInt(-2);
+            if (level < -1 || level > 9) {
+                qWarning() << "Invalid upload.pngCompression (-1-9):" << level;
+                return false;
+            }
+        }
+        if (upload.contains("jpegQuality")) {
+            int quality = upload["jpegQuality"].toInt(-1);
+            if (quality < 0 || quality > 100) {
+                qWarning() << "Invalid upload.jpegQuality (0 = auto, 1-100):" << quality;
+                return false;
+            }
+        }
+        if (upload.contains("webpQuality")) {
+            int quality = upload["webpQuality"].toInt(-1);
+            if (quality < 0 || quality > 100) {
+                qWarning() << "Invalid upload.webpQuality (0-100):" << quality;
+                return false;
+            }
+        }
+        if (upload.contains("maxUploadKB")) {
+            int budget = upload["maxUploadKB"].toInt(0);
+            if (budget <= 0) {
+                qWarning() << "Invalid upload.maxUploadKB (> 0):" << budget;
+                return false;
+            }
+        }
+    }
+
+    // 验证转换缓存配置（可选）
+    if (configData.contains("cache")) {
+        if (!configData["cache"].isObject()) {
+            qWarning() << "Config key is not an object: cache";
+            return false;
+        }
+        QJsonObject cache = configData["cache"].toObject();
+        if (cache.contains("conversionMemoryKB") && cache["conversionMemoryKB"].toInt() < 0) {
+            qWarning() << "cache.conversionMemoryKB must be >= 0";
+            return false;
+        }
+        if (cache.contains("precomputeFormats")) {
+            if (!cache["precomputeFormats"].isArray()) {
+                qWarning() << "cache.precomputeFormats must be an array";
+                return false;
+            }
+            QStringList validFormats = {"omml-html", "docx"};
+            for (const QJsonValue &format : cache["precomputeFormats"].toArray()) {
+                if (!validFormats.contains(format.toString())) {
+                    qWarning() << "Invalid cache.precomputeFormats value:" << format.toVariant();
+                    return false;
+                }
+            }
+        }
+        if (cache.contains("precomputeDebounceMs") && cache["precomputeDebounceMs"].toInt() < 0) {
+            qWarning() << "cache.precomputeDebounceMs must be >= 0";
+            return false;
+        }
+    }
+
+    // 验证生成参数配置（可选）
+    if (configData.contains("generation")) {
+        if (!configData["generation"].isObject()) {
+            qWarning() << "Config key is not an object: generation";
+            return false;
+        }
+        QJsonObject generation = configData["generation"].toObject();
+        QStringList validModes = {"auto", "fixed", "off"};
+        if (generation.contains("mode") && !validModes.contains(generation["mode"].toString())) {
+            qWarning() << "Invalid generation.mode value:" << generation["mode"].toString();
+            return false;
+        }
+        if (generation.contains("numPredict") && generation["numPredict"].toInt() < -1) {
+            qWarning() << "generation.numPredict must be >= -1";
+            return false;
+        }
+        if (generation.contains("numCtx") && generation["numCtx"].toInt() < 0) {
+            qWarning() << "generation.numCtx must be >= 0";
+            return false;
+        }
+        if (generation.contains("temperature")) {
+            double temperature = generation["temperature"].toDouble(-1);
+            if (temperature < 0 || temperature > 2) {
+                qWarning() << "generation.temperature must be in [0, 2]";
+                return false;
+            }
+        }
+        if (generation.contains("stop") && !generation["stop"].isArray()) {
+            qWarning() << "generation.stop must be an array";
+            return false;
+        }
+    }
+
+    // 验证版面分析配置（可选）
+    if (configData.contains("layout")) {
+        if (!configData["layout"].isObject()) {
+            qWarning() << "Config key is not an object: layout";
+            return false;
+        }
+        QJsonObject layout = configData["layout"].toObject();
+        if (layout.contains("minHeight") && layout["minHeight"].toInt() < 0) {
+            qWarning() << "layout.minHeight must be >= 0";
+            return false;
+        }
+        if (layout.contains("minGapPx") && layout["minGapPx"].toInt() < 1) {
+            qWarning() << "layout.minGapPx must be >= 1";
+            return false;
+        }
+        if (layout.contains("maxSegments")) {
+            int maxSegments = layout["maxSegments"].toInt();
+            if (maxSegments < 1 || maxSegments > 32) {
+                qWarning() << "layout.maxSegments must be in [1, 32]";
+                return false;
+            }
+        }
+    }
+
+    // 验证传输层配置（可选）
+    if (configData.contains("transport")) {
+        if (!configData["transport"].isObject()) {
+            qWarning() << "Config key is not an object: transport";
+            return false;
+        }
+        QJsonObject transport = configData["transport"].toObject();
+        for (const QString &key : {"keepAlive", "http2", "tlsSessionReuse", "preconnect"}) {
+            if (transport.contains(key) && !transport[key].isBool()) {
+                qWarning() << "transport." + key + " must be a boolean";
+                return false;
+            }
+        }
+    }
+
+    // 验证截图后端配置（可选）
+    if (configData.contains("capture")) {
+        if (!configData["capture"].isObject()) {
+            qWarning() << "Config key is not an object: capture";
+            return false;
+        }
+        QJsonObject capture = configData["capture"].toObject();
+        QStringList validBackends = {"auto", "qt", "xcb-shm"};
+        if (capture.contains("backend") && !validBackends.contains(capture["backend"].toString())) {
+            qWarning() << "Invalid capture.backend value:" << capture["backend"].toString();
+            return false;
+        }
+        if (capture.contains("snap") && !capture["snap"].isBool()) {
+            qWarning() << "capture.snap must be a boolean";
+            return false;
+        }
+    }
+
+    // 验证监视区域配置（可选）
+    if (configData.contains("watch")) {
+        if (!configData["watch"].isObject()) {
+            qWarning() << "Config key is not an object: watch";
+            return false;
+        }
+        QJsonObject watch = configData["watch"].toObject();
+        int intervalMs = watch["intervalMs"].toInt(500);
+        if (intervalMs < 100 || intervalMs > 60000) {
+            qWarning() << "watch.intervalMs must be in [100, 60000]";
+            return false;
+        }
+        if (watch.contains("maxIntervalMs") && watch["maxIntervalMs"].toInt() < intervalMs) {
+            qWarning() << "watch.maxIntervalMs must be >= watch.intervalMs";
+            return false;
+        }
+        if (watch.contains("hashThreshold")) {
+            int hashThreshold = watch["hashThreshold"].toInt(-1);
+            if (hashThreshold < 1 || hashThreshold > 64) {
+                qWarning() << "watch.hashThreshold must be in [1, 64]";
+                return false;
+            }
+        }
+        if (watch.contains("changeFraction")) {
+            double changeFraction = watch["changeFraction"].toDouble(-1);
+            if (changeFraction <= 0 || changeFraction > 1) {
+                qWarning() << "watch.changeFraction must be in (0, 1]";
+                return false;
+            }
+        }
+    }
+
+    // 验证分级识别配置（可选）
+    if (configData.contains("cascade")) {
+        if (!configData["cascade"].isObject()) {
+            qWarning() << "Config key is not an object: cascade";
+            return false;
+        }
+        QJsonObject cascade = configData["cascade"].toObject();
+        if (cascade.contains("enabled") && !cascade["enabled"].isBool()) {
+            qWarning() << "cascade.enabled must be a boolean";
+            return false;
+        }
+        if (cascade["enabled"].toBool() && cascade["fastModel"].toString().trimmed().isEmpty()) {
+            qWarning() << "cascade.fastModel must be set when cascade is enabled";
+            return false;
+        }
+        if (cascade.contains("minConfidence")) {
+            double minConfidence = cascade["minConfidence"].toDouble(-1);
+            if (minConfidence < 0 || minConfidence > 1) {
+                qWarning() << "cascade.minConfidence must be in [0, 1]";
+                return false;
+            }
+        }
+        double maxChars = cascade["maxCharsPerKPixel"].toDouble(24.0);
+        double minChars = cascade["minCharsPerKPixel"].toDouble(0.02);
+        if (minChars < 0 || maxChars <= minChars) {
+            qWarning() << "cascade.minCharsPerKPixel must be >= 0 and below cascade.maxCharsPerKPixel";
+            return false;
+        }
+    }
+
+    // 验证进程内推理配置（可选）
+    if (configData.contains("llama")) {
+        if (!configData["llama"].isObject()) {
+            qWarning() << "Config key is not an object: llama";
+            return false;
+        }
+        QJsonObject llama = configData["llama"].toObject();
+        if (llama.contains("mmap") && !llama["mmap"].isBool()) {
+            qWarning() << "llama.mmap must be a boolean";
+            return false;
+        }
+        if (llama["threads"].toInt(0) < 0 || llama["gpuLayers"].toInt(0) < 0) {
+            qWarning() << "llama.threads and llama.gpuLayers must be >= 0";
+            return false;
+        }
+        if (llama.contains("contextSize") && llama["contextSize"].toInt(0) < 512) {
+            qWarning() << "llama.contextSize must be >= 512";
+            return false;
+        }
+        if (configData["ollama"].toObject()["api"].toString() == "llama"
+                && (llama["modelPath"].toString().trimmed().isEmpty()
+                    || llama["mmprojPath"].toString().trimmed().isEmpty())) {
+            qWarning() << "llama.modelPath and llama.mmprojPath must be set when ollama.api is llama";
+            return false;
+        }
+    }
+
+    // 验证运行参数配置（可选）：顶层为默认值，endpoints 下按端点覆盖，字段相同
+    if (configData.contains("tuning")) {
+        if (!configData["tuning"].isObject()) {
+            qWarning() << "Config key is not an object: tuning";
+            return false;
+        }
+        auto validTuning = [](const QJsonObject &tuning, const QString &prefix) {
+            for (const QString &key : {QString("enabled"), QString("useMmap"), QString("useMlock")}) {
+                if (tuning.contains(key) && !tuning[key].isBool()) {
+                    qWarning() << prefix + key << "must be a boolean";
+                    return false;
+                }
+            }
+            if (tuning["numThread"].toInt(0) < 0 || tuning["numBatch"].toInt(0) < 0) {
+                qWarning() << prefix + "numThread and" << prefix + "numBatch must be >= 0";
+                return false;
+            }
+            return true;
+        };
+        QJsonObject tuning = configData["tuning"].toObject();
+        if (!validTuning(tuning, "tuning.")) {
+            return false;
+        }
+        if (tuning.contains("endpoints")) {
+            if (!tuning["endpoints"].isObject()) {
+                qWarning() << "Config key is not an object: tuning.endpoints";
+                return false;
+            }
+            QJsonObject endpoints = tuning["endpoints"].toObject();
+            for (auto it = endpoints.constBegin(); it != endpoints.constEnd(); ++it) {
+                if (!it.value().isObject()) {
+                    qWarning() << "tuning.endpoints entry is not an object:" << it.key();
+                    return false;
+                }
+                if (!validTuning(it.value().toObject(), "tuning.endpoints[" + it.key() + "].")) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    // 验证识别调度配置（可选）
+    if (configData.contains("scheduler")) {
+        if (!configData["scheduler"].isObject()) {
+            qWarning() << "Config key is not an object: scheduler";
+            return false;
+        }
+        QJsonObject scheduler = configData["scheduler"].toObject();
+        for (const QString &key : {QString("interactiveLimit"), QString("backgroundLimit"), QString("bulkLimit")}) {
+            if (scheduler.contains(key) && scheduler[key].toInt(0) < 1) {
+                qWarning() << "scheduler." + key << "must be >= 1";
+                return false;
+            }
+        }
+        for (const QString &key : {QString("deferBulk"), QString("preemptBulk"), QString("cancelSuperseded")}) {
+            if (scheduler.contains(key) && !scheduler[key].isBool()) {
+                qWarning() << "scheduler." + key << "must be a boolean";
+                return false;
+            }
+        }
+    }
+
+    // 验证持久任务队列配置（可选）
+    if (configData.contains("queue")) {
+        if (!configData["queue"].isObject()) {
+            qWarning() << "Config key is not an object: queue";
+            return false;
+        }
+        QJsonObject queue = configData["queue"].toObject();
+        if (queue.contains("enabled") && !queue["enabled"].isBool()) {
+            qWarning() << "queue.enabled must be a boolean";
+            return false;
+        }
+        if (queue.contains("syncIntervalMs")) {
+            int interval = queue["syncIntervalMs"].toInt(-1);
+            if (interval < 0 || interval > 10000) {
+                qWarning() << "Invalid queue.syncIntervalMs (0-10000):" << interval;
+                return false;
+            }
+        }
+        if (queue.contains("syncBatch") && queue["syncBatch"].toInt(0) < 1) {
+            qWarning() << "queue.syncBatch must be >= 1";
+            return false;
+        }
+        if (queue.contains("healthIntervalMs")) {
+            int interval = queue["healthIntervalMs"].toInt(0);
+            if (interval < 100 || interval > 600000) {
+                qWarning() << "Invalid queue.healthIntervalMs (100-600000):" << interval;
+                return false;
+            }
+        }
+        if (queue.contains("maxRetries")) {
+            int retries = queue["maxRetries"].toInt(-1);
+            if (retries < 0 || retries > 100) {
+                qWarning() << "Invalid queue.maxRetries (0-100):" << retries;
+                return false;
+            }
+        }
+    }
+
     return true;
 }
 
@@ -401,6 +865,16 @@ int ConfigManager::getOllamaTimeout() const
     return get("ollama.timeout", 30).toInt();
 }
 
+QString ConfigManager::getOllamaOutputMode() const
+{
+    return get("ollama.outputMode", "markdown").toString();
+}
+
+QString ConfigManager::getOllamaApi() const
+{
+    return get("ollama.api", "ollama").toString();
+}
+
 QRect ConfigManager::getWindowGeometry() const
 {
     int x = get("ui.windowGeometry.x", 100).toInt();
@@ -461,6 +935,308 @@ int ConfigManager::getRetryDelayMs() const
     return get("advanced.retryDelayMs", 1000).toInt();
 }
 
+bool ConfigManager::isReaskOnInvalidEnabled() const
+{
+    return get("advanced.reaskOnInvalid", true).toBool();
+}
+
+QString ConfigManager::getUploadCodec() const
+{
+    return get("upload.codec", "png").toString();
+}
+
+int ConfigManager::getUploadPngCompression() const
+{
+    return get("upload.pngCompression", -1).toInt();
+}
+
+int ConfigManager::getUploadJpegQuality() const
+{
+    return get("upload.jpegQuality", 90).toInt();
+}
+
+int ConfigManager::getUploadWebpQuality() const
+{
+    return get("upload.webpQuality", 100).toInt();
+}
+
+int ConfigManager::getUploadMaxKB() const
+{
+    return get("upload.maxUploadKB", 1024).toInt();
+}
+
+bool ConfigManager::isUploadAutoWebpAllowed() const
+{
+    return get("upload.autoAllowWebp", false).toBool();
+}
+
+int ConfigManager::getConversionCacheMemoryKB() const
+{
+    return get("cache.conversionMemoryKB", 8192).toInt();
+}
+
+bool ConfigManager::isConversionDiskCacheEnabled() const
+{
+    return get("cache.conversionDiskEnabled", true).toBool();
+}
+
+QStringList ConfigManager::getPrecomputeFormats() const
+{
+    return get("cache.precomputeFormats", QStringList{"omml-html", "docx"}).toStringList();
+}
+
+int ConfigManager::getPrecomputeDebounceMs() const
+{
+    return get("cache.precomputeDebounceMs", 800).toInt();
+}
+
+QString ConfigManager::getGenerationMode() const
+{
+    return get("generation.mode", "auto").toString();
+}
+
+int ConfigManager::getGenerationNumPredict() const
+{
+    return get("generation.numPredict", 0).toInt();
+}
+
+int ConfigManager::getGenerationNumCtx() const
+{
+    return get("generation.numCtx", 0).toInt();
+}
+
+double ConfigManager::getGenerationTemperature() const
+{
+    return get("generation.temperature", 0.0).toDouble();
+}
+
+QStringList ConfigManager::getGenerationStop() const
+{
+    return get("generation.stop", GenerationOptions::defaultStop()).toStringList();
+}
+
+bool ConfigManager::isLayoutSegmentationEnabled() const
+{
+    return get("layout.enabled", true).toBool();
+}
+
+int ConfigManager::getLayoutMinHeight() const
+{
+    return get("layout.minHeight", 240).toInt();
+}
+
+int ConfigManager::getLayoutMinGapPx() const
+{
+    return get("layout.minGapPx", 10).toInt();
+}
+
+int ConfigManager::getLayoutMaxSegments() const
+{
+    return get("layout.maxSegments", 8).toInt();
+}
+
+bool ConfigManager::isTransportKeepAliveEnabled() const
+{
+    return get("transport.keepAlive", true).toBool();
+}
+
+bool ConfigManager::isTransportHttp2Enabled() const
+{
+    return get("transport.http2", true).toBool();
+}
+
+bool ConfigManager::isTlsSessionReuseEnabled() const
+{
+    return get("transport.tlsSessionReuse", true).toBool();
+}
+
+bool ConfigManager::isPreconnectEnabled() const
+{
+    return get("transport.preconnect", true).toBool();
+}
+
+QString ConfigManager::getCaptureBackend() const
+{
+    return get("capture.backend", "auto").toString();
+}
+
+bool ConfigManager::isCaptureSnapEnabled() const
+{
+    return get("capture.snap", true).toBool();
+}
+
+int ConfigManager::getWatchIntervalMs() const
+{
+    return get("watch.intervalMs", 500).toInt();
+}
+
+int ConfigManager::getWatchMaxIntervalMs() const
+{
+    return get("watch.maxIntervalMs", 4000).toInt();
+}
+
+int ConfigManager::getWatchHashThreshold() const
+{
+    return get("watch.hashThreshold", 6).toInt();
+}
+
+double ConfigManager::getWatchChangeFraction() const
+{
+    return get("watch.changeFraction", 0.01).toDouble();
+}
+
+bool ConfigManager::isCascadeEnabled() const
+{
+    return get("cascade.enabled", false).toBool();
+}
+
+QString ConfigManager::getCascadeFastModel() const
+{
+    return get("cascade.fastModel", "qwen2.5vl:3b").toString();
+}
+
+double ConfigManager::getCascadeMinConfidence() const
+{
+    return get("cascade.minConfidence", 0.5).toDouble();
+}
+
+double ConfigManager::getCascadeMaxCharsPerKPixel() const
+{
+    return get("cascade.maxCharsPerKPixel", 24.0).toDouble();
+}
+
+double ConfigManager::getCascadeMinCharsPerKPixel() const
+{
+    return get("cascade.minCharsPerKPixel", 0.02).toDouble();
+}
+
+QString ConfigManager::getLlamaModelPath() const
+{
+    return get("llama.modelPath", "").toString();
+}
+
+QString ConfigManager::getLlamaMmprojPath() const
+{
+    return get("llama.mmprojPath", "").toString();
+}
+
+int ConfigManager::getLlamaThreads() const
+{
+    return get("llama.threads", 0).toInt();
+}
+
+bool ConfigManager::isLlamaMmapEnabled() const
+{
+    return get("llama.mmap", true).toBool();
+}
+
+int ConfigManager::getLlamaContextSize() const
+{
+    return get("llama.contextSize", 4096).toInt();
+}
+
+int ConfigManager::getLlamaGpuLayers() const
+{
+    return get("llama.gpuLayers", 0).toInt();
+}
+
+bool ConfigManager::isTuningEnabled() const
+{
+    return get("tuning.enabled", true).toBool();
+}
+
+int ConfigManager::getTuningNumThread() const
+{
+    return get("tuning.numThread", 0).toInt();
+}
+
+int ConfigManager::getTuningNumBatch() const
+{
+    return get("tuning.numBatch", 0).toInt();
+}
+
+bool ConfigManager::isTuningMmapEnabled() const
+{
+    return get("tuning.useMmap", true).toBool();
+}
+
+bool ConfigManager::isTuningMlockEnabled() const
+{
+    return get("tuning.useMlock", false).toBool();
+}
+
+QJsonObject ConfigManager::getTuningEndpoint(const QString &endpoint) const
+{
+    // 端点键含 "://" 和 ":"，不能用点号路径读取
+    return configData["tuning"].toObject()["endpoints"].toObject()[endpoint].toObject();
+}
+
+void ConfigManager::setTuningEndpoint(const QString &endpoint, const QJsonObject &values)
+{
+    QJsonObject tuning = configData["tuning"].toObject();
+    QJsonObject endpoints = tuning["endpoints"].toObject();
+    endpoints[endpoint] = values;
+    tuning["endpoints"] = endpoints;
+    configData["tuning"] = tuning;
+
+    emit configChanged("tuning.endpoints");
+}
+
+int ConfigManager::getSchedulerInteractiveLimit() const
+{
+    return get("scheduler.interactiveLimit", 2).toInt();
+}
+
+int ConfigManager::getSchedulerBackgroundLimit() const
+{
+    return get("scheduler.backgroundLimit", 1).toInt();
+}
+
+int ConfigManager::getSchedulerBulkLimit() const
+{
+    return get("scheduler.bulkLimit", 2).toInt();
+}
+
+bool ConfigManager::isSchedulerDeferBulkEnabled() const
+{
+    return get("scheduler.deferBulk", true).toBool();
+}
+
+bool ConfigManager::isSchedulerPreemptBulkEnabled() const
+{
+    return get("scheduler.preemptBulk", false).toBool();
+}
+
+bool ConfigManager::isSchedulerCancelSupersededEnabled() const
+{
+    return get("scheduler.cancelSuperseded", true).toBool();
+}
+
+bool ConfigManager::isQueueEnabled() const
+{
+    return get("queue.enabled", true).toBool();
+}
+
+int ConfigManager::getQueueSyncIntervalMs() const
+{
+    return get("queue.syncIntervalMs", 20).toInt();
+}
+
+int ConfigManager::getQueueSyncBatch() const
+{
+    return get("queue.syncBatch", 256).toInt();
+}
+
+int ConfigManager::getQueueHealthIntervalMs() const
+{
+    return get("queue.healthIntervalMs", 5000).toInt();
+}
+
+int ConfigManager::getQueueMaxRetries() const
+{
+    return get("queue.maxRetries", 5).toInt();
+}
+
 QVariant ConfigManager::get(const QString &key, const QVariant &defaultValue) const
 {
     return getValueFromPath(configData, key, defaultValue);
@@ -511,6 +1287,11 @@ void ConfigManager::setAutoRetry(bool enabled)
     set("advanced.autoRetry", enabled);
 }
 
+void ConfigManager::setUploadCodec(const QString &codec)
+{
+    set("upload.codec", codec);
+}
+
 void ConfigManager::set(const QString &key, const QVariant &value)
 {
     QStringList keys = key.split('.');
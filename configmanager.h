@@ -3,6 +3,7 @@
 
 #include <QObject>
 #include <QString>
+#include <QStringList>
 #include <QVariant>
 #include <QRect>
 #include <QJsonObject>
@@ -24,6 +25,8 @@ public:
     QString getOllamaUrl() const;
     QString getOllamaModel() const;
     int getOllamaTimeout() const;
+    QString getOllamaOutputMode() const;
+    QString getOllamaApi() const;
     QRect getWindowGeometry() const;
     QString getWindowState() const;
     QString getTheme() const;
@@ -35,6 +38,65 @@ public:
     bool isAutoRetryEnabled() const;
     int getRetryAttempts() const;
     int getRetryDelayMs() const;
+    bool isReaskOnInvalidEnabled() const;
+    QString getUploadCodec() const;
+    int getUploadPngCompression() const;
+    int getUploadJpegQuality() const;
+    int getUploadWebpQuality() const;
+    int getUploadMaxKB() const;
+    bool isUploadAutoWebpAllowed() const;
+    int getConversionCacheMemoryKB() const;
+    bool isConversionDiskCacheEnabled() const;
+    QStringList getPrecomputeFormats() const;
+    int getPrecomputeDebounceMs() const;
+    QString getGenerationMode() const;
+    int getGenerationNumPredict() const;
+    int getGenerationNumCtx() const;
+    double getGenerationTemperature() const;
+    QStringList getGenerationStop() const;
+    bool isLayoutSegmentationEnabled() const;
+    int getLayoutMinHeight() const;
+    int getLayoutMinGapPx() const;
+    int getLayoutMaxSegments() const;
+    bool isTransportKeepAliveEnabled() const;
+    bool isTransportHttp2Enabled() const;
+    bool isTlsSessionReuseEnabled() const;
+    bool isPreconnectEnabled() const;
+    QString getCaptureBackend() const;
+    bool isCaptureSnapEnabled() const;
+    int getWatchIntervalMs() const;
+    int getWatchMaxIntervalMs() const;
+    int getWatchHashThreshold() const;
+    double getWatchChangeFraction() const;
+    bool isCascadeEnabled() const;
+    QString getCascadeFastModel() const;
+    double getCascadeMinConfidence() const;
+    double getCascadeMaxCharsPerKPixel() const;
+    double getCascadeMinCharsPerKPixel() const;
+    QString getLlamaModelPath() const;
+    QString getLlamaMmprojPath() const;
+    int getLlamaThreads() const;
+    bool isLlamaMmapEnabled() const;
+    int getLlamaContextSize() const;
+    int getLlamaGpuLayers() const;
+    bool isTuningEnabled() const;
+    int getTuningNumThread() const;
+    int getTuningNumBatch() const;
+    bool isTuningMmapEnabled() const;
+    bool isTuningMlockEnabled() const;
+    // 某个端点（RuntimeOptions::endpointKey）的运行参数覆盖值，没有时为空对象
+    QJsonObject getTuningEndpoint(const QString &endpoint) const;
+    int getSchedulerInteractiveLimit() const;
+    int getSchedulerBackgroundLimit() const;
+    int getSchedulerBulkLimit() const;
+    bool isSchedulerDeferBulkEnabled() const;
+    bool isSchedulerPreemptBulkEnabled() const;
+    bool isSchedulerCancelSupersededEnabled() const;
+    bool isQueueEnabled() const;
+    int getQueueSyncIntervalMs() const;
+    int getQueueSyncBatch() const;
+    int getQueueHealthIntervalMs() const;
+    int getQueueMaxRetries() const;
 
     // 通用 get 方法，支持点号路径（如 "ollama.url"）
     QVariant get(const QString &key, const QVariant &defaultValue = QVariant()) const;
@@ -48,6 +110,9 @@ public:
     void setTheme(const QString &theme);
     void setLoggingLevel(const QString &level);
     void setAutoRetry(bool enabled);
+    void setUploadCodec(const QString &codec);
+    // 保存某个端点的运行参数（校准结果），发射 configChanged("tuning.endpoints")
+    void setTuningEndpoint(const QString &endpoint, const QJsonObject &values);
 
     // 通用 set 方法
     void set(const QString &key, const QVariant &value);
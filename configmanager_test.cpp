@@ -49,6 +49,47 @@ private slots:
     // 测试重置到默认值
     void testResetToDefaults();
 
+    // 测试上传编码配置
+    void testUploadSettings();
+
+    // 测试转换缓存配置
+    void testConversionCacheSettings();
+
+    // 测试预转换配置
+    void testPrecomputeSettings();
+
+    // 测试输出模式配置
+    void testOutputModeSettings();
+
+    // 测试推理接口格式配置
+    void testApiSettings();
+
+    // 测试版面分析配置读取与校验
+    void testLayoutSettings();
+
+    // 测试传输层配置读取与校验
+    void testTransportSettings();
+
+    // 测试截图后端配置
+    void testCaptureBackendSettings();
+    void testCaptureSnapSettings();
+
+    // 测试监视区域配置读取与校验
+    void testWatchSettings();
+
+    // 测试分级识别配置读取与校验
+    void testCascadeSettings();
+
+    // 测试进程内推理配置读取与校验
+    void testLlamaSettings();
+
+    // 测试运行参数及按端点覆盖
+    void testTuningSettings();
+
+    // 测试识别调度配置读取与校验
+    void testSchedulerSettings();
+    void testQueueSettings();
+
 private:
     QString originalConfigPath;
     QTemporaryDir tempDir;
@@ -343,5 +384,368 @@ void ConfigManagerTest::testResetToDefaults()
     QCOMPARE(config.getTheme(), QString("dark"));
 }
 
+void ConfigManagerTest::testUploadSettings()
+{
+    ConfigManager &config = ConfigManager::instance();
+
+    // 默认值
+    QCOMPARE(config.getUploadCodec(), QString("png"));
+    QCOMPARE(config.getUploadPngCompression(), -1);
+    QCOMPARE(config.getUploadJpegQuality(), 90);
+    QCOMPARE(config.isUploadAutoWebpAllowed(), false);
+
+    // 合法的编码值
+    config.setUploadCodec("auto");
+    QCOMPARE(config.getUploadCodec(), QString("auto"));
+    QVERIFY(config.validateConfig());
+
+    // 非法的编码值应导致验证失败
+    config.setUploadCodec("bmp");
+    QVERIFY(!config.validateConfig());
+    config.setUploadCodec("png");
+
+    // zlib 压缩级别为 0-9，-1 为默认级别
+    config.set("upload.pngCompression", -1);
+    QVERIFY(config.validateConfig());
+    config.set("upload.pngCompression", -2);
+    QVERIFY(!config.validateConfig());
+    config.set("upload.pngCompression", 10);
+    QVERIFY(!config.validateConfig());
+    config.set("upload.pngCompression", -1);
+
+    // JPEG 质量 1-100，0 为按 maxUploadKB 自动选择
+    config.set("upload.jpegQuality", 0);
+    QVERIFY(config.validateConfig());
+    config.set("upload.jpegQuality", 100);
+    QVERIFY(config.validateConfig());
+    config.set("upload.jpegQuality", -1);
+    QVERIFY(!config.validateConfig());
+    config.set("upload.jpegQuality", 101);
+    QVERIFY(!config.validateConfig());
+    config.set("upload.jpegQuality", 90);
+
+    // WebP 质量 0-100
+    config.set("upload.webpQuality", 0);
+    QVERIFY(config.validateConfig());
+    config.set("upload.webpQuality", -1);
+    QVERIFY(!config.validateConfig());
+    config.set("upload.webpQuality", 101);
+    QVERIFY(!config.validateConfig());
+    config.set("upload.webpQuality", 100);
+
+    // 目标大小必须为正
+    config.set("upload.maxUploadKB", 0);
+    QVERIFY(!config.validateConfig());
+    config.set("upload.maxUploadKB", -5);
+    QVERIFY(!config.validateConfig());
+    config.set("upload.maxUploadKB", 1024);
+    QVERIFY(config.validateConfig());
+}
+
+void ConfigManagerTest::testConversionCacheSettings()
+{
+    ConfigManager &config = ConfigManager::instance();
+
+    // 默认值
+    QCOMPARE(config.getConversionCacheMemoryKB(), 8192);
+    QCOMPARE(config.isConversionDiskCacheEnabled(), true);
+
+    config.set("cache.conversionMemoryKB", 0);
+    QCOMPARE(config.getConversionCacheMemoryKB(), 0);
+    QVERIFY(config.validateConfig());
+
+    // 负数应导致验证失败
+    config.set("cache.conversionMemoryKB", -1);
+    QVERIFY(!config.validateConfig());
+}
+
+void ConfigManagerTest::testPrecomputeSettings()
+{
+    ConfigManager &config = ConfigManager::instance();
+
+    // 默认预转换复制和导出两种格式
+    QCOMPARE(config.getPrecomputeFormats(), QStringList({"omml-html", "docx"}));
+    QCOMPARE(config.getPrecomputeDebounceMs(), 800);
+
+    config.set("cache.precomputeFormats", QStringList{"docx"});
+    QCOMPARE(config.getPrecomputeFormats(), QStringList{"docx"});
+    QVERIFY(config.validateConfig());
+
+    // 空数组关闭预转换
+    config.set("cache.precomputeFormats", QStringList());
+    QVERIFY(config.getPrecomputeFormats().isEmpty());
+    QVERIFY(config.validateConfig());
+
+    // 未知格式应导致验证失败
+    config.set("cache.precomputeFormats", QStringList{"mathml"});
+    QVERIFY(!config.validateConfig());
+
+    config.resetToDefaults();
+    config.set("cache.precomputeDebounceMs", -1);
+    QVERIFY(!config.validateConfig());
+}
+
+void ConfigManagerTest::testOutputModeSettings()
+{
+    ConfigManager &config = ConfigManager::instance();
+
+    QCOMPARE(config.getOllamaOutputMode(), QString("markdown"));
+
+    config.set("ollama.outputMode", "json");
+    QCOMPARE(config.getOllamaOutputMode(), QString("json"));
+    QVERIFY(config.validateConfig());
+
+    config.set("ollama.outputMode", "xml");
+    QVERIFY(!config.validateConfig());
+}
+
+void ConfigManagerTest::testApiSettings()
+{
+    ConfigManager &config = ConfigManager::instance();
+
+    QCOMPARE(config.getOllamaApi(), QString("ollama"));
+
+    config.set("ollama.api", "openai");
+    QCOMPARE(config.getOllamaApi(), QString("openai"));
+    QVERIFY(config.validateConfig());
+
+    config.set("ollama.api", "grpc");
+    QVERIFY(!config.validateConfig());
+}
+
+void ConfigManagerTest::testLayoutSettings()
+{
+    ConfigManager &config = ConfigManager::instance();
+
+    QVERIFY(config.isLayoutSegmentationEnabled());
+    QCOMPARE(config.getLayoutMinHeight(), 240);
+    QCOMPARE(config.getLayoutMinGapPx(), 10);
+    QCOMPARE(config.getLayoutMaxSegments(), 8);
+
+    config.set("layout.enabled", false);
+    config.set("layout.maxSegments", 4);
+    QVERIFY(!config.isLayoutSegmentationEnabled());
+    QCOMPARE(config.getLayoutMaxSegments(), 4);
+    QVERIFY(config.validateConfig());
+
+    config.set("layout.maxSegments", 0);
+    QVERIFY(!config.validateConfig());
+    config.set("layout.maxSegments", 8);
+    config.set("layout.minGapPx", 0);
+    QVERIFY(!config.validateConfig());
+}
+
+void ConfigManagerTest::testTransportSettings()
+{
+    ConfigManager &config = ConfigManager::instance();
+
+    QVERIFY(config.isTransportKeepAliveEnabled());
+    QVERIFY(config.isTransportHttp2Enabled());
+    QVERIFY(config.isTlsSessionReuseEnabled());
+    QVERIFY(config.isPreconnectEnabled());
+
+    config.set("transport.http2", false);
+    QVERIFY(!config.isTransportHttp2Enabled());
+    QVERIFY(config.validateConfig());
+
+    config.set("transport.keepAlive", "yes");
+    QVERIFY(!config.validateConfig());
+}
+
+void ConfigManagerTest::testCaptureBackendSettings()
+{
+    ConfigManager &config = ConfigManager::instance();
+
+    QCOMPARE(config.getCaptureBackend(), QString("auto"));
+
+    config.set("capture.backend", "xcb-shm");
+    QCOMPARE(config.getCaptureBackend(), QString("xcb-shm"));
+    QVERIFY(config.validateConfig());
+
+    config.set("capture.backend", "gdi");
+    QVERIFY(!config.validateConfig());
+}
+
+void ConfigManagerTest::testCaptureSnapSettings()
+{
+    ConfigManager &config = ConfigManager::instance();
+
+    QVERIFY(config.isCaptureSnapEnabled());
+
+    config.set("capture.snap", false);
+    QVERIFY(!config.isCaptureSnapEnabled());
+    QVERIFY(config.validateConfig());
+
+    config.set("capture.snap", "on");
+    QVERIFY(!config.validateConfig());
+}
+
+void ConfigManagerTest::testWatchSettings()
+{
+    ConfigManager &config = ConfigManager::instance();
+
+    QCOMPARE(config.getWatchIntervalMs(), 500);
+    QCOMPARE(config.getWatchMaxIntervalMs(), 4000);
+    QCOMPARE(config.getWatchHashThreshold(), 6);
+    QCOMPARE(config.getWatchChangeFraction(), 0.01);
+
+    config.set("watch.intervalMs", 1000);
+    QCOMPARE(config.getWatchIntervalMs(), 1000);
+    QVERIFY(config.validateConfig());
+
+    // 最长间隔不能小于基础间隔
+    config.set("watch.maxIntervalMs", 800);
+    QVERIFY(!config.validateConfig());
+    config.set("watch.maxIntervalMs", 4000);
+    config.set("watch.changeFraction", 0);
+    QVERIFY(!config.validateConfig());
+}
+
+void ConfigManagerTest::testCascadeSettings()
+{
+    ConfigManager &config = ConfigManager::instance();
+
+    QVERIFY(!config.isCascadeEnabled());
+    QCOMPARE(config.getCascadeFastModel(), QString("qwen2.5vl:3b"));
+    QCOMPARE(config.getCascadeMinConfidence(), 0.5);
+    QCOMPARE(config.getCascadeMaxCharsPerKPixel(), 24.0);
+
+    config.set("cascade.enabled", true);
+    config.set("cascade.fastModel", "llava-phi3");
+    QVERIFY(config.isCascadeEnabled());
+    QCOMPARE(config.getCascadeFastModel(), QString("llava-phi3"));
+    QVERIFY(config.validateConfig());
+
+    // 启用时必须指定小模型
+    config.set("cascade.fastModel", "");
+    QVERIFY(!config.validateConfig());
+    config.set("cascade.fastModel", "llava-phi3");
+    config.set("cascade.minConfidence", 1.5);
+    QVERIFY(!config.validateConfig());
+}
+
+void ConfigManagerTest::testLlamaSettings()
+{
+    ConfigManager &config = ConfigManager::instance();
+
+    QCOMPARE(config.getLlamaModelPath(), QString(""));
+    QCOMPARE(config.getLlamaThreads(), 0);
+    QVERIFY(config.isLlamaMmapEnabled());
+    QCOMPARE(config.getLlamaContextSize(), 4096);
+    QCOMPARE(config.getLlamaGpuLayers(), 0);
+
+    // 使用进程内推理时必须指定模型和投影文件
+    config.set("ollama.api", "llama");
+    QVERIFY(!config.validateConfig());
+    config.set("llama.modelPath", "/models/qwen2.5-vl-7b-q4_k_m.gguf");
+    config.set("llama.mmprojPath", "/models/mmproj-qwen2.5-vl-7b-f16.gguf");
+    config.set("llama.threads", 8);
+    config.set("llama.mmap", false);
+    QCOMPARE(config.getLlamaModelPath(), QString("/models/qwen2.5-vl-7b-q4_k_m.gguf"));
+    QCOMPARE(config.getLlamaThreads(), 8);
+    QVERIFY(!config.isLlamaMmapEnabled());
+    QVERIFY(config.validateConfig());
+
+    config.set("llama.contextSize", 256);
+    QVERIFY(!config.validateConfig());
+    config.set("llama.contextSize", 8192);
+    config.set("llama.threads", -1);
+    QVERIFY(!config.validateConfig());
+}
+
+void ConfigManagerTest::testTuningSettings()
+{
+    ConfigManager &config = ConfigManager::instance();
+
+    QVERIFY(config.isTuningEnabled());
+    QCOMPARE(config.getTuningNumThread(), 0);
+    QCOMPARE(config.getTuningNumBatch(), 0);
+    QVERIFY(config.isTuningMmapEnabled());
+    QVERIFY(!config.isTuningMlockEnabled());
+    QVERIFY(config.getTuningEndpoint("http://localhost:11434").isEmpty());
+
+    QSignalSpy spy(&config, &ConfigManager::configChanged);
+    QJsonObject calibrated;
+    calibrated["numThread"] = 12;
+    calibrated["numBatch"] = 1024;
+    config.setTuningEndpoint("http://gpu-box:11434", calibrated);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.takeFirst().at(0).toString(), QString("tuning.endpoints"));
+    QCOMPARE(config.getTuningEndpoint("http://gpu-box:11434")["numThread"].toInt(), 12);
+    QVERIFY(config.getTuningEndpoint("http://localhost:11434").isEmpty());
+    QVERIFY(config.validateConfig());
+
+    config.set("tuning.numBatch", -1);
+    QVERIFY(!config.validateConfig());
+    config.set("tuning.numBatch", 0);
+    calibrated["useMlock"] = "yes";
+    config.setTuningEndpoint("http://gpu-box:11434", calibrated);
+    QVERIFY(!config.validateConfig());
+}
+
+void ConfigManagerTest::testSchedulerSettings()
+{
+    ConfigManager &config = ConfigManager::instance();
+
+    QCOMPARE(config.getSchedulerInteractiveLimit(), 2);
+    QCOMPARE(config.getSchedulerBackgroundLimit(), 1);
+    QCOMPARE(config.getSchedulerBulkLimit(), 2);
+    QVERIFY(config.isSchedulerDeferBulkEnabled());
+    QVERIFY(!config.isSchedulerPreemptBulkEnabled());
+    QVERIFY(config.isSchedulerCancelSupersededEnabled());
+
+    config.set("scheduler.bulkLimit", 4);
+    config.set("scheduler.deferBulk", false);
+    QCOMPARE(config.getSchedulerBulkLimit(), 4);
+    QVERIFY(!config.isSchedulerDeferBulkEnabled());
+    QVERIFY(config.validateConfig());
+
+    // 上限为 0 时该优先级的任务永远不会发出
+    config.set("scheduler.interactiveLimit", 0);
+    QVERIFY(!config.validateConfig());
+    config.set("scheduler.interactiveLimit", 2);
+    config.set("scheduler.deferBulk", "no");
+    QVERIFY(!config.validateConfig());
+    config.set("scheduler.deferBulk", true);
+    config.set("scheduler.cancelSuperseded", 1);
+    QVERIFY(!config.validateConfig());
+}
+
+void ConfigManagerTest::testQueueSettings()
+{
+    ConfigManager &config = ConfigManager::instance();
+
+    QVERIFY(config.isQueueEnabled());
+    QCOMPARE(config.getQueueSyncIntervalMs(), 20);
+    QCOMPARE(config.getQueueSyncBatch(), 256);
+    QCOMPARE(config.getQueueHealthIntervalMs(), 5000);
+    QCOMPARE(config.getQueueMaxRetries(), 5);
+
+    // 0 表示每条记录立即 fsync
+    config.set("queue.syncIntervalMs", 0);
+    config.set("queue.enabled", false);
+    QCOMPARE(config.getQueueSyncIntervalMs(), 0);
+    QVERIFY(!config.isQueueEnabled());
+    QVERIFY(config.validateConfig());
+
+    config.set("queue.syncBatch", 0);
+    QVERIFY(!config.validateConfig());
+    config.set("queue.syncBatch", 256);
+    config.set("queue.healthIntervalMs", 10);
+    QVERIFY(!config.validateConfig());
+    config.set("queue.healthIntervalMs", 5000);
+    config.set("queue.enabled", "yes");
+    QVERIFY(!config.validateConfig());
+    config.set("queue.enabled", true);
+    // 0 表示不推迟，连接失败时直接报错
+    config.set("queue.maxRetries", 0);
+    QVERIFY(config.validateConfig());
+    config.set("queue.maxRetries", -1);
+    QVERIFY(!config.validateConfig());
+    config.set("queue.maxRetries", 5);
+    config.set("queue.syncIntervalMs", 20);
+    QVERIFY(config.validateConfig());
+}
+
 QTEST_MAIN(ConfigManagerTest)
 #include "configmanager_test.moc"
@@ -0,0 +1,227 @@
+#include "conversioncache.h"
+#include "docxwriter.h"
+#include "latextoomml.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QtConcurrent>
+#include <QDebug>
+
+const char *ConversionCache::ClipboardHtmlFormat = "omml-html";
+const char *ConversionCache::DocxFormat = "docx";
+
+ConversionCache::ConversionCache(QObject *parent)
+    : QObject(parent), memory(8192), diskWrites(0)
+{
+}
+
+ConversionCache::~ConversionCache()
+{
+    waitForPrecompute();
+}
+
+void ConversionCache::setMemoryLimitKB(int kilobytes)
+{
+    QMutexLocker locker(&mutex);
+    memory.setMaxCost(qMax(0, kilobytes));
+}
+
+void ConversionCache::setDiskCacheDir(const QString &dir)
+{
+    {
+        QMutexLocker locker(&mutex);
+        diskDir = dir;
+    }
+    if (!dir.isEmpty()) {
+        QDir().mkpath(dir);
+        pruneDisk(dir);
+    }
+}
+
+QString ConversionCache::diskCacheDir() const
+{
+    QMutexLocker locker(&mutex);
+    return diskDir;
+}
+
+QString ConversionCache::converterVersion(const QString &format)
+{
+    if (format == QLatin1String(DocxFormat)) {
+        return QString("docx%1-omml%2").arg(DocxWriter::Version).arg(LatexToOmml::Version);
+    }
+    return QString("omml%1").arg(LatexToOmml::Version);
+}
+
+QByteArray ConversionCache::cacheKey(const QString &source, const QString &format)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(format.toUtf8());
+    hash.addData("\n", 1);
+    hash.addData(converterVersion(format).toUtf8());
+    hash.addData("\n", 1);
+    hash.addData(source.toUtf8());
+    return hash.result().toHex();
+}
+
+QByteArray ConversionCache::convert(const QString &source, const QString &format)
+{
+    if (format == QLatin1String(ClipboardHtmlFormat)) {
+        return LatexToOmml::clipboardHtml(source).toUtf8();
+    }
+    if (format == QLatin1String(DocxFormat)) {
+        return DocxWriter::build(source);
+    }
+    qWarning() << "ConversionCache: unknown format" << format;
+    return QByteArray();
+}
+
+QByteArray ConversionCache::get(const QString &source, const QString &format)
+{
+    const QByteArray key = cacheKey(source, format);
+    QFuture<QByteArray> future;
+    bool inProgress = false;
+    QString dir;
+    {
+        QMutexLocker locker(&mutex);
+        if (QByteArray *cached = memory.object(key)) {
+            counters.memoryHits++;
+            return *cached;
+        }
+        inProgress = pending.contains(key);
+        if (inProgress) {
+            future = pending.value(key);
+        }
+        dir = diskDir;
+    }
+
+    // 后台正在转换同一内容：等它完成，不重复计算
+    if (inProgress) {
+        const QByteArray data = future.result();
+        QMutexLocker locker(&mutex);
+        counters.memoryHits++;
+        return data;
+    }
+
+    QByteArray data;
+    if (readDisk(dir, key, &data)) {
+        QMutexLocker locker(&mutex);
+        counters.diskHits++;
+        insertMemory(key, data);
+        return data;
+    }
+
+    data = convert(source, format);
+    writeDisk(dir, key, data);
+    QMutexLocker locker(&mutex);
+    counters.misses++;
+    insertMemory(key, data);
+    return data;
+}
+
+void ConversionCache::precompute(const QString &source, const QStringList &formats)
+{
+    if (source.trimmed().isEmpty()) {
+        return;
+    }
+
+    QMutexLocker locker(&mutex);
+    const QString dir = diskDir;
+    for (const QString &format : formats) {
+        const QByteArray key = cacheKey(source, format);
+        if (memory.contains(key) || pending.contains(key)) {
+            continue;
+        }
+        // 持有锁期间登记任务，保证任务完成时的 pending.remove 发生在 insert 之后
+        pending.insert(key, QtConcurrent::run([this, key, source, format, dir]() {
+            QByteArray data;
+            if (!readDisk(dir, key, &data)) {
+                data = convert(source, format);
+                writeDisk(dir, key, data);
+            }
+            QMutexLocker workerLocker(&mutex);
+            insertMemory(key, data);
+            pending.remove(key);
+            counters.precomputed++;
+            return data;
+        }));
+    }
+}
+
+void ConversionCache::waitForPrecompute()
+{
+    QList<QFuture<QByteArray>> futures;
+    {
+        QMutexLocker locker(&mutex);
+        futures = pending.values();
+    }
+    for (QFuture<QByteArray> &future : futures) {
+        future.waitForFinished();
+    }
+}
+
+void ConversionCache::clearMemory()
+{
+    QMutexLocker locker(&mutex);
+    memory.clear();
+}
+
+ConversionCache::Stats ConversionCache::stats() const
+{
+    QMutexLocker locker(&mutex);
+    return counters;
+}
+
+void ConversionCache::insertMemory(const QByteArray &key, const QByteArray &data)
+{
+    if (data.isEmpty()) {
+        return;
+    }
+    memory.insert(key, new QByteArray(data), qMax(1, data.size() / 1024));
+}
+
+bool ConversionCache::readDisk(const QString &dir, const QByteArray &key, QByteArray *data) const
+{
+    if (dir.isEmpty()) {
+        return false;
+    }
+    QFile file(QDir(dir).filePath(QString::fromLatin1(key)));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    *data = file.readAll();
+    return !data->isEmpty();
+}
+
+void ConversionCache::writeDisk(const QString &dir, const QByteArray &key, const QByteArray &data) const
+{
+    if (dir.isEmpty() || data.isEmpty()) {
+        return;
+    }
+    QSaveFile file(QDir(dir).filePath(QString::fromLatin1(key)));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "ConversionCache: cannot write" << file.fileName() << file.errorString();
+        return;
+    }
+    file.write(data);
+    if (!file.commit()) {
+        qWarning() << "ConversionCache: cannot write" << file.fileName() << file.errorString();
+        return;
+    }
+    // 只由达到间隔的那个线程清理，避免多个后台任务同时遍历目录
+    if (diskWrites.fetchAndAddRelaxed(1) + 1 >= PruneInterval) {
+        diskWrites.storeRelaxed(0);
+        pruneDisk(dir);
+    }
+}
+
+void ConversionCache::pruneDisk(const QString &dir) const
+{
+    QDir cacheDir(dir);
+    const QFileInfoList files = cacheDir.entryInfoList(QDir::Files, QDir::Time);
+    // 按修改时间从新到旧排列，删除超出上限的旧条目
+    for (int i = MaxDiskEntries; i < files.size(); ++i) {
+        QFile::remove(files.at(i).absoluteFilePath());
+    }
+}
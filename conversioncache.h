@@ -0,0 +1,78 @@
+#ifndef CONVERSIONCACHE_H
+#define CONVERSIONCACHE_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QCache>
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+// 转换结果缓存：键为 SHA-256(源文本) + 目标格式 + 转换器版本。
+// 内存层按最近最少使用淘汰，可选的磁盘层在重启后仍然有效。
+// 识别完成后在后台线程预先转换，复制/导出时直接取结果。
+class ConversionCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 目标格式
+    static const char *ClipboardHtmlFormat;  // 含 OMML 的剪贴板 HTML
+    static const char *DocxFormat;           // 完整的 .docx 文件
+
+    // 磁盘层最多保留的条目数，超出时删除最旧的
+    static const int MaxDiskEntries = 500;
+    // 每写入这么多条目检查一次磁盘层上限
+    static const int PruneInterval = 50;
+
+    struct Stats
+    {
+        int memoryHits = 0;
+        int diskHits = 0;
+        int misses = 0;
+        int precomputed = 0;
+    };
+
+    explicit ConversionCache(QObject *parent = nullptr);
+    ~ConversionCache();
+
+    void setMemoryLimitKB(int kilobytes);
+    // 空字符串关闭磁盘层
+    void setDiskCacheDir(const QString &dir);
+    QString diskCacheDir() const;
+
+    // 依次查内存、后台任务、磁盘，都未命中时同步转换并写入缓存
+    QByteArray get(const QString &source, const QString &format);
+
+    // 在后台线程转换尚未缓存的格式
+    void precompute(const QString &source, const QStringList &formats);
+
+    // 等待所有后台转换完成
+    void waitForPrecompute();
+
+    // 只清空内存层
+    void clearMemory();
+    Stats stats() const;
+
+    static QByteArray cacheKey(const QString &source, const QString &format);
+    static QString converterVersion(const QString &format);
+    static QByteArray convert(const QString &source, const QString &format);
+
+private:
+    bool readDisk(const QString &dir, const QByteArray &key, QByteArray *data) const;
+    void writeDisk(const QString &dir, const QByteArray &key, const QByteArray &data) const;
+    void pruneDisk(const QString &dir) const;
+    void insertMemory(const QByteArray &key, const QByteArray &data);
+
+    mutable QMutex mutex;
+    QCache<QByteArray, QByteArray> memory;   // 代价以 KB 计
+    QHash<QByteArray, QFuture<QByteArray>> pending;
+    QString diskDir;
+    Stats counters;
+    mutable QAtomicInt diskWrites;   // 上次清理之后的写入次数，后台线程也会写盘
+};
+
+#endif // CONVERSIONCACHE_H
@@ -0,0 +1,142 @@
+#include <QTest>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+#include "conversioncache.h"
+
+class ConversionCacheTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // 测试缓存键
+    void testCacheKey();
+
+    // 测试内存层命中
+    void testMemoryHit();
+
+    // 测试磁盘层在新实例中命中
+    void testDiskHit();
+
+    // 测试运行期间写盘也会清理超出上限的条目
+    void testDiskPrune();
+
+    // 测试后台预先转换
+    void testPrecompute();
+
+    // 测试内存上限
+    void testMemoryLimit();
+
+private:
+    const QString sample = "$$\\sum_{k=1}^{n} k = \\frac{n(n+1)}{2}$$";
+};
+
+void ConversionCacheTest::testCacheKey()
+{
+    const QByteArray key = ConversionCache::cacheKey(sample, ConversionCache::DocxFormat);
+    QCOMPARE(key.size(), 64);
+    QCOMPARE(key, ConversionCache::cacheKey(sample, ConversionCache::DocxFormat));
+
+    // 格式或内容不同，键不同
+    QVERIFY(key != ConversionCache::cacheKey(sample, ConversionCache::ClipboardHtmlFormat));
+    QVERIFY(key != ConversionCache::cacheKey(sample + " ", ConversionCache::DocxFormat));
+
+    // DOCX 的版本同时包含公式转换器的版本
+    QVERIFY(ConversionCache::converterVersion(ConversionCache::DocxFormat).contains("omml"));
+}
+
+void ConversionCacheTest::testMemoryHit()
+{
+    ConversionCache cache;
+    const QByteArray first = cache.get(sample, ConversionCache::ClipboardHtmlFormat);
+    QVERIFY(first.contains("msEquation"));
+    QCOMPARE(cache.stats().misses, 1);
+
+    const QByteArray second = cache.get(sample, ConversionCache::ClipboardHtmlFormat);
+    QCOMPARE(second, first);
+    QCOMPARE(cache.stats().memoryHits, 1);
+    QCOMPARE(cache.stats().misses, 1);
+}
+
+void ConversionCacheTest::testDiskHit()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QByteArray docx;
+    {
+        ConversionCache cache;
+        cache.setDiskCacheDir(dir.path());
+        docx = cache.get(sample, ConversionCache::DocxFormat);
+        QVERIFY(docx.startsWith("PK"));
+    }
+    QCOMPARE(QDir(dir.path()).entryList(QDir::Files).size(), 1);
+
+    // 新实例（相当于重启后）从磁盘读取
+    ConversionCache cache;
+    cache.setDiskCacheDir(dir.path());
+    QCOMPARE(cache.get(sample, ConversionCache::DocxFormat), docx);
+    QCOMPARE(cache.stats().diskHits, 1);
+    QCOMPARE(cache.stats().misses, 0);
+}
+
+void ConversionCacheTest::testDiskPrune()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    ConversionCache cache;
+    cache.setDiskCacheDir(dir.path());
+    // 目录已满（比如另一个实例写入的旧条目）
+    for (int i = 0; i < ConversionCache::MaxDiskEntries; ++i) {
+        QFile file(QDir(dir.path()).filePath(QString("stale%1").arg(i)));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write("x");
+    }
+
+    for (int i = 0; i < ConversionCache::PruneInterval; ++i) {
+        cache.get(QString("$x^{%1}$").arg(i), ConversionCache::ClipboardHtmlFormat);
+    }
+    QCOMPARE(QDir(dir.path()).entryList(QDir::Files).size(), ConversionCache::MaxDiskEntries);
+}
+
+void ConversionCacheTest::testPrecompute()
+{
+    ConversionCache cache;
+    cache.precompute(sample, QStringList() << ConversionCache::ClipboardHtmlFormat
+                                           << ConversionCache::DocxFormat);
+    // 重复的预计算请求不会产生新的任务
+    cache.precompute(sample, QStringList() << ConversionCache::DocxFormat);
+    cache.waitForPrecompute();
+    QCOMPARE(cache.stats().precomputed, 2);
+
+    QElapsedTimer timer;
+    timer.start();
+    cache.get(sample, ConversionCache::ClipboardHtmlFormat);
+    cache.get(sample, ConversionCache::DocxFormat);
+    qDebug() << "cached lookups took" << timer.nsecsElapsed() / 1000 << "us";
+
+    QCOMPARE(cache.stats().memoryHits, 2);
+    QCOMPARE(cache.stats().misses, 0);
+
+    // 转换进行中时 get 等待后台结果而不是重复转换
+    const QString other = sample + "\n$x^2$";
+    cache.precompute(other, QStringList() << ConversionCache::DocxFormat);
+    QVERIFY(cache.get(other, ConversionCache::DocxFormat).startsWith("PK"));
+    QCOMPARE(cache.stats().misses, 0);
+}
+
+void ConversionCacheTest::testMemoryLimit()
+{
+    ConversionCache cache;
+    cache.setMemoryLimitKB(0);
+    cache.get(sample, ConversionCache::ClipboardHtmlFormat);
+    cache.get(sample, ConversionCache::ClipboardHtmlFormat);
+    // 内存层关闭，且没有磁盘层，每次都重新转换
+    QCOMPARE(cache.stats().memoryHits, 0);
+    QCOMPARE(cache.stats().misses, 2);
+}
+
+QTEST_MAIN(ConversionCacheTest)
+#include "conversioncache_test.moc"
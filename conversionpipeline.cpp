@@ -0,0 +1,80 @@
+#include "conversionpipeline.h"
+#include "conversioncache.h"
+
+ConversionPipeline::ConversionPipeline(ConversionCache *cache, QObject *parent)
+    : QObject(parent), cache(cache)
+{
+    formatList << ConversionCache::ClipboardHtmlFormat << ConversionCache::DocxFormat;
+    debounceTimer.setSingleShot(true);
+    debounceTimer.setInterval(800);
+    connect(&debounceTimer, &QTimer::timeout, this, &ConversionPipeline::onDebounceTimeout);
+}
+
+void ConversionPipeline::setFormats(const QStringList &formats)
+{
+    formatList = formats;
+}
+
+QStringList ConversionPipeline::formats() const
+{
+    return formatList;
+}
+
+void ConversionPipeline::setDebounceMs(int milliseconds)
+{
+    debounceTimer.setInterval(qMax(0, milliseconds));
+}
+
+int ConversionPipeline::debounceMs() const
+{
+    return debounceTimer.interval();
+}
+
+void ConversionPipeline::submit(const QString &source)
+{
+    debounceTimer.stop();
+    pendingSource.clear();
+    start(source);
+}
+
+void ConversionPipeline::sourceEdited(const QString &source)
+{
+    // setPlainText 之后的 textChanged 也会走到这里，内容没变就不必再转换
+    if (source == lastSource) {
+        debounceTimer.stop();
+        pendingSource.clear();
+        return;
+    }
+    pendingSource = source;
+    debounceTimer.start();
+}
+
+void ConversionPipeline::flush()
+{
+    if (debounceTimer.isActive()) {
+        debounceTimer.stop();
+        onDebounceTimeout();
+    }
+}
+
+bool ConversionPipeline::hasPendingEdit() const
+{
+    return debounceTimer.isActive();
+}
+
+void ConversionPipeline::onDebounceTimeout()
+{
+    const QString source = pendingSource;
+    pendingSource.clear();
+    start(source);
+}
+
+void ConversionPipeline::start(const QString &source)
+{
+    lastSource = source;
+    if (formatList.isEmpty() || source.trimmed().isEmpty()) {
+        return;
+    }
+    cache->precompute(source, formatList);
+    emit conversionsScheduled(source, formatList);
+}
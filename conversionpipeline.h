@@ -0,0 +1,55 @@
+#ifndef CONVERSIONPIPELINE_H
+#define CONVERSIONPIPELINE_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+class ConversionCache;
+
+// 识别之后的预转换阶段：结果一确定就在后台生成剪贴板和导出所需的内容，
+// 用户编辑结果时等输入停顿后再转换，复制/导出时从缓存直接取用。
+class ConversionPipeline : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ConversionPipeline(ConversionCache *cache, QObject *parent = nullptr);
+
+    // 需要预先转换的格式（ConversionCache 的格式名），为空时不做预转换
+    void setFormats(const QStringList &formats);
+    QStringList formats() const;
+
+    // 编辑停顿多久后开始转换
+    void setDebounceMs(int milliseconds);
+    int debounceMs() const;
+
+    // 新的识别结果或历史记录：立即开始转换，并取消尚未执行的编辑转换
+    void submit(const QString &source);
+
+    // 结果被编辑：重新计时，停顿 debounceMs 后转换
+    void sourceEdited(const QString &source);
+
+    // 立即执行等待中的编辑转换
+    void flush();
+    bool hasPendingEdit() const;
+
+signals:
+    // 已把 source 的转换交给后台线程
+    void conversionsScheduled(const QString &source, const QStringList &formats);
+
+private slots:
+    void onDebounceTimeout();
+
+private:
+    void start(const QString &source);
+
+    ConversionCache *cache;
+    QTimer debounceTimer;
+    QStringList formatList;
+    QString pendingSource;   // 等待停顿的编辑内容
+    QString lastSource;      // 最近一次交给后台的内容
+};
+
+#endif // CONVERSIONPIPELINE_H
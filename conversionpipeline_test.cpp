@@ -0,0 +1,114 @@
+#include <QTest>
+#include <QSignalSpy>
+#include "conversionpipeline.h"
+#include "conversioncache.h"
+
+class ConversionPipelineTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // 测试提交后立即预转换，复制/导出不再转换
+    void testSubmitPrecomputes();
+
+    // 测试连续编辑只在停顿后转换一次
+    void testEditDebounce();
+
+    // 测试内容未变的编辑不触发转换
+    void testUnchangedEditIgnored();
+
+    // 测试 flush 立即执行等待中的编辑
+    void testFlush();
+
+    // 测试格式列表为空时不转换
+    void testNoFormats();
+
+private:
+    const QString sample = "$$\\int_0^1 x^2 \\, dx = \\frac{1}{3}$$";
+};
+
+void ConversionPipelineTest::testSubmitPrecomputes()
+{
+    ConversionCache cache;
+    ConversionPipeline pipeline(&cache);
+    QSignalSpy spy(&pipeline, &ConversionPipeline::conversionsScheduled);
+
+    pipeline.submit(sample);
+    QCOMPARE(spy.count(), 1);
+    cache.waitForPrecompute();
+    QCOMPARE(cache.stats().precomputed, 2);
+
+    cache.get(sample, ConversionCache::ClipboardHtmlFormat);
+    cache.get(sample, ConversionCache::DocxFormat);
+    QCOMPARE(cache.stats().misses, 0);
+}
+
+void ConversionPipelineTest::testEditDebounce()
+{
+    ConversionCache cache;
+    ConversionPipeline pipeline(&cache);
+    pipeline.setDebounceMs(50);
+    QSignalSpy spy(&pipeline, &ConversionPipeline::conversionsScheduled);
+
+    // 模拟逐字输入
+    QString typed;
+    for (const QChar &c : sample) {
+        typed += c;
+        pipeline.sourceEdited(typed);
+    }
+    QVERIFY(pipeline.hasPendingEdit());
+    QCOMPARE(spy.count(), 0);
+
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(0).toString(), sample);
+    cache.waitForPrecompute();
+    QCOMPARE(cache.stats().precomputed, 2);
+}
+
+void ConversionPipelineTest::testUnchangedEditIgnored()
+{
+    ConversionCache cache;
+    ConversionPipeline pipeline(&cache);
+    pipeline.setDebounceMs(0);
+    QSignalSpy spy(&pipeline, &ConversionPipeline::conversionsScheduled);
+
+    pipeline.submit(sample);
+    // setPlainText 引起的 textChanged 带着相同的内容
+    pipeline.sourceEdited(sample);
+    QVERIFY(!pipeline.hasPendingEdit());
+    QTest::qWait(20);
+    QCOMPARE(spy.count(), 1);
+}
+
+void ConversionPipelineTest::testFlush()
+{
+    ConversionCache cache;
+    ConversionPipeline pipeline(&cache);
+    pipeline.setDebounceMs(60000);
+    QSignalSpy spy(&pipeline, &ConversionPipeline::conversionsScheduled);
+
+    pipeline.sourceEdited(sample);
+    QCOMPARE(spy.count(), 0);
+    pipeline.flush();
+    QCOMPARE(spy.count(), 1);
+    QVERIFY(!pipeline.hasPendingEdit());
+
+    // 没有等待中的编辑时 flush 不做任何事
+    pipeline.flush();
+    QCOMPARE(spy.count(), 1);
+}
+
+void ConversionPipelineTest::testNoFormats()
+{
+    ConversionCache cache;
+    ConversionPipeline pipeline(&cache);
+    pipeline.setFormats(QStringList());
+    QSignalSpy spy(&pipeline, &ConversionPipeline::conversionsScheduled);
+
+    pipeline.submit(sample);
+    QCOMPARE(spy.count(), 0);
+    QCOMPARE(cache.stats().precomputed, 0);
+}
+
+QTEST_MAIN(ConversionPipelineTest)
+#include "conversionpipeline_test.moc"
@@ -0,0 +1,260 @@
+#include "docxwriter.h"
+#include "latextoomml.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QVector>
+#include <QDebug>
+
+namespace {
+
+const char *ContentTypesXml =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+        "<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">"
+        "<Default Extension=\"rels\" ContentType=\"application/vnd.openxmlformats-package.relationships+xml\"/>"
+        "<Default Extension=\"xml\" ContentType=\"application/xml\"/>"
+        "<Override PartName=\"/word/document.xml\" "
+        "ContentType=\"application/vnd.openxmlformats-officedocument.wordprocessingml.document.main+xml\"/>"
+        "</Types>";
+
+const char *PackageRelsXml =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+        "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
+        "<Relationship Id=\"rId1\" "
+        "Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/officeDocument\" "
+        "Target=\"word/document.xml\"/>"
+        "</Relationships>";
+
+// 只写不读的 ZIP 生成器，条目使用 deflate 压缩
+class ZipWriter
+{
+public:
+    ZipWriter()
+    {
+        const QDateTime now = QDateTime::currentDateTime();
+        const QDate date = now.date();
+        const QTime time = now.time();
+        dosTime = quint16((time.hour() << 11) | (time.minute() << 5) | (time.second() / 2));
+        dosDate = quint16(((qMax(date.year(), 1980) - 1980) << 9) | (date.month() << 5) | date.day());
+    }
+
+    void addFile(const QString &name, const QByteArray &data)
+    {
+        Entry entry;
+        entry.name = name.toUtf8();
+        entry.crc = DocxWriter::crc32(data);
+        entry.size = quint32(data.size());
+        entry.offset = quint32(buffer.size());
+
+        // qCompress 输出 4 字节长度 + zlib 流（2 字节头 + deflate 数据 + 4 字节 Adler-32），
+        // ZIP 需要的是中间的原始 deflate 数据
+        const QByteArray compressed = qCompress(data);
+        const QByteArray deflated = compressed.mid(6, compressed.size() - 10);
+        entry.compressedSize = quint32(deflated.size());
+
+        QDataStream out(&buffer, QIODevice::WriteOnly | QIODevice::Append);
+        out.setByteOrder(QDataStream::LittleEndian);
+        out << quint32(0x04034b50)      // 本地文件头签名
+            << quint16(20)              // 解压所需版本
+            << GeneralPurposeFlags
+            << quint16(8)               // deflate
+            << dosTime << dosDate
+            << entry.crc << entry.compressedSize << entry.size
+            << quint16(entry.name.size())
+            << quint16(0);              // 扩展字段长度
+        out.writeRawData(entry.name.constData(), entry.name.size());
+        out.writeRawData(deflated.constData(), deflated.size());
+
+        entries.append(entry);
+    }
+
+    QByteArray finish()
+    {
+        const quint32 directoryOffset = quint32(buffer.size());
+        QDataStream out(&buffer, QIODevice::WriteOnly | QIODevice::Append);
+        out.setByteOrder(QDataStream::LittleEndian);
+
+        for (const Entry &entry : entries) {
+            out << quint32(0x02014b50)  // 中央目录签名
+                << quint16(20)          // 创建版本
+                << quint16(20)          // 解压所需版本
+                << GeneralPurposeFlags
+                << quint16(8)
+                << dosTime << dosDate
+                << entry.crc << entry.compressedSize << entry.size
+                << quint16(entry.name.size())
+                << quint16(0)           // 扩展字段长度
+                << quint16(0)           // 注释长度
+                << quint16(0)           // 起始磁盘号
+                << quint16(0)           // 内部属性
+                << quint32(0)           // 外部属性
+                << entry.offset;
+            out.writeRawData(entry.name.constData(), entry.name.size());
+        }
+
+        const quint32 directorySize = quint32(buffer.size()) - directoryOffset;
+        out << quint32(0x06054b50)      // 中央目录结束签名
+            << quint16(0) << quint16(0)
+            << quint16(entries.size()) << quint16(entries.size())
+            << directorySize << directoryOffset
+            << quint16(0);              // 注释长度
+        return buffer;
+    }
+
+private:
+    struct Entry
+    {
+        QByteArray name;
+        quint32 crc = 0;
+        quint32 size = 0;
+        quint32 compressedSize = 0;
+        quint32 offset = 0;
+    };
+
+    // bit 11：文件名为 UTF-8
+    static const quint16 GeneralPurposeFlags = 0x0800;
+
+    QByteArray buffer;
+    QVector<Entry> entries;
+    quint16 dosTime;
+    quint16 dosDate;
+};
+
+QString textRun(const QString &text)
+{
+    return "<w:r><w:t xml:space=\"preserve\">" + text.toHtmlEscaped() + "</w:t></w:r>";
+}
+
+} // namespace
+
+quint32 DocxWriter::crc32(const QByteArray &data)
+{
+    static const QVector<quint32> table = []() {
+        QVector<quint32> t(256);
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[int(i)] = c;
+        }
+        return t;
+    }();
+
+    quint32 crc = 0xFFFFFFFFu;
+    const uchar *bytes = reinterpret_cast<const uchar *>(data.constData());
+    for (int i = 0; i < data.size(); ++i) {
+        crc = table.at((crc ^ bytes[i]) & 0xFF) ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+bool DocxWriter::hasRichMarkdown(const QString &markdown)
+{
+    // 行首的标题、列表、引用、表格、代码块，或行内的粗体/代码/链接
+    static const QRegularExpression blockPattern("^\\s*(#{1,6}\\s|[-*+]\\s|\\d+[.)]\\s|>|\\||```)",
+                                                 QRegularExpression::MultilineOption);
+    static const QRegularExpression inlinePattern("\\*\\*|__|`|\\]\\(");
+
+    for (const LatexToOmml::Segment &segment : LatexToOmml::splitMarkdown(markdown)) {
+        if (segment.kind != LatexToOmml::Segment::Text) {
+            continue;
+        }
+        if (blockPattern.match(segment.content).hasMatch() || inlinePattern.match(segment.content).hasMatch()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QByteArray DocxWriter::documentXml(const QString &markdown, int *formulaCount)
+{
+    int converted = 0;
+    QString body;
+    QString paragraph;
+    auto flushParagraph = [&]() {
+        if (!paragraph.isEmpty()) {
+            body += "<w:p>" + paragraph + "</w:p>";
+        }
+        paragraph.clear();
+    };
+
+    for (const LatexToOmml::Segment &segment : LatexToOmml::splitMarkdown(markdown)) {
+        if (segment.kind == LatexToOmml::Segment::Text) {
+            const QStringList lines = segment.content.split('\n');
+            for (int i = 0; i < lines.size(); ++i) {
+                if (i > 0) {
+                    flushParagraph();
+                }
+                if (!lines.at(i).trimmed().isEmpty()) {
+                    paragraph += textRun(lines.at(i));
+                }
+            }
+            continue;
+        }
+
+        const bool display = segment.kind == LatexToOmml::Segment::DisplayMath;
+        QString error;
+        const QString omml = LatexToOmml::convert(segment.content, display, &error);
+        if (omml.isEmpty()) {
+            // 转换失败时保留 LaTeX 源码，内容不丢失
+            qWarning() << "OMML conversion failed:" << error << "in" << segment.content;
+            paragraph += textRun(display ? "$$" + segment.content + "$$" : "$" + segment.content + "$");
+            continue;
+        }
+        ++converted;
+
+        if (display) {
+            flushParagraph();
+            body += "<w:p>" + omml + "</w:p>";
+        } else {
+            paragraph += omml;
+        }
+    }
+    flushParagraph();
+
+    if (formulaCount) {
+        *formulaCount = converted;
+    }
+
+    QString xml = QString("<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+                          "<w:document xmlns:w=\"http://schemas.openxmlformats.org/wordprocessingml/2006/main\" "
+                          "xmlns:m=\"%1\"><w:body>%2<w:sectPr/></w:body></w:document>")
+            .arg(QLatin1String(LatexToOmml::MathNamespace), body);
+    return xml.toUtf8();
+}
+
+QByteArray DocxWriter::build(const QString &markdown, int *formulaCount)
+{
+    ZipWriter zip;
+    // [Content_Types].xml 按惯例放在第一个
+    zip.addFile("[Content_Types].xml", QByteArray(ContentTypesXml));
+    zip.addFile("_rels/.rels", QByteArray(PackageRelsXml));
+    zip.addFile("word/document.xml", documentXml(markdown, formulaCount));
+    return zip.finish();
+}
+
+bool DocxWriter::write(const QString &markdown, const QString &filePath, QString *errorString)
+{
+    return save(build(markdown), filePath, errorString);
+}
+
+bool DocxWriter::save(const QByteArray &docx, const QString &filePath, QString *errorString)
+{
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (errorString) {
+            *errorString = file.errorString();
+        }
+        return false;
+    }
+    file.write(docx);
+    if (!file.commit()) {
+        if (errorString) {
+            *errorString = file.errorString();
+        }
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,34 @@
+#ifndef DOCXWRITER_H
+#define DOCXWRITER_H
+
+#include <QByteArray>
+#include <QString>
+
+// 最小化的 DOCX 生成器：在内存中生成 ZIP 容器和 word/document.xml，
+// 公式以 OMML 写入，Word 打开后即为可编辑的原生公式，不依赖 pandoc。
+class DocxWriter
+{
+public:
+    // 包结构或 document.xml 的写法变化时递增（公式部分另见 LatexToOmml::Version）
+    static const int Version = 1;
+
+    // 生成完整的 .docx 文件内容；formulaCount 返回成功转换为 OMML 的公式数
+    static QByteArray build(const QString &markdown, int *formulaCount = nullptr);
+
+    // 生成 .docx 并写入文件（先写临时文件再替换，避免留下半个文件）
+    static bool write(const QString &markdown, const QString &filePath, QString *errorString = nullptr);
+
+    // 将已生成的 .docx 内容写入文件
+    static bool save(const QByteArray &docx, const QString &filePath, QString *errorString = nullptr);
+
+    // word/document.xml 的内容
+    static QByteArray documentXml(const QString &markdown, int *formulaCount = nullptr);
+
+    // 公式之外是否包含标题、列表、表格等 Markdown 排版，这类内容交给 pandoc 处理效果更好
+    static bool hasRichMarkdown(const QString &markdown);
+
+    // ZIP 使用的 CRC-32（IEEE 802.3）
+    static quint32 crc32(const QByteArray &data);
+};
+
+#endif // DOCXWRITER_H
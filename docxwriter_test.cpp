@@ -0,0 +1,220 @@
+#include <QTest>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QMap>
+#include <QTemporaryDir>
+#include <QXmlStreamReader>
+#include "docxwriter.h"
+
+class DocxWriterTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // 测试 CRC-32 的标准校验值
+    void testCrc32();
+
+    // 测试 document.xml 的内容
+    void testDocumentXml();
+
+    // 测试 ZIP 容器：逐个解析条目并校验内容
+    void testZipContainer();
+
+    // 测试富 Markdown 判断
+    void testHasRichMarkdown();
+
+    // 测试写入文件
+    void testWriteFile();
+
+private:
+    struct ZipEntry
+    {
+        quint16 method = 0;
+        quint32 crc = 0;
+        QByteArray data;   // 原始 deflate 数据
+    };
+
+    static QList<QPair<QString, ZipEntry>> readZip(const QByteArray &zip);
+    static QByteArray inflateRaw(const QByteArray &deflated, quint32 size, const QByteArray &expected);
+    static quint32 adler32(const QByteArray &data);
+
+    const QString sample = "Mass-energy $E = mc^2$\n$$\\int_0^1 x^2 \\, dx = \\frac{1}{3}$$";
+};
+
+quint32 DocxWriterTest::adler32(const QByteArray &data)
+{
+    quint32 a = 1;
+    quint32 b = 0;
+    for (char c : data) {
+        a = (a + uchar(c)) % 65521;
+        b = (b + a) % 65521;
+    }
+    return (b << 16) | a;
+}
+
+QByteArray DocxWriterTest::inflateRaw(const QByteArray &deflated, quint32 size, const QByteArray &expected)
+{
+    // 拼回 qUncompress 需要的格式：4 字节长度 + zlib 头 + deflate 数据 + Adler-32。
+    // Adler-32 用期望内容计算，内容不一致时 qUncompress 会失败
+    QByteArray stream;
+    QDataStream out(&stream, QIODevice::WriteOnly);
+    out << size;
+    stream.append(char(0x78));
+    stream.append(char(0x9C));
+    stream.append(deflated);
+    QDataStream trailer(&stream, QIODevice::WriteOnly | QIODevice::Append);
+    trailer << adler32(expected);
+    return qUncompress(stream);
+}
+
+QList<QPair<QString, DocxWriterTest::ZipEntry>> DocxWriterTest::readZip(const QByteArray &zip)
+{
+    QList<QPair<QString, ZipEntry>> entries;
+
+    const int endOffset = zip.lastIndexOf(QByteArray("PK\x05\x06", 4));
+    if (endOffset < 0) {
+        return entries;
+    }
+    QDataStream end(zip.mid(endOffset));
+    end.setByteOrder(QDataStream::LittleEndian);
+    quint32 signature;
+    quint16 disk, directoryDisk, diskEntries, totalEntries;
+    quint32 directorySize, directoryOffset;
+    end >> signature >> disk >> directoryDisk >> diskEntries >> totalEntries >> directorySize >> directoryOffset;
+
+    QDataStream directory(zip.mid(int(directoryOffset), int(directorySize)));
+    directory.setByteOrder(QDataStream::LittleEndian);
+    for (int i = 0; i < totalEntries; ++i) {
+        quint16 versionMade, versionNeeded, flags, method, time, date, nameLength, extraLength, commentLength;
+        quint16 startDisk, internalAttributes;
+        quint32 crc, compressedSize, size, externalAttributes, localOffset;
+        directory >> signature >> versionMade >> versionNeeded >> flags >> method >> time >> date
+                  >> crc >> compressedSize >> size >> nameLength >> extraLength >> commentLength
+                  >> startDisk >> internalAttributes >> externalAttributes >> localOffset;
+        if (signature != 0x02014b50) {
+            return QList<QPair<QString, ZipEntry>>();
+        }
+        QByteArray name(nameLength, Qt::Uninitialized);
+        directory.readRawData(name.data(), nameLength);
+        directory.skipRawData(extraLength + commentLength);
+
+        // 本地文件头
+        QDataStream local(zip.mid(int(localOffset)));
+        local.setByteOrder(QDataStream::LittleEndian);
+        quint32 localSignature;
+        local >> localSignature;
+        if (localSignature != 0x04034b50) {
+            return QList<QPair<QString, ZipEntry>>();
+        }
+        local.skipRawData(22);
+        quint16 localNameLength, localExtraLength;
+        local >> localNameLength >> localExtraLength;
+        const int dataOffset = int(localOffset) + 30 + localNameLength + localExtraLength;
+
+        ZipEntry entry;
+        entry.method = method;
+        entry.crc = crc;
+        entry.data = zip.mid(dataOffset, int(compressedSize));
+        entries.append(qMakePair(QString::fromUtf8(name), entry));
+        Q_UNUSED(size);
+    }
+    return entries;
+}
+
+void DocxWriterTest::testCrc32()
+{
+    QCOMPARE(DocxWriter::crc32(QByteArray("123456789")), quint32(0xCBF43926));
+    QCOMPARE(DocxWriter::crc32(QByteArray()), quint32(0));
+}
+
+void DocxWriterTest::testDocumentXml()
+{
+    int count = -1;
+    const QByteArray xml = DocxWriter::documentXml(sample, &count);
+    QCOMPARE(count, 2);
+
+    QXmlStreamReader reader(xml);
+    int paragraphs = 0;
+    int mathParagraphs = 0;
+    while (!reader.atEnd()) {
+        reader.readNext();
+        if (reader.isStartElement() && reader.qualifiedName() == QLatin1String("w:p")) {
+            ++paragraphs;
+        }
+        if (reader.isStartElement() && reader.qualifiedName() == QLatin1String("m:oMathPara")) {
+            ++mathParagraphs;
+        }
+    }
+    QVERIFY2(!reader.hasError(), qPrintable(reader.errorString()));
+    QCOMPARE(paragraphs, 2);
+    QCOMPARE(mathParagraphs, 1);
+    QVERIFY(xml.contains("<w:t xml:space=\"preserve\">Mass-energy </w:t>"));
+
+    // 转换失败的公式以源码写入
+    const QByteArray fallback = DocxWriter::documentXml("$\\frac{a}{b$", &count);
+    QCOMPARE(count, 0);
+    QVERIFY(fallback.contains("$\\frac{a}{b$"));
+}
+
+void DocxWriterTest::testZipContainer()
+{
+    const QByteArray docx = DocxWriter::build(sample);
+    QVERIFY(docx.startsWith("PK\x03\x04"));
+
+    const QList<QPair<QString, ZipEntry>> entries = readZip(docx);
+    QCOMPARE(entries.size(), 3);
+    QCOMPARE(entries.at(0).first, QString("[Content_Types].xml"));
+    QCOMPARE(entries.at(1).first, QString("_rels/.rels"));
+    QCOMPARE(entries.at(2).first, QString("word/document.xml"));
+
+    const QByteArray expected = DocxWriter::documentXml(sample);
+    const ZipEntry &document = entries.at(2).second;
+    QCOMPARE(document.method, quint16(8));
+    QCOMPARE(document.crc, DocxWriter::crc32(expected));
+    QCOMPARE(inflateRaw(document.data, quint32(expected.size()), expected), expected);
+
+    // 包结构部件同样使用 deflate 且不为空
+    for (int i = 0; i < 2; ++i) {
+        const ZipEntry &entry = entries.at(i).second;
+        QCOMPARE(entry.method, quint16(8));
+        QVERIFY(entry.data.size() > 0);
+    }
+}
+
+void DocxWriterTest::testHasRichMarkdown()
+{
+    QVERIFY(!DocxWriter::hasRichMarkdown("$$a^2 + b^2 = c^2$$"));
+    QVERIFY(!DocxWriter::hasRichMarkdown("where $x > 0$ and $y < 1$"));
+    // 公式内的 * 或 - 不算排版
+    QVERIFY(!DocxWriter::hasRichMarkdown("$$\n- x * y\n$$"));
+
+    QVERIFY(DocxWriter::hasRichMarkdown("# Title\n$$x$$"));
+    QVERIFY(DocxWriter::hasRichMarkdown("- item $x$\n- item $y$"));
+    QVERIFY(DocxWriter::hasRichMarkdown("| a | b |\n|---|---|"));
+    QVERIFY(DocxWriter::hasRichMarkdown("**bold** $x$"));
+}
+
+void DocxWriterTest::testWriteFile()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("out.docx");
+
+    QElapsedTimer timer;
+    timer.start();
+    QString error;
+    QVERIFY2(DocxWriter::write(sample, path, &error), qPrintable(error));
+    qDebug() << "DOCX written in" << timer.nsecsElapsed() / 1000 << "us";
+
+    QFileInfo info(path);
+    QVERIFY(info.exists());
+    QCOMPARE(info.size(), qint64(DocxWriter::build(sample).size()));
+
+    // 目录不存在时报告错误
+    QVERIFY(!DocxWriter::write(sample, dir.filePath("missing/out.docx"), &error));
+    QVERIFY(!error.isEmpty());
+}
+
+QTEST_MAIN(DocxWriterTest)
+#include "docxwriter_test.moc"
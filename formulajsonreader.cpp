@@ -0,0 +1,133 @@
+#include "formulajsonreader.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QStringList>
+
+QJsonObject FormulaJsonReader::schema()
+{
+    QJsonObject latex;
+    latex["type"] = "string";
+    QJsonObject display;
+    display["type"] = "boolean";
+    QJsonObject confidence;
+    confidence["type"] = "number";
+
+    QJsonObject itemProperties;
+    itemProperties["latex"] = latex;
+    itemProperties["display"] = display;
+    itemProperties["confidence"] = confidence;
+
+    QJsonObject item;
+    item["type"] = "object";
+    item["properties"] = itemProperties;
+    item["required"] = QJsonArray{"latex", "display"};
+
+    QJsonObject formulas;
+    formulas["type"] = "array";
+    formulas["items"] = item;
+
+    QJsonObject properties;
+    properties["formulas"] = formulas;
+
+    QJsonObject root;
+    root["type"] = "object";
+    root["properties"] = properties;
+    root["required"] = QJsonArray{"formulas"};
+    return root;
+}
+
+int FormulaJsonReader::feed(const QString &fragment)
+{
+    const int before = parsed.size();
+    raw += fragment;
+    pending += fragment;
+
+    for (; scanPos < pending.size() && !complete; ++scanPos) {
+        const QChar c = pending.at(scanPos);
+        if (inString) {
+            if (escaped) {
+                escaped = false;
+            } else if (c == '\\') {
+                escaped = true;
+            } else if (c == '"') {
+                inString = false;
+            }
+            continue;
+        }
+        if (c == '"') {
+            inString = true;
+        } else if (c == '{' || c == '[') {
+            if (!started) {
+                started = true;
+                itemDepth = c == '[' ? 2 : 3;
+            }
+            ++depth;
+            if (c == '{' && depth == itemDepth) {
+                itemStart = scanPos;
+            }
+        } else if (c == '}' || c == ']') {
+            if (c == '}' && depth == itemDepth && itemStart >= 0) {
+                parseItem(pending.mid(itemStart, scanPos - itemStart + 1));
+                itemStart = -1;
+            }
+            --depth;
+            if (depth == 0 && started) {
+                complete = true;
+            }
+        }
+    }
+
+    // 只保留还没闭合的公式对象，已扫描的部分不再占用内存
+    if (itemStart >= 0) {
+        pending.remove(0, itemStart);
+        scanPos -= itemStart;
+        itemStart = 0;
+    } else {
+        pending.clear();
+        scanPos = 0;
+    }
+    return parsed.size() - before;
+}
+
+void FormulaJsonReader::parseItem(const QString &item)
+{
+    const QJsonObject object = QJsonDocument::fromJson(item.toUtf8()).object();
+    QString latex = object["latex"].toString().trimmed();
+    // 模型偶尔仍会在字段里带上定界符
+    while (latex.startsWith('$') && latex.endsWith('$') && latex.size() >= 2) {
+        latex = latex.mid(1, latex.size() - 2).trimmed();
+    }
+    if (latex.isEmpty()) {
+        return;
+    }
+
+    Formula formula;
+    formula.latex = latex;
+    formula.display = object["display"].toBool(true);
+    formula.confidence = object["confidence"].toDouble(-1);
+    parsed.append(formula);
+}
+
+bool FormulaJsonReader::isComplete() const
+{
+    return complete;
+}
+
+QList<FormulaJsonReader::Formula> FormulaJsonReader::formulas() const
+{
+    return parsed;
+}
+
+QString FormulaJsonReader::text() const
+{
+    return raw;
+}
+
+QString FormulaJsonReader::toMarkdown(const QList<Formula> &formulas)
+{
+    QStringList lines;
+    for (const Formula &formula : formulas) {
+        lines << (formula.display ? "$$" + formula.latex + "$$" : "$" + formula.latex + "$");
+    }
+    return lines.join('\n');
+}
@@ -0,0 +1,54 @@
+#ifndef FORMULAJSONREADER_H
+#define FORMULAJSONREADER_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+
+// 结构化输出模式下的响应读取器。
+// 请求通过 Ollama 的 format 字段约束模型输出 {"formulas":[{"latex","display","confidence"}]}；
+// 流式响应的各分片文本拼起来才是上述文档，读取器边收边扫描，每个公式对象一闭合就解析出来，不必等整个响应结束。
+// 线路格式（NDJSON 或 SSE）和服务端错误由推理后端的解码器处理，OllamaClient 把解码出的文本交给 feed
+class FormulaJsonReader
+{
+public:
+    struct Formula
+    {
+        QString latex;            // 不含 $ 定界符
+        bool display = true;
+        double confidence = -1;   // 模型给出的 0-1 置信度，-1 表示未给出
+    };
+
+    // 发送给 format 字段的 JSON Schema
+    static QJsonObject schema();
+
+    // 追加一段模型输出的文本，返回本次新解析出的公式数
+    int feed(const QString &fragment);
+
+    bool isComplete() const;    // JSON 根节点已闭合
+
+    QList<Formula> formulas() const;
+    // 模型输出的原始文本（模型不支持 format 时退回按 Markdown 处理）
+    QString text() const;
+
+    // 行间公式独占一行 $$...$$，行内公式 $...$
+    static QString toMarkdown(const QList<Formula> &formulas);
+
+private:
+    void parseItem(const QString &item);
+
+    QString raw;
+    QString pending;         // 尚未扫描或正在扫描的公式对象文本
+    int scanPos = 0;
+    int depth = 0;
+    int itemDepth = 3;       // 根为对象时公式对象在第 3 层，根为数组时在第 2 层
+    int itemStart = -1;
+    bool started = false;
+    bool inString = false;
+    bool escaped = false;
+    bool complete = false;
+    QList<Formula> parsed;
+};
+
+#endif // FORMULAJSONREADER_H
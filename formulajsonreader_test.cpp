@@ -0,0 +1,209 @@
+#include <QTest>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QScopedPointer>
+#include "formulajsonreader.h"
+#include "ollamabackend.h"
+
+class FormulaJsonReaderTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // 测试 Schema 结构
+    void testSchema();
+
+    // 测试在任意位置切分文本时结果一致
+    void testFeedSplitAnywhere();
+
+    // 测试公式对象一闭合就能取到
+    void testIncremental();
+
+    // 测试经 Ollama 解码器读取的 NDJSON 流（/api/generate 与 /api/chat）
+    void testStream_data();
+    void testStream();
+
+    // 测试截断的输出与忽略 format 的服务端
+    void testTruncation();
+
+    // 测试转换为 Markdown
+    void testToMarkdown();
+
+    // 测试流式解析耗时
+    void benchFeed();
+
+private:
+    static QString sampleDocument();
+    static QByteArray ndjson(const QString &text, int pieces, bool chat);
+};
+
+QString FormulaJsonReaderTest::sampleDocument()
+{
+    return "{\"formulas\": ["
+           "{\"latex\": \"\\\\frac{a}{b} = \\\\{x\\\\}\", \"display\": true, \"confidence\": 0.9},"
+           "{\"latex\": \"x^2 \\\"quoted\\\" }]\", \"display\": false, \"confidence\": 0.6},"
+           "{\"latex\": \"$E = mc^2$\", \"display\": true}"
+           "]}";
+}
+
+QByteArray FormulaJsonReaderTest::ndjson(const QString &text, int pieces, bool chat)
+{
+    QByteArray out;
+    const int step = qMax(1, (text.size() + pieces - 1) / pieces);
+    for (int i = 0; i <= text.size(); i += step) {
+        QJsonObject chunk;
+        chunk["model"] = "mock-vl";
+        const QString piece = text.mid(i, step);
+        if (chat) {
+            QJsonObject message;
+            message["role"] = "assistant";
+            message["content"] = piece;
+            chunk["message"] = message;
+        } else {
+            chunk["response"] = piece;
+        }
+        chunk["done"] = false;
+        out += QJsonDocument(chunk).toJson(QJsonDocument::Compact) + "\n";
+    }
+    out += "{\"model\":\"mock-vl\",\"response\":\"\",\"done\":true}\n";
+    return out;
+}
+
+void FormulaJsonReaderTest::testSchema()
+{
+    const QJsonObject schema = FormulaJsonReader::schema();
+    QCOMPARE(schema["type"].toString(), QString("object"));
+    const QJsonObject item = schema["properties"].toObject()["formulas"].toObject()["items"].toObject();
+    QVERIFY(item["properties"].toObject().contains("latex"));
+    QVERIFY(item["properties"].toObject().contains("display"));
+    QVERIFY(item["properties"].toObject().contains("confidence"));
+    QVERIFY(item["required"].toArray().contains("latex"));
+}
+
+void FormulaJsonReaderTest::testFeedSplitAnywhere()
+{
+    const QString document = sampleDocument();
+    for (int split = 0; split <= document.size(); ++split) {
+        FormulaJsonReader reader;
+        reader.feed(document.left(split));
+        reader.feed(document.mid(split));
+        QVERIFY(reader.isComplete());
+        const QList<FormulaJsonReader::Formula> formulas = reader.formulas();
+        QCOMPARE(formulas.size(), 3);
+        // 字符串里的花括号、方括号和转义引号不影响结构扫描
+        QCOMPARE(formulas.at(0).latex, QString("\\frac{a}{b} = \\{x\\}"));
+        QCOMPARE(formulas.at(1).latex, QString("x^2 \"quoted\" }]"));
+        QCOMPARE(formulas.at(1).display, false);
+        QCOMPARE(formulas.at(1).confidence, 0.6);
+        // 字段里多余的 $ 被去掉；没有 confidence 时为 -1
+        QCOMPARE(formulas.at(2).latex, QString("E = mc^2"));
+        QCOMPARE(formulas.at(2).confidence, -1.0);
+    }
+}
+
+void FormulaJsonReaderTest::testIncremental()
+{
+    FormulaJsonReader reader;
+    QCOMPARE(reader.feed("{\"formulas\":[{\"latex\":\"a\",\"display\":true}"), 1);
+    QCOMPARE(reader.formulas().size(), 1);
+    QVERIFY(!reader.isComplete());
+    QCOMPARE(reader.feed(",{\"latex\":\"b\",\"dis"), 0);
+    QCOMPARE(reader.feed("play\":false}]}"), 1);
+    QVERIFY(reader.isComplete());
+
+    // 根节点也可以直接是数组
+    FormulaJsonReader arrayReader;
+    QCOMPARE(arrayReader.feed("[{\"latex\":\"c\",\"display\":true}]"), 1);
+    QVERIFY(arrayReader.isComplete());
+}
+
+void FormulaJsonReaderTest::testStream_data()
+{
+    QTest::addColumn<bool>("chat");
+    QTest::addColumn<int>("pieces");
+    QTest::addColumn<int>("readSize");
+
+    QTest::newRow("generate, 1 piece") << false << 1 << 65536;
+    QTest::newRow("generate, 16 pieces, 7-byte reads") << false << 16 << 7;
+    QTest::newRow("chat, 5 pieces, 1-byte reads") << true << 5 << 1;
+}
+
+void FormulaJsonReaderTest::testStream()
+{
+    QFETCH(bool, chat);
+    QFETCH(int, pieces);
+    QFETCH(int, readSize);
+
+    const QByteArray stream = ndjson(sampleDocument(), pieces, chat);
+    InferenceBackend::Request request;
+    request.structured = true;
+    OllamaBackend backend;
+    QScopedPointer<InferenceBackend::Decoder> decoder(backend.createDecoder(request));
+    FormulaJsonReader reader;
+    // 与 OllamaClient 相同：解码器处理线路格式，解码出的文本交给读取器。
+    // 网络数据可能在任意位置断开，包括一行 JSON 的中间
+    for (int i = 0; i < stream.size(); i += readSize) {
+        reader.feed(decoder->feed(stream.mid(i, readSize)));
+    }
+    reader.feed(decoder->finish());
+
+    QVERIFY(!decoder->hasError());
+    QVERIFY(reader.isComplete());
+    QCOMPARE(reader.formulas().size(), 3);
+    QCOMPARE(reader.text(), sampleDocument());
+}
+
+void FormulaJsonReaderTest::testTruncation()
+{
+    // 输出被截断：已闭合的公式仍然可用
+    FormulaJsonReader truncated;
+    truncated.feed("{\"formulas\":[{\"latex\":\"a\",\"display\":true},{\"latex\":\"\\\\fra");
+    QVERIFY(!truncated.isComplete());
+    QCOMPARE(truncated.formulas().size(), 1);
+
+    // 服务端忽略 format：没有 JSON 结构，保留原文
+    FormulaJsonReader freeText;
+    freeText.feed("Here is the formula: $$x$$");
+    QVERIFY(freeText.formulas().isEmpty());
+    QVERIFY(!freeText.isComplete());
+    QCOMPARE(freeText.text(), QString("Here is the formula: $$x$$"));
+}
+
+void FormulaJsonReaderTest::testToMarkdown()
+{
+    FormulaJsonReader::Formula display;
+    display.latex = "a+b";
+    FormulaJsonReader::Formula inlineFormula;
+    inlineFormula.latex = "c";
+    inlineFormula.display = false;
+
+    QCOMPARE(FormulaJsonReader::toMarkdown({display, inlineFormula}), QString("$$a+b$$\n$c$"));
+    QCOMPARE(FormulaJsonReader::toMarkdown({}), QString());
+}
+
+void FormulaJsonReaderTest::benchFeed()
+{
+    QString document = "{\"formulas\":[";
+    for (int i = 0; i < 20; ++i) {
+        document += QString("%1{\"latex\":\"\\\\sum_{k=1}^{%2} \\\\frac{k^2}{2}\",\"display\":true,\"confidence\":0.95}")
+                .arg(i ? "," : "").arg(i);
+    }
+    document += "]}";
+    // 与流式响应一样切成 200 段
+    QStringList pieces;
+    const int step = document.size() / 200 + 1;
+    for (int i = 0; i < document.size(); i += step) {
+        pieces << document.mid(i, step);
+    }
+
+    QBENCHMARK {
+        FormulaJsonReader reader;
+        for (const QString &piece : pieces) {
+            reader.feed(piece);
+        }
+    }
+}
+
+QTEST_MAIN(FormulaJsonReaderTest)
+#include "formulajsonreader_test.moc"
@@ -0,0 +1,88 @@
+#include "generationoptions.h"
+#include <QJsonArray>
+#include <QtMath>
+
+QStringList GenerationOptions::defaultStop()
+{
+    // 都以空行开头：公式之后另起一段的解释才会被截断
+    return {"\n\nExplanation", "\n\nThis formula", "\n\nThis equation", "\n\nNote:", "\n\nI hope"};
+}
+
+int GenerationOptions::imageTokens(const QSize &size)
+{
+    if (size.isEmpty()) {
+        return 0;
+    }
+    double width = size.width();
+    double height = size.height();
+    const double pixels = width * height;
+    if (pixels > MaxPixels) {
+        const double scale = qSqrt(MaxPixels / pixels);
+        width *= scale;
+        height *= scale;
+    } else if (pixels < MinPixels) {
+        const double scale = qSqrt(MinPixels / pixels);
+        width *= scale;
+        height *= scale;
+    }
+    const int columns = qMax(1, qRound(width / PatchSize));
+    const int rows = qMax(1, qRound(height / PatchSize));
+    return columns * rows;
+}
+
+int GenerationOptions::estimateFormulaCount(const QSize &size)
+{
+    return qMax(1, qRound(double(size.height()) / LineHeightPx));
+}
+
+int GenerationOptions::estimateNumPredict(const QSize &size, bool structured)
+{
+    // 一行公式的可见字符约每 14 px 一个；LaTeX 的命令和花括号使 token 数约为字符数的两倍
+    const int lines = estimateFormulaCount(size);
+    const int glyphsPerLine = qMax(8, size.width() / 14);
+    int tokens = 32 + lines * glyphsPerLine * 2;
+    if (structured) {
+        // 每个公式对象的键名和标点
+        tokens += lines * 24;
+    }
+    // 按 64 取整，便于在日志里比较
+    tokens = (tokens + 63) / 64 * 64;
+    return qBound(128, tokens, 4096);
+}
+
+int GenerationOptions::estimateNumCtx(int imageTokens, int numPredict)
+{
+    const int needed = imageTokens + PromptTokens + numPredict;
+    int numCtx = 2048;
+    while (numCtx < needed && numCtx < 32768) {
+        numCtx *= 2;
+    }
+    return numCtx;
+}
+
+QJsonObject GenerationOptions::build(const Settings &settings, const QSize &imageSize, bool structured)
+{
+    QJsonObject options;
+    if (settings.mode == "off") {
+        return options;
+    }
+
+    options["temperature"] = settings.temperature;
+    if (settings.mode == "fixed") {
+        if (settings.numPredict != 0) {
+            options["num_predict"] = settings.numPredict;
+        }
+        if (settings.numCtx > 0) {
+            options["num_ctx"] = settings.numCtx;
+        }
+    } else {
+        const int numPredict = estimateNumPredict(imageSize, structured);
+        options["num_predict"] = numPredict;
+        options["num_ctx"] = estimateNumCtx(imageTokens(imageSize), numPredict);
+    }
+
+    if (!structured && !settings.stop.isEmpty()) {
+        options["stop"] = QJsonArray::fromStringList(settings.stop);
+    }
+    return options;
+}
@@ -0,0 +1,44 @@
+#ifndef GENERATIONOPTIONS_H
+#define GENERATIONOPTIONS_H
+
+#include <QJsonObject>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+
+// 每个识别请求的 Ollama options：按选区大小估算生成上限和上下文长度，
+// 固定 temperature 为 0，并用停止序列截断公式之后的解释文字
+class GenerationOptions
+{
+public:
+    struct Settings
+    {
+        QString mode = "auto";      // "auto"：按选区估算；"fixed"：使用下面的固定值；"off"：不发送 options
+        int numPredict = 0;         // fixed 模式的生成上限（token），0 使用服务端默认值，-1 不限制
+        int numCtx = 0;             // fixed 模式的上下文长度，0 使用服务端默认值
+        double temperature = 0.0;
+        QStringList stop = defaultStop(); // 仅自由文本模式使用，结构化输出由 Schema 约束
+    };
+
+    // Qwen2.5-VL：14 px 的 patch 按 2×2 合并，每 28×28 像素一个图像 token；
+    // 图像先缩放到像素数在 [MinPixels, MaxPixels] 内且边长为 28 的倍数
+    static const int PatchSize = 28;
+    static const qint64 MinPixels = 56 * 56;
+    static const qint64 MaxPixels = 28 * 28 * 1280;
+
+    // 估算公式行数时假定的行高（像素），以及提示词本身的 token 数
+    static const int LineHeightPx = 48;
+    static const int PromptTokens = 192;
+
+    static QJsonObject build(const Settings &settings, const QSize &imageSize, bool structured);
+
+    static int imageTokens(const QSize &size);
+    static int estimateFormulaCount(const QSize &size);
+    static int estimateNumPredict(const QSize &size, bool structured);
+    // 按 2 的幂分档：num_ctx 变化会让 Ollama 重新加载模型，档位越少重载越少
+    static int estimateNumCtx(int imageTokens, int numPredict);
+
+    static QStringList defaultStop();
+};
+
+#endif // GENERATIONOPTIONS_H
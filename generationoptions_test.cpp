@@ -0,0 +1,96 @@
+#include <QTest>
+#include <QJsonArray>
+#include "generationoptions.h"
+
+class GenerationOptionsTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // 测试图像 token 数估算
+    void testImageTokens_data();
+    void testImageTokens();
+
+    // 测试生成上限随选区增长且有上下界
+    void testNumPredict();
+
+    // 测试上下文长度按档位取值并容纳图像
+    void testNumCtx();
+
+    // 测试三种模式生成的 options
+    void testBuildModes();
+};
+
+void GenerationOptionsTest::testImageTokens_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<int>("tokens");
+
+    QTest::newRow("empty") << QSize() << 0;
+    QTest::newRow("exact patches") << QSize(280, 56) << 20;
+    QTest::newRow("rounded") << QSize(300, 60) << 22;        // 11 × 2
+    QTest::newRow("tiny upscaled") << QSize(20, 20) << 4;    // 放大到 56×56
+    // 超过 MaxPixels 时等比缩小，token 数约为 1280（边长取整后略有出入）
+    QTest::newRow("4k downscaled") << QSize(3840, 2160) << 1296;
+}
+
+void GenerationOptionsTest::testImageTokens()
+{
+    QFETCH(QSize, size);
+    QFETCH(int, tokens);
+    QCOMPARE(GenerationOptions::imageTokens(size), tokens);
+}
+
+void GenerationOptionsTest::testNumPredict()
+{
+    const int small = GenerationOptions::estimateNumPredict(QSize(200, 40), false);
+    const int wide = GenerationOptions::estimateNumPredict(QSize(1200, 40), false);
+    const int page = GenerationOptions::estimateNumPredict(QSize(1200, 900), false);
+    QCOMPARE(small, 128);
+    QVERIFY(wide > small);
+    QVERIFY(page > wide);
+    QCOMPARE(GenerationOptions::estimateNumPredict(QSize(3840, 2160), false), 4096);
+
+    // 结构化输出为每个公式的 JSON 键名留出余量
+    QVERIFY(GenerationOptions::estimateNumPredict(QSize(1200, 400), true)
+            > GenerationOptions::estimateNumPredict(QSize(1200, 400), false));
+    QCOMPARE(GenerationOptions::estimateNumPredict(QSize(1200, 400), false) % 64, 0);
+}
+
+void GenerationOptionsTest::testNumCtx()
+{
+    QCOMPARE(GenerationOptions::estimateNumCtx(100, 128), 2048);
+    QCOMPARE(GenerationOptions::estimateNumCtx(1254, 1024), 4096);
+    QCOMPARE(GenerationOptions::estimateNumCtx(1254, 4096), 8192);
+    QCOMPARE(GenerationOptions::estimateNumCtx(100000, 4096), 32768);
+}
+
+void GenerationOptionsTest::testBuildModes()
+{
+    GenerationOptions::Settings settings;
+    const QSize size(640, 160);
+
+    // auto：估算的上限和上下文，temperature 0，自由文本模式带停止序列
+    QJsonObject options = GenerationOptions::build(settings, size, false);
+    QCOMPARE(options["temperature"].toDouble(), 0.0);
+    QCOMPARE(options["num_predict"].toInt(), GenerationOptions::estimateNumPredict(size, false));
+    QCOMPARE(options["num_ctx"].toInt(), 2048);
+    QCOMPARE(options["stop"].toArray().size(), GenerationOptions::defaultStop().size());
+
+    // 结构化输出不带停止序列
+    QVERIFY(!GenerationOptions::build(settings, size, true).contains("stop"));
+
+    // fixed：使用配置值，0 表示不发送
+    settings.mode = "fixed";
+    settings.numPredict = 512;
+    options = GenerationOptions::build(settings, size, false);
+    QCOMPARE(options["num_predict"].toInt(), 512);
+    QVERIFY(!options.contains("num_ctx"));
+
+    // off：不发送 options
+    settings.mode = "off";
+    QVERIFY(GenerationOptions::build(settings, size, false).isEmpty());
+}
+
+QTEST_MAIN(GenerationOptionsTest)
+#include "generationoptions_test.moc"
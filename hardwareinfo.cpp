@@ -0,0 +1,141 @@
+#include "hardwareinfo.h"
+#include <QDir>
+#include <QFile>
+#include <QRegularExpression>
+#include <QSet>
+#include <QThread>
+
+namespace {
+
+QByteArray readFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    // /proc 下的文件大小显示为 0，只能读到末尾
+    return file.readAll();
+}
+
+QString gib(qint64 bytes)
+{
+    return QString::number(bytes / double(1LL << 30), 'f', 1) + " GiB";
+}
+
+} // namespace
+
+int HardwareInfo::Info::coresPerNode() const
+{
+    return qMax(1, physicalCores / qMax(1, numaNodes));
+}
+
+QString HardwareInfo::Info::summary() const
+{
+    QString text = QString("%1 cores / %2 threads").arg(physicalCores).arg(logicalCpus);
+    if (sockets > 1) {
+        text += QString(", %1 sockets").arg(sockets);
+    }
+    if (numaNodes > 1) {
+        text += QString(", %1 NUMA nodes").arg(numaNodes);
+    }
+    if (totalMemoryBytes > 0) {
+        text += ", " + gib(totalMemoryBytes);
+        if (availableMemoryBytes > 0) {
+            text += " (" + gib(availableMemoryBytes) + " available)";
+        }
+    }
+    return text;
+}
+
+HardwareInfo::Info HardwareInfo::detect()
+{
+    static const Info cached = [] {
+        Info info;
+        info.logicalCpus = qMax(1, QThread::idealThreadCount());
+        info.physicalCores = info.logicalCpus;
+#ifdef Q_OS_LINUX
+        parseCpuInfo(readFile("/proc/cpuinfo"), &info);
+        parseMemInfo(readFile("/proc/meminfo"), &info);
+        info.numaNodes = countNumaNodes("/sys/devices/system/node");
+#endif
+        return info;
+    }();
+    return cached;
+}
+
+void HardwareInfo::parseCpuInfo(const QByteArray &cpuinfo, Info *info)
+{
+    int processors = 0;
+    QSet<QString> cores;
+    QSet<QString> sockets;
+    QString physicalId;
+    QString coreId;
+    auto endBlock = [&]() {
+        if (!coreId.isEmpty()) {
+            cores.insert(physicalId + ':' + coreId);
+        }
+        if (!physicalId.isEmpty()) {
+            sockets.insert(physicalId);
+        }
+        physicalId.clear();
+        coreId.clear();
+    };
+
+    // 每个逻辑 CPU 一段，段之间以空行分隔
+    for (const QByteArray &rawLine : cpuinfo.split('\n')) {
+        const QByteArray line = rawLine.trimmed();
+        if (line.isEmpty()) {
+            endBlock();
+            continue;
+        }
+        const int colon = line.indexOf(':');
+        if (colon < 0) {
+            continue;
+        }
+        const QByteArray key = line.left(colon).trimmed();
+        const QString value = QString::fromLatin1(line.mid(colon + 1).trimmed());
+        if (key == "processor") {
+            ++processors;
+        } else if (key == "physical id") {
+            physicalId = value;
+        } else if (key == "core id") {
+            coreId = value;
+        }
+    }
+    endBlock();
+
+    if (processors == 0) {
+        return;
+    }
+    info->logicalCpus = processors;
+    info->physicalCores = cores.isEmpty() ? processors : cores.size();
+    info->sockets = qMax(1, sockets.size());
+}
+
+void HardwareInfo::parseMemInfo(const QByteArray &meminfo, Info *info)
+{
+    for (const QByteArray &line : meminfo.split('\n')) {
+        const QList<QByteArray> fields = line.simplified().split(' ');
+        if (fields.size() < 2) {
+            continue;
+        }
+        const qint64 bytes = fields.at(1).toLongLong() * 1024;
+        if (fields.at(0) == "MemTotal:") {
+            info->totalMemoryBytes = bytes;
+        } else if (fields.at(0) == "MemAvailable:") {
+            info->availableMemoryBytes = bytes;
+        }
+    }
+}
+
+int HardwareInfo::countNumaNodes(const QString &nodeDir)
+{
+    static const QRegularExpression nodeName("^node[0-9]+$");
+    int nodes = 0;
+    for (const QString &entry : QDir(nodeDir).entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        if (nodeName.match(entry).hasMatch()) {
+            ++nodes;
+        }
+    }
+    return qMax(1, nodes);
+}
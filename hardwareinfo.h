@@ -0,0 +1,40 @@
+#ifndef HARDWAREINFO_H
+#define HARDWAREINFO_H
+
+#include <QByteArray>
+#include <QString>
+
+// 本机的 CPU 拓扑和内存：物理核心、SMT、插槽、NUMA 节点。
+// 用于推算同一台机器上的 Ollama 的 num_thread（见 RuntimeOptions）和校准的候选值（见 TuningCalibrator）
+class HardwareInfo
+{
+public:
+    struct Info
+    {
+        int logicalCpus = 1;         // 逻辑 CPU（含 SMT 线程）
+        int physicalCores = 1;       // 物理核心，无法确定时等于 logicalCpus
+        int sockets = 1;
+        int numaNodes = 1;
+        qint64 totalMemoryBytes = 0; // 0 表示未知
+        qint64 availableMemoryBytes = 0;
+
+        bool smt() const { return logicalCpus > physicalCores; }
+        // 单个 NUMA 节点上的物理核心数
+        int coresPerNode() const;
+        // 例如 "16 cores / 32 threads, 2 sockets, 2 NUMA nodes, 62.8 GiB (41.0 GiB available)"
+        QString summary() const;
+    };
+
+    // 首次调用时读取 /proc 和 /sys（Linux），之后返回缓存的结果；其他平台只有逻辑 CPU 数
+    static Info detect();
+
+    // 以下单独暴露以便测试
+    // /proc/cpuinfo：按 (physical id, core id) 去重得到物理核心数；没有这两个字段（如 ARM）时按逻辑 CPU 计
+    static void parseCpuInfo(const QByteArray &cpuinfo, Info *info);
+    // /proc/meminfo：MemTotal 和 MemAvailable（单位 kB）
+    static void parseMemInfo(const QByteArray &meminfo, Info *info);
+    // /sys/devices/system/node 下 node<N> 目录的个数，目录不存在时为 1
+    static int countNumaNodes(const QString &nodeDir);
+};
+
+#endif // HARDWAREINFO_H
@@ -0,0 +1,193 @@
+#include "historypanel.h"
+#include <QElapsedTimer>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListView>
+#include <QVBoxLayout>
+#include <QDebug>
+
+HistoryModel::HistoryModel(HistoryStore *store, QObject *parent)
+    : QAbstractListModel(parent), store(store), exhausted(true), thumbnailCache(200)
+{
+    connect(store, &HistoryStore::entryAdded, this, &HistoryModel::onEntryAdded);
+    connect(store, &HistoryStore::entryRemoved, this, &HistoryModel::onEntryRemoved);
+}
+
+void HistoryModel::setQuery(const QString &query)
+{
+    beginResetModel();
+    currentQuery = query;
+    rows.clear();
+    exhausted = false;
+    endResetModel();
+
+    fetchMore(QModelIndex());
+}
+
+QString HistoryModel::query() const
+{
+    return currentQuery;
+}
+
+int HistoryModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : rows.size();
+}
+
+QVariant HistoryModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rows.size()) {
+        return QVariant();
+    }
+
+    const HistoryEntry &entry = rows.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole: {
+        QString firstLine = entry.result.section('\n', 0, 0).trimmed();
+        return QString("%1  %2\n%3")
+                .arg(entry.createdAt.toString("yyyy-MM-dd hh:mm"))
+                .arg(entry.model)
+                .arg(firstLine);
+    }
+    case Qt::ToolTipRole:
+        return entry.result;
+    case Qt::DecorationRole: {
+        // 只有可见的行才会被请求缩略图
+        if (QPixmap *cached = thumbnailCache.object(entry.id)) {
+            return *cached;
+        }
+        QPixmap *pixmap = new QPixmap(QPixmap::fromImage(store->thumbnail(entry.id)));
+        thumbnailCache.insert(entry.id, pixmap);
+        return *pixmap;
+    }
+    case IdRole:
+        return entry.id;
+    default:
+        return QVariant();
+    }
+}
+
+bool HistoryModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && !exhausted;
+}
+
+void HistoryModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid() || exhausted) {
+        return;
+    }
+
+    const qint64 beforeId = rows.isEmpty() ? 0 : rows.last().id;
+    QList<HistoryEntry> page = store->page(currentQuery, beforeId, PageSize);
+    if (page.size() < PageSize) {
+        exhausted = true;
+    }
+    if (page.isEmpty()) {
+        return;
+    }
+
+    beginInsertRows(QModelIndex(), rows.size(), rows.size() + page.size() - 1);
+    rows.append(page);
+    endInsertRows();
+}
+
+void HistoryModel::onEntryAdded(qint64 id)
+{
+    // 搜索状态下新记录不一定匹配，等用户修改搜索词时再刷新
+    if (!currentQuery.trimmed().isEmpty()) {
+        return;
+    }
+    HistoryEntry entry = store->entry(id);
+    entry.result.truncate(HistoryStore::SnippetLength);
+
+    beginInsertRows(QModelIndex(), 0, 0);
+    rows.prepend(entry);
+    endInsertRows();
+}
+
+void HistoryModel::onEntryRemoved(qint64 id)
+{
+    for (int i = 0; i < rows.size(); ++i) {
+        if (rows.at(i).id == id) {
+            beginRemoveRows(QModelIndex(), i, i);
+            rows.removeAt(i);
+            endRemoveRows();
+            thumbnailCache.remove(id);
+            return;
+        }
+    }
+}
+
+HistoryPanel::HistoryPanel(HistoryStore *store, QWidget *parent)
+    : QDockWidget("识别历史", parent), store(store), loaded(false)
+{
+    setObjectName("historyPanel");
+
+    QWidget *container = new QWidget(this);
+    QVBoxLayout *layout = new QVBoxLayout(container);
+    layout->setContentsMargins(4, 4, 4, 4);
+
+    searchEdit = new QLineEdit(container);
+    searchEdit->setPlaceholderText("搜索公式或模型名…");
+    searchEdit->setClearButtonEnabled(true);
+    layout->addWidget(searchEdit);
+
+    model = new HistoryModel(store, this);
+    listView = new QListView(container);
+    listView->setModel(model);
+    listView->setIconSize(QSize(HistoryStore::ThumbnailWidth / 2, HistoryStore::ThumbnailHeight / 2));
+    // 所有行等高，视图不必为计算滚动条而遍历全部行
+    listView->setUniformItemSizes(true);
+    listView->setSelectionMode(QAbstractItemView::SingleSelection);
+    listView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    layout->addWidget(listView);
+
+    statusLabel = new QLabel(container);
+    layout->addWidget(statusLabel);
+
+    setWidget(container);
+
+    // 输入停顿后再查询，避免每个按键都触发一次搜索
+    searchDebounce.setSingleShot(true);
+    searchDebounce.setInterval(120);
+    connect(searchEdit, &QLineEdit::textChanged, &searchDebounce, static_cast<void (QTimer::*)()>(&QTimer::start));
+    connect(&searchDebounce, &QTimer::timeout, this, &HistoryPanel::onSearchTextChanged);
+    connect(listView, &QListView::activated, this, &HistoryPanel::onItemActivated);
+    connect(model, &QAbstractItemModel::rowsInserted, this, &HistoryPanel::updateStatus);
+    connect(model, &QAbstractItemModel::modelReset, this, &HistoryPanel::updateStatus);
+}
+
+void HistoryPanel::showEvent(QShowEvent *event)
+{
+    QDockWidget::showEvent(event);
+    // 首次显示时才加载第一页，启动时不访问历史数据
+    if (!loaded) {
+        loaded = true;
+        model->setQuery(QString());
+    }
+}
+
+void HistoryPanel::onSearchTextChanged()
+{
+    QElapsedTimer timer;
+    timer.start();
+    model->setQuery(searchEdit->text());
+    qDebug() << "History search" << searchEdit->text() << "took" << timer.elapsed() << "ms";
+}
+
+void HistoryPanel::onItemActivated(const QModelIndex &index)
+{
+    if (index.isValid()) {
+        emit entryActivated(index.data(HistoryModel::IdRole).toLongLong());
+    }
+}
+
+void HistoryPanel::updateStatus()
+{
+    if (model->query().trimmed().isEmpty()) {
+        statusLabel->setText(QString("共 %1 条记录").arg(store->count()));
+    } else {
+        statusLabel->setText(QString("已加载 %1 条匹配记录").arg(model->rowCount()));
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef HISTORYPANEL_H
+#define HISTORYPANEL_H
+
+#include <QAbstractListModel>
+#include <QCache>
+#include <QDockWidget>
+#include <QPixmap>
+#include <QTimer>
+#include "historystore.h"
+
+class QLineEdit;
+class QListView;
+class QLabel;
+
+// 历史记录列表模型：按页从 HistoryStore 读取，缩略图在视图请求时才加载
+class HistoryModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Roles {
+        IdRole = Qt::UserRole + 1
+    };
+
+    static const int PageSize = 50;
+
+    explicit HistoryModel(HistoryStore *store, QObject *parent = nullptr);
+
+    void setQuery(const QString &query);
+    QString query() const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+private slots:
+    void onEntryAdded(qint64 id);
+    void onEntryRemoved(qint64 id);
+
+private:
+    HistoryStore *store;
+    QString currentQuery;
+    QList<HistoryEntry> rows;
+    bool exhausted;
+    mutable QCache<qint64, QPixmap> thumbnailCache;
+};
+
+// 历史记录面板：增量搜索 + 分页列表
+class HistoryPanel : public QDockWidget
+{
+    Q_OBJECT
+
+public:
+    explicit HistoryPanel(HistoryStore *store, QWidget *parent = nullptr);
+
+signals:
+    // 用户双击了某条记录
+    void entryActivated(qint64 id);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+
+private slots:
+    void onSearchTextChanged();
+    void onItemActivated(const QModelIndex &index);
+
+private:
+    void updateStatus();
+
+    HistoryStore *store;
+    HistoryModel *model;
+    QLineEdit *searchEdit;
+    QListView *listView;
+    QLabel *statusLabel;
+    QTimer searchDebounce;
+    bool loaded;
+};
+
+#endif // HISTORYPANEL_H
@@ -0,0 +1,349 @@
+#include "historystore.h"
+#include "imageencoder.h"
+#include <QBuffer>
+#include <QDir>
+#include <QFileInfo>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QVariant>
+#include <QDebug>
+#include <limits>
+
+HistoryStore::HistoryStore(QObject *parent)
+    : QObject(parent),
+      connectionName(QString("history-%1").arg(quintptr(this))),
+      ftsEnabled(false)
+{
+}
+
+HistoryStore::~HistoryStore()
+{
+    close();
+}
+
+bool HistoryStore::open(const QString &databasePath)
+{
+    close();
+
+    QDir().mkpath(QFileInfo(databasePath).absolutePath());
+
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    db.setDatabaseName(databasePath);
+    if (!db.open()) {
+        lastError = QString("Failed to open history database: %1").arg(db.lastError().text());
+        qWarning() << lastError;
+        return false;
+    }
+
+    // WAL 模式下写入不阻塞读取，NORMAL 同步级别对历史记录足够安全
+    exec("PRAGMA journal_mode=WAL");
+    exec("PRAGMA synchronous=NORMAL");
+
+    if (!createSchema()) {
+        close();
+        return false;
+    }
+
+    qDebug() << "History database opened:" << databasePath << "FTS5:" << ftsEnabled;
+    return true;
+}
+
+void HistoryStore::close()
+{
+    if (!QSqlDatabase::contains(connectionName)) {
+        return;
+    }
+    {
+        QSqlDatabase db = QSqlDatabase::database(connectionName, false);
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+}
+
+bool HistoryStore::isOpen() const
+{
+    return QSqlDatabase::contains(connectionName)
+            && QSqlDatabase::database(connectionName, false).isOpen();
+}
+
+bool HistoryStore::exec(const QString &sql) const
+{
+    QSqlQuery query(QSqlDatabase::database(connectionName, false));
+    if (!query.exec(sql)) {
+        lastError = query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool HistoryStore::createSchema()
+{
+    const QStringList statements = {
+        "CREATE TABLE IF NOT EXISTS history ("
+        " id INTEGER PRIMARY KEY AUTOINCREMENT,"
+        " created_at INTEGER NOT NULL,"
+        " image_hash TEXT NOT NULL,"
+        " model TEXT,"
+        " result TEXT,"
+        " codec TEXT,"
+        " encode_us INTEGER,"
+        " network_ms INTEGER,"
+        " image_bytes INTEGER)",
+        "CREATE INDEX IF NOT EXISTS idx_history_hash ON history(image_hash)",
+        // 缩略图与主表分开存放，分页查询不会读到图像数据
+        "CREATE TABLE IF NOT EXISTS thumbnails (id INTEGER PRIMARY KEY, png BLOB)"
+    };
+    for (const QString &sql : statements) {
+        if (!exec(sql)) {
+            qWarning() << "Failed to create history schema:" << lastError;
+            return false;
+        }
+    }
+
+    QSqlQuery check(QSqlDatabase::database(connectionName, false));
+    check.exec("SELECT 1 FROM sqlite_master WHERE type='table' AND name='history_fts'");
+    const bool ftsExisted = check.next();
+
+    // 外部内容表：索引只保存 result/model 的倒排表，正文仍在 history 中
+    ftsEnabled = exec("CREATE VIRTUAL TABLE IF NOT EXISTS history_fts USING fts5("
+                      "result, model, content='history', content_rowid='id')");
+    if (!ftsEnabled) {
+        qWarning() << "SQLite FTS5 not available, history search falls back to LIKE:" << lastError;
+        return true;
+    }
+
+    exec("CREATE TRIGGER IF NOT EXISTS history_ai AFTER INSERT ON history BEGIN"
+         " INSERT INTO history_fts(rowid, result, model) VALUES (new.id, new.result, new.model);"
+         " END");
+    exec("CREATE TRIGGER IF NOT EXISTS history_ad AFTER DELETE ON history BEGIN"
+         " INSERT INTO history_fts(history_fts, rowid, result, model)"
+         " VALUES ('delete', old.id, old.result, old.model);"
+         " END");
+
+    // 索引是后建的（例如之前的 SQLite 不支持 FTS5），为已有记录补建
+    if (!ftsExisted && count() > 0) {
+        exec("INSERT INTO history_fts(history_fts) VALUES ('rebuild')");
+    }
+    return true;
+}
+
+QString HistoryStore::imageHash(const QImage &image)
+{
+    return QString::fromLatin1(ImageEncoder::contentHash(image));
+}
+
+qint64 HistoryStore::addEntry(const HistoryEntry &entry, const QImage &image)
+{
+    QSqlDatabase db = QSqlDatabase::database(connectionName, false);
+    if (!db.isOpen()) {
+        lastError = "History database is not open";
+        return 0;
+    }
+
+    QByteArray thumbnailPng;
+    if (!image.isNull()) {
+        QImage thumb = image.scaled(ThumbnailWidth, ThumbnailHeight, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        QBuffer buffer(&thumbnailPng);
+        buffer.open(QIODevice::WriteOnly);
+        thumb.save(&buffer, "PNG");
+    }
+
+    db.transaction();
+
+    QSqlQuery insert(db);
+    insert.prepare("INSERT INTO history (created_at, image_hash, model, result, codec, encode_us, network_ms, image_bytes)"
+                   " VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
+    QDateTime createdAt = entry.createdAt.isValid() ? entry.createdAt : QDateTime::currentDateTime();
+    insert.addBindValue(createdAt.toMSecsSinceEpoch());
+    insert.addBindValue(entry.imageHash.isEmpty() && !image.isNull() ? imageHash(image) : entry.imageHash);
+    insert.addBindValue(entry.model);
+    insert.addBindValue(entry.result);
+    insert.addBindValue(entry.codec);
+    insert.addBindValue(entry.encodeUs);
+    insert.addBindValue(entry.networkMs);
+    insert.addBindValue(entry.imageBytes);
+    if (!insert.exec()) {
+        lastError = insert.lastError().text();
+        qWarning() << "Failed to insert history entry:" << lastError;
+        db.rollback();
+        return 0;
+    }
+    const qint64 id = insert.lastInsertId().toLongLong();
+
+    if (!thumbnailPng.isEmpty()) {
+        QSqlQuery thumbInsert(db);
+        thumbInsert.prepare("INSERT OR REPLACE INTO thumbnails (id, png) VALUES (?, ?)");
+        thumbInsert.addBindValue(id);
+        thumbInsert.addBindValue(thumbnailPng);
+        if (!thumbInsert.exec()) {
+            qWarning() << "Failed to store history thumbnail:" << thumbInsert.lastError().text();
+        }
+    }
+
+    db.commit();
+    emit entryAdded(id);
+    return id;
+}
+
+QString HistoryStore::buildMatchExpression(const QString &query)
+{
+    // 与 FTS5 的 unicode61 分词保持一致：字母和数字组成词，其余字符都是分隔符
+    // 每个词都做前缀匹配，多个词之间为 AND，实现输入即搜索
+    QStringList terms;
+    QString current;
+    for (const QChar &ch : query) {
+        if (ch.isLetterOrNumber()) {
+            current += ch;
+        } else if (!current.isEmpty()) {
+            terms << current;
+            current.clear();
+        }
+    }
+    if (!current.isEmpty()) {
+        terms << current;
+    }
+
+    QStringList parts;
+    for (const QString &term : terms) {
+        parts << QString("\"%1\"*").arg(term);
+    }
+    return parts.join(' ');
+}
+
+QList<HistoryEntry> HistoryStore::page(const QString &query, qint64 beforeId, int limit) const
+{
+    QList<HistoryEntry> entries;
+    QSqlDatabase db = QSqlDatabase::database(connectionName, false);
+    if (!db.isOpen()) {
+        return entries;
+    }
+
+    const qint64 before = beforeId > 0 ? beforeId : std::numeric_limits<qint64>::max();
+    const QString columns = QString("h.id, h.created_at, h.image_hash, h.model, substr(h.result, 1, %1),"
+                                    " h.codec, h.encode_us, h.network_ms, h.image_bytes").arg(SnippetLength);
+    const QString trimmed = query.trimmed();
+    const QString match = ftsEnabled ? buildMatchExpression(trimmed) : QString();
+
+    QSqlQuery select(db);
+    select.setForwardOnly(true);
+    if (trimmed.isEmpty()) {
+        select.prepare(QString("SELECT %1 FROM history h WHERE h.id < ? ORDER BY h.id DESC LIMIT ?").arg(columns));
+        select.addBindValue(before);
+        select.addBindValue(limit);
+    } else if (!match.isEmpty()) {
+        // 先在索引中按 rowid 倒序取出一页，再回表读取摘要
+        select.prepare(QString("SELECT %1 FROM history h JOIN ("
+                               " SELECT rowid FROM history_fts WHERE history_fts MATCH ? AND rowid < ?"
+                               " ORDER BY rowid DESC LIMIT ?) f ON h.id = f.rowid"
+                               " ORDER BY h.id DESC").arg(columns));
+        select.addBindValue(match);
+        select.addBindValue(before);
+        select.addBindValue(limit);
+    } else {
+        QString pattern = trimmed;
+        pattern.replace("\\", "\\\\").replace("%", "\\%").replace("_", "\\_");
+        pattern = "%" + pattern + "%";
+        select.prepare(QString("SELECT %1 FROM history h WHERE h.id < ?"
+                               " AND (h.result LIKE ? ESCAPE '\\' OR h.model LIKE ? ESCAPE '\\')"
+                               " ORDER BY h.id DESC LIMIT ?").arg(columns));
+        select.addBindValue(before);
+        select.addBindValue(pattern);
+        select.addBindValue(pattern);
+        select.addBindValue(limit);
+    }
+
+    if (!select.exec()) {
+        lastError = select.lastError().text();
+        qWarning() << "History query failed:" << lastError;
+        return entries;
+    }
+
+    while (select.next()) {
+        HistoryEntry e;
+        e.id = select.value(0).toLongLong();
+        e.createdAt = QDateTime::fromMSecsSinceEpoch(select.value(1).toLongLong());
+        e.imageHash = select.value(2).toString();
+        e.model = select.value(3).toString();
+        e.result = select.value(4).toString();
+        e.codec = select.value(5).toString();
+        e.encodeUs = select.value(6).toLongLong();
+        e.networkMs = select.value(7).toLongLong();
+        e.imageBytes = select.value(8).toLongLong();
+        entries.append(e);
+    }
+    return entries;
+}
+
+HistoryEntry HistoryStore::entry(qint64 id) const
+{
+    HistoryEntry e;
+    QSqlQuery select(QSqlDatabase::database(connectionName, false));
+    select.prepare("SELECT id, created_at, image_hash, model, result, codec, encode_us, network_ms, image_bytes"
+                   " FROM history WHERE id = ?");
+    select.addBindValue(id);
+    if (select.exec() && select.next()) {
+        e.id = select.value(0).toLongLong();
+        e.createdAt = QDateTime::fromMSecsSinceEpoch(select.value(1).toLongLong());
+        e.imageHash = select.value(2).toString();
+        e.model = select.value(3).toString();
+        e.result = select.value(4).toString();
+        e.codec = select.value(5).toString();
+        e.encodeUs = select.value(6).toLongLong();
+        e.networkMs = select.value(7).toLongLong();
+        e.imageBytes = select.value(8).toLongLong();
+    }
+    return e;
+}
+
+QImage HistoryStore::thumbnail(qint64 id) const
+{
+    QSqlQuery select(QSqlDatabase::database(connectionName, false));
+    select.prepare("SELECT png FROM thumbnails WHERE id = ?");
+    select.addBindValue(id);
+    if (select.exec() && select.next()) {
+        return QImage::fromData(select.value(0).toByteArray(), "PNG");
+    }
+    return QImage();
+}
+
+bool HistoryStore::removeEntry(qint64 id)
+{
+    QSqlDatabase db = QSqlDatabase::database(connectionName, false);
+    db.transaction();
+    QSqlQuery remove(db);
+    remove.prepare("DELETE FROM history WHERE id = ?");
+    remove.addBindValue(id);
+    bool ok = remove.exec();
+    if (ok) {
+        QSqlQuery removeThumb(db);
+        removeThumb.prepare("DELETE FROM thumbnails WHERE id = ?");
+        removeThumb.addBindValue(id);
+        removeThumb.exec();
+    } else {
+        lastError = remove.lastError().text();
+    }
+    db.commit();
+    if (ok) {
+        emit entryRemoved(id);
+    }
+    return ok;
+}
+
+qint64 HistoryStore::count() const
+{
+    QSqlQuery select(QSqlDatabase::database(connectionName, false));
+    if (select.exec("SELECT count(*) FROM history") && select.next()) {
+        return select.value(0).toLongLong();
+    }
+    return 0;
+}
+
+bool HistoryStore::hasFullTextSearch() const
+{
+    return ftsEnabled;
+}
+
+QString HistoryStore::getLastError() const
+{
+    return lastError;
+}
@@ -0,0 +1,76 @@
+#ifndef HISTORYSTORE_H
+#define HISTORYSTORE_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QImage>
+#include <QList>
+#include <QSqlDatabase>
+#include <QString>
+
+// 一条识别记录
+struct HistoryEntry
+{
+    qint64 id = 0;
+    QDateTime createdAt;
+    QString imageHash;   // 截图内容的 SHA-1，用于去重和定位
+    QString model;
+    QString result;      // Markdown/LaTeX 识别结果（分页查询时只包含前若干字符）
+    QString codec;
+    qint64 encodeUs = 0;
+    qint64 networkMs = 0;
+    qint64 imageBytes = 0;
+};
+
+// 识别历史的持久化存储：SQLite + FTS5 全文索引
+// 列表查询只读取摘要列，缩略图单独存表并按需加载，启动时间与历史条数无关
+class HistoryStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit HistoryStore(QObject *parent = nullptr);
+    ~HistoryStore();
+
+    bool open(const QString &databasePath);
+    void close();
+    bool isOpen() const;
+
+    // 添加记录，返回新记录的 id；失败返回 0
+    qint64 addEntry(const HistoryEntry &entry, const QImage &image);
+
+    // 按 id 倒序分页查询；query 为空时列出全部，否则做前缀全文搜索
+    // beforeId 为 0 表示从最新的记录开始
+    QList<HistoryEntry> page(const QString &query, qint64 beforeId, int limit) const;
+
+    HistoryEntry entry(qint64 id) const;
+    QImage thumbnail(qint64 id) const;
+    bool removeEntry(qint64 id);
+    qint64 count() const;
+
+    bool hasFullTextSearch() const;
+    QString getLastError() const;
+
+    static QString imageHash(const QImage &image);
+
+    // 缩略图的最大尺寸
+    static const int ThumbnailWidth = 240;
+    static const int ThumbnailHeight = 80;
+    // 分页结果中 result 的最大字符数
+    static const int SnippetLength = 200;
+
+signals:
+    void entryAdded(qint64 id);
+    void entryRemoved(qint64 id);
+
+private:
+    bool createSchema();
+    bool exec(const QString &sql) const;
+    static QString buildMatchExpression(const QString &query);
+
+    QString connectionName;
+    bool ftsEnabled;
+    mutable QString lastError;
+};
+
+#endif // HISTORYSTORE_H
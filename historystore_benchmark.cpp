@@ -0,0 +1,139 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include "historystore.h"
+
+// 识别历史在 10 万条记录下的查询性能
+class HistoryStoreBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void testSearchResults();
+
+    void benchFirstPage();
+    void benchDeepPage();
+    void benchSearch_data();
+    void benchSearch();
+    void benchThumbnail();
+
+private:
+    static const int EntryCount = 100000;
+
+    QTemporaryDir tempDir;
+    HistoryStore store;
+    qint64 thumbnailId = 0;
+};
+
+void HistoryStoreBenchmark::initTestCase()
+{
+    QVERIFY(tempDir.isValid());
+    QVERIFY(store.open(tempDir.filePath("history.sqlite")));
+
+    static const char *const templates[] = {
+        "$$\\frac{a_%1}{b} + \\sqrt{x^2 + y^2}$$",
+        "$\\int_0^%1 e^{-x} dx$",
+        "$$\\sum_{k=1}^{%1} k = \\frac{n(n+1)}{2}$$",
+        "$\\alpha + \\beta_%1 = \\gamma$",
+        "$$\\lim_{n \\to \\infty} (1 + 1/n)^{%1}$$",
+    };
+    static const char *const models[] = {"qwen2.5vl:7b", "qwen2.5vl:3b", "llava:13b"};
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < EntryCount; ++i) {
+        HistoryEntry entry;
+        entry.imageHash = QString::number(i, 16);
+        entry.model = models[i % 3];
+        entry.result = QString(templates[i % 5]).arg(i);
+        // 只给最后一条存缩略图，填充阶段不计入图像编码开销
+        QImage image;
+        if (i == EntryCount - 1) {
+            image = QImage(400, 100, QImage::Format_RGB32);
+            image.fill(Qt::white);
+        }
+        qint64 id = store.addEntry(entry, image);
+        QVERIFY(id > 0);
+        if (!image.isNull()) {
+            thumbnailId = id;
+        }
+    }
+    qInfo() << "Inserted" << EntryCount << "entries in" << timer.elapsed() << "ms, FTS5:" << store.hasFullTextSearch();
+}
+
+void HistoryStoreBenchmark::testSearchResults()
+{
+    QCOMPARE(store.count(), qint64(EntryCount));
+
+    // 前缀搜索：每 5 条中有 1 条包含 \sqrt
+    QList<HistoryEntry> page = store.page("sqr", 0, 50);
+    QCOMPARE(page.size(), 50);
+    for (const HistoryEntry &entry : page) {
+        QVERIFY(entry.result.contains("sqrt"));
+    }
+
+    // 分页：第二页紧接第一页，id 严格递减
+    QList<HistoryEntry> next = store.page("sqr", page.last().id, 50);
+    QCOMPARE(next.size(), 50);
+    QVERIFY(next.first().id < page.last().id);
+
+    // 多个词之间为 AND
+    QList<HistoryEntry> both = store.page("alpha llava", 0, 50);
+    QVERIFY(!both.isEmpty());
+    for (const HistoryEntry &entry : both) {
+        QVERIFY(entry.result.contains("alpha"));
+        QCOMPARE(entry.model, QString("llava:13b"));
+    }
+}
+
+void HistoryStoreBenchmark::benchFirstPage()
+{
+    QBENCHMARK {
+        QList<HistoryEntry> page = store.page(QString(), 0, 50);
+        Q_UNUSED(page);
+    }
+}
+
+void HistoryStoreBenchmark::benchDeepPage()
+{
+    // 键集分页：翻到最早的记录附近与第一页代价相同
+    QBENCHMARK {
+        QList<HistoryEntry> page = store.page(QString(), 100, 50);
+        Q_UNUSED(page);
+    }
+}
+
+void HistoryStoreBenchmark::benchSearch_data()
+{
+    QTest::addColumn<QString>("query");
+    QTest::newRow("f") << "f";
+    QTest::newRow("fra") << "fra";
+    QTest::newRow("frac") << "frac";
+    QTest::newRow("lim infty") << "lim infty";
+    QTest::newRow("model") << "llava";
+    QTest::newRow("no-match") << "zeta";
+    QTest::newRow("symbols-only") << "^{";
+}
+
+void HistoryStoreBenchmark::benchSearch()
+{
+    QFETCH(QString, query);
+    QBENCHMARK {
+        QList<HistoryEntry> page = store.page(query, 0, 50);
+        Q_UNUSED(page);
+    }
+}
+
+void HistoryStoreBenchmark::benchThumbnail()
+{
+    QVERIFY(thumbnailId > 0);
+    QBENCHMARK {
+        QImage thumb = store.thumbnail(thumbnailId);
+        Q_UNUSED(thumb);
+    }
+}
+
+QTEST_MAIN(HistoryStoreBenchmark)
+#include "historystore_benchmark.moc"
@@ -0,0 +1,345 @@
+#include <QTest>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QGuiApplication>
+#include <QScreen>
+#include <QScopedPointer>
+#include <algorithm>
+#include "ollamaclient.h"
+#include "ollamabackend.h"
+#include "imageencoder.h"
+#include "screenshotoverlay.h"
+#include "capturebackend.h"
+#include "benchmarkutils.h"
+
+// 图像采集与编码路径的微基准：
+// 截图后端抓屏 -> ScreenshotOverlay 的选区裁剪 -> ImageEncoder 编码 -> base64 -> JSON 请求体
+class ImageCaptureBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    // 抓屏：各截图后端 × 单屏 1080p / 4K / 双 4K 大小的区域（需要真实的 X 服务器或 Xvfb）
+    void benchGrab_data();
+    void benchGrab();
+    void reportGrab();
+
+    void benchCrop_data();
+    void benchCrop();
+    void benchEncode_data();
+    void benchEncode();
+    void benchBase64_data();
+    void benchBase64();
+    void benchSerialize_data();
+    void benchSerialize();
+
+    // 汇总表：每种尺寸 × 编码设置一行
+    void reportTable();
+
+private:
+    struct Codec
+    {
+        QString name;
+        ImageEncoder::Settings settings;
+    };
+
+    static Codec makeCodec(const QString &name, const QString &codec, int level);
+
+    void addSizeRows();
+    void addSizeCodecRows();
+    QRect selectionFor(const QSize &size) const;
+    static qint64 medianUs(QVector<qint64> samples);
+    // 所有屏幕合起来的范围（逻辑坐标）
+    static QRect virtualDesktop();
+
+    QPixmap desktopPixmap;
+    QList<QSize> sizes;
+    QList<Codec> codecs;
+    QList<QSize> grabSizes;
+};
+
+void ImageCaptureBenchmark::initTestCase()
+{
+    // 模拟一块 4K 屏幕的冻结截图，与 ScreenshotOverlay::desktopPixmap 同等规格
+    desktopPixmap = QPixmap::fromImage(BenchmarkUtils::renderFormulaImage(QSize(3840, 2160)));
+    QVERIFY(!desktopPixmap.isNull());
+
+    sizes = {QSize(100, 50), QSize(320, 80), QSize(800, 200), QSize(1280, 720),
+             QSize(1920, 1080), QSize(3840, 2160)};
+
+    codecs = {makeCodec("png-default", "png", -1),
+              makeCodec("png-level1", "png", 1),
+              makeCodec("png-level5", "png", 5),
+              makeCodec("png-level9", "png", 9),
+              makeCodec("jpeg-q90", "jpeg", 90),
+              makeCodec("jpeg-auto", "jpeg", 0),
+              makeCodec("auto", "auto", 0)};
+
+    // 双 4K 模拟多屏：X 的根窗口覆盖所有屏幕，一次抓取跨越两块屏幕
+    grabSizes = {QSize(1920, 1080), QSize(3840, 2160), QSize(7680, 2160)};
+    if (ImageEncoder::isFormatSupported("webp")) {
+        codecs.append(makeCodec("webp-lossless", "webp", 100));
+        codecs.append(makeCodec("webp-q80", "webp", 80));
+        codecs.append(makeCodec("auto+webp", "auto", 1));
+    } else {
+        qInfo() << "WebP image plugin not available, skipping WebP rows";
+    }
+}
+
+ImageCaptureBenchmark::Codec ImageCaptureBenchmark::makeCodec(const QString &name, const QString &codec, int level)
+{
+    // level 的含义随编码而定：PNG 为 zlib 级别，JPEG/WebP 为质量，auto 时非 0 表示允许 WebP
+    Codec result;
+    result.name = name;
+    result.settings.codec = codec;
+    if (codec == "png") {
+        result.settings.pngCompression = level;
+    } else if (codec == "jpeg") {
+        result.settings.jpegQuality = level;
+    } else if (codec == "webp") {
+        result.settings.webpQuality = level;
+    } else {
+        result.settings.autoAllowWebp = level != 0;
+    }
+    return result;
+}
+
+QRect ImageCaptureBenchmark::selectionFor(const QSize &size) const
+{
+    // 选区居中，避免总是从 (0,0) 开始裁剪
+    QRect rect(QPoint(0, 0), size);
+    rect.moveCenter(desktopPixmap.rect().center());
+    return rect.intersected(desktopPixmap.rect());
+}
+
+qint64 ImageCaptureBenchmark::medianUs(QVector<qint64> samples)
+{
+    std::sort(samples.begin(), samples.end());
+    return samples.isEmpty() ? 0 : samples.at(samples.size() / 2);
+}
+
+QRect ImageCaptureBenchmark::virtualDesktop()
+{
+    QRect desktop;
+    for (QScreen *screen : QGuiApplication::screens()) {
+        desktop |= screen->geometry();
+    }
+    return desktop;
+}
+
+void ImageCaptureBenchmark::benchGrab_data()
+{
+    QTest::addColumn<QString>("backend");
+    QTest::addColumn<QSize>("size");
+    for (const QString &backend : {QString("qt"), QString("xcb-shm")}) {
+        for (const QSize &size : grabSizes) {
+            QTest::newRow(qPrintable(QString("%1/%2x%3").arg(backend).arg(size.width()).arg(size.height())))
+                    << backend << size;
+        }
+    }
+}
+
+void ImageCaptureBenchmark::benchGrab()
+{
+    QFETCH(QString, backend);
+    QFETCH(QSize, size);
+
+    QScopedPointer<CaptureBackend> capture(CaptureBackend::create(backend));
+    if (capture->name() != backend) {
+        QSKIP("Capture backend not available (xcb-shm needs CONFIG+=xcb_shm and -platform xcb)");
+    }
+    const QRect region(virtualDesktop().topLeft(), size);
+    if (!virtualDesktop().contains(region)) {
+        QSKIP("Desktop smaller than the grab region (e.g. Xvfb :99 -screen 0 7680x2160x24)");
+    }
+    QVERIFY(!capture->grab(region).isNull());
+
+    QBENCHMARK {
+        QImage image = capture->grab(region);
+        Q_UNUSED(image);
+    }
+}
+
+void ImageCaptureBenchmark::reportGrab()
+{
+    const int iterations = 7;
+    QTextStream out(stdout);
+    out << "\n";
+    out << QString("%1 %2 %3 %4\n")
+               .arg("backend", -9).arg("size", -10).arg("grab(us)", 9).arg("MB/s", 8);
+
+    for (const QString &backend : {QString("qt"), QString("xcb-shm")}) {
+        QScopedPointer<CaptureBackend> capture(CaptureBackend::create(backend));
+        if (capture->name() != backend) {
+            out << QString("%1 (not available)\n").arg(backend, -9);
+            continue;
+        }
+        for (const QSize &size : grabSizes) {
+            const QRect region(virtualDesktop().topLeft(), size);
+            if (!virtualDesktop().contains(region)) {
+                continue;
+            }
+            QVector<qint64> samples;
+            for (int i = 0; i < iterations; ++i) {
+                QElapsedTimer timer;
+                timer.start();
+                QImage image = capture->grab(region);
+                samples.append(timer.nsecsElapsed() / 1000);
+                Q_UNUSED(image);
+            }
+            const qint64 us = qMax<qint64>(1, medianUs(samples));
+            const double mbps = double(size.width()) * size.height() * 4 / us;
+            out << QString("%1 %2 %3 %4\n")
+                       .arg(backend, -9)
+                       .arg(QString("%1x%2").arg(size.width()).arg(size.height()), -10)
+                       .arg(us, 9).arg(mbps, 8, 'f', 0);
+        }
+    }
+    out.flush();
+}
+
+void ImageCaptureBenchmark::addSizeRows()
+{
+    QTest::addColumn<QSize>("size");
+    for (const QSize &size : sizes) {
+        QTest::newRow(qPrintable(QString("%1x%2").arg(size.width()).arg(size.height()))) << size;
+    }
+}
+
+void ImageCaptureBenchmark::addSizeCodecRows()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<int>("codecIndex");
+    for (const QSize &size : sizes) {
+        for (int i = 0; i < codecs.size(); ++i) {
+            QString name = QString("%1x%2/%3").arg(size.width()).arg(size.height()).arg(codecs[i].name);
+            QTest::newRow(qPrintable(name)) << size << i;
+        }
+    }
+}
+
+void ImageCaptureBenchmark::benchCrop_data()
+{
+    addSizeRows();
+}
+
+void ImageCaptureBenchmark::benchCrop()
+{
+    QFETCH(QSize, size);
+    QRect selection = selectionFor(size);
+
+    QBENCHMARK {
+        QPixmap cropped = ScreenshotOverlay::cropSelection(desktopPixmap, selection);
+        Q_UNUSED(cropped);
+    }
+}
+
+void ImageCaptureBenchmark::benchEncode_data()
+{
+    addSizeCodecRows();
+}
+
+void ImageCaptureBenchmark::benchEncode()
+{
+    QFETCH(QSize, size);
+    QFETCH(int, codecIndex);
+    QPixmap cropped = ScreenshotOverlay::cropSelection(desktopPixmap, selectionFor(size));
+    const Codec &codec = codecs.at(codecIndex);
+
+    QBENCHMARK {
+        ImageEncoder::Result encoded = ImageEncoder::encode(cropped, codec.settings);
+        Q_UNUSED(encoded);
+    }
+}
+
+void ImageCaptureBenchmark::benchBase64_data()
+{
+    addSizeRows();
+}
+
+void ImageCaptureBenchmark::benchBase64()
+{
+    QFETCH(QSize, size);
+    QPixmap cropped = ScreenshotOverlay::cropSelection(desktopPixmap, selectionFor(size));
+    QByteArray png = ImageEncoder::encode(cropped, ImageEncoder::Settings()).data;
+    QVERIFY(!png.isEmpty());
+
+    QBENCHMARK {
+        QByteArray base64 = png.toBase64();
+        Q_UNUSED(base64);
+    }
+}
+
+void ImageCaptureBenchmark::benchSerialize_data()
+{
+    addSizeRows();
+}
+
+void ImageCaptureBenchmark::benchSerialize()
+{
+    QFETCH(QSize, size);
+    QPixmap cropped = ScreenshotOverlay::cropSelection(desktopPixmap, selectionFor(size));
+    QByteArray png = ImageEncoder::encode(cropped, ImageEncoder::Settings()).data;
+    QVERIFY(!png.isEmpty());
+    QByteArray base64 = png.toBase64();
+    const QString prompt = OllamaClient::recognitionPrompt();
+
+    QBENCHMARK {
+        QByteArray payload = OllamaBackend::buildPayload("qwen2.5vl:7b", prompt, base64, false);
+        Q_UNUSED(payload);
+    }
+}
+
+void ImageCaptureBenchmark::reportTable()
+{
+    const int iterations = 7;
+    const QString prompt = OllamaClient::recognitionPrompt();
+
+    QTextStream out(stdout);
+    out << "\n";
+    out << QString("%1 %2 %3 %4 %5 %6 %7 %8\n")
+               .arg("size", -10).arg("codec", -14)
+               .arg("crop(us)", 9).arg("encode(us)", 11).arg("bytes", 10)
+               .arg("base64(us)", 11).arg("json(us)", 9).arg("total(us)", 10);
+
+    for (const QSize &size : sizes) {
+        QRect selection = selectionFor(size);
+        for (const Codec &codec : codecs) {
+            QVector<qint64> crop, enc, b64, json;
+            qint64 bytes = 0;
+            for (int i = 0; i < iterations; ++i) {
+                QElapsedTimer timer;
+                timer.start();
+                QPixmap cropped = ScreenshotOverlay::cropSelection(desktopPixmap, selection);
+                crop.append(timer.nsecsElapsed() / 1000);
+
+                timer.restart();
+                QByteArray encoded = ImageEncoder::encode(cropped, codec.settings).data;
+                enc.append(timer.nsecsElapsed() / 1000);
+                bytes = encoded.size();
+
+                timer.restart();
+                QByteArray base64 = encoded.toBase64();
+                b64.append(timer.nsecsElapsed() / 1000);
+
+                timer.restart();
+                QByteArray payload = OllamaBackend::buildPayload("qwen2.5vl:7b", prompt, base64, false);
+                json.append(timer.nsecsElapsed() / 1000);
+                Q_UNUSED(payload);
+            }
+
+            qint64 total = medianUs(crop) + medianUs(enc) + medianUs(b64) + medianUs(json);
+            out << QString("%1 %2 %3 %4 %5 %6 %7 %8\n")
+                       .arg(QString("%1x%2").arg(size.width()).arg(size.height()), -10)
+                       .arg(codec.name, -14)
+                       .arg(medianUs(crop), 9).arg(medianUs(enc), 11).arg(bytes, 10)
+                       .arg(medianUs(b64), 11).arg(medianUs(json), 9).arg(total, 10);
+        }
+    }
+    out.flush();
+}
+
+QTEST_MAIN(ImageCaptureBenchmark)
+#include "imagecapture_benchmark.moc"
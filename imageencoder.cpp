@@ -0,0 +1,120 @@
+#include "imageencoder.h"
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QImageWriter>
+#include <QDebug>
+
+bool ImageEncoder::isFormatSupported(const QString &format)
+{
+    return QImageWriter::supportedImageFormats().contains(format.toLatin1());
+}
+
+int ImageEncoder::pngQualityForLevel(int level)
+{
+    if (level < 0) {
+        return -1;
+    }
+    level = qMin(level, 9);
+    return 100 - (level * 91 + 8) / 9;
+}
+
+bool ImageEncoder::write(const QImage &image, const char *format, int quality, QByteArray *out)
+{
+    out->clear();
+    QBuffer buffer(out);
+    buffer.open(QIODevice::WriteOnly);
+    return image.save(&buffer, format, quality);
+}
+
+QByteArray ImageEncoder::contentHash(const QImage &image)
+{
+    QImage normalized = image.convertToFormat(QImage::Format_ARGB32);
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray::number(normalized.width()) + 'x' + QByteArray::number(normalized.height()));
+    const int rowBytes = normalized.width() * 4;
+    for (int y = 0; y < normalized.height(); ++y) {
+        hash.addData(reinterpret_cast<const char *>(normalized.constScanLine(y)), rowBytes);
+    }
+    return hash.result().toHex();
+}
+
+ImageEncoder::Settings ImageEncoder::resolveAuto(const QSize &size, const Settings &settings)
+{
+    Settings resolved = settings;
+    if (settings.codec != "auto") {
+        return resolved;
+    }
+
+    const qint64 pixels = qint64(size.width()) * size.height();
+    if (pixels <= SmallCropPixels) {
+        // 小选区：编码本身只需几毫秒，用默认压缩级别换取最小的上传体积
+        resolved.codec = "png";
+        resolved.pngCompression = -1;
+    } else if (pixels <= LargeCropPixels || !settings.autoAllowWebp || !isFormatSupported("webp")) {
+        // 中等及以上选区：默认级别的 zlib 耗时随像素数快速增长，1 级压缩快数倍而体积只略大
+        resolved.codec = "png";
+        resolved.pngCompression = 1;
+    } else {
+        // 大选区：无损 WebP 的体积明显小于 PNG，节省的上传时间超过编码开销
+        resolved.codec = "webp";
+        resolved.webpQuality = 100;
+    }
+    return resolved;
+}
+
+ImageEncoder::Result ImageEncoder::encode(const QPixmap &pixmap, const Settings &settings)
+{
+    return encode(pixmap.toImage(), settings);
+}
+
+ImageEncoder::Result ImageEncoder::encode(const QImage &image, const Settings &settings)
+{
+    Result result;
+    if (image.isNull()) {
+        return result;
+    }
+
+    Settings resolved = resolveAuto(image.size(), settings);
+
+    if (resolved.codec == "webp" && !isFormatSupported("webp")) {
+        qWarning() << "WebP image plugin not available, falling back to PNG";
+        resolved.codec = "png";
+    }
+
+    if (resolved.codec == "jpeg") {
+        result.format = "jpeg";
+        if (resolved.jpegQuality > 0) {
+            result.quality = qMin(resolved.jpegQuality, 100);
+            result.ok = write(image, "JPEG", result.quality, &result.data);
+        } else {
+            // 自动质量：从高到低尝试，取第一个不超过目标大小的结果
+            static const int qualities[] = {92, 85, 78, 70};
+            const int budget = qMax(1, resolved.maxUploadKB) * 1024;
+            for (int quality : qualities) {
+                result.quality = quality;
+                result.ok = write(image, "JPEG", quality, &result.data);
+                if (!result.ok || result.data.size() <= budget) {
+                    break;
+                }
+            }
+        }
+        result.codec = QString("jpeg-%1").arg(result.quality);
+    } else if (resolved.codec == "webp") {
+        result.format = "webp";
+        result.quality = qBound(0, resolved.webpQuality, 100);
+        result.ok = write(image, "WEBP", result.quality, &result.data);
+        result.codec = QString("webp-%1").arg(result.quality);
+    } else {
+        result.format = "png";
+        result.quality = pngQualityForLevel(resolved.pngCompression);
+        result.ok = write(image, "PNG", result.quality, &result.data);
+        result.codec = resolved.pngCompression < 0
+                ? QString("png-default")
+                : QString("png-%1").arg(qMin(resolved.pngCompression, 9));
+    }
+
+    if (settings.codec == "auto") {
+        result.codec.prepend("auto:");
+    }
+    return result;
+}
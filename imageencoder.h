@@ -0,0 +1,55 @@
+#ifndef IMAGEENCODER_H
+#define IMAGEENCODER_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QPixmap>
+#include <QSize>
+#include <QString>
+
+// 上传图像的编码器：PNG（可选 zlib 压缩级别）、JPEG、WebP，以及按选区尺寸自动选择
+class ImageEncoder
+{
+public:
+    struct Settings
+    {
+        QString codec = "png";      // "png" / "jpeg" / "webp" / "auto"
+        int pngCompression = -1;    // zlib 压缩级别 0-9，-1 为默认级别
+        int jpegQuality = 90;       // 1-100；0 表示按 maxUploadKB 自动调整
+        int webpQuality = 100;      // 100 为无损
+        int maxUploadKB = 1024;     // JPEG 自动质量的目标大小
+        bool autoAllowWebp = false; // auto 模式是否可选 WebP（需服务端支持 WebP 解码）
+    };
+
+    struct Result
+    {
+        bool ok = false;
+        QByteArray data;
+        QString codec;   // 实际使用的编码，如 "png-1"、"jpeg-85"、"webp-100"
+        QString format;  // "png" / "jpeg" / "webp"
+        int quality = -1;
+    };
+
+    // auto 模式的尺寸阈值（像素数）
+    static const qint64 SmallCropPixels = 512 * 512;
+    static const qint64 LargeCropPixels = 1920 * 1080;
+
+    static Result encode(const QImage &image, const Settings &settings);
+    static Result encode(const QPixmap &pixmap, const Settings &settings);
+
+    // 图像像素内容的 SHA-1（十六进制），与编码方式无关
+    static QByteArray contentHash(const QImage &image);
+
+    // 按选区尺寸解析 auto 模式，返回具体的编码设置（codec 不再为 "auto"）
+    static Settings resolveAuto(const QSize &size, const Settings &settings);
+
+    static bool isFormatSupported(const QString &format);
+
+    // Qt 的 PNG 写入器把 quality 映射为 (100 - quality) * 9 / 91，这里做反向换算
+    static int pngQualityForLevel(int level);
+
+private:
+    static bool write(const QImage &image, const char *format, int quality, QByteArray *out);
+};
+
+#endif // IMAGEENCODER_H
@@ -0,0 +1,49 @@
+#include "inferencebackend.h"
+#include "ollamabackend.h"
+#include "openaibackend.h"
+
+QString InferenceBackend::Decoder::text() const
+{
+    return decoded;
+}
+
+bool InferenceBackend::Decoder::hasError() const
+{
+    return !error.isEmpty();
+}
+
+QString InferenceBackend::Decoder::errorString() const
+{
+    return error;
+}
+
+InferenceBackend::Usage InferenceBackend::Decoder::usage() const
+{
+    return stats;
+}
+
+void InferenceBackend::setUrl(const QString &url)
+{
+    endpoint = url;
+}
+
+QString InferenceBackend::url() const
+{
+    return endpoint;
+}
+
+InferenceBackend *InferenceBackend::create(const QString &api)
+{
+    if (api == "ollama") {
+        return new OllamaBackend;
+    }
+    if (api == "openai") {
+        return new OpenAiBackend;
+    }
+    return nullptr;
+}
+
+QStringList InferenceBackend::availableApis()
+{
+    return {"ollama", "openai"};
+}
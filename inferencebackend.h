@@ -0,0 +1,81 @@
+#ifndef INFERENCEBACKEND_H
+#define INFERENCEBACKEND_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+
+// 推理后端：一次识别调用在线路上的格式。
+// 编码、去重、切分、重新提问和分级识别都在 OllamaClient 中，与后端无关；
+// 后端只负责把一次调用写成请求体，并把（可能是流式的）响应解码为模型输出的文本和统计字段
+class InferenceBackend
+{
+public:
+    // 一次调用
+    struct Request
+    {
+        QString model;
+        QString prompt;
+        QByteArray base64Image;
+        QString mimeType = "image/png";
+        bool structured = false;   // 输出约束为 FormulaJsonReader::schema() 描述的公式列表
+        QJsonObject options;       // GenerationOptions::build 的结果（Ollama 的 options 命名），由后端映射到各自的参数
+    };
+
+    // 响应中的统计字段，服务端没有给出的保持为 0
+    struct Usage
+    {
+        int promptTokens = 0;      // 输入 token 数（含图像）
+        qint64 promptMs = 0;       // 预填充耗时
+        int completionTokens = 0;  // 生成的 token 数
+        qint64 completionMs = 0;   // 解码耗时
+        qint64 loadMs = 0;         // 模型加载耗时
+        QString doneReason;        // "stop" 或 "length"（达到生成上限）
+    };
+
+    // 一次响应的解码器，响应数据可以在任意位置切开送入
+    class Decoder
+    {
+    public:
+        virtual ~Decoder() = default;
+
+        // 追加响应数据，返回其中新解码出的文本
+        virtual QString feed(const QByteArray &data) = 0;
+        // 响应结束：处理缓冲区中剩余的数据，返回其中的文本
+        virtual QString finish() = 0;
+
+        QString text() const;          // 至今解码出的全部文本
+        bool hasError() const;         // 服务端返回了错误，或响应无法解析
+        QString errorString() const;
+        Usage usage() const;
+
+    protected:
+        QString decoded;
+        QString error;
+        Usage stats;
+    };
+
+    virtual ~InferenceBackend() = default;
+
+    virtual QString name() const = 0;
+    // 服务端地址（完整的接口 URL，如 http://localhost:11434/api/generate）
+    void setUrl(const QString &url);
+    QString url() const;
+
+    // 探测服务端是否可用的 GET 地址（不加载模型）
+    virtual QString healthUrl() const = 0;
+
+    virtual QByteArray buildPayload(const Request &request) const = 0;
+    // 调用方拥有返回的对象
+    virtual Decoder *createDecoder(const Request &request) const = 0;
+
+    // api："ollama" 或 "openai"；调用方拥有返回的对象，未知的名称返回 nullptr
+    static InferenceBackend *create(const QString &api);
+    static QStringList availableApis();
+
+protected:
+    QString endpoint;
+};
+
+#endif // INFERENCEBACKEND_H
@@ -0,0 +1,350 @@
+#include <QTest>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QScopedPointer>
+#include "inferencebackend.h"
+#include "ollamabackend.h"
+#include "openaibackend.h"
+#include "formulajsonreader.h"
+#include "generationoptions.h"
+
+class InferenceBackendTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // 测试按名称创建后端
+    void testCreate();
+    void testHealthUrl_data();
+    void testHealthUrl();
+
+    // 测试 Ollama 请求体与响应解码
+    void testOllamaPayload();
+    void testOllamaDecoder_data();
+    void testOllamaDecoder();
+
+    // 测试 OpenAI 兼容接口的请求体与 SSE 解码
+    void testOpenAiPayload();
+    void testSseDecoder_data();
+    void testSseDecoder();
+    void testSseErrors();
+
+    // 测试 SSE 解码耗时
+    void benchSseDecoder();
+
+private:
+    static InferenceBackend::Request sampleRequest();
+    static QByteArray sseStream(const QStringList &pieces, const QString &finishReason);
+    // 按 readSize 字节切开送入解码器，返回各次 feed/finish 返回的文本之和
+    static QString decode(InferenceBackend::Decoder *decoder, const QByteArray &data, int readSize);
+};
+
+InferenceBackend::Request InferenceBackendTest::sampleRequest()
+{
+    InferenceBackend::Request request;
+    request.model = "mock-vl";
+    request.prompt = "transcribe";
+    request.base64Image = "iVBORw0KGgo=";
+    request.options["num_predict"] = 128;
+    request.options["num_ctx"] = 2048;
+    request.options["temperature"] = 0.0;
+    request.options["stop"] = QJsonArray{"\n\n\n"};
+    return request;
+}
+
+// 与 llama-server 的输出形态相同：role 事件、内容事件、finish_reason 事件、usage 事件、[DONE]
+QByteArray InferenceBackendTest::sseStream(const QStringList &pieces, const QString &finishReason)
+{
+    auto event = [](const QJsonObject &object) {
+        return "data: " + QJsonDocument(object).toJson(QJsonDocument::Compact) + "\n\n";
+    };
+    auto chunk = [](const QJsonObject &delta, const QJsonValue &finish) {
+        QJsonObject choice;
+        choice["index"] = 0;
+        choice["delta"] = delta;
+        choice["finish_reason"] = finish;
+        QJsonObject object;
+        object["object"] = "chat.completion.chunk";
+        object["choices"] = QJsonArray{choice};
+        return object;
+    };
+
+    QByteArray stream = ": keep-alive\n\n";
+    QJsonObject role;
+    role["role"] = "assistant";
+    stream += event(chunk(role, QJsonValue::Null));
+    for (const QString &piece : pieces) {
+        QJsonObject delta;
+        delta["content"] = piece;
+        stream += event(chunk(delta, QJsonValue::Null));
+    }
+    QJsonObject last = chunk(QJsonObject(), finishReason);
+    QJsonObject timings;
+    timings["prompt_ms"] = 120.5;
+    timings["predicted_ms"] = 80.0;
+    last["timings"] = timings;
+    stream += event(last);
+    QJsonObject usage;
+    usage["prompt_tokens"] = 300;
+    usage["completion_tokens"] = 12;
+    QJsonObject usageEvent;
+    usageEvent["choices"] = QJsonArray();
+    usageEvent["usage"] = usage;
+    stream += event(usageEvent);
+    stream += "data: [DONE]\n\n";
+    return stream;
+}
+
+QString InferenceBackendTest::decode(InferenceBackend::Decoder *decoder, const QByteArray &data, int readSize)
+{
+    QString text;
+    for (int i = 0; i < data.size(); i += readSize) {
+        text += decoder->feed(data.mid(i, readSize));
+    }
+    text += decoder->finish();
+    return text;
+}
+
+void InferenceBackendTest::testCreate()
+{
+    QScopedPointer<InferenceBackend> ollama(InferenceBackend::create("ollama"));
+    QScopedPointer<InferenceBackend> openAi(InferenceBackend::create("openai"));
+    QVERIFY(ollama);
+    QVERIFY(openAi);
+    QCOMPARE(ollama->name(), QString("ollama"));
+    QCOMPARE(openAi->name(), QString("openai"));
+    QVERIFY(!InferenceBackend::create("grpc"));
+    QCOMPARE(InferenceBackend::availableApis(), QStringList({"ollama", "openai"}));
+}
+
+void InferenceBackendTest::testHealthUrl_data()
+{
+    QTest::addColumn<QString>("api");
+    QTest::addColumn<QString>("url");
+    QTest::addColumn<QString>("health");
+
+    QTest::newRow("ollama-generate") << "ollama" << "http://localhost:11434/api/generate"
+                                     << "http://localhost:11434/api/version";
+    QTest::newRow("ollama-chat") << "ollama" << "https://gpu-box/ollama/api/chat"
+                                 << "https://gpu-box/ollama/api/version";
+    QTest::newRow("openai") << "openai" << "http://localhost:8080/v1/chat/completions"
+                            << "http://localhost:8080/v1/models";
+    QTest::newRow("openai-prefix") << "openai" << "https://example.com/proxy/v1/chat/completions?key=1"
+                                   << "https://example.com/proxy/v1/models";
+}
+
+void InferenceBackendTest::testHealthUrl()
+{
+    QFETCH(QString, api);
+    QFETCH(QString, url);
+    QFETCH(QString, health);
+
+    QScopedPointer<InferenceBackend> backend(InferenceBackend::create(api));
+    backend->setUrl(url);
+    QCOMPARE(backend->healthUrl(), health);
+}
+
+void InferenceBackendTest::testOllamaPayload()
+{
+    OllamaBackend backend;
+    const InferenceBackend::Request request = sampleRequest();
+
+    backend.setUrl("http://localhost:11434/api/generate");
+    QJsonObject payload = QJsonDocument::fromJson(backend.buildPayload(request)).object();
+    QCOMPARE(payload["prompt"].toString(), request.prompt);
+    QCOMPARE(payload["images"].toArray().first().toString(), QString::fromLatin1(request.base64Image));
+    QCOMPARE(payload["options"].toObject(), request.options);
+    QVERIFY(!payload["stream"].toBool());
+
+    // /api/chat 按 URL 的路径区分
+    backend.setUrl("http://localhost:11434/api/chat");
+    payload = QJsonDocument::fromJson(backend.buildPayload(request)).object();
+    QVERIFY(payload.contains("messages"));
+    QVERIFY(!payload.contains("prompt"));
+}
+
+void InferenceBackendTest::testOllamaDecoder_data()
+{
+    QTest::addColumn<bool>("structured");
+    QTest::addColumn<int>("readSize");
+
+    QTest::newRow("single response") << false << 65536;
+    QTest::newRow("single response, 3-byte reads") << false << 3;
+    QTest::newRow("ndjson stream") << true << 65536;
+    QTest::newRow("ndjson stream, 1-byte reads") << true << 1;
+}
+
+void InferenceBackendTest::testOllamaDecoder()
+{
+    QFETCH(bool, structured);
+    QFETCH(int, readSize);
+
+    const QString text = "$$\\frac{a}{b}$$";
+    QByteArray body;
+    QJsonObject done;
+    done["done"] = true;
+    done["done_reason"] = "length";
+    done["eval_count"] = 9;
+    done["eval_duration"] = 45e6;
+    done["prompt_eval_count"] = 300;
+    if (structured) {
+        for (int i = 0; i < text.size(); i += 4) {
+            QJsonObject chunk;
+            chunk["response"] = text.mid(i, 4);
+            chunk["done"] = false;
+            body += QJsonDocument(chunk).toJson(QJsonDocument::Compact) + "\n";
+        }
+        done["response"] = "";
+    } else {
+        done["response"] = text;
+    }
+    body += QJsonDocument(done).toJson(QJsonDocument::Compact);
+
+    InferenceBackend::Request request = sampleRequest();
+    request.structured = structured;
+    OllamaBackend backend;
+    QScopedPointer<InferenceBackend::Decoder> decoder(backend.createDecoder(request));
+    QCOMPARE(decode(decoder.data(), body, readSize), text);
+    QCOMPARE(decoder->text(), text);
+    QVERIFY(!decoder->hasError());
+    QCOMPARE(decoder->usage().completionTokens, 9);
+    QCOMPARE(decoder->usage().completionMs, qint64(45));
+    QCOMPARE(decoder->usage().promptTokens, 300);
+    QCOMPARE(decoder->usage().doneReason, QString("length"));
+}
+
+void InferenceBackendTest::testOpenAiPayload()
+{
+    OpenAiBackend backend;
+    InferenceBackend::Request request = sampleRequest();
+    request.mimeType = "image/jpeg";
+
+    QJsonObject payload = QJsonDocument::fromJson(backend.buildPayload(request)).object();
+    QCOMPARE(payload["model"].toString(), request.model);
+    QVERIFY(payload["stream"].toBool());
+    QCOMPARE(payload["max_tokens"].toInt(), 128);
+    QCOMPARE(payload["temperature"].toDouble(), 0.0);
+    QCOMPARE(payload["stop"].toArray(), request.options["stop"].toArray());
+    // num_ctx 由服务端决定
+    QVERIFY(!payload.contains("num_ctx"));
+    QVERIFY(!payload.contains("options"));
+    QVERIFY(!payload.contains("response_format"));
+
+    const QJsonArray content = payload["messages"].toArray().first().toObject()["content"].toArray();
+    QCOMPARE(content.size(), 2);
+    QCOMPARE(content.at(0).toObject()["image_url"].toObject()["url"].toString(),
+             QString("data:image/jpeg;base64,iVBORw0KGgo="));
+    QCOMPARE(content.at(1).toObject()["text"].toString(), request.prompt);
+
+    request.structured = true;
+    payload = QJsonDocument::fromJson(backend.buildPayload(request)).object();
+    const QJsonObject format = payload["response_format"].toObject();
+    QCOMPARE(format["type"].toString(), QString("json_schema"));
+    QCOMPARE(format["json_schema"].toObject()["schema"].toObject(), FormulaJsonReader::schema());
+    // Schema 中有可选属性，不能开启 strict
+    QVERIFY(!format["json_schema"].toObject()["strict"].toBool());
+
+    // 0 和 -1 都交给服务端决定生成上限
+    for (int numPredict : {0, -1}) {
+        QJsonObject options = request.options;
+        options["num_predict"] = numPredict;
+        QJsonObject mapped;
+        OpenAiBackend::applyOptions(options, &mapped);
+        QVERIFY(!mapped.contains("max_tokens"));
+    }
+
+    // 默认停止序列超过接口上限时截断
+    QJsonObject options;
+    options["stop"] = QJsonArray::fromStringList(GenerationOptions::defaultStop());
+    QJsonObject mapped;
+    OpenAiBackend::applyOptions(options, &mapped);
+    QCOMPARE(mapped["stop"].toArray().size(), OpenAiBackend::MaxStop);
+    QCOMPARE(mapped["stop"].toArray().first().toString(), GenerationOptions::defaultStop().first());
+}
+
+void InferenceBackendTest::testSseDecoder_data()
+{
+    QTest::addColumn<int>("readSize");
+    QTest::addColumn<bool>("crlf");
+
+    QTest::newRow("whole stream") << 65536 << false;
+    QTest::newRow("7-byte reads") << 7 << false;
+    QTest::newRow("1-byte reads") << 1 << false;
+    QTest::newRow("CRLF, 5-byte reads") << 5 << true;
+}
+
+void InferenceBackendTest::testSseDecoder()
+{
+    QFETCH(int, readSize);
+    QFETCH(bool, crlf);
+
+    const QStringList pieces = {"$$\\int_0^1", " x\\,dx", " = \\frac{1}{2}$$"};
+    QByteArray stream = sseStream(pieces, "stop");
+    if (crlf) {
+        stream.replace("\n", "\r\n");
+    }
+
+    OpenAiBackend backend;
+    QScopedPointer<InferenceBackend::Decoder> decoder(backend.createDecoder(sampleRequest()));
+    QCOMPARE(decode(decoder.data(), stream, readSize), pieces.join(QString()));
+    QCOMPARE(decoder->text(), pieces.join(QString()));
+    QVERIFY(!decoder->hasError());
+
+    const InferenceBackend::Usage usage = decoder->usage();
+    QCOMPARE(usage.doneReason, QString("stop"));
+    QCOMPARE(usage.promptTokens, 300);
+    QCOMPARE(usage.completionTokens, 12);
+    QCOMPARE(usage.promptMs, qint64(120));
+    QCOMPARE(usage.completionMs, qint64(80));
+}
+
+void InferenceBackendTest::testSseErrors()
+{
+    OpenAiBackend backend;
+
+    // 服务端返回普通 JSON 的错误
+    QScopedPointer<InferenceBackend::Decoder> error(backend.createDecoder(sampleRequest()));
+    decode(error.data(), R"({"error":{"message":"model not found","type":"invalid_request_error"}})", 10);
+    QVERIFY(error->hasError());
+    QVERIFY(error->errorString().contains("model not found"));
+
+    // 流中途的错误事件
+    QScopedPointer<InferenceBackend::Decoder> midStream(backend.createDecoder(sampleRequest()));
+    decode(midStream.data(), "data: {\"error\":\"out of memory\"}\n\n", 65536);
+    QVERIFY(midStream->errorString().contains("out of memory"));
+
+    // 服务端忽略 stream：整体返回的 chat.completion
+    QScopedPointer<InferenceBackend::Decoder> single(backend.createDecoder(sampleRequest()));
+    const QString text = decode(single.data(),
+        R"({"choices":[{"index":0,"message":{"role":"assistant","content":"$x$"},"finish_reason":"length"}],)"
+        R"("usage":{"prompt_tokens":5,"completion_tokens":2}})", 65536);
+    QCOMPARE(text, QString("$x$"));
+    QVERIFY(!single->hasError());
+    QCOMPARE(single->usage().doneReason, QString("length"));
+    QCOMPARE(single->usage().completionTokens, 2);
+
+    // 无法解析的响应
+    QScopedPointer<InferenceBackend::Decoder> garbage(backend.createDecoder(sampleRequest()));
+    decode(garbage.data(), "<html>502 Bad Gateway</html>", 65536);
+    QVERIFY(garbage->hasError());
+}
+
+void InferenceBackendTest::benchSseDecoder()
+{
+    // 200 个内容事件，约为一整页公式的输出
+    QStringList pieces;
+    for (int i = 0; i < 200; ++i) {
+        pieces << QString("\\frac{x_{%1}}{2} + ").arg(i);
+    }
+    const QByteArray stream = sseStream(pieces, "stop");
+    OpenAiBackend backend;
+
+    QBENCHMARK {
+        QScopedPointer<InferenceBackend::Decoder> decoder(backend.createDecoder(sampleRequest()));
+        decoder->feed(stream);
+        decoder->finish();
+    }
+}
+
+QTEST_MAIN(InferenceBackendTest)
+#include "inferencebackend_test.moc"
@@ -0,0 +1,172 @@
+#include "inkmap.h"
+#include <QtMath>
+#include <algorithm>
+
+InkMap::InkMap(const QImage &image, const Settings &settings)
+    : current(settings)
+{
+    if (image.isNull()) {
+        return;
+    }
+
+    // 截图后端返回的通常已是 RGB32（xcb-shm 的图像直接引用共享内存），此时不复制
+    const QImage source = (image.format() == QImage::Format_RGB32
+                           || image.format() == QImage::Format_ARGB32
+                           || image.format() == QImage::Format_ARGB32_Premultiplied)
+            ? image : image.convertToFormat(QImage::Format_RGB32);
+    dpr = source.devicePixelRatio();
+    columns = (source.width() + CellSize - 1) / CellSize;
+    rows = (source.height() + CellSize - 1) / CellSize;
+    integral.fill(0, (columns + 1) * (rows + 1));
+
+    // 4K 截图有八百多万像素：内层循环只用裸指针，避免 QVector 每次下标访问的分离检查
+    QVector<uchar> minimum(columns);
+    QVector<uchar> maximum(columns);
+    uchar *minData = minimum.data();
+    uchar *maxData = maximum.data();
+    quint32 *sums = integral.data();
+    const int stride = columns + 1;
+    const int width = source.width();
+    for (int cy = 0; cy < rows; ++cy) {
+        std::fill(minData, minData + columns, uchar(255));
+        std::fill(maxData, maxData + columns, uchar(0));
+        const int lastY = qMin(source.height(), (cy + 1) * CellSize);
+        for (int y = cy * CellSize; y < lastY; ++y) {
+            const QRgb *line = reinterpret_cast<const QRgb *>(source.constScanLine(y));
+            for (int x = 0; x < width; ++x) {
+                // 近似亮度 (2R + 5G + B) / 8，只比较格内差值，不需要精确的灰度
+                const QRgb pixel = line[x];
+                const uchar luma = uchar((qRed(pixel) * 2 + qGreen(pixel) * 5 + qBlue(pixel)) >> 3);
+                const int cx = x / CellSize;
+                minData[cx] = qMin(minData[cx], luma);
+                maxData[cx] = qMax(maxData[cx], luma);
+            }
+        }
+
+        quint32 rowSum = 0;
+        const quint32 *above = sums + cy * stride;
+        quint32 *row = sums + (cy + 1) * stride;
+        for (int cx = 0; cx < columns; ++cx) {
+            rowSum += maxData[cx] - minData[cx] > ContrastThreshold ? 1 : 0;
+            row[cx + 1] = above[cx + 1] + rowSum;
+        }
+    }
+}
+
+bool InkMap::isNull() const
+{
+    return columns == 0 || rows == 0;
+}
+
+QSize InkMap::cellGridSize() const
+{
+    return QSize(columns, rows);
+}
+
+int InkMap::inkCount(const QRect &cells) const
+{
+    const QRect clipped = cells.intersected(QRect(0, 0, columns, rows));
+    if (clipped.isEmpty()) {
+        return 0;
+    }
+    const int stride = columns + 1;
+    const int x0 = clipped.left();
+    const int y0 = clipped.top();
+    const int x1 = clipped.right() + 1;
+    const int y1 = clipped.bottom() + 1;
+    return int(integral.at(y1 * stride + x1) - integral.at(y0 * stride + x1)
+               - integral.at(y1 * stride + x0) + integral.at(y0 * stride + x0));
+}
+
+QRect InkMap::inkBounds(const QRect &cells) const
+{
+    const QRect clipped = cells.intersected(QRect(0, 0, columns, rows));
+    if (inkCount(clipped) == 0) {
+        return QRect();
+    }
+
+    // 从四边向内逐行/逐列查询，遇到第一行（列）笔迹即停
+    int top = clipped.top();
+    while (inkCount(QRect(clipped.left(), top, clipped.width(), 1)) == 0) {
+        ++top;
+    }
+    int bottom = clipped.bottom();
+    while (inkCount(QRect(clipped.left(), bottom, clipped.width(), 1)) == 0) {
+        --bottom;
+    }
+    const int height = bottom - top + 1;
+    int left = clipped.left();
+    while (inkCount(QRect(left, top, 1, height)) == 0) {
+        ++left;
+    }
+    int right = clipped.right();
+    while (inkCount(QRect(right, top, 1, height)) == 0) {
+        --right;
+    }
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+QRect InkMap::toCells(const QRect &logical) const
+{
+    const int left = qFloor(logical.x() * dpr) / CellSize;
+    const int top = qFloor(logical.y() * dpr) / CellSize;
+    const int right = (qCeil((logical.x() + logical.width()) * dpr) - 1) / CellSize;
+    const int bottom = (qCeil((logical.y() + logical.height()) * dpr) - 1) / CellSize;
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+QRect InkMap::toLogical(const QRect &cells) const
+{
+    const int left = qFloor(cells.left() * CellSize / dpr);
+    const int top = qFloor(cells.top() * CellSize / dpr);
+    const int right = qCeil((cells.right() + 1) * CellSize / dpr) - 1;
+    const int bottom = qCeil((cells.bottom() + 1) * CellSize / dpr) - 1;
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+QRect InkMap::snap(const QRect &selection) const
+{
+    if (isNull() || selection.isEmpty()) {
+        return selection;
+    }
+    const QRect bounds = inkBounds(toCells(selection));
+    if (bounds.isNull()) {
+        return selection;
+    }
+    // 只收缩不扩大：笔迹贴着选区边缘时保持用户拖出的边界
+    const int p = current.padding;
+    return toLogical(bounds).adjusted(-p, -p, p, p).intersected(selection);
+}
+
+QRect InkMap::blockAt(const QPoint &point) const
+{
+    if (isNull()) {
+        return QRect();
+    }
+    const int gapX = qMax(1, qCeil(current.horizontalGap * dpr / CellSize));
+    const int gapY = qMax(1, qCeil(current.verticalGap * dpr / CellSize));
+    const QPoint cell(qFloor(point.x() * dpr) / CellSize, qFloor(point.y() * dpr) / CellSize);
+
+    QRect bounds = inkBounds(QRect(cell.x() - gapX, cell.y() - gapY, 2 * gapX + 1, 2 * gapY + 1));
+    if (bounds.isNull()) {
+        return QRect();
+    }
+
+    // 外接矩形每次向外扩一个间隙再求笔迹边界；边界单调增大，通常几轮即收敛
+    const int maxWidth = qMax(1, int(columns * current.maxCoverage));
+    const int maxHeight = qMax(1, int(rows * current.maxCoverage));
+    for (;;) {
+        const QRect next = inkBounds(bounds.adjusted(-gapX, -gapY, gapX, gapY));
+        if (next.width() > maxWidth || next.height() > maxHeight) {
+            return QRect();
+        }
+        if (next == bounds) {
+            break;
+        }
+        bounds = next;
+    }
+
+    const int p = current.padding;
+    const QRect screen = toLogical(QRect(0, 0, columns, rows));
+    return toLogical(bounds).adjusted(-p, -p, p, p).intersected(screen);
+}
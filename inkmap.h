@@ -0,0 +1,57 @@
+#ifndef INKMAP_H
+#define INKMAP_H
+
+#include <QImage>
+#include <QPoint>
+#include <QRect>
+#include <QVector>
+
+// 截图覆盖层的选区吸附：每次截图后把整屏图像缩成 CellSize×CellSize 的格子，
+// 格内亮度差超过阈值即视为有笔迹（不依赖背景色，窗口、深色主题同样适用），
+// 再建立格子的积分图。之后任意矩形内的笔迹格数都是 O(1) 查询，
+// 鼠标移动时找笔迹边界只需沿边逐行/逐列查询，4K 屏幕上每次也只有几微秒
+class InkMap
+{
+public:
+    struct Settings
+    {
+        int horizontalGap = 24;  // 横向相距不超过该值（逻辑像素）的笔迹属于同一个公式块
+        int verticalGap = 10;    // 纵向间隙，分式、上下标之间通常更小，相邻段落之间通常更大
+        int padding = 4;         // 吸附后的矩形四周保留的留白
+        qreal maxCoverage = 0.6; // 公式块宽或高超过屏幕的该比例时视为窗口边框等，不吸附
+    };
+
+    static const int CellSize = 4;       // 设备像素
+    static const int ContrastThreshold = 40;
+
+    InkMap() = default;
+    // 在整屏截图上建立一次；图像的 devicePixelRatio 决定逻辑坐标到格子的换算
+    explicit InkMap(const QImage &image, const Settings &settings = Settings());
+
+    bool isNull() const;
+    QSize cellGridSize() const;
+
+    // 把拖出的选区收缩到其中笔迹的外接矩形（加留白）；选区内没有笔迹时原样返回
+    QRect snap(const QRect &selection) const;
+    // 光标处的公式块：从光标附近的笔迹出发，反复并入间隙内的笔迹直到不再变化；
+    // 光标附近没有笔迹或公式块过大时返回空矩形
+    QRect blockAt(const QPoint &point) const;
+
+    // 矩形（格子坐标，含边界）内有笔迹的格子数
+    int inkCount(const QRect &cells) const;
+
+private:
+    // 格子坐标 cells 内笔迹的外接矩形，没有笔迹时返回空矩形
+    QRect inkBounds(const QRect &cells) const;
+    QRect toCells(const QRect &logical) const;
+    QRect toLogical(const QRect &cells) const;
+
+    Settings current;
+    qreal dpr = 1.0;
+    int columns = 0;
+    int rows = 0;
+    // (columns + 1) × (rows + 1) 的积分图，第一行和第一列为 0
+    QVector<quint32> integral;
+};
+
+#endif // INKMAP_H
@@ -0,0 +1,185 @@
+#include <QTest>
+#include <QPainter>
+#include <QElapsedTimer>
+#include "inkmap.h"
+#include "benchmarkutils.h"
+
+class InkMapTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // 测试拖出的选区收缩到笔迹边界，且不超出原选区
+    void testSnapShrinksToInk();
+    void testSnapWithoutInk();
+
+    // 测试光标下的公式块：间隙内的笔迹合并，间隙外的不合并
+    void testBlockAt();
+    void testBlockAtBlank();
+
+    // 测试跨越大半个屏幕的边框不作为公式块
+    void testBlockTooLarge();
+
+    // 测试 devicePixelRatio 为 2 时的坐标换算
+    void testHighDpi();
+
+    // 测试深色背景
+    void testDarkBackground();
+
+    // 4K 截图上建立积分图和查询公式块的耗时
+    void benchBuild4K();
+    void benchBlockAt4K();
+
+private:
+    // 用间隔 6 像素、2 像素宽的竖线填满 glyphs，近似一段文字的笔画
+    static QImage desktop(const QSize &size, const QList<QRect> &glyphs,
+                          const QColor &background = Qt::white, const QColor &ink = Qt::black);
+    // 吸附结果应包住笔迹，且每边最多多出一个格子加留白
+    static bool tight(const QRect &snapped, const QRect &ink);
+};
+
+QImage InkMapTest::desktop(const QSize &size, const QList<QRect> &glyphs,
+                           const QColor &background, const QColor &ink)
+{
+    QImage image(size, QImage::Format_RGB32);
+    image.fill(background);
+    QPainter painter(&image);
+    for (const QRect &glyph : glyphs) {
+        for (int x = glyph.left(); x + 1 <= glyph.right(); x += 6) {
+            painter.fillRect(QRect(x, glyph.top(), 2, glyph.height()), ink);
+        }
+    }
+    painter.end();
+    return image;
+}
+
+bool InkMapTest::tight(const QRect &snapped, const QRect &ink)
+{
+    const int slack = InkMap::CellSize + InkMap::Settings().padding;
+    return snapped.contains(ink) && ink.adjusted(-slack, -slack, slack, slack).contains(snapped);
+}
+
+void InkMapTest::testSnapShrinksToInk()
+{
+    const QRect glyphs(200, 150, 182, 40);
+    const InkMap map(desktop(QSize(800, 600), {glyphs}));
+    QVERIFY(!map.isNull());
+    QCOMPARE(map.cellGridSize(), QSize(200, 150));
+
+    const QRect selection(120, 90, 400, 200);
+    const QRect snapped = map.snap(selection);
+    QVERIFY(tight(snapped, glyphs));
+    QVERIFY(selection.contains(snapped));
+
+    // 笔迹被选区截断时不向外扩
+    const QRect clipped(250, 140, 80, 60);
+    QVERIFY(clipped.contains(map.snap(clipped)));
+    QCOMPARE(map.snap(clipped).left(), clipped.left());
+}
+
+void InkMapTest::testSnapWithoutInk()
+{
+    const InkMap map(desktop(QSize(800, 600), {QRect(600, 400, 100, 30)}));
+    const QRect selection(50, 50, 200, 100);
+    QCOMPARE(map.snap(selection), selection);
+    QCOMPARE(InkMap().snap(selection), selection);
+}
+
+void InkMapTest::testBlockAt()
+{
+    // 左侧公式：两段相距 16 像素，分子与分母上下相距 6 像素；右侧公式相距 120 像素
+    const QRect numerator(100, 100, 98, 20);
+    const QRect tail(214, 100, 62, 20);
+    const QRect denominator(100, 126, 98, 20);
+    const QRect other(400, 100, 98, 20);
+    const InkMap map(desktop(QSize(800, 600), {numerator, tail, denominator, other}));
+
+    const QRect block = map.blockAt(QPoint(150, 110));
+    QVERIFY(tight(block, numerator | tail | denominator));
+    QVERIFY(!block.intersects(other));
+
+    // 光标在两段之间的空白处也能找到
+    QCOMPARE(map.blockAt(QPoint(206, 110)), block);
+    QVERIFY(tight(map.blockAt(QPoint(450, 110)), other));
+}
+
+void InkMapTest::testBlockAtBlank()
+{
+    const InkMap map(desktop(QSize(800, 600), {QRect(100, 100, 98, 20)}));
+    QVERIFY(map.blockAt(QPoint(600, 400)).isNull());
+    QVERIFY(InkMap().blockAt(QPoint(10, 10)).isNull());
+}
+
+void InkMapTest::testBlockTooLarge()
+{
+    // 横贯屏幕的一排笔迹（如工具栏）
+    const InkMap map(desktop(QSize(800, 600), {QRect(0, 20, 800, 20)}));
+    QVERIFY(map.blockAt(QPoint(400, 30)).isNull());
+
+    InkMap::Settings settings;
+    settings.maxCoverage = 1.0;
+    QVERIFY(!InkMap(desktop(QSize(800, 600), {QRect(0, 20, 800, 20)}), settings).blockAt(QPoint(400, 30)).isNull());
+}
+
+void InkMapTest::testHighDpi()
+{
+    // 设备像素中的笔迹 (400, 300, 362, 80) 对应逻辑坐标 (200, 150, 181, 40)
+    QImage image = desktop(QSize(1600, 1200), {QRect(400, 300, 362, 80)});
+    image.setDevicePixelRatio(2.0);
+    const InkMap map(image);
+    QCOMPARE(map.cellGridSize(), QSize(400, 300));
+
+    const QRect logical(200, 150, 181, 40);
+    QVERIFY(tight(map.blockAt(QPoint(250, 170)), logical));
+    QVERIFY(tight(map.snap(QRect(100, 100, 400, 200)), logical));
+}
+
+void InkMapTest::testDarkBackground()
+{
+    const QRect glyphs(200, 150, 182, 40);
+    const InkMap map(desktop(QSize(800, 600), {glyphs}, QColor(30, 30, 30), QColor(220, 220, 220)));
+    QVERIFY(tight(map.blockAt(QPoint(250, 170)), glyphs));
+}
+
+void InkMapTest::benchBuild4K()
+{
+    const QImage image = BenchmarkUtils::renderFormulaImage(QSize(3840, 2160));
+    InkMap map;
+    QBENCHMARK {
+        map = InkMap(image);
+    }
+    QCOMPARE(map.cellGridSize(), QSize(960, 540));
+}
+
+void InkMapTest::benchBlockAt4K()
+{
+    // 整页公式是查询的最坏情况：每个点都有笔迹，合并要扩展多轮
+    const InkMap map(BenchmarkUtils::renderFormulaImage(QSize(3840, 2160)));
+    QVector<QPoint> points;
+    for (int y = 100; y < 2160; y += 97) {
+        for (int x = 100; x < 3840; x += 193) {
+            points << QPoint(x, y);
+        }
+    }
+
+    int found = 0;
+    QBENCHMARK {
+        found = 0;
+        for (const QPoint &point : points) {
+            found += map.blockAt(point).isNull() ? 0 : 1;
+        }
+    }
+
+    // 每次查询必须远小于 60 Hz 的一帧（16.7 ms），鼠标移动时才不掉帧
+    QElapsedTimer timer;
+    timer.start();
+    for (const QPoint &point : points) {
+        map.blockAt(point);
+    }
+    const qint64 perQueryUs = timer.nsecsElapsed() / 1000 / points.size();
+    qDebug() << points.size() << "queries," << found << "blocks," << perQueryUs << "us per query";
+    QVERIFY(perQueryUs < 2000);
+}
+
+QTEST_MAIN(InkMapTest)
+#include "inkmap_test.moc"
@@ -0,0 +1,538 @@
+#include "jobjournal.h"
+#include "imageencoder.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtConcurrent>
+#include <QDebug>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char Magic[4] = {'F', 'R', 'J', 'Q'};
+// 2：Enqueue 载荷增加服务端地址、模型和输出模式
+const quint16 FormatVersion = 2;
+
+QByteArray fileHeader()
+{
+    QByteArray header(Magic, 4);
+    QDataStream out(&header, QIODevice::WriteOnly | QIODevice::Append);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out << FormatVersion << quint16(0);
+    return header;
+}
+
+// 只把数据交给内核不够：断电后页缓存中的记录会丢失。只使用文件描述符，可以在线程池中调用
+bool syncHandle(int handle)
+{
+#if defined(Q_OS_WIN)
+    return _commit(handle) == 0;
+#elif defined(Q_OS_LINUX)
+    return ::fdatasync(handle) == 0;
+#else
+    return ::fsync(handle) == 0;
+#endif
+}
+
+bool syncToDisk(QFile &file)
+{
+    return file.flush() && syncHandle(file.handle());
+}
+
+}
+
+JobJournal::JobJournal(QObject *parent)
+    : QObject(parent), liveBytes(0), nextId(1), unsynced(0), syncing(0)
+{
+    syncTimer.setSingleShot(true);
+    connect(&syncTimer, &QTimer::timeout, this, &JobJournal::startSync);
+    connect(&syncWatcher, &QFutureWatcherBase::finished, this, [this]() {
+        // sync() 已经等待并处理过这次 fsync、之后又发起了新的一次时，旧的信号不再处理
+        if (!syncWatcher.isFinished()) {
+            return;
+        }
+        // 进行中时到达的记录没有发起 fsync，由这里接着同步；失败时等下一次追加再重试
+        if (finishSync() && unsynced > 0) {
+            scheduleSync();
+        }
+    });
+}
+
+JobJournal::~JobJournal()
+{
+    close();
+}
+
+void JobJournal::setSettings(const Settings &settings)
+{
+    config = settings;
+}
+
+bool JobJournal::open(const QString &path)
+{
+    close();
+    counters = Stats();
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadWrite)) {
+        lastError = QString("Failed to open job journal %1: %2").arg(path, file.errorString());
+        qWarning() << lastError;
+        return false;
+    }
+    if (!replay()) {
+        qWarning() << lastError;
+        file.close();
+        return false;
+    }
+    reader.setFileName(path);
+    if (!reader.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        lastError = QString("Failed to open job journal %1: %2").arg(path, reader.errorString());
+        qWarning() << lastError;
+        file.close();
+        return false;
+    }
+
+    qDebug() << "Job journal opened:" << path << "pending:" << live.size()
+             << "truncated:" << counters.truncatedBytes << "bytes";
+    return true;
+}
+
+void JobJournal::close()
+{
+    if (!file.isOpen()) {
+        return;
+    }
+    sync();
+    syncTimer.stop();
+    file.close();
+    reader.close();
+    live.clear();
+    liveBytes = 0;
+    nextId = 1;
+}
+
+bool JobJournal::isOpen() const
+{
+    return file.isOpen();
+}
+
+QString JobJournal::path() const
+{
+    return file.fileName();
+}
+
+bool JobJournal::replay()
+{
+    live.clear();
+    liveBytes = 0;
+    nextId = 1;
+    unsynced = 0;
+
+    const qint64 size = file.size();
+    if (size < FileHeaderSize) {
+        // 新文件，或者写文件头时崩溃
+        counters.truncatedBytes = int(size);
+        if (!file.resize(0) || file.write(fileHeader()) != FileHeaderSize || !syncToDisk(file)) {
+            lastError = QString("Failed to initialize job journal: %1").arg(file.errorString());
+            return false;
+        }
+        return true;
+    }
+
+    const QByteArray header = file.read(FileHeaderSize);
+    if (!header.startsWith(QByteArray(Magic, 4))) {
+        // 不是本程序的日志：不覆盖
+        lastError = QString("%1 is not a job journal").arg(file.fileName());
+        return false;
+    }
+    if (header != fileHeader()) {
+        lastError = QString("Unsupported job journal version in %1").arg(file.fileName());
+        return false;
+    }
+
+    qint64 offset = FileHeaderSize;
+    quint64 maxId = 0;
+    while (offset < size) {
+        // 记录头或载荷不完整、校验和不符：其后的内容都是崩溃时写了一半的数据
+        if (size - offset < RecordHeaderSize) {
+            break;
+        }
+        file.seek(offset);
+        QDataStream in(file.read(RecordHeaderSize));
+        in.setByteOrder(QDataStream::LittleEndian);
+        quint32 length = 0;
+        quint16 checksum = 0;
+        quint8 type = 0;
+        in >> length >> checksum >> type;
+        if (qint64(length) > size - offset - RecordHeaderSize) {
+            break;
+        }
+        QByteArray body;
+        body.reserve(int(length) + 1);
+        body.append(char(type));
+        body += file.read(length);
+        if (body.size() != int(length) + 1 || qChecksum(body.constData(), uint(body.size())) != checksum) {
+            break;
+        }
+
+        QDataStream payload(body.mid(1));
+        payload.setByteOrder(QDataStream::LittleEndian);
+        quint64 id = 0;
+        payload >> id;
+        if (payload.status() != QDataStream::Ok) {
+            break;
+        }
+        const qint64 recordSize = RecordHeaderSize + qint64(length);
+        if (type == Enqueue) {
+            Location location;
+            location.offset = offset;
+            location.size = recordSize;
+            live.insert(id, location);
+            liveBytes += recordSize;
+        } else if (type == Done) {
+            auto it = live.find(id);
+            if (it != live.end()) {
+                liveBytes -= it->size;
+                live.erase(it);
+            }
+        } else {
+            break;
+        }
+        maxId = qMax(maxId, id);
+        offset += recordSize;
+    }
+
+    if (offset < size) {
+        counters.truncatedBytes = int(size - offset);
+        qWarning() << "Job journal has a torn tail, dropping" << (size - offset) << "bytes";
+    }
+    if (live.isEmpty()) {
+        offset = FileHeaderSize;
+    }
+    if (offset < size && (!file.resize(offset) || !syncToDisk(file))) {
+        lastError = QString("Failed to truncate job journal: %1").arg(file.errorString());
+        return false;
+    }
+    file.seek(offset);
+    nextId = live.isEmpty() ? 1 : maxId + 1;
+    return true;
+}
+
+QByteArray JobJournal::encodeRecord(RecordType type, const QByteArray &payload)
+{
+    QByteArray body;
+    body.reserve(payload.size() + 1);
+    body.append(char(type));
+    body += payload;
+
+    QByteArray record;
+    record.reserve(RecordHeaderSize + payload.size());
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out << quint32(payload.size()) << qChecksum(body.constData(), uint(body.size()));
+    record += body;
+    return record;
+}
+
+QByteArray JobJournal::encodeImage(const QImage &image)
+{
+    ImageEncoder::Settings settings;
+    settings.codec = "png";
+    settings.pngCompression = 1;
+    return ImageEncoder::encode(image, settings).data;
+}
+
+bool JobJournal::writeRecord(RecordType type, const QByteArray &payload)
+{
+    const QByteArray record = encodeRecord(type, payload);
+    if (file.write(record) != record.size()) {
+        lastError = QString("Failed to write job journal: %1").arg(file.errorString());
+        qWarning() << lastError;
+        return false;
+    }
+    counters.bytesWritten += record.size();
+    ++unsynced;
+    return true;
+}
+
+quint64 JobJournal::append(const QByteArray &image, int priority, const Params &params)
+{
+    if (!file.isOpen()) {
+        lastError = "Job journal is not open";
+        return 0;
+    }
+
+    const quint64 id = nextId;
+    QByteArray payload;
+    payload.reserve(image.size() + 256);
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out << id << QDateTime::currentMSecsSinceEpoch() << quint8(priority)
+        << params.url.toUtf8() << params.model.toUtf8() << params.outputMode.toUtf8() << quint32(image.size());
+    payload += image;
+
+    Location location;
+    location.offset = file.pos();
+    location.size = RecordHeaderSize + payload.size();
+    if (!writeRecord(Enqueue, payload)) {
+        return 0;
+    }
+    ++nextId;
+    live.insert(id, location);
+    liveBytes += location.size;
+    ++counters.appended;
+    scheduleSync();
+    return id;
+}
+
+void JobJournal::markDone(quint64 id)
+{
+    auto it = live.find(id);
+    if (it == live.end()) {
+        return;
+    }
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out << id;
+    if (!writeRecord(Done, payload)) {
+        return;
+    }
+    liveBytes -= it->size;
+    live.erase(it);
+    ++counters.completed;
+    scheduleSync();
+}
+
+void JobJournal::scheduleSync()
+{
+    if (config.syncIntervalMs <= 0 || unsynced >= qMax(1, config.syncBatch)) {
+        startSync();
+    } else if (!syncTimer.isActive()) {
+        // 不随后续追加重新计时：第一条记录最多等待 syncIntervalMs
+        syncTimer.start(config.syncIntervalMs);
+    }
+}
+
+void JobJournal::startSync()
+{
+    syncTimer.stop();
+    if (syncing > 0 || !file.isOpen() || unsynced == 0) {
+        return;
+    }
+    // 写入在 GUI 线程完成，线程池中只等待落盘；压缩和截断在 finishSync 中进行，不与 fsync 同时发生
+    if (!file.flush()) {
+        lastError = QString("Failed to sync job journal: %1").arg(file.errorString());
+        qWarning() << lastError;
+        return;
+    }
+    const int handle = file.handle();
+    syncing = unsynced;
+    unsynced = 0;
+    syncWatcher.setFuture(QtConcurrent::run([handle]() { return syncHandle(handle); }));
+}
+
+bool JobJournal::finishSync()
+{
+    if (syncing == 0) {
+        return true;
+    }
+    const int records = syncing;
+    syncing = 0;
+    if (!syncWatcher.future().result()) {
+        // 记录仍算作未同步，下一次 fsync 一起重试
+        unsynced += records;
+        lastError = QString("Failed to sync job journal %1").arg(file.fileName());
+        qWarning() << lastError;
+        return false;
+    }
+    ++counters.syncs;
+    maybeCompact();
+    emit synced(records);
+    return true;
+}
+
+bool JobJournal::sync()
+{
+    syncTimer.stop();
+    if (syncing > 0) {
+        // 等待后台的 fsync，随后到达的 finished 信号因 syncing 为 0 不再处理
+        syncWatcher.waitForFinished();
+        finishSync();
+    }
+    if (!file.isOpen() || unsynced == 0) {
+        return true;
+    }
+    if (!syncToDisk(file)) {
+        lastError = QString("Failed to sync job journal: %1").arg(file.errorString());
+        qWarning() << lastError;
+        return false;
+    }
+    const int records = unsynced;
+    unsynced = 0;
+    ++counters.syncs;
+    maybeCompact();
+    emit synced(records);
+    return true;
+}
+
+void JobJournal::maybeCompact()
+{
+    const qint64 size = file.size();
+    if (live.isEmpty()) {
+        // 所有任务都已完成并落盘，日志可以清空
+        if (size > FileHeaderSize && file.resize(FileHeaderSize)) {
+            file.seek(FileHeaderSize);
+            nextId = 1;
+        }
+        return;
+    }
+    if (size > config.compactBytes && liveBytes * 2 < size) {
+        compact();
+    }
+}
+
+bool JobJournal::compact()
+{
+    const QString path = file.fileName();
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly)) {
+        lastError = QString("Failed to compact job journal: %1").arg(out.errorString());
+        qWarning() << lastError;
+        return false;
+    }
+    out.write(fileHeader());
+
+    QMap<quint64, Location> moved;
+    qint64 offset = FileHeaderSize;
+    for (auto it = live.cbegin(); it != live.cend(); ++it) {
+        reader.seek(it->offset);
+        const QByteArray record = reader.read(it->size);
+        if (record.size() != it->size || out.write(record) != record.size()) {
+            out.cancelWriting();
+            lastError = QString("Failed to compact job journal: %1").arg(out.errorString());
+            qWarning() << lastError;
+            return false;
+        }
+        Location location;
+        location.offset = offset;
+        location.size = it->size;
+        moved.insert(it.key(), location);
+        offset += it->size;
+    }
+    // QSaveFile 提交时先落盘再替换原文件，中途崩溃时旧日志仍然完整
+    if (!out.commit()) {
+        lastError = QString("Failed to compact job journal: %1").arg(out.errorString());
+        qWarning() << lastError;
+        return false;
+    }
+
+    file.close();
+    reader.close();
+    if (!file.open(QIODevice::ReadWrite) || !reader.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        lastError = QString("Failed to reopen job journal: %1").arg(file.errorString());
+        qWarning() << lastError;
+        return false;
+    }
+    file.seek(offset);
+    live = moved;
+    qDebug() << "Job journal compacted to" << offset << "bytes," << live.size() << "pending";
+    return true;
+}
+
+QList<quint64> JobJournal::pendingIds() const
+{
+    return live.keys();
+}
+
+int JobJournal::pendingCount() const
+{
+    return live.size();
+}
+
+bool JobJournal::contains(quint64 id) const
+{
+    return live.contains(id);
+}
+
+JobJournal::Record JobJournal::record(quint64 id)
+{
+    Record record;
+    auto it = live.constFind(id);
+    if (it == live.cend()) {
+        return record;
+    }
+    // 还在写缓冲区中的记录对只读句柄不可见
+    file.flush();
+    if (!readAt(it->offset, &record)) {
+        qWarning() << "Failed to read job" << id << "from journal";
+        return Record();
+    }
+    return record;
+}
+
+bool JobJournal::readAt(qint64 offset, Record *record)
+{
+    if (!reader.seek(offset)) {
+        return false;
+    }
+    const QByteArray header = reader.read(RecordHeaderSize);
+    if (header.size() != RecordHeaderSize) {
+        return false;
+    }
+    QDataStream in(header);
+    in.setByteOrder(QDataStream::LittleEndian);
+    quint32 length = 0;
+    quint16 checksum = 0;
+    quint8 type = 0;
+    in >> length >> checksum >> type;
+    if (type != Enqueue) {
+        return false;
+    }
+
+    const QByteArray payload = reader.read(length);
+    if (payload.size() != int(length)) {
+        return false;
+    }
+    QDataStream fields(payload);
+    fields.setByteOrder(QDataStream::LittleEndian);
+    quint8 priority = 0;
+    QByteArray url;
+    QByteArray model;
+    QByteArray outputMode;
+    quint32 imageLength = 0;
+    fields >> record->id >> record->createdAtMs >> priority >> url >> model >> outputMode >> imageLength;
+    const int imageOffset = int(fields.device()->pos());
+    if (fields.status() != QDataStream::Ok || int(imageLength) != payload.size() - imageOffset) {
+        return false;
+    }
+    record->priority = priority;
+    record->params.url = QString::fromUtf8(url);
+    record->params.model = QString::fromUtf8(model);
+    record->params.outputMode = QString::fromUtf8(outputMode);
+    record->image = payload.mid(imageOffset);
+    return true;
+}
+
+qint64 JobJournal::fileSize() const
+{
+    return file.isOpen() ? file.size() : 0;
+}
+
+JobJournal::Stats JobJournal::stats() const
+{
+    return counters;
+}
+
+QString JobJournal::getLastError() const
+{
+    return lastError;
+}
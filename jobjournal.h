@@ -0,0 +1,135 @@
+#ifndef JOBJOURNAL_H
+#define JOBJOURNAL_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QFile>
+#include <QFutureWatcher>
+#include <QImage>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QTimer>
+
+// 待识别任务的日志：每个任务追加到磁盘，识别成功或被取消后追加一条完成记录。
+// 服务端不可用时任务留在日志中，启动时重放日志即可恢复所有未完成的任务。
+//
+// 文件格式（小端）：8 字节文件头 "FRJQ" + 版本号(quint16) + 保留(quint16)，之后是连续的记录：
+//   quint32 载荷长度 | quint16 校验和（qChecksum，覆盖类型和载荷）| quint8 类型 | 载荷
+//   Enqueue 载荷：quint64 id | qint64 创建时间(ms) | quint8 优先级 | 服务端地址 | 模型 | 输出模式 | quint32 图像长度 | 图像（PNG）
+//   （三个字符串各为 quint32 长度 + UTF-8，与 QDataStream 写入 QByteArray 的格式相同）
+//   Done 载荷：quint64 id
+// 只追加不改写；写入先进入缓冲区，按 syncIntervalMs 或每 syncBatch 条记录 flush 一次并在线程池中 fsync，
+// 批量入队时多条记录共用一次 fsync，追加不等待落盘；同一时间只有一次 fsync，期间写入的记录由下一次一起同步。打开时逐条校验，遇到写了一半的记录（断电、崩溃）即截断到最后一条完整记录。
+// 没有未完成任务时文件截回文件头；已完成记录占多数且文件超过 compactBytes 时重写为只含未完成任务的新文件
+class JobJournal : public QObject
+{
+    Q_OBJECT
+public:
+    struct Settings
+    {
+        int syncIntervalMs = 20;                  // 追加后最多等待多久 fsync
+        int syncBatch = 256;                      // 累积这么多条未同步的记录立即 fsync
+        qint64 compactBytes = 64 * 1024 * 1024;   // 文件超过该大小且一半以上是已完成的任务时压缩
+    };
+
+    // 任务入队时的识别参数：重放时按原来的服务端、模型和输出模式识别，不受之后的设置变化影响
+    struct Params
+    {
+        QString url;
+        QString model;
+        QString outputMode;
+    };
+
+    struct Record
+    {
+        quint64 id = 0;
+        qint64 createdAtMs = 0;
+        int priority = 0;
+        Params params;
+        QByteArray image;   // PNG
+    };
+
+    struct Stats
+    {
+        qint64 appended = 0;     // Enqueue 记录数
+        qint64 completed = 0;    // Done 记录数
+        qint64 syncs = 0;        // fsync 次数
+        qint64 bytesWritten = 0;
+        int truncatedBytes = 0;  // 打开时丢弃的不完整尾部
+    };
+
+    enum RecordType : quint8 { Enqueue = 1, Done = 2 };
+
+    static const int FileHeaderSize = 8;
+    static const int RecordHeaderSize = 7;
+
+    explicit JobJournal(QObject *parent = nullptr);
+    ~JobJournal() override;
+
+    void setSettings(const Settings &settings);
+
+    // 打开（不存在时创建）并重放日志，之后 pendingIds() 为未完成的任务
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const;
+    QString path() const;
+
+    // 追加一个任务，返回其 id；失败返回 0。记录在下一次 sync 后才落盘
+    quint64 append(const QByteArray &image, int priority, const Params &params = Params());
+    void markDone(quint64 id);
+    // 立即 flush 并 fsync 尚未同步的记录，等待进行中的后台 fsync 结束；阻塞调用方
+    bool sync();
+
+    // 未完成的任务，按入队顺序
+    QList<quint64> pendingIds() const;
+    int pendingCount() const;
+    bool contains(quint64 id) const;
+    // 从文件读取一个未完成的任务；不存在时 id 为 0
+    Record record(quint64 id);
+
+    qint64 fileSize() const;
+    Stats stats() const;
+    QString getLastError() const;
+
+    // 截图编码为日志中存储的 PNG：低压缩级别，入队不因编码拖慢
+    static QByteArray encodeImage(const QImage &image);
+    // 一条完整的记录（记录头 + 载荷），测试中用于构造损坏的文件
+    static QByteArray encodeRecord(RecordType type, const QByteArray &payload);
+
+signals:
+    // 一批记录已经落盘
+    void synced(int records);
+
+private:
+    bool writeRecord(RecordType type, const QByteArray &payload);
+    void scheduleSync();
+    // flush 后在线程池中 fsync，结果回到 finishSync
+    void startSync();
+    bool finishSync();
+    bool replay();
+    void maybeCompact();
+    bool compact();
+    bool readAt(qint64 offset, Record *record);
+
+    struct Location
+    {
+        qint64 offset = 0;
+        qint64 size = 0;   // 记录头 + 载荷
+    };
+
+    Settings config;
+    QFile file;
+    QFile reader;                 // 读取图像用的只读句柄，不带缓冲：文件会被截断和重写
+    QMap<quint64, Location> live; // 未完成的任务 id -> Enqueue 记录在文件中的位置
+    qint64 liveBytes;             // 未完成任务的记录总大小
+    quint64 nextId;
+    int unsynced;
+    int syncing;                  // 后台 fsync 进行中的记录数，0 表示没有
+    QFutureWatcher<bool> syncWatcher;
+    QTimer syncTimer;
+    Stats counters;
+    QString lastError;
+};
+
+#endif // JOBJOURNAL_H
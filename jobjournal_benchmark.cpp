@@ -0,0 +1,385 @@
+#include <QTest>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include "jobjournal.h"
+#include "benchmarkutils.h"
+
+// 持久任务队列：日志格式、崩溃后的恢复，以及批量入队时 fsync 合并的效果
+class JobJournalBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void testRoundTrip();
+    void testTornTail();
+    void testCorruptRecord();
+    void testForeignFile();
+    void testTruncateWhenIdle();
+    void testCompaction();
+    void testBatchedSync();
+    void testIntervalSync();
+
+    void reportEnqueueThroughput();
+    void benchAppend_data();
+    void benchAppend();
+    void benchReplay();
+
+private:
+    static const int JobCount = 2000;
+
+    QString freshPath(const QString &name) const;
+    static void appendRaw(const QString &path, const QByteArray &data);
+
+    QTemporaryDir tempDir;
+    QByteArray image;   // 一张公式截图的 PNG
+};
+
+void JobJournalBenchmark::initTestCase()
+{
+    QVERIFY(tempDir.isValid());
+    image = JobJournal::encodeImage(BenchmarkUtils::renderFormulaImage(QSize(640, 120), 1));
+    QVERIFY(!image.isEmpty());
+    qInfo() << "Job image:" << image.size() << "bytes";
+}
+
+QString JobJournalBenchmark::freshPath(const QString &name) const
+{
+    const QString path = tempDir.filePath(name);
+    QFile::remove(path);
+    return path;
+}
+
+void JobJournalBenchmark::appendRaw(const QString &path, const QByteArray &data)
+{
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::Append));
+    QCOMPARE(file.write(data), qint64(data.size()));
+}
+
+void JobJournalBenchmark::testRoundTrip()
+{
+    const QString path = freshPath("roundtrip.journal");
+    {
+        JobJournal journal;
+        QVERIFY(journal.open(path));
+        QCOMPARE(journal.pendingCount(), 0);
+        QCOMPARE(journal.fileSize(), qint64(JobJournal::FileHeaderSize));
+
+        JobJournal::Params params;
+        params.url = "http://localhost:11434/api/generate";
+        params.model = "qwen2.5vl:7b";
+        params.outputMode = "json";
+        const quint64 first = journal.append(image, 0, params);
+        const quint64 second = journal.append("second", 2);
+        const quint64 third = journal.append("third", 2);
+        QVERIFY(first > 0 && second > first && third > second);
+        journal.markDone(second);
+        QCOMPARE(journal.pendingIds(), QList<quint64>({first, third}));
+
+        // 还在写缓冲区中的记录也能读到
+        const JobJournal::Record record = journal.record(first);
+        QCOMPARE(record.id, first);
+        QCOMPARE(record.image, image);
+        QCOMPARE(journal.record(second).id, quint64(0));
+    }
+
+    // 析构时落盘；重新打开得到同样的未完成任务，新任务的 id 不与之重复
+    JobJournal journal;
+    QVERIFY(journal.open(path));
+    QCOMPARE(journal.pendingCount(), 2);
+    const QList<quint64> pending = journal.pendingIds();
+    const JobJournal::Record first = journal.record(pending.at(0));
+    QCOMPARE(first.image, image);
+    QCOMPARE(first.priority, 0);
+    QVERIFY(first.createdAtMs > 0);
+    QCOMPARE(first.params.url, QString("http://localhost:11434/api/generate"));
+    QCOMPARE(first.params.model, QString("qwen2.5vl:7b"));
+    QCOMPARE(first.params.outputMode, QString("json"));
+    const JobJournal::Record third = journal.record(pending.at(1));
+    QCOMPARE(third.image, QByteArray("third"));
+    QCOMPARE(third.priority, 2);
+    QVERIFY(third.params.model.isEmpty());
+    QVERIFY(journal.append("next", 1) > pending.last());
+    QCOMPARE(journal.stats().truncatedBytes, 0);
+}
+
+void JobJournalBenchmark::testTornTail()
+{
+    const QString path = freshPath("torn.journal");
+    qint64 intact = 0;
+    {
+        JobJournal journal;
+        QVERIFY(journal.open(path));
+        journal.append(image, 2);
+        journal.append(image, 2);
+        QVERIFY(journal.sync());
+        intact = journal.fileSize();
+    }
+
+    // 崩溃时最后一条记录只写了一半
+    QByteArray payload(8, '\0');
+    payload[0] = char(42);
+    const QByteArray record = JobJournal::encodeRecord(JobJournal::Enqueue, payload + image);
+    appendRaw(path, record.left(record.size() / 2));
+
+    JobJournal journal;
+    QVERIFY(journal.open(path));
+    QCOMPARE(journal.pendingCount(), 2);
+    QCOMPARE(journal.stats().truncatedBytes, record.size() / 2);
+    QCOMPARE(journal.fileSize(), intact);
+    QCOMPARE(journal.record(journal.pendingIds().last()).image, image);
+
+    // 只剩记录头的几个字节
+    journal.close();
+    appendRaw(path, record.left(3));
+    QVERIFY(journal.open(path));
+    QCOMPARE(journal.pendingCount(), 2);
+    QCOMPARE(journal.fileSize(), intact);
+}
+
+void JobJournalBenchmark::testCorruptRecord()
+{
+    const QString path = freshPath("corrupt.journal");
+    qint64 firstEnd = 0;
+    {
+        JobJournal journal;
+        QVERIFY(journal.open(path));
+        journal.append("first", 0);
+        QVERIFY(journal.sync());
+        firstEnd = journal.fileSize();
+        journal.append("second", 0);
+    }
+
+    // 第二条记录的载荷被改写：校验和不符，从这里截断
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.seek(file.size() - 1));
+    QVERIFY(file.putChar('X'));
+    file.close();
+
+    JobJournal journal;
+    QVERIFY(journal.open(path));
+    QCOMPARE(journal.pendingCount(), 1);
+    QCOMPARE(journal.record(journal.pendingIds().first()).image, QByteArray("first"));
+    QCOMPARE(journal.fileSize(), firstEnd);
+}
+
+void JobJournalBenchmark::testForeignFile()
+{
+    const QString path = freshPath("foreign.journal");
+    appendRaw(path, "not a job journal at all");
+
+    // 不是本程序的文件：不能截断或覆盖
+    JobJournal journal;
+    QVERIFY(!journal.open(path));
+    QVERIFY(!journal.getLastError().isEmpty());
+    QVERIFY(!journal.isOpen());
+    QCOMPARE(QFileInfo(path).size(), qint64(24));
+
+    // 旧版本的日志（Enqueue 载荷没有识别参数）同样不改动
+    const QString old = freshPath("v1.journal");
+    appendRaw(old, QByteArray("FRJQ\x01\x00\x00\x00", 8) + JobJournal::encodeRecord(JobJournal::Done, QByteArray(8, '\0')));
+    QVERIFY(!journal.open(old));
+    QVERIFY(journal.getLastError().contains("version"));
+    QCOMPARE(QFileInfo(old).size(), qint64(JobJournal::FileHeaderSize + JobJournal::RecordHeaderSize + 8));
+}
+
+void JobJournalBenchmark::testTruncateWhenIdle()
+{
+    const QString path = freshPath("idle.journal");
+    JobJournal journal;
+    QVERIFY(journal.open(path));
+    const quint64 first = journal.append(image, 0);
+    const quint64 second = journal.append(image, 2);
+    QVERIFY(journal.sync());
+    QVERIFY(journal.fileSize() > 2 * image.size());
+
+    journal.markDone(first);
+    journal.markDone(second);
+    QVERIFY(journal.sync());
+    // 所有任务都已完成：日志截回文件头，id 重新开始
+    QCOMPARE(journal.fileSize(), qint64(JobJournal::FileHeaderSize));
+    QCOMPARE(journal.append("again", 0), quint64(1));
+}
+
+void JobJournalBenchmark::testCompaction()
+{
+    const QString path = freshPath("compact.journal");
+    JobJournal::Settings settings;
+    settings.syncIntervalMs = 1000;
+    settings.syncBatch = 1000;
+    settings.compactBytes = 4 * image.size();
+
+    JobJournal journal;
+    journal.setSettings(settings);
+    QVERIFY(journal.open(path));
+    QList<quint64> ids;
+    for (int i = 0; i < 20; ++i) {
+        ids << journal.append(image, 2);
+    }
+    QVERIFY(journal.sync());
+    const qint64 before = journal.fileSize();
+
+    // 完成 17 个：只剩 3 个任务，文件超过 compactBytes，压缩为只含这 3 条记录
+    for (int i = 0; i < 17; ++i) {
+        journal.markDone(ids.at(i));
+    }
+    QVERIFY(journal.sync());
+    QCOMPARE(journal.pendingIds(), ids.mid(17));
+    QVERIFY(journal.fileSize() < before / 5);
+    QCOMPARE(journal.record(ids.at(18)).image, image);
+
+    // 压缩后的文件可以继续追加，重新打开时内容一致
+    const quint64 next = journal.append("after", 1);
+    journal.close();
+    QVERIFY(journal.open(path));
+    QCOMPARE(journal.pendingIds(), ids.mid(17) << next);
+    QCOMPARE(journal.record(next).image, QByteArray("after"));
+    QCOMPARE(journal.stats().truncatedBytes, 0);
+}
+
+void JobJournalBenchmark::testBatchedSync()
+{
+    JobJournal::Settings settings;
+    settings.syncIntervalMs = 60000;
+    settings.syncBatch = 100;
+
+    JobJournal journal;
+    journal.setSettings(settings);
+    QVERIFY(journal.open(freshPath("batched.journal")));
+    QSignalSpy synced(&journal, &JobJournal::synced);
+    for (int i = 0; i < 250; ++i) {
+        journal.append("x", 2);
+    }
+    // 追加不等待落盘：满 100 条发起一次后台 fsync，结果在事件循环中处理
+    QCOMPARE(journal.stats().syncs, qint64(0));
+    // 同一时间只有一次 fsync：进行中时到达的 150 条由下一次一起同步
+    QTRY_COMPARE(journal.stats().syncs, qint64(2));
+    QCOMPARE(synced.count(), 2);
+    QCOMPARE(synced.at(0).at(0).toInt(), 100);
+    QCOMPARE(synced.at(1).at(0).toInt(), 150);
+
+    // syncIntervalMs 为 0：每条记录立即发起 fsync，进行中时到达的记录排在下一次
+    settings.syncIntervalMs = 0;
+    journal.setSettings(settings);
+    journal.append("y", 2);
+    journal.append("z", 2);
+    QTRY_COMPARE(journal.stats().syncs, qint64(4));
+
+    // 显式 sync 等待进行中的 fsync 并同步其余记录，之后到达的 finished 信号不再重复计数
+    journal.append("w", 2);
+    QVERIFY(journal.sync());
+    QCOMPARE(journal.stats().syncs, qint64(5));
+    QTest::qWait(50);
+    QCOMPARE(journal.stats().syncs, qint64(5));
+    QCOMPARE(synced.count(), 5);
+}
+
+void JobJournalBenchmark::testIntervalSync()
+{
+    JobJournal::Settings settings;
+    settings.syncIntervalMs = 10;
+    settings.syncBatch = 1000;
+
+    JobJournal journal;
+    journal.setSettings(settings);
+    QVERIFY(journal.open(freshPath("interval.journal")));
+    for (int i = 0; i < 5; ++i) {
+        journal.append("x", 2);
+    }
+    QCOMPARE(journal.stats().syncs, qint64(0));
+    // 五条记录共用计时器到期时的一次 fsync
+    QTRY_COMPARE(journal.stats().syncs, qint64(1));
+}
+
+void JobJournalBenchmark::reportEnqueueThroughput()
+{
+    // 逐个入队 JobCount 张截图，每条之后处理一次事件（与界面中逐个提交相同）。
+    // blocking 为每条记录之后调用 sync()，在调用方线程上逐条 fsync；其余在线程池中 fsync，追加不等待落盘，
+    // fsyncs 为实际的落盘次数：进行中时到达的记录合并到下一次
+    qInfo().noquote() << QString("%1 %2 %3 %4 %5").arg("syncBatch", 10).arg("ms", 8)
+                         .arg("jobs/s", 10).arg("fsyncs", 8).arg("MB", 8);
+    for (int batch : {0, 1, 16, 256, 4096}) {
+        JobJournal::Settings settings;
+        settings.syncIntervalMs = 60000;
+        settings.syncBatch = qMax(1, batch);
+
+        JobJournal journal;
+        journal.setSettings(settings);
+        QVERIFY(journal.open(freshPath(QString("throughput-%1.journal").arg(batch))));
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < JobCount; ++i) {
+            QVERIFY(journal.append(image, 2) > 0);
+            if (batch == 0) {
+                QVERIFY(journal.sync());
+            }
+            QCoreApplication::processEvents();
+        }
+        QVERIFY(journal.sync());
+        const qint64 ms = qMax<qint64>(1, timer.elapsed());
+        const JobJournal::Stats stats = journal.stats();
+        QCOMPARE(journal.pendingCount(), JobCount);
+        const QString label = batch == 0 ? QString("blocking") : QString::number(batch);
+        qInfo().noquote() << QString("%1 %2 %3 %4 %5").arg(label, 10).arg(ms, 8)
+                             .arg(JobCount * 1000 / ms, 10).arg(stats.syncs, 8)
+                             .arg(stats.bytesWritten / 1048576.0, 8, 'f', 1);
+    }
+}
+
+void JobJournalBenchmark::benchAppend_data()
+{
+    QTest::addColumn<bool>("blocking");
+    QTest::newRow("sync-each") << true;
+    QTest::newRow("background") << false;
+}
+
+void JobJournalBenchmark::benchAppend()
+{
+    // 单条入队在调用方线程上的耗时：逐条 sync() 与后台 fsync（syncBatch 为 1）
+    QFETCH(bool, blocking);
+    JobJournal::Settings settings;
+    settings.syncIntervalMs = 60000;
+    settings.syncBatch = 1;
+
+    JobJournal journal;
+    journal.setSettings(settings);
+    QVERIFY(journal.open(freshPath(QString("append-%1.journal").arg(blocking ? "sync" : "background"))));
+    QBENCHMARK {
+        journal.append(image, 2);
+        if (blocking) {
+            journal.sync();
+        }
+        QCoreApplication::processEvents();
+    }
+}
+
+void JobJournalBenchmark::benchReplay()
+{
+    // 启动时扫描 JobCount 个未完成任务的日志（逐条校验，图像不留在内存中）
+    const QString path = freshPath("replay.journal");
+    {
+        JobJournal::Settings settings;
+        settings.syncBatch = JobCount;
+        JobJournal journal;
+        journal.setSettings(settings);
+        QVERIFY(journal.open(path));
+        for (int i = 0; i < JobCount; ++i) {
+            journal.append(image, 2);
+        }
+    }
+    QBENCHMARK {
+        JobJournal journal;
+        QVERIFY(journal.open(path));
+        QCOMPARE(journal.pendingCount(), JobCount);
+    }
+}
+
+QTEST_MAIN(JobJournalBenchmark)
+#include "jobjournal_benchmark.moc"
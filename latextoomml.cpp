@@ -0,0 +1,1130 @@
+#include "latextoomml.h"
+#include <QHash>
+#include <QRegularExpression>
+#include <QSet>
+#include <QVector>
+#include <QDebug>
+
+const char *LatexToOmml::MathNamespace = "http://schemas.openxmlformats.org/officeDocument/2006/math";
+
+namespace {
+
+struct Token
+{
+    enum Type { Command, Char, Space, BeginGroup, EndGroup, Superscript, Subscript, Align, NewRow, End };
+    Type type;
+    QString text;
+};
+
+bool isAsciiLetter(QChar c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+QVector<Token> tokenize(const QString &latex)
+{
+    QVector<Token> tokens;
+    const int n = latex.size();
+    for (int i = 0; i < n; ++i) {
+        const QChar c = latex.at(i);
+        if (c == '\\') {
+            if (i + 1 >= n) {
+                tokens.append({Token::Char, QString(c)});
+                break;
+            }
+            const QChar next = latex.at(i + 1);
+            if (next == '\\') {
+                tokens.append({Token::NewRow, QString()});
+                ++i;
+            } else if (isAsciiLetter(next)) {
+                int j = i + 1;
+                while (j < n && isAsciiLetter(latex.at(j))) {
+                    ++j;
+                }
+                // \operatorname* 之类带星号的命令
+                if (j < n && latex.at(j) == '*') {
+                    ++j;
+                }
+                tokens.append({Token::Command, latex.mid(i + 1, j - i - 1)});
+                i = j - 1;
+            } else {
+                tokens.append({Token::Command, QString(next)});
+                ++i;
+            }
+        } else if (c == '{') {
+            tokens.append({Token::BeginGroup, QString()});
+        } else if (c == '}') {
+            tokens.append({Token::EndGroup, QString()});
+        } else if (c == '^') {
+            tokens.append({Token::Superscript, QString()});
+        } else if (c == '_') {
+            tokens.append({Token::Subscript, QString()});
+        } else if (c == '&') {
+            tokens.append({Token::Align, QString()});
+        } else if (c == '%') {
+            while (i + 1 < n && latex.at(i + 1) != '\n') {
+                ++i;
+            }
+        } else if (c.isSpace()) {
+            if (tokens.isEmpty() || tokens.last().type != Token::Space) {
+                tokens.append({Token::Space, QString(' ')});
+            }
+        } else if (c.isHighSurrogate() && i + 1 < n) {
+            tokens.append({Token::Char, latex.mid(i, 2)});
+            ++i;
+        } else {
+            tokens.append({Token::Char, QString(c)});
+        }
+    }
+    tokens.append({Token::End, QString()});
+    return tokens;
+}
+
+// ---- OMML 片段 ----
+
+QString element(const QString &name, const QString &content)
+{
+    return QLatin1String("<m:") + name + QLatin1Char('>') + content + QLatin1String("</m:") + name + QLatin1Char('>');
+}
+
+QString valueProperty(const QString &name, const QString &value)
+{
+    return QLatin1String("<m:") + name + QLatin1String(" m:val=\"") + value.toHtmlEscaped() + QLatin1String("\"/>");
+}
+
+QString makeRun(const QString &text, const QString &props)
+{
+    QString run = QLatin1String("<m:r>");
+    if (!props.isEmpty()) {
+        run += element("rPr", props);
+    }
+    run += text.contains(' ') ? QLatin1String("<m:t xml:space=\"preserve\">") : QLatin1String("<m:t>");
+    run += text.toHtmlEscaped() + QLatin1String("</m:t></m:r>");
+    return run;
+}
+
+const QString PlainStyle = QStringLiteral("<m:sty m:val=\"p\"/>");
+const QString TextStyle = QStringLiteral("<m:nor/>");
+
+// ---- 符号表 ----
+
+struct SymbolEntry
+{
+    const char *name;
+    ushort code;
+};
+
+QHash<QString, QString> buildTable(const SymbolEntry *entries, int count)
+{
+    QHash<QString, QString> table;
+    for (int i = 0; i < count; ++i) {
+        table.insert(QLatin1String(entries[i].name), QString(QChar(entries[i].code)));
+    }
+    return table;
+}
+
+const QHash<QString, QString> &symbols()
+{
+    static const SymbolEntry entries[] = {
+        // 希腊字母
+        {"alpha", 0x03B1}, {"beta", 0x03B2}, {"gamma", 0x03B3}, {"delta", 0x03B4},
+        {"epsilon", 0x03F5}, {"varepsilon", 0x03B5}, {"zeta", 0x03B6}, {"eta", 0x03B7},
+        {"theta", 0x03B8}, {"vartheta", 0x03D1}, {"iota", 0x03B9}, {"kappa", 0x03BA},
+        {"lambda", 0x03BB}, {"mu", 0x03BC}, {"nu", 0x03BD}, {"xi", 0x03BE},
+        {"pi", 0x03C0}, {"varpi", 0x03D6}, {"rho", 0x03C1}, {"varrho", 0x03F1},
+        {"sigma", 0x03C3}, {"varsigma", 0x03C2}, {"tau", 0x03C4}, {"upsilon", 0x03C5},
+        {"phi", 0x03D5}, {"varphi", 0x03C6}, {"chi", 0x03C7}, {"psi", 0x03C8},
+        {"omega", 0x03C9},
+        {"Gamma", 0x0393}, {"Delta", 0x0394}, {"Theta", 0x0398}, {"Lambda", 0x039B},
+        {"Xi", 0x039E}, {"Pi", 0x03A0}, {"Sigma", 0x03A3}, {"Upsilon", 0x03A5},
+        {"Phi", 0x03A6}, {"Psi", 0x03A8}, {"Omega", 0x03A9},
+        // 运算符与关系符
+        {"infty", 0x221E}, {"partial", 0x2202}, {"nabla", 0x2207}, {"cdot", 0x22C5},
+        {"times", 0x00D7}, {"div", 0x00F7}, {"pm", 0x00B1}, {"mp", 0x2213},
+        {"ast", 0x2217}, {"star", 0x22C6}, {"circ", 0x2218}, {"bullet", 0x2219},
+        {"leq", 0x2264}, {"le", 0x2264}, {"geq", 0x2265}, {"ge", 0x2265},
+        {"leqslant", 0x2A7D}, {"geqslant", 0x2A7E},
+        {"neq", 0x2260}, {"ne", 0x2260}, {"approx", 0x2248}, {"equiv", 0x2261},
+        {"sim", 0x223C}, {"simeq", 0x2243}, {"cong", 0x2245}, {"propto", 0x221D},
+        {"ll", 0x226A}, {"gg", 0x226B}, {"in", 0x2208}, {"notin", 0x2209},
+        {"ni", 0x220B}, {"subset", 0x2282}, {"supset", 0x2283}, {"subseteq", 0x2286},
+        {"supseteq", 0x2287}, {"cup", 0x222A}, {"cap", 0x2229}, {"setminus", 0x2216},
+        {"emptyset", 0x2205}, {"varnothing", 0x2205}, {"forall", 0x2200}, {"exists", 0x2203},
+        {"nexists", 0x2204}, {"neg", 0x00AC}, {"lnot", 0x00AC}, {"land", 0x2227},
+        {"wedge", 0x2227}, {"lor", 0x2228}, {"vee", 0x2228}, {"oplus", 0x2295},
+        {"otimes", 0x2297}, {"odot", 0x2299}, {"perp", 0x22A5}, {"parallel", 0x2225},
+        {"mid", 0x2223}, {"therefore", 0x2234}, {"because", 0x2235},
+        // 箭头
+        {"to", 0x2192}, {"rightarrow", 0x2192}, {"leftarrow", 0x2190}, {"gets", 0x2190},
+        {"leftrightarrow", 0x2194}, {"Rightarrow", 0x21D2}, {"implies", 0x21D2},
+        {"Leftarrow", 0x21D0}, {"Leftrightarrow", 0x21D4}, {"iff", 0x21D4},
+        {"mapsto", 0x21A6}, {"uparrow", 0x2191}, {"downarrow", 0x2193},
+        {"longrightarrow", 0x27F6}, {"longleftarrow", 0x27F5}, {"Longrightarrow", 0x27F9},
+        {"rightleftharpoons", 0x21CC},
+        // 其他符号
+        {"ldots", 0x2026}, {"dots", 0x2026}, {"cdots", 0x22EF}, {"vdots", 0x22EE},
+        {"ddots", 0x22F1}, {"angle", 0x2220}, {"hbar", 0x210F}, {"ell", 0x2113},
+        {"Re", 0x211C}, {"Im", 0x2111}, {"aleph", 0x2135}, {"prime", 0x2032},
+        {"degree", 0x00B0}, {"dagger", 0x2020}, {"top", 0x22A4}, {"bot", 0x22A5},
+        {"triangle", 0x25B3}, {"square", 0x25A1},
+        // 定界符
+        {"langle", 0x27E8}, {"rangle", 0x27E9}, {"lfloor", 0x230A}, {"rfloor", 0x230B},
+        {"lceil", 0x2308}, {"rceil", 0x2309}, {"vert", 0x007C}, {"lvert", 0x007C},
+        {"rvert", 0x007C}, {"Vert", 0x2016}, {"lVert", 0x2016}, {"rVert", 0x2016},
+        {"|", 0x2016}, {"lbrace", '{'}, {"rbrace", '}'}, {"{", '{'}, {"}", '}'},
+        // 转义字符
+        {"%", '%'}, {"$", '$'}, {"&", '&'}, {"_", '_'}, {"#", '#'}, {"colon", ':'},
+    };
+    static const QHash<QString, QString> table = buildTable(entries, sizeof(entries) / sizeof(entries[0]));
+    return table;
+}
+
+const QHash<QString, QString> &naryOperators()
+{
+    static const SymbolEntry entries[] = {
+        {"sum", 0x2211}, {"prod", 0x220F}, {"coprod", 0x2210},
+        {"int", 0x222B}, {"iint", 0x222C}, {"iiint", 0x222D}, {"oint", 0x222E},
+        {"bigcup", 0x22C3}, {"bigcap", 0x22C2}, {"bigoplus", 0x2A01}, {"bigotimes", 0x2A02},
+        {"bigvee", 0x22C1}, {"bigwedge", 0x22C0}, {"bigsqcup", 0x2A06},
+    };
+    static const QHash<QString, QString> table = buildTable(entries, sizeof(entries) / sizeof(entries[0]));
+    return table;
+}
+
+const QHash<QString, QString> &accents()
+{
+    static const SymbolEntry entries[] = {
+        {"hat", 0x0302}, {"widehat", 0x0302}, {"check", 0x030C}, {"tilde", 0x0303},
+        {"widetilde", 0x0303}, {"acute", 0x0301}, {"grave", 0x0300}, {"dot", 0x0307},
+        {"ddot", 0x0308}, {"breve", 0x0306}, {"bar", 0x0305}, {"vec", 0x20D7},
+        {"overrightarrow", 0x20D7}, {"overleftarrow", 0x20D6}, {"mathring", 0x030A},
+    };
+    static const QHash<QString, QString> table = buildTable(entries, sizeof(entries) / sizeof(entries[0]));
+    return table;
+}
+
+const QHash<QString, QString> &spaces()
+{
+    static const QHash<QString, QString> table = {
+        {",", QString(QChar(0x2009))}, {"thinspace", QString(QChar(0x2009))},
+        {":", QString(QChar(0x2005))}, {">", QString(QChar(0x2005))},
+        {";", QString(QChar(0x2004))}, {" ", QStringLiteral(" ")},
+        {"enspace", QString(QChar(0x2002))}, {"quad", QString(QChar(0x2003))},
+        {"qquad", QString(2, QChar(0x2003))},
+    };
+    return table;
+}
+
+// 字体命令 → m:rPr 内容
+const QHash<QString, QString> &fontStyles()
+{
+    static const QHash<QString, QString> table = {
+        {"mathrm", PlainStyle},
+        {"mathup", PlainStyle},
+        {"mathbf", QStringLiteral("<m:sty m:val=\"b\"/>")},
+        {"mathit", QStringLiteral("<m:sty m:val=\"i\"/>")},
+        {"boldsymbol", QStringLiteral("<m:sty m:val=\"bi\"/>")},
+        {"bm", QStringLiteral("<m:sty m:val=\"bi\"/>")},
+        {"mathbb", QStringLiteral("<m:scr m:val=\"double-struck\"/><m:sty m:val=\"p\"/>")},
+        {"mathcal", QStringLiteral("<m:scr m:val=\"script\"/><m:sty m:val=\"p\"/>")},
+        {"mathscr", QStringLiteral("<m:scr m:val=\"script\"/><m:sty m:val=\"p\"/>")},
+        {"mathfrak", QStringLiteral("<m:scr m:val=\"fraktur\"/><m:sty m:val=\"p\"/>")},
+        {"mathsf", QStringLiteral("<m:scr m:val=\"sans-serif\"/><m:sty m:val=\"p\"/>")},
+        {"mathtt", QStringLiteral("<m:scr m:val=\"monospace\"/><m:sty m:val=\"p\"/>")},
+    };
+    return table;
+}
+
+const QSet<QString> &functionNames()
+{
+    static const QSet<QString> names = {
+        "sin", "cos", "tan", "cot", "sec", "csc", "arcsin", "arccos", "arctan",
+        "sinh", "cosh", "tanh", "coth", "log", "ln", "lg", "exp", "lim", "limsup",
+        "liminf", "max", "min", "sup", "inf", "det", "dim", "ker", "gcd", "deg",
+        "arg", "Pr", "hom", "mod",
+    };
+    return names;
+}
+
+// 下标写在函数名正下方的函数
+const QSet<QString> &limitFunctions()
+{
+    static const QSet<QString> names = {
+        "lim", "limsup", "liminf", "max", "min", "sup", "inf", "det", "gcd", "Pr",
+    };
+    return names;
+}
+
+const QSet<QString> &relationCommands()
+{
+    static const QSet<QString> names = {
+        "leq", "le", "geq", "ge", "leqslant", "geqslant", "neq", "ne", "approx",
+        "equiv", "sim", "simeq", "cong", "propto", "ll", "gg", "in", "notin",
+        "subset", "supset", "subseteq", "supseteq", "to", "rightarrow", "Rightarrow",
+        "leftarrow", "Leftarrow", "leftrightarrow", "Leftrightarrow", "implies", "iff",
+        "mapsto", "longrightarrow", "Longrightarrow",
+    };
+    return names;
+}
+
+// 只影响排版尺寸、在 OMML 中没有对应的命令
+const QSet<QString> &ignoredCommands()
+{
+    static const QSet<QString> names = {
+        "!", "displaystyle", "textstyle", "scriptstyle", "scriptscriptstyle",
+        "big", "Big", "bigg", "Bigg", "bigl", "bigr", "Bigl", "Bigr",
+        "biggl", "biggr", "Biggl", "Biggr", "nonumber", "notag", "limits", "nolimits",
+    };
+    return names;
+}
+
+struct Atom
+{
+    enum Kind { Ordinary, Nary, Func, Brace };
+    Kind kind = Ordinary;
+    bool isText = false;     // 文本节点可与相邻的同样式文本合并为一个 m:r
+    bool relation = false;   // =、<、\leq 等，用于确定求和/积分的作用范围
+    QString text;
+    QString props;
+    QString xml;
+    QString symbol;          // 大型运算符或花括号字符
+    QString funcName;
+    bool limitsUnder = true; // 大型运算符的上下限位置
+    bool braceTop = true;
+
+    QString toXml() const { return isText ? makeRun(text, props) : xml; }
+};
+
+class Parser
+{
+public:
+    explicit Parser(const QVector<Token> &tokens) : tokens(tokens), pos(0) {}
+
+    QString parseFormula()
+    {
+        QList<QStringList> rows = parseRows();
+        if (error.isEmpty() && peek().type != Token::End) {
+            const Token &t = peek();
+            if (t.type == Token::EndGroup) {
+                fail("Unbalanced '}'");
+            } else if (t.type == Token::Command) {
+                fail(QString("Unexpected \\%1").arg(t.text));
+            } else {
+                fail("Unexpected token");
+            }
+        }
+        if (rows.size() == 1) {
+            return rows.first().join(QString());
+        }
+        return equationArray(rows);
+    }
+
+    QString errorString() const { return error; }
+
+private:
+    const Token &peek() const { return tokens.at(pos); }
+
+    const Token &next()
+    {
+        const Token &t = tokens.at(pos);
+        if (t.type != Token::End) {
+            ++pos;
+        }
+        return t;
+    }
+
+    void skipSpaces()
+    {
+        while (peek().type == Token::Space) {
+            ++pos;
+        }
+    }
+
+    void fail(const QString &message)
+    {
+        if (error.isEmpty()) {
+            error = message;
+        }
+    }
+
+    void expectEndGroup()
+    {
+        skipSpaces();
+        if (peek().type == Token::EndGroup) {
+            next();
+        } else {
+            fail("Missing '}'");
+        }
+    }
+
+    static bool isTerminator(const Token &t)
+    {
+        switch (t.type) {
+        case Token::End:
+        case Token::EndGroup:
+        case Token::Align:
+        case Token::NewRow:
+            return true;
+        case Token::Command:
+            return t.text == "right" || t.text == "middle" || t.text == "end";
+        default:
+            return false;
+        }
+    }
+
+    static bool isRelation(const Token &t)
+    {
+        if (t.type == Token::Char) {
+            return t.text == "=" || t.text == "<" || t.text == ">";
+        }
+        return t.type == Token::Command && relationCommands().contains(t.text);
+    }
+
+    // 单元格按 & 分隔，行按 \\ 分隔
+    QList<QStringList> parseRows()
+    {
+        QList<QStringList> rows;
+        QStringList cells;
+        while (error.isEmpty()) {
+            cells << parseSequence();
+            const Token::Type type = peek().type;
+            if (type == Token::Align) {
+                next();
+                continue;
+            }
+            rows << cells;
+            cells.clear();
+            if (type == Token::NewRow) {
+                next();
+                skipRowSpacing();
+                continue;
+            }
+            break;
+        }
+        // 末尾的 \\ 会多出一个空行
+        if (rows.size() > 1 && rows.last().size() == 1 && rows.last().first().isEmpty()) {
+            rows.removeLast();
+        }
+        return rows;
+    }
+
+    // \\[2pt] 这类行距参数
+    void skipRowSpacing()
+    {
+        skipSpaces();
+        if (peek().type == Token::Char && peek().text == "[") {
+            while (peek().type != Token::End && !(peek().type == Token::Char && peek().text == "]")) {
+                next();
+            }
+            next();
+        }
+    }
+
+    QString parseSequence(bool stopAtRelation = false, const QString &stopChar = QString())
+    {
+        QList<Atom> atoms;
+        while (error.isEmpty()) {
+            skipSpaces();
+            const Token &t = peek();
+            if (isTerminator(t)
+                    || (!stopChar.isEmpty() && t.type == Token::Char && t.text == stopChar)
+                    || (stopAtRelation && isRelation(t))) {
+                break;
+            }
+            Atom atom;
+            if (parseScripted(&atom)) {
+                atoms.append(atom);
+            }
+        }
+        return joinAtoms(atoms);
+    }
+
+    static QString joinAtoms(const QList<Atom> &atoms)
+    {
+        QString xml;
+        QString pendingText;
+        QString pendingProps;
+        bool pending = false;
+        for (const Atom &atom : atoms) {
+            if (atom.isText && pending && atom.props == pendingProps) {
+                pendingText += atom.text;
+                continue;
+            }
+            if (pending) {
+                xml += makeRun(pendingText, pendingProps);
+                pending = false;
+            }
+            if (atom.isText) {
+                pendingText = atom.text;
+                pendingProps = atom.props;
+                pending = true;
+            } else {
+                xml += atom.xml;
+            }
+        }
+        if (pending) {
+            xml += makeRun(pendingText, pendingProps);
+        }
+        return xml;
+    }
+
+    // 基本单元及其上下标
+    bool parseScripted(Atom *out)
+    {
+        Atom base;
+        if (!parseAtom(&base)) {
+            return false;
+        }
+
+        QString sub;
+        QString sup;
+        bool hasSub = false;
+        bool hasSup = false;
+        while (error.isEmpty()) {
+            skipSpaces();
+            const Token &t = peek();
+            if (t.type == Token::Command && (t.text == "limits" || t.text == "nolimits")) {
+                base.limitsUnder = t.text == "limits";
+                next();
+            } else if (t.type == Token::Superscript) {
+                next();
+                sup += parseArgument();
+                hasSup = true;
+            } else if (t.type == Token::Subscript) {
+                next();
+                sub += parseArgument();
+                hasSub = true;
+            } else if (t.type == Token::Char && t.text == "'") {
+                next();
+                sup += makeRun(QString(QChar(0x2032)), QString());
+                hasSup = true;
+            } else {
+                break;
+            }
+        }
+
+        switch (base.kind) {
+        case Atom::Nary: {
+            QString props = valueProperty("chr", base.symbol)
+                    + valueProperty("limLoc", base.limitsUnder ? "undOvr" : "subSup");
+            if (!hasSub) {
+                props += valueProperty("subHide", "1");
+            }
+            if (!hasSup) {
+                props += valueProperty("supHide", "1");
+            }
+            // 被积/求和部分延续到下一个关系符为止
+            const QString body = parseSequence(true);
+            out->xml = element("nary", element("naryPr", props) + element("sub", sub)
+                               + element("sup", sup) + element("e", body));
+            return true;
+        }
+        case Atom::Func: {
+            QString name = makeRun(base.funcName, PlainStyle);
+            if (hasSub && !hasSup && limitFunctions().contains(base.funcName)) {
+                name = element("limLow", element("e", name) + element("lim", sub));
+            } else {
+                name = scripts(name, hasSub, sub, hasSup, sup);
+            }
+            out->xml = element("func", element("fName", name) + element("e", parseFunctionArgument()));
+            return true;
+        }
+        case Atom::Brace:
+            if (hasSup && base.braceTop && !hasSub) {
+                out->xml = element("limUpp", element("e", base.xml) + element("lim", sup));
+                return true;
+            }
+            if (hasSub && !base.braceTop && !hasSup) {
+                out->xml = element("limLow", element("e", base.xml) + element("lim", sub));
+                return true;
+            }
+            break;
+        case Atom::Ordinary:
+            break;
+        }
+
+        if (!hasSub && !hasSup) {
+            *out = base;
+        } else {
+            out->xml = scripts(base.toXml(), hasSub, sub, hasSup, sup);
+        }
+        return true;
+    }
+
+    static QString scripts(const QString &base, bool hasSub, const QString &sub, bool hasSup, const QString &sup)
+    {
+        if (hasSub && hasSup) {
+            return element("sSubSup", element("e", base) + element("sub", sub) + element("sup", sup));
+        }
+        if (hasSup) {
+            return element("sSup", element("e", base) + element("sup", sup));
+        }
+        if (hasSub) {
+            return element("sSub", element("e", base) + element("sub", sub));
+        }
+        return base;
+    }
+
+    // \sin x、\log(x+1)：括号内整体作为函数参数
+    QString parseFunctionArgument()
+    {
+        skipSpaces();
+        const Token &t = peek();
+        if (isTerminator(t) || isRelation(t)) {
+            return QString();
+        }
+        if (t.type == Token::Char && t.text == "(") {
+            next();
+            const QString inner = parseSequence(false, ")");
+            if (peek().type == Token::Char && peek().text == ")") {
+                next();
+            } else {
+                fail("Missing ')'");
+            }
+            return element("d", element("dPr", QString()) + element("e", inner));
+        }
+        Atom argument;
+        if (!parseScripted(&argument)) {
+            return QString();
+        }
+        return argument.toXml();
+    }
+
+    // 命令参数或上下标：{...} 整组，否则取单个记号
+    QString parseArgument()
+    {
+        skipSpaces();
+        const Token &t = peek();
+        if (t.type == Token::BeginGroup) {
+            next();
+            const QString xml = parseSequence();
+            expectEndGroup();
+            return xml;
+        }
+        if (isTerminator(t) || t.type == Token::Superscript || t.type == Token::Subscript) {
+            fail("Missing argument");
+            return QString();
+        }
+        Atom atom;
+        if (!parseAtom(&atom)) {
+            return QString();
+        }
+        return atom.toXml();
+    }
+
+    // \text{...} 之类按原样读取的参数
+    QString readRawArgument()
+    {
+        skipSpaces();
+        if (peek().type != Token::BeginGroup) {
+            const Token &t = next();
+            return t.type == Token::Command ? symbols().value(t.text, "\\" + t.text) : t.text;
+        }
+        next();
+        QString text;
+        int depth = 1;
+        while (error.isEmpty()) {
+            const Token &t = next();
+            switch (t.type) {
+            case Token::BeginGroup:
+                ++depth;
+                break;
+            case Token::EndGroup:
+                if (--depth == 0) {
+                    return text;
+                }
+                break;
+            case Token::Command:
+                text += symbols().value(t.text, spaces().value(t.text, "\\" + t.text));
+                break;
+            case Token::Superscript:
+                text += '^';
+                break;
+            case Token::Subscript:
+                text += '_';
+                break;
+            case Token::Align:
+                text += '&';
+                break;
+            case Token::NewRow:
+                text += ' ';
+                break;
+            case Token::End:
+                fail("Missing '}'");
+                break;
+            default:
+                text += t.text;
+                break;
+            }
+        }
+        return text;
+    }
+
+    QString parseDelimiter()
+    {
+        skipSpaces();
+        const Token &t = next();
+        if (t.type == Token::Char) {
+            return t.text == "." ? QString() : t.text;
+        }
+        if (t.type == Token::Command && symbols().contains(t.text)) {
+            return symbols().value(t.text);
+        }
+        fail("Invalid delimiter after \\left or \\right");
+        return QString();
+    }
+
+    bool parseAtom(Atom *atom)
+    {
+        skipSpaces();
+        const Token &t = next();
+        switch (t.type) {
+        case Token::BeginGroup:
+            atom->xml = parseSequence();
+            expectEndGroup();
+            return true;
+        case Token::Char:
+            return charAtom(t.text, atom);
+        case Token::Command:
+            return commandAtom(t.text, atom);
+        case Token::Superscript:
+        case Token::Subscript:
+            // 没有底数的上下标（如 {}^{14}C 之外的 ^2），用空底数
+            --pos;
+            return true;
+        default:
+            fail("Unexpected token");
+            return false;
+        }
+    }
+
+    bool charAtom(const QString &text, Atom *atom)
+    {
+        atom->isText = true;
+        atom->props = currentStyle;
+        atom->relation = text == "=" || text == "<" || text == ">";
+        if (text == "-") {
+            atom->text = QChar(0x2212);
+        } else if (text == "*") {
+            atom->text = QChar(0x2217);
+        } else {
+            atom->text = text;
+        }
+        return true;
+    }
+
+    bool textAtom(const QString &text, const QString &props, Atom *atom)
+    {
+        atom->isText = true;
+        atom->text = text;
+        atom->props = props;
+        return true;
+    }
+
+    bool commandAtom(const QString &name, Atom *atom)
+    {
+        if (symbols().contains(name)) {
+            atom->relation = relationCommands().contains(name);
+            return textAtom(symbols().value(name), currentStyle, atom);
+        }
+        if (spaces().contains(name)) {
+            return textAtom(spaces().value(name), QString(), atom);
+        }
+        if (ignoredCommands().contains(name)) {
+            return false;
+        }
+        if (name == "label" || name == "tag" || name == "tag*") {
+            readRawArgument();
+            return false;
+        }
+        if (naryOperators().contains(name)) {
+            atom->kind = Atom::Nary;
+            atom->symbol = naryOperators().value(name);
+            // 积分的上下限默认写在右侧
+            atom->limitsUnder = !name.contains("int");
+            atom->xml = makeRun(atom->symbol, QString());
+            return true;
+        }
+        if (functionNames().contains(name)) {
+            atom->kind = Atom::Func;
+            atom->funcName = name;
+            atom->xml = makeRun(name, PlainStyle);
+            return true;
+        }
+        if (name == "operatorname" || name == "operatorname*") {
+            atom->kind = Atom::Func;
+            atom->funcName = readRawArgument();
+            atom->xml = makeRun(atom->funcName, PlainStyle);
+            return true;
+        }
+        if (name == "frac" || name == "dfrac" || name == "tfrac" || name == "cfrac") {
+            const QString num = parseArgument();
+            const QString den = parseArgument();
+            atom->xml = element("f", element("num", num) + element("den", den));
+            return true;
+        }
+        if (name == "binom" || name == "dbinom" || name == "tbinom") {
+            const QString top = parseArgument();
+            const QString bottom = parseArgument();
+            const QString fraction = element("f", element("fPr", valueProperty("type", "noBar"))
+                                             + element("num", top) + element("den", bottom));
+            atom->xml = element("d", element("dPr", QString()) + element("e", fraction));
+            return true;
+        }
+        if (name == "sqrt") {
+            skipSpaces();
+            QString degree;
+            const bool hasDegree = peek().type == Token::Char && peek().text == "[";
+            if (hasDegree) {
+                next();
+                degree = parseSequence(false, "]");
+                if (peek().type == Token::Char && peek().text == "]") {
+                    next();
+                } else {
+                    fail("Missing ']'");
+                }
+            }
+            const QString radicand = parseArgument();
+            const QString props = hasDegree ? QString() : valueProperty("degHide", "1");
+            atom->xml = element("rad", element("radPr", props) + element("deg", degree) + element("e", radicand));
+            return true;
+        }
+        if (accents().contains(name)) {
+            const QString base = parseArgument();
+            atom->xml = element("acc", element("accPr", valueProperty("chr", accents().value(name)))
+                                + element("e", base));
+            return true;
+        }
+        if (name == "overline" || name == "underline") {
+            const QString base = parseArgument();
+            const QString position = name == "overline" ? "top" : "bot";
+            atom->xml = element("bar", element("barPr", valueProperty("pos", position)) + element("e", base));
+            return true;
+        }
+        if (name == "overbrace" || name == "underbrace") {
+            const bool top = name == "overbrace";
+            const QString base = parseArgument();
+            atom->kind = Atom::Brace;
+            atom->braceTop = top;
+            const QString props = valueProperty("chr", QString(QChar(top ? 0x23DE : 0x23DF)))
+                    + valueProperty("pos", top ? "top" : "bot")
+                    + valueProperty("vertJc", top ? "bot" : "top");
+            atom->xml = element("groupChr", element("groupChrPr", props) + element("e", base));
+            return true;
+        }
+        if (name == "overset" || name == "stackrel" || name == "underset") {
+            const QString limit = parseArgument();
+            const QString base = parseArgument();
+            const QString tag = name == "underset" ? "limLow" : "limUpp";
+            atom->xml = element(tag, element("e", base) + element("lim", limit));
+            return true;
+        }
+        if (fontStyles().contains(name)) {
+            const QString saved = currentStyle;
+            currentStyle = fontStyles().value(name);
+            atom->xml = parseArgument();
+            currentStyle = saved;
+            return true;
+        }
+        if (name == "text" || name == "textrm" || name == "textnormal" || name == "mbox"
+                || name == "textit" || name == "textbf") {
+            return textAtom(readRawArgument(), TextStyle, atom);
+        }
+        if (name == "not") {
+            Atom negated;
+            if (!parseAtom(&negated) || !negated.isText) {
+                fail("Unsupported \\not");
+                return false;
+            }
+            if (negated.text == "=") {
+                negated.text = QChar(0x2260);
+            } else if (negated.text == symbols().value("in")) {
+                negated.text = QChar(0x2209);
+            } else if (negated.text == symbols().value("subset")) {
+                negated.text = QChar(0x2284);
+            } else if (negated.text == symbols().value("equiv")) {
+                negated.text = QChar(0x2262);
+            } else {
+                negated.text += QChar(0x0338);
+            }
+            *atom = negated;
+            atom->relation = true;
+            return true;
+        }
+        if (name == "left") {
+            return delimitedAtom(atom);
+        }
+        if (name == "begin") {
+            return environmentAtom(atom);
+        }
+
+        // 不认识的命令原样保留，保证内容不丢失
+        qDebug() << "LatexToOmml: unsupported command" << name;
+        return textAtom("\\" + name, PlainStyle, atom);
+    }
+
+    bool delimitedAtom(Atom *atom)
+    {
+        const QString begin = parseDelimiter();
+        QString separator;
+        QString end;
+        QStringList elements;
+        while (error.isEmpty()) {
+            elements << parseSequence();
+            const Token &t = peek();
+            if (t.type == Token::Command && t.text == "middle") {
+                next();
+                separator = parseDelimiter();
+                continue;
+            }
+            if (t.type == Token::Command && t.text == "right") {
+                next();
+                end = parseDelimiter();
+                break;
+            }
+            fail("Missing \\right");
+        }
+
+        QString props = valueProperty("begChr", begin) + valueProperty("endChr", end);
+        if (!separator.isEmpty()) {
+            props += valueProperty("sepChr", separator);
+        }
+        QString xml = element("dPr", props);
+        for (const QString &e : elements) {
+            xml += element("e", e);
+        }
+        atom->xml = element("d", xml);
+        return true;
+    }
+
+    bool environmentAtom(Atom *atom)
+    {
+        const QString name = readRawArgument();
+        if (name == "array") {
+            readRawArgument(); // 列格式
+        }
+        const QList<QStringList> rows = parseRows();
+        skipSpaces();
+        if (peek().type == Token::Command && peek().text == "end") {
+            next();
+            const QString endName = readRawArgument();
+            if (endName != name) {
+                fail(QString("\\begin{%1} ended by \\end{%2}").arg(name, endName));
+            }
+        } else {
+            fail(QString("Missing \\end{%1}").arg(name));
+        }
+
+        static const QHash<QString, QPair<QString, QString>> matrixDelimiters = {
+            {"matrix", {QString(), QString()}},
+            {"smallmatrix", {QString(), QString()}},
+            {"array", {QString(), QString()}},
+            {"pmatrix", {"(", ")"}},
+            {"bmatrix", {"[", "]"}},
+            {"Bmatrix", {"{", "}"}},
+            {"vmatrix", {"|", "|"}},
+            {"Vmatrix", {QString(QChar(0x2016)), QString(QChar(0x2016))}},
+        };
+
+        if (matrixDelimiters.contains(name)) {
+            const QPair<QString, QString> delimiters = matrixDelimiters.value(name);
+            atom->xml = matrix(rows, "center");
+            if (!delimiters.first.isEmpty()) {
+                atom->xml = element("d", element("dPr", valueProperty("begChr", delimiters.first)
+                                                 + valueProperty("endChr", delimiters.second))
+                                    + element("e", atom->xml));
+            }
+        } else if (name == "cases" || name == "dcases") {
+            atom->xml = element("d", element("dPr", valueProperty("begChr", "{") + valueProperty("endChr", QString()))
+                                + element("e", matrix(rows, "left")));
+        } else {
+            // aligned、gathered、split 等多行环境
+            atom->xml = equationArray(rows);
+        }
+        return true;
+    }
+
+    static QString matrix(const QList<QStringList> &rows, const QString &justification)
+    {
+        int columns = 1;
+        for (const QStringList &row : rows) {
+            columns = qMax(columns, row.size());
+        }
+        const QString columnProps = element("mcPr", valueProperty("count", QString::number(columns))
+                                            + valueProperty("mcJc", justification));
+        QString xml = element("mPr", element("mcs", element("mc", columnProps)));
+        for (const QStringList &row : rows) {
+            QString cells;
+            for (int i = 0; i < columns; ++i) {
+                cells += element("e", i < row.size() ? row.at(i) : QString());
+            }
+            xml += element("mr", cells);
+        }
+        return element("m", xml);
+    }
+
+    static QString equationArray(const QList<QStringList> &rows)
+    {
+        QString xml;
+        for (const QStringList &row : rows) {
+            xml += element("e", row.join(QString()));
+        }
+        return element("eqArr", xml);
+    }
+
+    QVector<Token> tokens;
+    int pos;
+    QString error;
+    QString currentStyle;   // 当前字体命令对应的 m:rPr 内容
+};
+
+bool looksLikeLatex(const QString &text)
+{
+    return text.contains('\\') || text.contains('^') || text.contains('_');
+}
+
+} // namespace
+
+QList<LatexToOmml::Segment> LatexToOmml::splitMarkdown(const QString &markdown)
+{
+    QList<Segment> segments;
+    QString text;
+    bool hasMath = false;
+
+    auto flushText = [&]() {
+        if (!text.isEmpty()) {
+            segments.append({Segment::Text, text});
+            text.clear();
+        }
+    };
+
+    const int n = markdown.size();
+    int i = 0;
+    while (i < n) {
+        QString close;
+        Segment::Kind kind = Segment::InlineMath;
+        const QStringRef two = markdown.midRef(i, 2);
+        if (two == QLatin1String("$$")) {
+            close = "$$";
+            kind = Segment::DisplayMath;
+        } else if (two == QLatin1String("\\[")) {
+            close = "\\]";
+            kind = Segment::DisplayMath;
+        } else if (two == QLatin1String("\\(")) {
+            close = "\\)";
+        } else if (two == QLatin1String("\\$")) {
+            // 转义的美元符号不是定界符
+            text += '$';
+            i += 2;
+            continue;
+        } else if (markdown.at(i) == '$') {
+            close = "$";
+        } else {
+            text += markdown.at(i);
+            ++i;
+            continue;
+        }
+
+        const int openLength = close.size();
+        const int end = markdown.indexOf(close, i + openLength);
+        if (end < 0) {
+            // 定界符不成对，剩余部分按普通文本处理
+            text += markdown.mid(i);
+            break;
+        }
+        const QString formula = markdown.mid(i + openLength, end - i - openLength).trimmed();
+        if (!formula.isEmpty()) {
+            flushText();
+            segments.append({kind, formula});
+            hasMath = true;
+        }
+        i = end + close.size();
+    }
+    flushText();
+
+    // 模型有时省略定界符，直接输出裸 LaTeX
+    if (!hasMath && looksLikeLatex(markdown)) {
+        segments.clear();
+        segments.append({Segment::DisplayMath, markdown.trimmed()});
+    }
+    return segments;
+}
+
+QString LatexToOmml::convert(const QString &latex, bool display, QString *errorString)
+{
+    Parser parser(tokenize(latex));
+    const QString body = parser.parseFormula();
+    if (!parser.errorString().isEmpty()) {
+        if (errorString) {
+            *errorString = parser.errorString();
+        }
+        return QString();
+    }
+
+    const QString math = element("oMath", body);
+    return display ? element("oMathPara", math) : math;
+}
+
+QString LatexToOmml::clipboardHtml(const QString &markdown, int *formulaCount)
+{
+    // Word 的 HTML 格式中 m:r 直接包含文本（不使用 m:t），外层用 Cambria Math 字体
+    static const QRegularExpression runPattern(
+            "<m:r>((?:<m:rPr>.*?</m:rPr>)?)<m:t(?: xml:space=\"preserve\")?>(.*?)</m:t></m:r>");
+    static const QString runReplacement = "<span style='font-family:\"Cambria Math\"'><m:r>\\1\\2</m:r></span>";
+
+    int converted = 0;
+    QString body;
+    QString paragraph;
+    auto flushParagraph = [&]() {
+        if (!paragraph.trimmed().isEmpty()) {
+            body += "<p class=MsoNormal>" + paragraph + "</p>\n";
+        }
+        paragraph.clear();
+    };
+
+    for (const Segment &segment : splitMarkdown(markdown)) {
+        if (segment.kind == Segment::Text) {
+            const QStringList lines = segment.content.split('\n');
+            for (int i = 0; i < lines.size(); ++i) {
+                if (i > 0) {
+                    flushParagraph();
+                }
+                paragraph += lines.at(i).toHtmlEscaped();
+            }
+            continue;
+        }
+
+        const bool display = segment.kind == Segment::DisplayMath;
+        const QString source = display ? "$$" + segment.content + "$$" : "$" + segment.content + "$";
+        QString error;
+        QString omml = convert(segment.content, display, &error);
+        if (omml.isEmpty()) {
+            qWarning() << "OMML conversion failed:" << error << "in" << segment.content;
+            paragraph += source.toHtmlEscaped();
+            continue;
+        }
+        ++converted;
+        omml.replace(runPattern, runReplacement);
+
+        // Word 读取条件注释中的 OMML；其他程序忽略注释，显示 LaTeX 源码
+        const QString fragment = "<!--[if gte msEquation 12]>" + omml + "<![endif]-->"
+                + "<![if !msEquation]>" + source.toHtmlEscaped() + "<![endif]>";
+        if (display) {
+            flushParagraph();
+            body += "<p class=MsoNormal align=center>" + fragment + "</p>\n";
+        } else {
+            paragraph += fragment;
+        }
+    }
+    flushParagraph();
+
+    if (formulaCount) {
+        *formulaCount = converted;
+    }
+
+    return QString("<html xmlns:o=\"urn:schemas-microsoft-com:office:office\" "
+                   "xmlns:w=\"urn:schemas-microsoft-com:office:word\" "
+                   "xmlns:m=\"%1\" xmlns=\"http://www.w3.org/TR/REC-html40\">\n"
+                   "<head><meta charset=\"utf-8\"></head>\n<body>\n%2</body>\n</html>\n")
+            .arg(QLatin1String(MathNamespace), body);
+}
@@ -0,0 +1,39 @@
+#ifndef LATEXTOOMML_H
+#define LATEXTOOMML_H
+
+#include <QList>
+#include <QString>
+
+// LaTeX 数学公式 → Office Math Markup (OMML) 的进程内转换器。
+// 覆盖模型常见输出：分式、根式、上下标、求和/积分、\left...\right 定界符、
+// 函数名、重音、字体命令、希腊字母与常用符号、matrix/cases/aligned 环境。
+class LatexToOmml
+{
+public:
+    struct Segment
+    {
+        enum Kind { Text, InlineMath, DisplayMath };
+        Kind kind;
+        QString content;   // 公式不含 $ 等定界符
+    };
+
+    // 输出格式变化时递增，转换结果缓存以此区分新旧条目
+    static const int Version = 1;
+
+    // OMML 命名空间，输出的元素使用 m: 前缀，由外层文档声明
+    static const char *MathNamespace;
+
+    // 按 $...$、$$...$$、\(...\)、\[...\] 将 Markdown 拆分为文本和公式片段。
+    // 没有任何定界符但内容像 LaTeX 时，整段视为一个行间公式。
+    static QList<Segment> splitMarkdown(const QString &markdown);
+
+    // 转换单个公式；display 为 true 时包在 m:oMathPara 中。
+    // 括号或环境不配对时返回空字符串并给出错误信息
+    static QString convert(const QString &latex, bool display, QString *errorString = nullptr);
+
+    // 生成 Word 可直接粘贴的 HTML：公式以 OMML 放在 msEquation 条件注释中，
+    // 其他程序则显示 LaTeX 源码。formulaCount 返回成功转换的公式数
+    static QString clipboardHtml(const QString &markdown, int *formulaCount = nullptr);
+};
+
+#endif // LATEXTOOMML_H
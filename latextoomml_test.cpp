@@ -0,0 +1,259 @@
+#include <QTest>
+#include <QXmlStreamReader>
+#include "latextoomml.h"
+
+class LatexToOmmlTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // 测试各类结构的转换结果
+    void testFraction();
+    void testScripts();
+    void testRadical();
+    void testNaryScope();
+    void testDelimiters();
+    void testFunctions();
+    void testMatrixEnvironments();
+    void testFontsAndText();
+
+    // 测试输出是合法的 XML
+    void testWellFormed_data();
+    void testWellFormed();
+
+    // 测试不配对的输入
+    void testUnbalancedInput_data();
+    void testUnbalancedInput();
+
+    // 测试 Markdown 拆分与剪贴板 HTML
+    void testSplitMarkdown();
+    void testClipboardHtml();
+
+private:
+    static bool isWellFormed(const QString &omml, QString *error);
+};
+
+bool LatexToOmmlTest::isWellFormed(const QString &omml, QString *error)
+{
+    QXmlStreamReader reader(QString("<root xmlns:m=\"%1\">%2</root>")
+                            .arg(QLatin1String(LatexToOmml::MathNamespace), omml));
+    while (!reader.atEnd()) {
+        reader.readNext();
+    }
+    if (reader.hasError()) {
+        *error = reader.errorString();
+        return false;
+    }
+    return true;
+}
+
+void LatexToOmmlTest::testFraction()
+{
+    QString omml = LatexToOmml::convert("\\frac{a+1}{b}", false);
+    QCOMPARE(omml, QString("<m:oMath><m:f><m:num><m:r><m:t>a+1</m:t></m:r></m:num>"
+                           "<m:den><m:r><m:t>b</m:t></m:r></m:den></m:f></m:oMath>"));
+
+    omml = LatexToOmml::convert("\\binom{n}{k}", false);
+    QVERIFY(omml.contains("<m:type m:val=\"noBar\"/>"));
+    QVERIFY(omml.startsWith("<m:oMath><m:d>"));
+
+    // 行间公式包在 oMathPara 中
+    QVERIFY(LatexToOmml::convert("x", true).startsWith("<m:oMathPara><m:oMath>"));
+}
+
+void LatexToOmmlTest::testScripts()
+{
+    QString omml = LatexToOmml::convert("x_i^2", false);
+    QCOMPARE(omml, QString("<m:oMath><m:sSubSup><m:e><m:r><m:t>x</m:t></m:r></m:e>"
+                           "<m:sub><m:r><m:t>i</m:t></m:r></m:sub>"
+                           "<m:sup><m:r><m:t>2</m:t></m:r></m:sup></m:sSubSup></m:oMath>"));
+
+    // 上标只作用于紧邻的字符
+    omml = LatexToOmml::convert("ab^2", false);
+    QVERIFY(omml.startsWith("<m:oMath><m:r><m:t>a</m:t></m:r><m:sSup><m:e><m:r><m:t>b</m:t></m:r></m:e>"));
+
+    // 撇号按上标处理
+    omml = LatexToOmml::convert("f'(x)", false);
+    QVERIFY(omml.contains(QString("<m:sSup><m:e><m:r><m:t>f</m:t></m:r></m:e><m:sup><m:r><m:t>%1</m:t>")
+                          .arg(QChar(0x2032))));
+}
+
+void LatexToOmmlTest::testRadical()
+{
+    QString omml = LatexToOmml::convert("\\sqrt{x}", false);
+    QVERIFY(omml.contains("<m:degHide m:val=\"1\"/>"));
+
+    omml = LatexToOmml::convert("\\sqrt[3]{x}", false);
+    QVERIFY(!omml.contains("degHide"));
+    QVERIFY(omml.contains("<m:deg><m:r><m:t>3</m:t></m:r></m:deg>"));
+}
+
+void LatexToOmmlTest::testNaryScope()
+{
+    // 求和的作用范围到等号为止
+    QString omml = LatexToOmml::convert("\\sum_{i=1}^{n} i = \\frac{n(n+1)}{2}", false);
+    QVERIFY(omml.contains(QString("<m:chr m:val=\"%1\"/>").arg(QChar(0x2211))));
+    QVERIFY(omml.contains("<m:limLoc m:val=\"undOvr\"/>"));
+    QVERIFY(omml.contains("<m:e><m:r><m:t>i</m:t></m:r></m:e></m:nary><m:r><m:t>=</m:t></m:r><m:f>"));
+
+    // 积分的上下限在右侧，没有上下限时隐藏
+    omml = LatexToOmml::convert("\\int f(x) dx", false);
+    QVERIFY(omml.contains("<m:limLoc m:val=\"subSup\"/>"));
+    QVERIFY(omml.contains("<m:subHide m:val=\"1\"/><m:supHide m:val=\"1\"/>"));
+}
+
+void LatexToOmmlTest::testDelimiters()
+{
+    QString omml = LatexToOmml::convert("\\left( x \\middle| y \\right]", false);
+    QVERIFY(omml.contains("<m:begChr m:val=\"(\"/><m:endChr m:val=\"]\"/><m:sepChr m:val=\"|\"/>"));
+    QCOMPARE(omml.count("<m:e>"), 2);
+
+    // \right. 表示省略右侧定界符
+    omml = LatexToOmml::convert("\\left\\{ x \\right.", false);
+    QVERIFY(omml.contains("<m:begChr m:val=\"{\"/><m:endChr m:val=\"\"/>"));
+}
+
+void LatexToOmmlTest::testFunctions()
+{
+    QString omml = LatexToOmml::convert("\\sin x", false);
+    QCOMPARE(omml, QString("<m:oMath><m:func><m:fName><m:r><m:rPr><m:sty m:val=\"p\"/></m:rPr>"
+                           "<m:t>sin</m:t></m:r></m:fName><m:e><m:r><m:t>x</m:t></m:r></m:e></m:func></m:oMath>"));
+
+    // 极限的下标写在函数名下方
+    omml = LatexToOmml::convert("\\lim_{x \\to 0} f(x)", false);
+    QVERIFY(omml.contains("<m:fName><m:limLow>"));
+
+    // 括号内整体作为参数
+    omml = LatexToOmml::convert("\\log(x+1)", false);
+    QVERIFY(omml.contains("<m:e><m:d><m:dPr></m:dPr><m:e><m:r><m:t>x+1</m:t></m:r></m:e></m:d></m:e></m:func>"));
+}
+
+void LatexToOmmlTest::testMatrixEnvironments()
+{
+    QString omml = LatexToOmml::convert("\\begin{pmatrix} a & b \\\\ c & d \\end{pmatrix}", false);
+    QVERIFY(omml.contains("<m:begChr m:val=\"(\"/>"));
+    QVERIFY(omml.contains("<m:count m:val=\"2\"/>"));
+    QCOMPARE(omml.count("<m:mr>"), 2);
+
+    omml = LatexToOmml::convert("f(x) = \\begin{cases} 1 & x > 0 \\\\ 0 & x \\le 0 \\end{cases}", false);
+    QVERIFY(omml.contains("<m:mcJc m:val=\"left\"/>"));
+    QCOMPARE(omml.count("<m:mr>"), 2);
+
+    // 顶层的 \\ 生成方程组
+    omml = LatexToOmml::convert("a &= b \\\\ c &= d \\\\", true);
+    QVERIFY(omml.contains("<m:eqArr>"));
+    QCOMPARE(omml.count("<m:e>"), 2);
+}
+
+void LatexToOmmlTest::testFontsAndText()
+{
+    QString omml = LatexToOmml::convert("\\mathbb{R}", false);
+    QVERIFY(omml.contains("<m:rPr><m:scr m:val=\"double-struck\"/><m:sty m:val=\"p\"/></m:rPr><m:t>R</m:t>"));
+
+    omml = LatexToOmml::convert("x \\text{ if } y", false);
+    QVERIFY(omml.contains("<m:rPr><m:nor/></m:rPr><m:t xml:space=\"preserve\"> if </m:t>"));
+
+    // 特殊字符需要转义
+    omml = LatexToOmml::convert("a < b", false);
+    QVERIFY(omml.contains("<m:t>a&lt;b</m:t>"));
+}
+
+void LatexToOmmlTest::testWellFormed_data()
+{
+    QTest::addColumn<QString>("latex");
+
+    QTest::newRow("quadratic") << "x = \\frac{-b \\pm \\sqrt{b^2 - 4ac}}{2a}";
+    QTest::newRow("euler") << "e^{i\\pi} + 1 = 0";
+    QTest::newRow("gauss") << "\\int_{-\\infty}^{\\infty} e^{-x^2} \\, dx = \\sqrt{\\pi}";
+    QTest::newRow("maxwell") << "\\nabla \\times \\vec{E} = -\\frac{\\partial \\vec{B}}{\\partial t}";
+    QTest::newRow("limit") << "\\lim_{n \\to \\infty} \\left(1 + \\frac{1}{n}\\right)^n = e";
+    QTest::newRow("matrix") << "\\det \\begin{vmatrix} a_{11} & a_{12} \\\\ a_{21} & a_{22} \\end{vmatrix}";
+    QTest::newRow("brace") << "\\underbrace{1 + 2 + \\cdots + n}_{n \\text{ terms}}";
+    QTest::newRow("aligned") << "\\begin{aligned} f(x) &= (x+1)^2 \\\\ &= x^2 + 2x + 1 \\end{aligned}";
+    QTest::newRow("accents") << "\\hat{\\theta}, \\bar{x}, \\overline{AB}, \\dot{q}";
+    QTest::newRow("sets") << "A \\cup B \\subseteq \\mathbb{R}^n, \\; x \\not\\in \\emptyset";
+    QTest::newRow("unknown") << "\\foo{x} + y";
+}
+
+void LatexToOmmlTest::testWellFormed()
+{
+    QFETCH(QString, latex);
+
+    QString error;
+    QString omml = LatexToOmml::convert(latex, true, &error);
+    QVERIFY2(!omml.isEmpty(), qPrintable(error));
+    QVERIFY2(isWellFormed(omml, &error), qPrintable(error + "\n" + omml));
+}
+
+void LatexToOmmlTest::testUnbalancedInput_data()
+{
+    QTest::addColumn<QString>("latex");
+
+    QTest::newRow("open brace") << "\\frac{a}{b";
+    QTest::newRow("close brace") << "a}";
+    QTest::newRow("missing right") << "\\left( x";
+    QTest::newRow("stray right") << "x \\right)";
+    QTest::newRow("missing end") << "\\begin{matrix} a & b";
+    QTest::newRow("mismatched end") << "\\begin{matrix} a \\end{pmatrix}";
+    QTest::newRow("missing argument") << "\\frac{a}";
+}
+
+void LatexToOmmlTest::testUnbalancedInput()
+{
+    QFETCH(QString, latex);
+
+    QString error;
+    QVERIFY(LatexToOmml::convert(latex, false, &error).isEmpty());
+    QVERIFY(!error.isEmpty());
+}
+
+void LatexToOmmlTest::testSplitMarkdown()
+{
+    QList<LatexToOmml::Segment> segments =
+            LatexToOmml::splitMarkdown("Energy $E = mc^2$ and\n$$\\int_0^1 x\\,dx$$ costs \\$5");
+    QCOMPARE(segments.size(), 5);
+    QCOMPARE(segments.at(0).kind, LatexToOmml::Segment::Text);
+    QCOMPARE(segments.at(1).kind, LatexToOmml::Segment::InlineMath);
+    QCOMPARE(segments.at(1).content, QString("E = mc^2"));
+    QCOMPARE(segments.at(3).kind, LatexToOmml::Segment::DisplayMath);
+    QCOMPARE(segments.at(4).content, QString(" costs $5"));
+
+    segments = LatexToOmml::splitMarkdown("\\[ a^2 \\] and \\( b \\)");
+    QCOMPARE(segments.size(), 3);
+    QCOMPARE(segments.at(0).kind, LatexToOmml::Segment::DisplayMath);
+    QCOMPARE(segments.at(2).kind, LatexToOmml::Segment::InlineMath);
+
+    // 没有定界符的裸 LaTeX 视为一个行间公式
+    segments = LatexToOmml::splitMarkdown("  \\alpha + \\beta  ");
+    QCOMPARE(segments.size(), 1);
+    QCOMPARE(segments.at(0).kind, LatexToOmml::Segment::DisplayMath);
+    QCOMPARE(segments.at(0).content, QString("\\alpha + \\beta"));
+
+    // 不成对的 $ 保留为文本
+    segments = LatexToOmml::splitMarkdown("price: 5$");
+    QCOMPARE(segments.size(), 1);
+    QCOMPARE(segments.at(0).kind, LatexToOmml::Segment::Text);
+}
+
+void LatexToOmmlTest::testClipboardHtml()
+{
+    int count = -1;
+    QString html = LatexToOmml::clipboardHtml("where $x<1$:\n$$\\frac{a}{b}$$", &count);
+    QCOMPARE(count, 2);
+    QVERIFY(html.contains(QString("xmlns:m=\"%1\"").arg(QLatin1String(LatexToOmml::MathNamespace))));
+    QCOMPARE(html.count("<!--[if gte msEquation 12]>"), 2);
+    QVERIFY(html.contains("<m:oMathPara>"));
+    // HTML 形式的 OMML：文本直接放在 m:r 中
+    QVERIFY(html.contains("<m:r>x&lt;1</m:r>"));
+    QVERIFY(!html.contains("<m:t>"));
+    // 其他程序看到的回退内容
+    QVERIFY(html.contains("<![if !msEquation]>$x&lt;1$<![endif]>"));
+
+    // 转换失败的公式保留源码，不计数
+    html = LatexToOmml::clipboardHtml("$\\frac{a}{b$", &count);
+    QCOMPARE(count, 0);
+    QVERIFY(html.contains("$\\frac{a}{b$"));
+}
+
+QTEST_MAIN(LatexToOmmlTest)
+#include "latextoomml_test.moc"
@@ -0,0 +1,145 @@
+#include "layoutanalyzer.h"
+#include <algorithm>
+#include <limits>
+
+int LayoutAnalyzer::estimateBackground(const QImage &gray)
+{
+    // 截图中背景占绝大多数像素：取亮度直方图的众数，深色背景同样适用
+    QVector<int> histogram(256, 0);
+    for (int y = 0; y < gray.height(); ++y) {
+        const uchar *line = gray.constScanLine(y);
+        for (int x = 0; x < gray.width(); ++x) {
+            ++histogram[line[x]];
+        }
+    }
+    return int(std::max_element(histogram.constBegin(), histogram.constEnd()) - histogram.constBegin());
+}
+
+QVector<int> LayoutAnalyzer::rowProfile(const QImage &image, int *background)
+{
+    const QImage gray = image.convertToFormat(QImage::Format_Grayscale8);
+    const int bg = estimateBackground(gray);
+    if (background) {
+        *background = bg;
+    }
+
+    QVector<int> profile(gray.height(), 0);
+    for (int y = 0; y < gray.height(); ++y) {
+        const uchar *line = gray.constScanLine(y);
+        int count = 0;
+        for (int x = 0; x < gray.width(); ++x) {
+            if (qAbs(int(line[x]) - bg) > InkThreshold) {
+                ++count;
+            }
+        }
+        profile[y] = count;
+    }
+    return profile;
+}
+
+QList<QRect> LayoutAnalyzer::segment(const QImage &image, const Settings &settings)
+{
+    const QList<QRect> whole = {image.rect()};
+    if (!settings.enabled || image.isNull() || image.height() <= settings.minHeight) {
+        return whole;
+    }
+
+    const QImage gray = image.convertToFormat(QImage::Format_Grayscale8);
+    int background = 0;
+    const QVector<int> profile = rowProfile(gray, &background);
+    auto isInk = [background](uchar value) {
+        return qAbs(int(value) - background) > InkThreshold;
+    };
+
+    // 连续有笔迹的像素行组成一段；间隙小于 minGapPx 的相邻段属于同一行公式
+    struct Run
+    {
+        int top;
+        int bottom;  // 含
+    };
+    QVector<Run> runs;
+    for (int y = 0; y < profile.size(); ++y) {
+        if (profile.at(y) == 0) {
+            continue;
+        }
+        if (!runs.isEmpty() && y - runs.last().bottom - 1 < settings.minGapPx) {
+            runs.last().bottom = y;
+        } else {
+            runs.append({y, y});
+        }
+    }
+
+    // 太矮的段（噪点、分数线、单独一行的上下标）并入间隙较小的一侧
+    const int none = std::numeric_limits<int>::max();
+    int i = 0;
+    while (i < runs.size() && runs.size() > 1) {
+        if (runs.at(i).bottom - runs.at(i).top + 1 >= MinLineHeight) {
+            ++i;
+            continue;
+        }
+        const int gapAbove = i > 0 ? runs.at(i).top - runs.at(i - 1).bottom : none;
+        const int gapBelow = i + 1 < runs.size() ? runs.at(i + 1).top - runs.at(i).bottom : none;
+        if (gapAbove <= gapBelow) {
+            runs[i - 1].bottom = runs.at(i).bottom;
+            runs.remove(i);
+            i = i - 1;
+        } else {
+            runs[i + 1].top = runs.at(i).top;
+            runs.remove(i);
+        }
+    }
+
+    // 行数过多时合并间隙最小的相邻行，限制并发的子请求数；
+    // 间隙相同时合并高度之和较小的一对，各子图大小尽量均匀
+    auto gapAfter = [&runs](int j) {
+        return runs.at(j + 1).top - runs.at(j).bottom;
+    };
+    auto pairHeight = [&runs](int j) {
+        return runs.at(j + 1).bottom - runs.at(j).top;
+    };
+    while (runs.size() > qMax(1, settings.maxSegments)) {
+        int best = 0;
+        for (int j = 1; j + 1 < runs.size(); ++j) {
+            if (gapAfter(j) < gapAfter(best)
+                    || (gapAfter(j) == gapAfter(best) && pairHeight(j) < pairHeight(best))) {
+                best = j;
+            }
+        }
+        runs[best].bottom = runs.at(best + 1).bottom;
+        runs.remove(best + 1);
+    }
+
+    if (runs.size() < 2) {
+        return whole;
+    }
+
+    QList<QRect> rects;
+    for (int j = 0; j < runs.size(); ++j) {
+        const Run &run = runs.at(j);
+        // 左右边界取该行内最靠外的笔迹
+        int left = gray.width();
+        int right = -1;
+        for (int y = run.top; y <= run.bottom; ++y) {
+            const uchar *line = gray.constScanLine(y);
+            for (int x = 0; x < left; ++x) {
+                if (isInk(line[x])) {
+                    left = x;
+                    break;
+                }
+            }
+            for (int x = gray.width() - 1; x > right; --x) {
+                if (isInk(line[x])) {
+                    right = x;
+                    break;
+                }
+            }
+        }
+        // 上下留白不超过到相邻行间隙的一半，子图之间不重叠
+        const int above = j > 0 ? (run.top - runs.at(j - 1).bottom - 1) / 2 : settings.padding;
+        const int below = j + 1 < runs.size() ? (runs.at(j + 1).top - run.bottom - 1) / 2 : settings.padding;
+        const QRect rect(QPoint(left - settings.padding, run.top - qMin(settings.padding, above)),
+                         QPoint(right + settings.padding, run.bottom + qMin(settings.padding, below)));
+        rects << rect.intersected(image.rect());
+    }
+    return rects;
+}
@@ -0,0 +1,38 @@
+#ifndef LAYOUTANALYZER_H
+#define LAYOUTANALYZER_H
+
+#include <QImage>
+#include <QList>
+#include <QRect>
+#include <QVector>
+
+// 版面分析：用水平投影把整页截图切成一行一行的公式，
+// 各行作为独立的子请求并行识别，结果按从上到下的顺序拼接
+class LayoutAnalyzer
+{
+public:
+    struct Settings
+    {
+        bool enabled = true;
+        int minHeight = 240;    // 选区高度不超过该值时不切分（单个公式或一两行）
+        int minGapPx = 10;      // 行间空白至少这么高才切开，分式上下的间隙通常更小
+        int maxSegments = 8;    // 行数更多时合并间隙最小的相邻行
+        int padding = 6;        // 每行四周保留的留白
+    };
+
+    // 与背景亮度相差超过该值的像素视为笔迹
+    static const int InkThreshold = 64;
+    // 比这更矮的行（噪点、单独的分数线或上下标）并入相邻的行
+    static const int MinLineHeight = 8;
+
+    // 返回按阅读顺序排列的各行区域；不需要切分时只返回整张图的区域
+    static QList<QRect> segment(const QImage &image, const Settings &settings);
+
+    // 每一行的笔迹像素数；background 不为空时返回估计的背景亮度
+    static QVector<int> rowProfile(const QImage &image, int *background = nullptr);
+
+private:
+    static int estimateBackground(const QImage &gray);
+};
+
+#endif // LAYOUTANALYZER_H
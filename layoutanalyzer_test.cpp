@@ -0,0 +1,150 @@
+#include <QTest>
+#include <QPainter>
+#include "layoutanalyzer.h"
+#include "benchmarkutils.h"
+
+class LayoutAnalyzerTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // 测试矮选区和关闭时不切分
+    void testSmallCropNotSplit();
+    void testDisabled();
+
+    // 测试按行间空白切分，结果按从上到下排列且互不重叠
+    void testLinesSplit();
+
+    // 测试小于 minGapPx 的间隙（如分式上下）不切开
+    void testSmallGapKept();
+
+    // 测试单独的细线并入相邻的行
+    void testThinLineMerged();
+
+    // 测试行数超过上限时合并
+    void testMaxSegments();
+
+    // 测试深色背景
+    void testDarkBackground();
+
+    // 整页截图的版面分析耗时
+    void benchSegment();
+
+private:
+    // 白底（或指定底色）上画若干条横条，模拟一行一行的公式
+    static QImage page(const QSize &size, const QList<QRect> &lines,
+                       const QColor &background = Qt::white, const QColor &ink = Qt::black);
+};
+
+QImage LayoutAnalyzerTest::page(const QSize &size, const QList<QRect> &lines,
+                                const QColor &background, const QColor &ink)
+{
+    QImage image(size, QImage::Format_RGB32);
+    image.fill(background);
+    QPainter painter(&image);
+    for (const QRect &line : lines) {
+        painter.fillRect(line, ink);
+    }
+    painter.end();
+    return image;
+}
+
+void LayoutAnalyzerTest::testSmallCropNotSplit()
+{
+    const QImage image = page(QSize(600, 200), {QRect(20, 20, 400, 30), QRect(20, 120, 300, 30)});
+    const QList<QRect> segments = LayoutAnalyzer::segment(image, LayoutAnalyzer::Settings());
+    QCOMPARE(segments.size(), 1);
+    QCOMPARE(segments.first(), image.rect());
+}
+
+void LayoutAnalyzerTest::testDisabled()
+{
+    const QImage image = page(QSize(600, 400), {QRect(20, 40, 400, 30), QRect(20, 240, 300, 30)});
+    LayoutAnalyzer::Settings settings;
+    settings.enabled = false;
+    QCOMPARE(LayoutAnalyzer::segment(image, settings).size(), 1);
+}
+
+void LayoutAnalyzerTest::testLinesSplit()
+{
+    const QList<QRect> lines = {QRect(40, 40, 500, 30), QRect(60, 140, 300, 40), QRect(40, 260, 420, 30)};
+    const QImage image = page(QSize(600, 340), lines);
+    const QList<QRect> segments = LayoutAnalyzer::segment(image, LayoutAnalyzer::Settings());
+
+    QCOMPARE(segments.size(), lines.size());
+    for (int i = 0; i < segments.size(); ++i) {
+        QVERIFY(segments.at(i).contains(lines.at(i)));
+        // 左右裁到笔迹附近，留出 padding
+        QCOMPARE(segments.at(i).left(), lines.at(i).left() - LayoutAnalyzer::Settings().padding);
+        if (i > 0) {
+            QVERIFY(segments.at(i).top() > segments.at(i - 1).bottom());
+        }
+    }
+}
+
+void LayoutAnalyzerTest::testSmallGapKept()
+{
+    // 分子、分数线、分母之间只有几像素
+    const QImage image = page(QSize(600, 400), {QRect(40, 40, 200, 30), QRect(40, 74, 200, 10),
+                                                QRect(40, 88, 200, 30), QRect(40, 260, 300, 30)});
+    const QList<QRect> segments = LayoutAnalyzer::segment(image, LayoutAnalyzer::Settings());
+    QCOMPARE(segments.size(), 2);
+    QVERIFY(segments.first().contains(QRect(40, 40, 200, 78)));
+}
+
+void LayoutAnalyzerTest::testThinLineMerged()
+{
+    // 2 像素高的细线与上一行相距 12 像素、与下一行相距 40 像素
+    const QImage image = page(QSize(600, 400), {QRect(40, 40, 300, 30), QRect(40, 82, 300, 2),
+                                                QRect(40, 124, 300, 30), QRect(40, 300, 300, 30)});
+    const QList<QRect> segments = LayoutAnalyzer::segment(image, LayoutAnalyzer::Settings());
+    QCOMPARE(segments.size(), 3);
+    QVERIFY(segments.first().contains(QRect(40, 40, 300, 44)));
+}
+
+void LayoutAnalyzerTest::testMaxSegments()
+{
+    QList<QRect> lines;
+    for (int i = 0; i < 10; ++i) {
+        lines << QRect(40, 20 + i * 60, 400, 30);
+    }
+    const QImage image = page(QSize(600, 640), lines);
+
+    QCOMPARE(LayoutAnalyzer::segment(image, LayoutAnalyzer::Settings()).size(), 8);
+
+    LayoutAnalyzer::Settings settings;
+    settings.maxSegments = 4;
+    const QList<QRect> segments = LayoutAnalyzer::segment(image, settings);
+    QCOMPARE(segments.size(), 4);
+    // 合并后仍覆盖每一行
+    for (const QRect &line : lines) {
+        bool covered = false;
+        for (const QRect &segment : segments) {
+            covered = covered || segment.contains(line);
+        }
+        QVERIFY(covered);
+    }
+}
+
+void LayoutAnalyzerTest::testDarkBackground()
+{
+    const QList<QRect> lines = {QRect(40, 40, 500, 30), QRect(40, 200, 300, 30)};
+    const QImage image = page(QSize(600, 300), lines, QColor(30, 30, 30), QColor(230, 230, 230));
+    int background = 0;
+    LayoutAnalyzer::rowProfile(image, &background);
+    QCOMPARE(background, qGray(QColor(30, 30, 30).rgb()));
+    QCOMPARE(LayoutAnalyzer::segment(image, LayoutAnalyzer::Settings()).size(), 2);
+}
+
+void LayoutAnalyzerTest::benchSegment()
+{
+    const QImage image = BenchmarkUtils::renderFormulaImage(QSize(1920, 1080));
+    QList<QRect> segments;
+    QBENCHMARK {
+        segments = LayoutAnalyzer::segment(image, LayoutAnalyzer::Settings());
+    }
+    QVERIFY(!segments.isEmpty());
+}
+
+QTEST_MAIN(LayoutAnalyzerTest)
+#include "layoutanalyzer_test.moc"
@@ -0,0 +1,356 @@
+#include "llamaengine.h"
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QThread>
+#include <QDebug>
+
+#ifdef HAVE_LLAMA
+#include <llama.h>
+#include <mtmd.h>
+#include <mtmd-helper.h>
+#include <cstring>
+#include <string>
+#include <vector>
+#endif
+
+#ifdef HAVE_LLAMA
+namespace {
+
+void logCallback(ggml_log_level level, const char *text, void *)
+{
+    // llama.cpp 的信息级日志非常多（每层权重一行），只转发警告和错误
+    if (level == GGML_LOG_LEVEL_WARN || level == GGML_LOG_LEVEL_ERROR) {
+        qWarning().noquote() << "llama:" << QString::fromUtf8(text).trimmed();
+    }
+}
+
+void initBackend()
+{
+    static bool initialized = false;
+    if (!initialized) {
+        initialized = true;
+        llama_log_set(logCallback, nullptr);
+        llama_backend_init();
+    }
+}
+
+// 按模型自带的对话模板包装提示词；图像位置用 mtmd 的占位标记表示
+std::string formatPrompt(const llama_model *model, const QString &prompt)
+{
+    const std::string content = std::string(mtmd_default_marker()) + "\n" + prompt.toStdString();
+    const char *tmpl = llama_model_chat_template(model, nullptr);
+    if (!tmpl) {
+        return content;
+    }
+    llama_chat_message message = {"user", content.c_str()};
+    std::vector<char> buffer(content.size() * 2 + 512);
+    int32_t length = llama_chat_apply_template(tmpl, &message, 1, true, buffer.data(), int32_t(buffer.size()));
+    if (length > int32_t(buffer.size())) {
+        buffer.resize(length);
+        length = llama_chat_apply_template(tmpl, &message, 1, true, buffer.data(), int32_t(buffer.size()));
+    }
+    if (length < 0) {
+        return content; // 模板无法识别（非内置的 Jinja 模板）
+    }
+    return std::string(buffer.data(), length);
+}
+
+} // namespace
+#endif
+
+bool LlamaEngine::Settings::operator==(const Settings &other) const
+{
+    return modelPath == other.modelPath && mmprojPath == other.mmprojPath && threads == other.threads
+            && mmap == other.mmap && contextSize == other.contextSize && gpuLayers == other.gpuLayers;
+}
+
+LlamaEngine::LlamaEngine(QObject *parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<InferenceBackend::Usage>("InferenceBackend::Usage");
+    qRegisterMetaType<LlamaEngine::Settings>("LlamaEngine::Settings");
+}
+
+LlamaEngine::~LlamaEngine()
+{
+    unload();
+}
+
+bool LlamaEngine::isAvailable()
+{
+#ifdef HAVE_LLAMA
+    return true;
+#else
+    return false;
+#endif
+}
+
+void LlamaEngine::load(const LlamaEngine::Settings &settings)
+{
+    if (isLoaded && settings == current) {
+        emit loaded(true, QString());
+        return;
+    }
+    unload();
+    current = settings;
+
+#ifdef HAVE_LLAMA
+    initBackend();
+    if (settings.modelPath.isEmpty() || settings.mmprojPath.isEmpty()) {
+        loadError = "llama.modelPath and llama.mmprojPath must both be set.";
+        emit loaded(false, loadError);
+        return;
+    }
+    const int threads = settings.threads > 0 ? settings.threads : QThread::idealThreadCount();
+
+    QElapsedTimer timer;
+    timer.start();
+    llama_model_params modelParams = llama_model_default_params();
+    modelParams.n_gpu_layers = settings.gpuLayers;
+    modelParams.use_mmap = settings.mmap;
+    model = llama_model_load_from_file(settings.modelPath.toLocal8Bit().constData(), modelParams);
+    if (!model) {
+        loadError = "Failed to load model: " + settings.modelPath;
+        emit loaded(false, loadError);
+        return;
+    }
+
+    llama_context_params contextParams = llama_context_default_params();
+    contextParams.n_ctx = uint32_t(settings.contextSize);
+    contextParams.n_batch = uint32_t(qMin(settings.contextSize, 2048));
+    contextParams.n_threads = threads;
+    contextParams.n_threads_batch = threads;
+    // 取消时中止正在进行的预填充，不必等整张图像的 token 算完
+    contextParams.abort_callback = [](void *data) {
+        return static_cast<QAtomicInt *>(data)->loadAcquire() != 0;
+    };
+    contextParams.abort_callback_data = &abortCurrent;
+    context = llama_init_from_model(model, contextParams);
+    if (!context) {
+        unload();
+        loadError = "Failed to create llama context.";
+        emit loaded(false, loadError);
+        return;
+    }
+
+    mtmd_context_params visionParams = mtmd_context_params_default();
+    visionParams.use_gpu = settings.gpuLayers > 0;
+    visionParams.n_threads = threads;
+    visionParams.print_timings = false;
+    vision = mtmd_init_from_file(settings.mmprojPath.toLocal8Bit().constData(), model, visionParams);
+    if (!vision) {
+        unload();
+        loadError = "Failed to load multimodal projector: " + settings.mmprojPath;
+        emit loaded(false, loadError);
+        return;
+    }
+
+    isLoaded = true;
+    loadError.clear();
+    pendingLoadMs = timer.elapsed();
+    qDebug() << "llama model loaded in" << pendingLoadMs << "ms, threads:" << threads
+             << "mmap:" << settings.mmap << "context:" << settings.contextSize;
+    emit loaded(true, QString());
+#else
+    loadError = "Local inference is not available: built without llama.cpp (qmake CONFIG+=llama).";
+    emit loaded(false, loadError);
+#endif
+}
+
+void LlamaEngine::unload()
+{
+#ifdef HAVE_LLAMA
+    if (vision) {
+        mtmd_free(vision);
+    }
+    if (context) {
+        llama_free(context);
+    }
+    if (model) {
+        llama_model_free(model);
+    }
+#endif
+    vision = nullptr;
+    context = nullptr;
+    model = nullptr;
+    isLoaded = false;
+    loadError = "No model loaded.";
+}
+
+void LlamaEngine::cancel(quint64 callId)
+{
+    QMutexLocker locker(&cancelMutex);
+    if (currentCall == callId) {
+        abortCurrent.storeRelease(1);
+    } else {
+        cancelled.insert(callId);
+    }
+}
+
+bool LlamaEngine::beginCall(quint64 callId)
+{
+    QMutexLocker locker(&cancelMutex);
+    if (cancelled.remove(callId)) {
+        return false;
+    }
+    currentCall = callId;
+    abortCurrent.storeRelease(0);
+    return true;
+}
+
+void LlamaEngine::endCall(quint64 callId)
+{
+    QMutexLocker locker(&cancelMutex);
+    if (currentCall == callId) {
+        currentCall = 0;
+    }
+    abortCurrent.storeRelease(0);
+}
+
+void LlamaEngine::run(quint64 callId, const QImage &image, const QString &prompt, const QJsonObject &options)
+{
+    InferenceBackend::Usage usage;
+    if (!beginCall(callId)) {
+        emit finished(callId, QString(), "Local inference cancelled.", usage);
+        return;
+    }
+    // 以下每个返回点都要结束本次调用
+    struct CallGuard
+    {
+        LlamaEngine *engine;
+        quint64 callId;
+        ~CallGuard() { engine->endCall(callId); }
+    } guard{this, callId};
+
+    if (!isLoaded) {
+        emit finished(callId, QString(), "Local inference error: " + loadError, usage);
+        return;
+    }
+
+#ifdef HAVE_LLAMA
+    // 模型加载耗时记到加载后的第一次调用上，与 Ollama 的 load_duration 一致
+    usage.loadMs = pendingLoadMs;
+    pendingLoadMs = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // mtmd 需要紧密排列的 RGB 数据；QImage 的行按 4 字节对齐，逐行拷贝
+    const QImage rgb = image.convertToFormat(QImage::Format_RGB888);
+    const int rowBytes = rgb.width() * 3;
+    std::vector<unsigned char> pixels(size_t(rowBytes) * rgb.height());
+    for (int y = 0; y < rgb.height(); ++y) {
+        memcpy(pixels.data() + size_t(y) * rowBytes, rgb.constScanLine(y), rowBytes);
+    }
+    mtmd_bitmap *bitmap = mtmd_bitmap_init(uint32_t(rgb.width()), uint32_t(rgb.height()), pixels.data());
+
+    const std::string text = formatPrompt(model, prompt);
+    mtmd_input_text input;
+    input.text = text.c_str();
+    input.add_special = true;
+    input.parse_special = true;
+    mtmd_input_chunks *chunks = mtmd_input_chunks_init();
+    const mtmd_bitmap *bitmaps[] = {bitmap};
+    const int32_t tokenized = mtmd_tokenize(vision, chunks, &input, bitmaps, 1);
+    mtmd_bitmap_free(bitmap);
+    if (tokenized != 0) {
+        mtmd_input_chunks_free(chunks);
+        emit finished(callId, QString(), QString("Local inference error: failed to tokenize prompt (%1).").arg(tokenized), usage);
+        return;
+    }
+
+    // 每次调用从空的 KV 缓存开始：图像不同，前缀无法复用
+    llama_memory_clear(llama_get_memory(context), true);
+    const int contextSize = int(llama_n_ctx(context));
+    llama_pos past = 0;
+    const int32_t evaluated = mtmd_helper_eval_chunks(vision, context, chunks, 0, 0,
+                                                      qMin(contextSize, 2048), true, &past);
+    mtmd_input_chunks_free(chunks);
+    if (evaluated != 0 && abortCurrent.loadAcquire()) {
+        emit finished(callId, QString(), "Local inference cancelled.", usage);
+        return;
+    }
+    if (evaluated != 0) {
+        emit finished(callId, QString(), "Local inference error: prompt evaluation failed (image and prompt may exceed llama.contextSize).", usage);
+        return;
+    }
+    usage.promptTokens = int(past);
+    usage.promptMs = timer.elapsed();
+
+    // 与服务端一致：temperature 为 0 时贪心解码
+    const double temperature = options.contains("temperature") ? options["temperature"].toDouble() : 0.0;
+    llama_sampler *sampler = llama_sampler_chain_init(llama_sampler_chain_default_params());
+    if (temperature <= 0) {
+        llama_sampler_chain_add(sampler, llama_sampler_init_greedy());
+    } else {
+        llama_sampler_chain_add(sampler, llama_sampler_init_temp(float(temperature)));
+        llama_sampler_chain_add(sampler, llama_sampler_init_dist(LLAMA_DEFAULT_SEED));
+    }
+
+    std::vector<std::string> stops;
+    for (const QJsonValue &stop : options["stop"].toArray()) {
+        if (!stop.toString().isEmpty()) {
+            stops.push_back(stop.toString().toStdString());
+        }
+    }
+    const int numPredict = options["num_predict"].toInt();
+    const llama_vocab *vocab = llama_model_get_vocab(model);
+
+    timer.restart();
+    std::string output;
+    QString error;
+    usage.doneReason = "stop";
+    while (true) {
+        if (abortCurrent.loadAcquire()) {
+            error = "Local inference cancelled.";
+            break;
+        }
+        if (numPredict > 0 && usage.completionTokens >= numPredict) {
+            usage.doneReason = "length";
+            break;
+        }
+        if (past >= contextSize) {
+            usage.doneReason = "length";
+            break;
+        }
+        llama_token token = llama_sampler_sample(sampler, context, -1);
+        if (llama_vocab_is_eog(vocab, token)) {
+            break;
+        }
+        char piece[256];
+        const int32_t length = llama_token_to_piece(vocab, token, piece, sizeof(piece), 0, false);
+        if (length > 0) {
+            output.append(piece, size_t(length));
+        }
+        usage.completionTokens++;
+
+        bool stopped = false;
+        for (const std::string &stop : stops) {
+            const size_t at = output.find(stop);
+            if (at != std::string::npos) {
+                output.resize(at);
+                stopped = true;
+                break;
+            }
+        }
+        if (stopped) {
+            break;
+        }
+
+        llama_batch batch = llama_batch_get_one(&token, 1);
+        if (llama_decode(context, batch) != 0) {
+            error = abortCurrent.loadAcquire() ? "Local inference cancelled." : "Local inference error: decode failed.";
+            break;
+        }
+        ++past;
+    }
+    llama_sampler_free(sampler);
+    usage.completionMs = timer.elapsed();
+
+    emit finished(callId, QString::fromUtf8(output.data(), int(output.size())), error, usage);
+#else
+    Q_UNUSED(image);
+    Q_UNUSED(prompt);
+    Q_UNUSED(options);
+#endif
+}
@@ -0,0 +1,79 @@
+#ifndef LLAMAENGINE_H
+#define LLAMAENGINE_H
+
+#include <QObject>
+#include <QImage>
+#include <QJsonObject>
+#include <QMutex>
+#include <QSet>
+#include <QAtomicInt>
+#include "inferencebackend.h"
+
+struct llama_model;
+struct llama_context;
+struct mtmd_context;
+
+// 进程内的 llama.cpp 推理：GGUF 视觉语言模型和多模态投影（mmproj）只加载一次，
+// 直接接受 QImage，省去 HTTP、JSON 以及 PNG 编码和 base64。
+// 对象移到工作线程上运行，run 按到达顺序依次执行（同一时刻只有一个上下文在推理）。
+// 需要 qmake CONFIG+=llama；未编译时 isAvailable() 为 false，run 直接报错
+class LlamaEngine : public QObject
+{
+    Q_OBJECT
+public:
+    struct Settings
+    {
+        QString modelPath;       // 语言模型 GGUF
+        QString mmprojPath;      // 多模态投影 GGUF
+        int threads = 0;         // CPU 线程数，0 表示 QThread::idealThreadCount()
+        bool mmap = true;        // 以 mmap 加载权重：启动快，与其他进程共享页缓存
+        int contextSize = 4096;  // 上下文长度（图像 token + 提示词 + 输出），加载时确定
+        int gpuLayers = 0;       // 放到 GPU 上的层数，0 为纯 CPU
+
+        bool operator==(const Settings &other) const;
+        bool operator!=(const Settings &other) const { return !(*this == other); }
+    };
+
+    explicit LlamaEngine(QObject *parent = nullptr);
+    ~LlamaEngine() override;
+
+    static bool isAvailable();
+
+    // 可在任意线程调用：排队中的调用不再执行，正在执行的调用在下一个 token（预填充中为下一个计算节点）处停止，
+    // 随后以 "Local inference cancelled." 结束
+    void cancel(quint64 callId);
+
+public slots:
+    // 与已加载的模型设置相同时不重新加载；失败的原因在之后每次 run 时报告
+    void load(const LlamaEngine::Settings &settings);
+    void unload();
+    // options 为 GenerationOptions::build 的结果：num_predict、temperature、stop（num_ctx 不适用）
+    void run(quint64 callId, const QImage &image, const QString &prompt, const QJsonObject &options);
+
+signals:
+    void loaded(bool ok, const QString &errorString);
+    void finished(quint64 callId, const QString &text, const QString &errorString,
+                  const InferenceBackend::Usage &usage);
+
+private:
+    Settings current;
+    bool isLoaded = false;
+    QString loadError;
+    qint64 pendingLoadMs = 0;   // 尚未报告的模型加载耗时
+    llama_model *model = nullptr;
+    llama_context *context = nullptr;
+    mtmd_context *vision = nullptr;
+
+    // 取消：cancelled 与 currentCall 由 cancelMutex 保护，abortCurrent 供解码循环和 llama.cpp 的中止回调读取
+    QMutex cancelMutex;
+    QSet<quint64> cancelled;
+    quint64 currentCall = 0;
+    QAtomicInt abortCurrent;
+    bool beginCall(quint64 callId);
+    void endCall(quint64 callId);
+};
+
+Q_DECLARE_METATYPE(InferenceBackend::Usage)
+Q_DECLARE_METATYPE(LlamaEngine::Settings)
+
+#endif // LLAMAENGINE_H
@@ -1,10 +1,128 @@
 #include "mainwindow.h"
+#include "configmanager.h"
+#include "tuningcalibrator.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QDir>
+#include <QTextStream>
+
+namespace {
+
+void print(const QString &line)
+{
+    // 校准要跑很久，逐行刷新以便看到进度
+    static QTextStream out(stdout);
+    out << line << '\n';
+    out.flush();
+}
+
+// --calibrate：对配置中的端点扫描运行参数，把最快的一组保存到 tuning.endpoints 下
+int runCalibration(QApplication &app, const QString &imageDir, int repetitions, const QString &threadList)
+{
+    ConfigManager &config = ConfigManager::instance();
+    if (config.getOllamaApi() != "ollama") {
+        // llama-server 的线程数在启动参数中指定，进程内推理使用 llama.threads
+        print("Calibration only applies to ollama.api = \"ollama\".");
+        return 1;
+    }
+
+    QList<QImage> images;
+    if (!imageDir.isEmpty()) {
+        const QDir dir(imageDir);
+        for (const QString &name : dir.entryList({"*.png", "*.jpg", "*.jpeg"}, QDir::Files, QDir::Name)) {
+            const QImage image(dir.filePath(name));
+            if (!image.isNull()) {
+                images << image;
+            }
+        }
+        if (images.isEmpty()) {
+            print("No images found in " + imageDir);
+            return 1;
+        }
+    }
+
+    QList<int> threads;
+    for (const QString &item : threadList.split(',', Qt::SkipEmptyParts)) {
+        bool ok = false;
+        const int count = item.trimmed().toInt(&ok);
+        if (!ok || count <= 0) {
+            print("Invalid --calibrate-threads value: " + item);
+            return 1;
+        }
+        threads << count;
+    }
+
+    // 本机的拓扑只对本机端点有意义：远程端点不按它扫描线程数，也不记录到校准结果中
+    const bool local = RuntimeOptions::isLocalEndpoint(config.getOllamaUrl());
+    const HardwareInfo::Info hardware = HardwareInfo::detect();
+    if (local) {
+        print("Hardware: " + hardware.summary());
+    } else if (threads.isEmpty()) {
+        print("Remote endpoint: skipping the num_thread sweep (pass --calibrate-threads to include it)");
+    }
+
+    TuningCalibrator calibrator;
+    calibrator.setEndpoint(config.getOllamaUrl(), config.getOllamaModel());
+    calibrator.setImages(images);
+    calibrator.setRepetitions(repetitions);
+    calibrator.setThreadCandidates(threads);
+    QObject::connect(&calibrator, &TuningCalibrator::progress, &print);
+    QObject::connect(&calibrator, &TuningCalibrator::finished,
+                     [&](const TuningCalibrator::Result &result) {
+        print("\n" + TuningCalibrator::report(result));
+        if (!result.ok) {
+            app.exit(1);
+            return;
+        }
+        const QString endpoint = RuntimeOptions::endpointKey(config.getOllamaUrl());
+        QJsonObject values = RuntimeOptions::toJson(result.best);
+        values["calibratedMs"] = result.bestMs;
+        values["baselineMs"] = result.baselineMs;
+        values["calibratedAt"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+        if (local) {
+            values["hardware"] = hardware.summary();
+        }
+        config.setTuningEndpoint(endpoint, values);
+        if (!config.save()) {
+            print("Failed to save config: " + config.getLastError());
+            app.exit(1);
+            return;
+        }
+        print("Saved to tuning.endpoints[\"" + endpoint + "\"]");
+        app.exit(0);
+    });
+    calibrator.start();
+    return app.exec();
+}
+
+} // namespace
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption calibrateOption("calibrate",
+        "Sweep num_thread, num_batch and mmap/mlock against the configured Ollama endpoint "
+        "and store the fastest settings.");
+    QCommandLineOption imagesOption("calibrate-images",
+        "Directory of PNG/JPEG images to calibrate with instead of the built-in set.", "dir");
+    QCommandLineOption repetitionsOption("calibrate-repetitions",
+        "Recognitions per image for each setting (default 2).", "n", "2");
+    QCommandLineOption threadsOption("calibrate-threads",
+        "Comma-separated num_thread values to try (default: derived from this machine for a local endpoint, "
+        "skipped for a remote one).", "list");
+    parser.addOptions({calibrateOption, imagesOption, repetitionsOption, threadsOption});
+    parser.process(a);
+
+    if (parser.isSet(calibrateOption)) {
+        return runCalibration(a, parser.value(imagesOption), parser.value(repetitionsOption).toInt(),
+                              parser.value(threadsOption));
+    }
+
     MainWindow w;
     w.show();
     return a.exec();
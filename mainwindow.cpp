@@ -1,6 +1,11 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "settingsdialog.h"
+#include "historypanel.h"
+#include "pandocprobe.h"
+#include "docxwriter.h"
+#include "conversioncache.h"
+#include "conversionpipeline.h"
 #include <QMessageBox>
 #include <QFileDialog> // For saving image if needed
 #include <QTimer>
@@ -9,6 +14,9 @@
 #include <QMimeData>
 #include <QDir>        // 用于处理路径和临时文件
 #include <QTemporaryFile> // 用于创建临时文件 (更安全)
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QStandardPaths>
 #include <QDesktopServices> // 用于打开文件
 #include <QMenuBar>
 #include <QMenu>
@@ -74,6 +82,44 @@ MainWindow::MainWindow(QWidget *parent)
     ollamaClient = new OllamaClient(this);
     connect(ollamaClient, &OllamaClient::recognitionSuccess, this, &MainWindow::handleRecognitionSuccess);
     connect(ollamaClient, &OllamaClient::recognitionError, this, &MainWindow::handleRecognitionError);
+    connect(ollamaClient, &OllamaClient::requestMetrics, this, &MainWindow::handleRequestMetrics);
+    // 所有识别经由调度发出：框选截图优先于监视区域和批量任务
+    scheduler = new RecognitionScheduler(ollamaClient, this);
+    connect(scheduler, &RecognitionScheduler::jobCancelled, this, [this](quint64 jobId) {
+        // 被新截图取代的旧任务不影响界面
+        if (jobId != currentJobId) {
+            return;
+        }
+        currentJobId = 0;
+        setRecognitionPending(false);
+        ui->resultTextEdit->setMarkdown("*已取消*");
+        statusBar()->showMessage("已取消识别", 3000);
+    });
+    // 服务端不可用：截图留在持久队列中，恢复后自动识别并写入历史
+    jobJournal = new JobJournal(this);
+    connect(scheduler, &RecognitionScheduler::jobDeferred, this, [this](quint64 jobId, const QString &errorString) {
+        qWarning() << "Job" << jobId << "deferred:" << errorString;
+        if (jobId == currentJobId) {
+            currentJobDeferred = true;
+            ui->resultTextEdit->setMarkdown("*服务端暂时不可用，截图已保存，恢复后自动识别*");
+        }
+        statusBar()->showMessage(QString("服务端不可用，%1 个识别等待恢复").arg(scheduler->deferredCount()));
+    });
+    connect(scheduler, &RecognitionScheduler::jobRecovered, this,
+            [this](quint64, const QString &markdownFormula, const QImage &image, const QString &model) {
+        if (historyStore->isOpen()) {
+            HistoryEntry entry;
+            entry.model = model;
+            entry.result = markdownFormula;
+            historyStore->addEntry(entry, image);
+        }
+        statusBar()->showMessage("已完成一个之前保存的识别，结果已写入历史", 5000);
+    });
+
+    // --- 监视区域 ---
+    // 截图后端在开始监视时才设置：后端随 capture.backend 配置重建
+    regionWatcher = new RegionWatcher(nullptr, this);
+    connect(regionWatcher, &RegionWatcher::regionChanged, this, &MainWindow::onWatchedRegionChanged);
 
     // --- 连接 Ollama 配置变更信号 ---
     connect(ui->ollamaUrlLineEdit, &QLineEdit::textChanged,
@@ -96,10 +142,54 @@ MainWindow::MainWindow(QWidget *parent)
 
     // 初始化 Ollama 客户端设置
     ollamaClient->updateSettings(config.getOllamaUrl(), config.getOllamaModel());
+    applyLlamaSettings();
+    ollamaClient->setApi(config.getOllamaApi());
+    applyUploadSettings();
+    ollamaClient->setReaskOnInvalid(config.isReaskOnInvalidEnabled());
+    ollamaClient->setOutputMode(config.getOllamaOutputMode());
+    applyGenerationSettings();
+    qDebug() << "Hardware:" << HardwareInfo::detect().summary();
+    applyRuntimeOptions();
+    applyLayoutSettings();
+    applyTransportSettings();
+    applyCaptureSettings();
+    applyWatchSettings();
+    applyCascadeSettings();
+    applySchedulerSettings();
+    // 启动时即建立到 Ollama 的连接，第一次识别不必等待
+    ollamaClient->warmUp();
+
+    // --- 转换结果缓存 ---
+    conversionCache = new ConversionCache(this);
+    conversionPipeline = new ConversionPipeline(conversionCache, this);
+    applyCacheSettings();
+
+    // 后台预先探测 pandoc，复制/导出时直接使用缓存结果
+    if (config.isPandocEnabled()) {
+        PandocProbe::instance().probe(config.getPandocPath());
+    }
 
     // --- Initial state for result text edit (supports some Markdown) ---
     ui->resultTextEdit->setMarkdown(""); // Clear initially
 //    ui->resultTextEdit->setReadOnly(true);
+    // 用户编辑结果后，停顿片刻再在后台重新转换；程序设置内容时 isModified() 为 false
+    connect(ui->resultTextEdit, &QTextEdit::textChanged, this, [this]() {
+        if (ui->resultTextEdit->document()->isModified()) {
+            conversionPipeline->sourceEdited(ui->resultTextEdit->toPlainText());
+        }
+    });
+
+    // --- 识别历史 ---
+    historyStore = new HistoryStore(this);
+    if (!historyStore->open(QDir(config.getConfigDir()).filePath("history.sqlite"))) {
+        qWarning() << "History disabled:" << historyStore->getLastError();
+    }
+    // 持久任务队列在历史之后打开：重放的任务识别完成后写入历史
+    applyQueueSettings();
+    historyPanel = new HistoryPanel(historyStore, this);
+    addDockWidget(Qt::RightDockWidgetArea, historyPanel);
+    historyPanel->hide();
+    connect(historyPanel, &HistoryPanel::entryActivated, this, &MainWindow::onHistoryEntryActivated);
 
     // --- 创建菜单栏 ---
     createMenuBar();
@@ -130,6 +220,9 @@ MainWindow::~MainWindow()
 
 void MainWindow::on_captureButton_clicked()
 {
+    // 用户框选期间建立连接（空闲连接可能已被服务端或代理关闭）
+    ollamaClient->warmUp();
+
     // Hide main window temporarily to not include it in screenshot
     this->hide();
      QTimer::singleShot(300, this, [this]() { // Small delay to ensure window is hidden
@@ -137,15 +230,7 @@ void MainWindow::on_captureButton_clicked()
         this->show(); // Show main window again
 
         if (!capturedPixmap.isNull()) {
-            ui->screenshotLabel->setPixmap(capturedPixmap.scaled(ui->screenshotLabel->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
-            ui->resultTextEdit->setMarkdown("*Processing...*");
-            statusBar()->showMessage("Sending image to Ollama...");
-
-            // Update Ollama client settings if you have LineEdits for them
-            // ollamaClient->setOllamaUrl(ui->ollamaUrlLineEdit->text());
-            // ollamaClient->setModelName(ui->modelNameLineEdit->text());
-
-            ollamaClient->recognizeFormula(capturedPixmap);
+            showCapture(capturedPixmap, RecognitionScheduler::Interactive);
         } else {
             statusBar()->showMessage("Screenshot cancelled or failed.");
             ui->screenshotLabel->setText("Screenshot cancelled or invalid.");
@@ -153,71 +238,340 @@ void MainWindow::on_captureButton_clicked()
      });
 }
 
+void MainWindow::showCapture(const QPixmap &pixmap, RecognitionScheduler::Priority priority)
+{
+    lastCapturedPixmap = pixmap;
+    ui->screenshotLabel->setPixmap(pixmap.scaled(ui->screenshotLabel->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
+    ui->resultTextEdit->setMarkdown("*Processing...*");
+    statusBar()->showMessage("Sending image to Ollama...");
+
+    // Update Ollama client settings if you have LineEdits for them
+    // ollamaClient->setOllamaUrl(ui->ollamaUrlLineEdit->text());
+    // ollamaClient->setModelName(ui->modelNameLineEdit->text());
+
+    currentJobDeferred = false;
+    // 新任务取代旧任务时旧任务的 jobCancelled 在 submit 返回之前发出，不应显示为用户取消
+    currentJobId = 0;
+    currentJobId = scheduler->submit(pixmap, priority);
+    setRecognitionPending(true);
+    if (scheduler->queuedCount(priority) > 0) {
+        statusBar()->showMessage("等待进行中的识别完成...");
+    }
+}
+
+void MainWindow::on_cancelButton_clicked()
+{
+    // 进行中的请求被中止，服务端随即停止生成；结果经由 jobCancelled 更新界面
+    if (currentJobId == 0 || !scheduler->cancel(currentJobId)) {
+        setRecognitionPending(false);
+    }
+}
+
+void MainWindow::setRecognitionPending(bool pending)
+{
+    ui->cancelButton->setEnabled(pending);
+    cancelAction->setEnabled(pending);
+}
+
+void MainWindow::onWatchToggled(bool enabled)
+{
+    if (!enabled) {
+        regionWatcher->stop();
+        statusBar()->showMessage("已停止监视区域", 3000);
+        return;
+    }
+
+    ollamaClient->warmUp();
+    this->hide();
+    QTimer::singleShot(300, this, [this]() {
+        QRect region;
+        QPixmap capturedPixmap = ScreenshotOverlay::takeScreenshot(&region);
+        this->show();
+
+        if (capturedPixmap.isNull() || region.isNull()) {
+            // 取消框选时恢复菜单项状态，不触发停止的提示
+            QSignalBlocker blocker(watchAction);
+            watchAction->setChecked(false);
+            statusBar()->showMessage("Screenshot cancelled or failed.");
+            return;
+        }
+        regionWatcher->setBackend(ScreenshotOverlay::captureBackend());
+        // 开始时立即抓取第一帧并识别，之后只在内容变化时识别
+        regionWatcher->start(region);
+        statusBar()->showMessage(QString("正在监视区域 %1×%2，内容变化时自动识别")
+                                 .arg(region.width()).arg(region.height()));
+    });
+}
+
+void MainWindow::onWatchedRegionChanged(const QImage &frame)
+{
+    QPixmap pixmap = QPixmap::fromImage(frame);
+    pixmap.setDevicePixelRatio(1.0); // 与框选截图一致，按设备像素上传
+    showCapture(pixmap, RecognitionScheduler::Background);
+}
+
 void MainWindow::handleRecognitionSuccess(const QString &markdownFormula)
 {
+    currentJobId = 0;
+    setRecognitionPending(false);
 //    ui->resultTextEdit->setMarkdown(markdownFormula);
     ui->resultTextEdit->setPlainText(markdownFormula);
-    statusBar()->showMessage("Recognition successful!", 5000);
+    if (lastMetrics.validationError.isEmpty()) {
+        statusBar()->showMessage("Recognition successful!", 5000);
+    } else {
+        statusBar()->showMessage("识别完成，但公式可能不完整：" + lastMetrics.validationError, 8000);
+    }
+    // 复制和导出读取的是 resultTextEdit 的纯文本，缓存键必须与之一致
+    conversionPipeline->submit(ui->resultTextEdit->toPlainText());
+
+    if (historyStore->isOpen()) {
+        HistoryEntry entry;
+        // 分级识别时结果可能来自小模型
+        entry.model = lastMetrics.tier == "fast" ? ConfigManager::instance().getCascadeFastModel()
+                                                 : ui->modelNameLineEdit->text();
+        entry.result = markdownFormula;
+        entry.codec = lastMetrics.codec;
+        entry.encodeUs = lastMetrics.encodeUs;
+        entry.networkMs = lastMetrics.networkMs;
+        entry.imageBytes = lastMetrics.imageBytes;
+        historyStore->addEntry(entry, lastCapturedPixmap.toImage());
+    }
 }
 
-void MainWindow::handleRecognitionError(const QString &errorString)
+void MainWindow::onHistoryEntryActivated(qint64 id)
 {
-    ui->resultTextEdit->setMarkdown("**Error:**\n" + errorString);
-    QMessageBox::critical(this, "Recognition Error", errorString);
-    statusBar()->showMessage("Recognition failed.", 5000);
+    HistoryEntry entry = historyStore->entry(id);
+    if (entry.id == 0) {
+        return;
+    }
+    ui->resultTextEdit->setPlainText(entry.result);
+    conversionPipeline->submit(ui->resultTextEdit->toPlainText());
+    QImage thumbnail = historyStore->thumbnail(id);
+    if (!thumbnail.isNull()) {
+        ui->screenshotLabel->setPixmap(QPixmap::fromImage(thumbnail));
+    }
+    statusBar()->showMessage(QString("已恢复 %1 的识别结果 (%2)")
+                             .arg(entry.createdAt.toString("yyyy-MM-dd hh:mm:ss"), entry.model), 5000);
 }
 
-QString MainWindow::convertMarkdownToMathML_Pandoc(const QString &markdownText)
+void MainWindow::handleRequestMetrics(const RecognitionMetrics &metrics)
 {
-    if (markdownText.trimmed().isEmpty()) {
-        return QString();
+    lastMetrics = metrics;
+    qDebug() << "Request metrics: codec" << metrics.codec
+             << "encode" << metrics.encodeUs << "us"
+             << "image" << metrics.imageBytes << "bytes"
+             << "payload" << metrics.payloadBytes << "bytes"
+             << "network" << metrics.networkMs << "ms"
+             << "first byte sent" << metrics.firstByteMs << "ms (incl. queueing)" << (metrics.http2 ? "h2" : "http/1.1")
+             << "prompt" << metrics.promptEvalCount << "tokens /" << metrics.promptEvalMs << "ms"
+             << "eval" << metrics.evalCount << "tokens /" << metrics.evalMs << "ms"
+             << "num_predict" << metrics.numPredict << "num_ctx" << metrics.numCtx
+             << "done" << metrics.doneReason
+             << "segments" << metrics.segments << "layout" << metrics.layoutUs << "us";
+    if (!metrics.tier.isEmpty()) {
+        // 分级识别：本次由哪一级给出结果，以及累计的命中率和节省的时间
+        qDebug() << "Cascade tier" << metrics.tier << metrics.escalationReason
+                 << "|" << ollamaClient->cascadeStats().summary();
     }
+    qDebug() << "Queue wait:" << scheduler->statsSummary();
+}
 
-    QProcess pandoc;
+void MainWindow::applyUploadSettings()
+{
+    ConfigManager &config = ConfigManager::instance();
+    ImageEncoder::Settings settings;
+    settings.codec = config.getUploadCodec();
+    settings.pngCompression = config.getUploadPngCompression();
+    settings.jpegQuality = config.getUploadJpegQuality();
+    settings.webpQuality = config.getUploadWebpQuality();
+    settings.maxUploadKB = config.getUploadMaxKB();
+    settings.autoAllowWebp = config.isUploadAutoWebpAllowed();
+    ollamaClient->setEncoderSettings(settings);
+}
 
-    QStringList arguments;
-    // -f markdown: 输入格式为 markdown
-    // -t mathml: 输出格式为 mathml
-    // --mathjax:  一个可选的尝试，有时能改善数学的解析，但对纯 mathml 输出可能不是必须
-    //             也可以尝试不加，或者用 --webtex (如果需要 URL 编码的数学)
-//    arguments << "-f" << "markdown" << "-t" << "mathml";
+void MainWindow::applyGenerationSettings()
+{
+    ConfigManager &config = ConfigManager::instance();
+    GenerationOptions::Settings settings;
+    settings.mode = config.getGenerationMode();
+    settings.numPredict = config.getGenerationNumPredict();
+    settings.numCtx = config.getGenerationNumCtx();
+    settings.temperature = config.getGenerationTemperature();
+    settings.stop = config.getGenerationStop();
+    ollamaClient->setGenerationSettings(settings);
+}
 
-//    arguments << "-f" << "markdown" << "-t" << "html5" << "--mathml" << "--wrap=none";
+void MainWindow::applyLayoutSettings()
+{
+    ConfigManager &config = ConfigManager::instance();
+    LayoutAnalyzer::Settings settings;
+    settings.enabled = config.isLayoutSegmentationEnabled();
+    settings.minHeight = config.getLayoutMinHeight();
+    settings.minGapPx = config.getLayoutMinGapPx();
+    settings.maxSegments = config.getLayoutMaxSegments();
+    ollamaClient->setLayoutSettings(settings);
+}
 
-    arguments << "--from=markdown" // 输入格式为 Markdown
-                  << "--to=latex"    // 输出格式为 latex
-                  << "-s";            // 独立文档模式（可选，视需求）
+void MainWindow::applyTransportSettings()
+{
+    ConfigManager &config = ConfigManager::instance();
+    OllamaTransport::Settings settings;
+    settings.keepAlive = config.isTransportKeepAliveEnabled();
+    settings.http2 = config.isTransportHttp2Enabled();
+    settings.tlsSessionReuse = config.isTlsSessionReuseEnabled();
+    settings.preconnect = config.isPreconnectEnabled();
+    ollamaClient->setTransportSettings(settings);
+}
 
-    // 查找 pandoc 执行文件 (更健壮的做法是允许用户配置路径或从系统 PATH 查找)
-    QString pandocExecutable = "pandoc"; // 假设 pandoc 在系统 PATH 中
+void MainWindow::applyCaptureSettings()
+{
+    ConfigManager &config = ConfigManager::instance();
+    ScreenshotOverlay::setCaptureBackend(config.getCaptureBackend());
+    ScreenshotOverlay::setSnapEnabled(config.isCaptureSnapEnabled());
+    // 后端可能已重建，监视中的区域改用新的后端
+    if (regionWatcher->isActive()) {
+        regionWatcher->setBackend(ScreenshotOverlay::captureBackend());
+    }
+}
 
-    pandoc.start(pandocExecutable, arguments);
+void MainWindow::applyRuntimeOptions()
+{
+    ConfigManager &config = ConfigManager::instance();
+    RuntimeOptions::Settings settings;
+    settings.enabled = config.isTuningEnabled();
+    settings.numThread = config.getTuningNumThread();
+    settings.numBatch = config.getTuningNumBatch();
+    settings.useMmap = config.isTuningMmapEnabled();
+    settings.useMlock = config.isTuningMlockEnabled();
+    // 当前端点有单独的设置（如校准结果）时覆盖默认值
+    const QString endpoint = RuntimeOptions::endpointKey(config.getOllamaUrl());
+    ollamaClient->setRuntimeOptions(RuntimeOptions::merge(settings, config.getTuningEndpoint(endpoint)));
+}
 
-    if (!pandoc.waitForStarted(3000)) { // 等待 Pandoc 启动，超时3秒
-        qWarning() << "Pandoc failed to start! Command:" << pandocExecutable << arguments.join(" ");
-        qWarning() << "Pandoc error:" << pandoc.errorString();
-        return QString();
+void MainWindow::applyLlamaSettings()
+{
+    ConfigManager &config = ConfigManager::instance();
+    LlamaEngine::Settings settings;
+    settings.modelPath = config.getLlamaModelPath();
+    settings.mmprojPath = config.getLlamaMmprojPath();
+    settings.threads = config.getLlamaThreads();
+    settings.mmap = config.isLlamaMmapEnabled();
+    settings.contextSize = config.getLlamaContextSize();
+    settings.gpuLayers = config.getLlamaGpuLayers();
+    ollamaClient->setLlamaSettings(settings);
+}
+
+void MainWindow::applyCascadeSettings()
+{
+    ConfigManager &config = ConfigManager::instance();
+    CascadePolicy::Settings settings;
+    settings.enabled = config.isCascadeEnabled();
+    settings.fastModel = config.getCascadeFastModel();
+    settings.minConfidence = config.getCascadeMinConfidence();
+    settings.maxCharsPerKPixel = config.getCascadeMaxCharsPerKPixel();
+    settings.minCharsPerKPixel = config.getCascadeMinCharsPerKPixel();
+    ollamaClient->setCascadeSettings(settings);
+}
+
+void MainWindow::applySchedulerSettings()
+{
+    ConfigManager &config = ConfigManager::instance();
+    RecognitionScheduler::Settings settings;
+    settings.interactiveLimit = config.getSchedulerInteractiveLimit();
+    settings.backgroundLimit = config.getSchedulerBackgroundLimit();
+    settings.bulkLimit = config.getSchedulerBulkLimit();
+    settings.deferBulk = config.isSchedulerDeferBulkEnabled();
+    settings.preemptBulk = config.isSchedulerPreemptBulkEnabled();
+    settings.cancelSuperseded = config.isSchedulerCancelSupersededEnabled();
+    settings.durable = config.isQueueEnabled();
+    settings.healthIntervalMs = config.getQueueHealthIntervalMs();
+    settings.maxRetries = config.getQueueMaxRetries();
+    scheduler->setSettings(settings);
+}
+
+void MainWindow::applyQueueSettings()
+{
+    ConfigManager &config = ConfigManager::instance();
+    JobJournal::Settings settings;
+    settings.syncIntervalMs = config.getQueueSyncIntervalMs();
+    settings.syncBatch = config.getQueueSyncBatch();
+    jobJournal->setSettings(settings);
+    applySchedulerSettings();
+
+    // 关闭后日志保持打开：已在日志中的任务照常完成，只是新任务不再写入
+    if (!config.isQueueEnabled() || jobJournal->isOpen()) {
+        return;
+    }
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    if (!jobJournal->open(QDir(dir).filePath("jobs.journal"))) {
+        qWarning() << "Durable job queue disabled:" << jobJournal->getLastError();
+        return;
+    }
+    scheduler->setJournal(jobJournal);
+    const int replayed = scheduler->replay();
+    if (replayed > 0) {
+        statusBar()->showMessage(QString("正在识别上次未完成的 %1 张截图").arg(replayed), 5000);
     }
+}
 
-    pandoc.write(markdownText.toUtf8());
-    pandoc.closeWriteChannel(); // 关闭写入，表示输入结束
+void MainWindow::applyWatchSettings()
+{
+    ConfigManager &config = ConfigManager::instance();
+    RegionWatcher::Settings settings;
+    settings.intervalMs = config.getWatchIntervalMs();
+    settings.maxIntervalMs = config.getWatchMaxIntervalMs();
+    settings.hashThreshold = config.getWatchHashThreshold();
+    settings.changeFraction = config.getWatchChangeFraction();
+    regionWatcher->setSettings(settings);
+}
 
-    if (!pandoc.waitForFinished(5000)) { // 等待 Pandoc 完成，超时5秒
-        qWarning() << "Pandoc timed out or failed to finish processing.";
-        pandoc.kill(); // 强制结束
-        return QString();
+void MainWindow::applyCacheSettings()
+{
+    ConfigManager &config = ConfigManager::instance();
+    conversionCache->setMemoryLimitKB(config.getConversionCacheMemoryKB());
+    if (config.isConversionDiskCacheEnabled()) {
+        QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+        conversionCache->setDiskCacheDir(QDir(cacheDir).filePath("conversions"));
+    } else {
+        conversionCache->setDiskCacheDir(QString());
     }
+    conversionPipeline->setFormats(config.getPrecomputeFormats());
+    conversionPipeline->setDebounceMs(config.getPrecomputeDebounceMs());
+}
 
-    if (pandoc.exitStatus() == QProcess::CrashExit || pandoc.exitCode() != 0) {
-        qWarning() << "Pandoc execution failed. Exit code:" << pandoc.exitCode();
-        qWarning() << "Pandoc stdout:" << QString::fromUtf8(pandoc.readAllStandardOutput());
-        qWarning() << "Pandoc stderr:" << QString::fromUtf8(pandoc.readAllStandardError());
+void MainWindow::handleRecognitionError(const QString &errorString)
+{
+    currentJobId = 0;
+    setRecognitionPending(false);
+    if (currentJobDeferred) {
+        // 截图已保存，jobDeferred 已经更新了界面
+        currentJobDeferred = false;
+        return;
+    }
+    ui->resultTextEdit->setMarkdown("**Error:**\n" + errorString);
+    QMessageBox::critical(this, "Recognition Error", errorString);
+    statusBar()->showMessage("Recognition failed.", 5000);
+}
+
+QString MainWindow::pandocExecutableFor(const QString &outputFormat) const
+{
+    ConfigManager &config = ConfigManager::instance();
+    if (!config.isPandocEnabled()) {
         return QString();
     }
 
-    QString mathMLOutput = QString::fromUtf8(pandoc.readAllStandardOutput());
-    qDebug() << "Pandoc MathML Output:\n" << mathMLOutput;
-    return mathMLOutput;
+    // 只读缓存：探测尚未完成时本次不使用 pandoc，而不是阻塞界面等待
+    PandocCapabilities capabilities = PandocProbe::instance().capabilities(config.getPandocPath());
+    if (!capabilities.probed || !capabilities.available) {
+        qDebug() << "Pandoc not usable:" << (capabilities.probed ? capabilities.error : QString("probe pending"));
+        return QString();
+    }
+    // 很旧的版本没有 --list-output-formats，格式列表为空时不做限制
+    if (!capabilities.outputFormats.isEmpty() && !capabilities.supportsOutput(outputFormat)) {
+        qDebug() << "Pandoc" << capabilities.version.toString() << "does not support output format" << outputFormat;
+        return QString();
+    }
+    return capabilities.executable;
 }
 
 bool MainWindow::convertMdFileToDocx_Pandoc(const QString &mdFilePath, const QString &docxFilePath)
@@ -227,6 +581,12 @@ bool MainWindow::convertMdFileToDocx_Pandoc(const QString &mdFilePath, const QSt
         return false;
     }
 
+    QString pandocExecutable = pandocExecutableFor("docx");
+    if (pandocExecutable.isEmpty()) {
+        qWarning() << "Pandoc 不可用或不支持 docx 输出。";
+        return false;
+    }
+
     QProcess pandoc;
     QStringList arguments;
     // -f markdown: 输入格式
@@ -235,7 +595,6 @@ bool MainWindow::convertMdFileToDocx_Pandoc(const QString &mdFilePath, const QSt
     // --standalone (-s): 确保生成一个完整的、可独立打开的 docx 文件
     arguments << "-f" << "markdown" << "-s" << "-t" << "docx" << "-o" << docxFilePath << mdFilePath;
 
-    QString pandocExecutable = "pandoc"; // 或 Pandoc 的完整路径
     qInfo() << "Pandoc command:" << pandocExecutable << arguments.join(" ");
 
     pandoc.start(pandocExecutable, arguments);
@@ -246,7 +605,7 @@ bool MainWindow::convertMdFileToDocx_Pandoc(const QString &mdFilePath, const QSt
         return false;
     }
 
-    if (!pandoc.waitForFinished(10000)) { // 转换可能需要更长时间，增加超时
+    if (!pandoc.waitForFinished(ConfigManager::instance().getPandocTimeout() * 1000)) {
         qWarning() << "Pandoc (MD->DOCX) timed out or failed to finish processing.";
         pandoc.kill();
         return false;
@@ -290,30 +649,24 @@ void MainWindow::on_copyButton_clicked()
     mimeData->setText(markdownSourceText);
     qDebug() << "复制到剪贴板 (text/plain):" << markdownSourceText;
 
-    // 2. 尝试使用 Pandoc 将 Markdown 转换为 MathML
-    //    Pandoc 可以处理 Markdown 中的 LaTeX 数学块 ($...$, $$...$$)
-    QString mathMLContent = convertMarkdownToMathML_Pandoc(markdownSourceText);
-
-    if (!mathMLContent.isEmpty()) {
-        // Word 期望的 MathML MIME 类型是 "application/mathml+xml"
-        // 或者 "application/mathml-presentation+xml"
-        mimeData->setData("application/mathml+xml", mathMLContent.toUtf8());
-        qDebug() << "复制到剪贴板 (application/mathml+xml):\n" << mathMLContent;
+    // 2. 在进程内将公式转换为 OMML，放入 HTML 中
+    //    Word 粘贴时直接读取 OMML，得到可编辑的原生公式，无需再次转换
+    //    识别完成时已在后台转换，这里通常直接命中缓存
+    QByteArray html = conversionCache->get(markdownSourceText, ConversionCache::ClipboardHtmlFormat);
+    int formulaCount = html.count("<!--[if gte msEquation 12]>");
+    if (formulaCount > 0) {
+        mimeData->setHtml(QString::fromUtf8(html));
+        qDebug() << "复制到剪贴板 (text/html, OMML):" << formulaCount << "个公式";
     } else {
-        qDebug() << "Pandoc 转换 MathML 失败或返回空结果。";
+        qDebug() << "未找到可转换为 OMML 的公式。";
     }
 
-    // (可选) 尝试生成 OMML
-    // 如前所述，直接从 Markdown/LaTeX 生成纯 OMML 片段比较困难。
-    // 如果你确实需要，可能要通过 Pandoc 生成 .docx 然后解析，或者找到专门的库。
-    // 对于大多数情况，高质量的 MathML 和原始 LaTeX 已经足够好。
-
     clipboard->setMimeData(mimeData); // mimeData 的所有权转移给剪贴板
 
-    if (!mathMLContent.isEmpty()) {
-        statusBar()->showMessage("公式已复制 (含MathML和纯文本)", 4000);
+    if (formulaCount > 0) {
+        statusBar()->showMessage(QString("公式已复制 (含 %1 个 Word 公式和纯文本)").arg(formulaCount), 4000);
     } else {
-        statusBar()->showMessage("公式已复制 (纯文本，MathML转换失败)", 4000);
+        statusBar()->showMessage("公式已复制 (纯文本，未找到可转换的公式)", 4000);
     }
 }
 
@@ -325,73 +678,61 @@ void MainWindow::on_exportButton_clicked()
         return;
     }
 
-    // 1. 创建一个临时的 .md 文件来保存 Markdown 内容
-    // 使用 QTemporaryFile 来确保文件名唯一且在作用域结束时可以自动删除（如果需要）
-    // 或者，我们可以指定一个固定的临时文件名，并在之后手动删除。
-    // 为了简单起见，我们先用一个固定目录下的临时文件名。
-
-    QString tempDir = QDir::currentPath(); // 获取系统临时目录
-    QString tempMdFileName = "formula_temp.md";
-    QString tempMdFilePath = tempDir + QDir::separator() + tempMdFileName;
-
-    QFile tempMdFile(tempMdFilePath);
-    if (!tempMdFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        qWarning() << "无法创建临时 Markdown 文件:" << tempMdFilePath << tempMdFile.errorString();
-        statusBar()->showMessage("错误：无法创建临时文件。", 5000);
-        return;
-    }
-    QTextStream outMd(&tempMdFile);
-    outMd.setCodec("UTF-8"); // 确保使用 UTF-8 编码
-    outMd << markdownSourceText;
-    tempMdFile.close();
-    qInfo() << "Markdown内容已保存到临时文件:" << tempMdFilePath;
-
-    // 2. 定义输出的 .docx 文件名
-    QString tempDocxFileName = "formula_output.docx";
-    QString tempDocxFilePath = tempDir + QDir::separator() + tempDocxFileName;
-
-    // 删除可能已存在的旧的 docx 文件，以避免 Pandoc 写入权限问题或追加内容
-    if (QFile::exists(tempDocxFilePath)) {
-        if (!QFile::remove(tempDocxFilePath)) {
-            qWarning() << "无法删除已存在的旧 DOCX 文件:" << tempDocxFilePath;
-            // 可以选择继续尝试，Pandoc 可能会覆盖它
+    // 输出到系统临时目录，而不是当前工作目录
+    QString docxFilePath = QDir(QDir::tempPath()).filePath("formula_output.docx");
+
+    // 1. 含有标题、列表等 Markdown 排版且 pandoc 可用时，交给 pandoc 转换
+    bool exported = false;
+    if (DocxWriter::hasRichMarkdown(markdownSourceText) && !pandocExecutableFor("docx").isEmpty()) {
+        QTemporaryDir tempDir;
+        QString tempMdFilePath = tempDir.filePath("formula_temp.md");
+        QFile tempMdFile(tempMdFilePath);
+        if (tempDir.isValid() && tempMdFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            QTextStream outMd(&tempMdFile);
+            outMd.setCodec("UTF-8"); // 确保使用 UTF-8 编码
+            outMd << markdownSourceText;
+            tempMdFile.close();
+
+            statusBar()->showMessage("正在使用 Pandoc 转换到 Word 文档...", 0);
+            qApp->processEvents(); // 处理事件，确保状态栏消息显示
+            exported = convertMdFileToDocx_Pandoc(tempMdFilePath, docxFilePath);
+        } else {
+            qWarning() << "无法创建临时 Markdown 文件:" << tempMdFilePath << tempMdFile.errorString();
+        }
+        if (!exported) {
+            qWarning() << "Pandoc 转换失败，改用内置 DOCX 生成。";
         }
     }
 
-    // 3. 调用 Pandoc 将 .md 文件转换为 .docx 文件
-    statusBar()->showMessage("正在转换到 Word 文档...", 0); // 0 表示一直显示直到被覆盖
-    qApp->processEvents(); // 处理事件，确保状态栏消息显示
-
-    if (convertMdFileToDocx_Pandoc(tempMdFilePath, tempDocxFilePath)) {
-        statusBar()->showMessage("转换成功！正在打开 Word 文档...", 3000);
-        qInfo() << "DOCX 文件已生成:" << tempDocxFilePath;
-
-        // 4. 使用默认程序打开生成的 .docx 文件
-        bool opened = QDesktopServices::openUrl(QUrl::fromLocalFile(tempDocxFilePath));
-        if (!opened) {
-            qWarning() << "无法使用默认程序打开 DOCX 文件:" << tempDocxFilePath;
-            QMessageBox::warning(this, "打开文件失败",
-                                 QString("无法自动打开 Word 文档：\n%1\n\n请尝试手动打开。")
-                                 .arg(QDir::toNativeSeparators(tempDocxFilePath)));
-            statusBar()->showMessage("无法自动打开 Word 文档，请手动打开。", 5000);
-        } else {
-            statusBar()->showMessage("Word 文档已打开。", 5000);
+    // 2. 其余情况使用内置生成的 DOCX（通常已在后台生成并缓存），公式以 OMML 写入
+    if (!exported) {
+        QElapsedTimer timer;
+        timer.start();
+        QString errorString;
+        QByteArray docx = conversionCache->get(markdownSourceText, ConversionCache::DocxFormat);
+        exported = DocxWriter::save(docx, docxFilePath, &errorString);
+        qInfo() << "DocxWriter:" << docxFilePath << "written in" << timer.nsecsElapsed() / 1000 << "us";
+        if (!exported) {
+            qWarning() << "写入 DOCX 失败:" << errorString;
+            QMessageBox::critical(this, "导出失败",
+                                  QString("无法写入 Word 文档：\n%1\n\n%2")
+                                  .arg(QDir::toNativeSeparators(docxFilePath), errorString));
+            statusBar()->showMessage("导出 Word 文档失败。", 5000);
+            return;
         }
-    } else {
-        qWarning() << "Pandoc 转换 MD 到 DOCX 失败。";
-        QMessageBox::critical(this, "转换失败",
-                              "使用 Pandoc 将 Markdown 转换为 Word 文档失败。\n请检查 Pandoc 是否已正确安装并配置在系统 PATH 中，以及是否有写入临时目录的权限。");
-        statusBar()->showMessage("转换为 Word 文档失败。", 5000);
     }
 
-    // 5. (可选) 清理临时的 .md 文件
-    // 如果希望保留 .md 文件用于调试，可以注释掉下面这行
-    if (QFile::exists(tempMdFilePath)) {
-        if (!tempMdFile.remove()) { // tempMdFile 对象在这里仍然有效
-             qWarning() << "无法删除临时 Markdown 文件:" << tempMdFilePath << tempMdFile.errorString();
-        } else {
-            qInfo() << "临时 Markdown 文件已删除:" << tempMdFilePath;
-        }
+    // 3. 使用默认程序打开生成的 .docx 文件
+    qInfo() << "DOCX 文件已生成:" << docxFilePath;
+    bool opened = QDesktopServices::openUrl(QUrl::fromLocalFile(docxFilePath));
+    if (!opened) {
+        qWarning() << "无法使用默认程序打开 DOCX 文件:" << docxFilePath;
+        QMessageBox::warning(this, "打开文件失败",
+                             QString("无法自动打开 Word 文档：\n%1\n\n请尝试手动打开。")
+                             .arg(QDir::toNativeSeparators(docxFilePath)));
+        statusBar()->showMessage("无法自动打开 Word 文档，请手动打开。", 5000);
+    } else {
+        statusBar()->showMessage("Word 文档已打开。", 5000);
     }
 }
 
@@ -410,10 +751,71 @@ void MainWindow::onConfigChanged(const QString &key)
             config.getOllamaUrl(),
             config.getOllamaModel()
         );
+        ollamaClient->setApi(config.getOllamaApi());
+        ollamaClient->setOutputMode(config.getOllamaOutputMode());
+        // 运行参数按端点保存，URL 变化后重新选取
+        applyRuntimeOptions();
         // 同时更新主窗口的显示
         ui->ollamaUrlLineEdit->setText(config.getOllamaUrl());
         ui->modelNameLineEdit->setText(config.getOllamaModel());
         qDebug() << "Ollama 配置已更新:" << key;
+    } else if (key.startsWith("pandoc.")) {
+        // 路径可能已变更，提前探测新的可执行文件
+        if (config.isPandocEnabled()) {
+            PandocProbe::instance().probe(config.getPandocPath());
+        }
+    } else if (key.startsWith("generation.")) {
+        applyGenerationSettings();
+        qDebug() << "生成参数已更新:" << key;
+    } else if (key.startsWith("layout.")) {
+        applyLayoutSettings();
+        qDebug() << "版面分析配置已更新:" << key;
+    } else if (key.startsWith("transport.")) {
+        applyTransportSettings();
+        qDebug() << "传输层配置已更新:" << key;
+    } else if (key.startsWith("capture.")) {
+        applyCaptureSettings();
+    } else if (key.startsWith("watch.")) {
+        applyWatchSettings();
+    } else if (key.startsWith("cascade.")) {
+        applyCascadeSettings();
+        qDebug() << "分级识别配置已更新:" << key;
+    } else if (key.startsWith("tuning.")) {
+        applyRuntimeOptions();
+        qDebug() << "运行参数已更新:" << key;
+    } else if (key.startsWith("scheduler.")) {
+        applySchedulerSettings();
+        qDebug() << "识别调度配置已更新:" << key;
+    } else if (key.startsWith("queue.")) {
+        applyQueueSettings();
+        qDebug() << "持久任务队列配置已更新:" << key;
+    } else if (key.startsWith("llama.")) {
+        applyLlamaSettings();
+        qDebug() << "本地推理配置已更新:" << key;
+    } else if (key.startsWith("advanced.")) {
+        ollamaClient->setReaskOnInvalid(config.isReaskOnInvalidEnabled());
+    } else if (key.startsWith("cache.")) {
+        applyCacheSettings();
+        qDebug() << "转换缓存配置已更新:" << key;
+    } else if (key.startsWith("upload.") || key == "*") {
+        applyUploadSettings();
+        if (key == "*") {
+            applyCacheSettings();
+            ollamaClient->setReaskOnInvalid(config.isReaskOnInvalidEnabled());
+            applyLlamaSettings();
+            ollamaClient->setApi(config.getOllamaApi());
+            ollamaClient->setOutputMode(config.getOllamaOutputMode());
+            applyGenerationSettings();
+            applyRuntimeOptions();
+            applyLayoutSettings();
+            applyTransportSettings();
+            applyCaptureSettings();
+            applyWatchSettings();
+            applyCascadeSettings();
+            applySchedulerSettings();
+            applyQueueSettings();
+        }
+        qDebug() << "上传编码配置已更新:" << key;
     } else if (key.startsWith("ui.theme")) {
         // 主题变更
         QString theme = config.getTheme();
@@ -439,6 +841,20 @@ void MainWindow::createMenuBar()
     settingsAction->setShortcut(QKeySequence("Ctrl+,"));
     connect(settingsAction, &QAction::triggered, this, &MainWindow::onSettingsTriggered);
     fileMenu->addAction(settingsAction);
+
+    // 监视区域：框选一次，之后内容变化（如幻灯片翻页）时自动识别
+    watchAction = new QAction("监视区域(&W)", this);
+    watchAction->setCheckable(true);
+    watchAction->setShortcut(QKeySequence("Ctrl+Shift+W"));
+    connect(watchAction, &QAction::toggled, this, &MainWindow::onWatchToggled);
+    fileMenu->addAction(watchAction);
+
+    // 取消识别：中止正在进行的请求，服务端不再为它生成
+    cancelAction = new QAction("取消识别(&C)", this);
+    cancelAction->setShortcut(QKeySequence(Qt::Key_Escape));
+    cancelAction->setEnabled(false);
+    connect(cancelAction, &QAction::triggered, this, &MainWindow::on_cancelButton_clicked);
+    fileMenu->addAction(cancelAction);
     
     fileMenu->addSeparator();
     
@@ -448,6 +864,13 @@ void MainWindow::createMenuBar()
     connect(exitAction, &QAction::triggered, this, &MainWindow::close);
     fileMenu->addAction(exitAction);
     
+    // 创建"视图"菜单
+    QMenu *viewMenu = menuBar->addMenu("视图(&V)");
+    QAction *historyAction = historyPanel->toggleViewAction();
+    historyAction->setText("识别历史(&H)");
+    historyAction->setShortcut(QKeySequence("Ctrl+H"));
+    viewMenu->addAction(historyAction);
+
     // 创建"帮助"菜单
     QMenu *helpMenu = menuBar->addMenu("帮助(&H)");
     
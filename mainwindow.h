@@ -5,12 +5,20 @@
 #include "ollamaclient.h" // Include ollamaclient
 #include "screenshotoverlay.h" // Include screenshotoverlay
 #include "configmanager.h" // Include configmanager
+#include "historystore.h"
+#include "regionwatcher.h"
+#include "recognitionscheduler.h"
+#include "jobjournal.h"
 #include <QProcess>
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
 QT_END_NAMESPACE
 
+class HistoryPanel;
+class ConversionCache;
+class ConversionPipeline;
+
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
@@ -21,8 +29,10 @@ public:
 
 private slots:
     void on_captureButton_clicked();
+    void on_cancelButton_clicked(); // 取消当前的识别（Esc）
     void handleRecognitionSuccess(const QString &markdownFormula);
     void handleRecognitionError(const QString &errorString);
+    void handleRequestMetrics(const RecognitionMetrics &metrics);
     void on_copyButton_clicked(); // 复制
     void on_exportButton_clicked(); // 导出
     // void handleScreenshotTaken(const QPixmap &pixmap); // If ScreenshotOverlay emits signal
@@ -30,14 +40,47 @@ private slots:
     void on_editable_checkBox_clicked();
     void onConfigChanged(const QString &key); // 配置变更处理
     void onSettingsTriggered(); // 打开设置对话框
+    void onHistoryEntryActivated(qint64 id); // 从历史记录恢复结果
+    void onWatchToggled(bool enabled); // 开始（框选区域）或停止监视区域
+    void onWatchedRegionChanged(const QImage &frame); // 监视区域内容变化后识别
 
 private:
     Ui::MainWindow *ui;
     OllamaClient *ollamaClient;
+    RecognitionScheduler *scheduler;
+    JobJournal *jobJournal;
+    HistoryStore *historyStore;
+    HistoryPanel *historyPanel;
+    ConversionCache *conversionCache;
+    ConversionPipeline *conversionPipeline;
+    RegionWatcher *regionWatcher;
+    QAction *watchAction;
+    QAction *cancelAction;
     // ScreenshotOverlay *overlay; // If using instance member
 
-    QString convertMarkdownToMathML_Pandoc(const QString& markdownText);
     bool convertMdFileToDocx_Pandoc(const QString& mdFilePath, const QString& docxFilePath);
+    QString pandocExecutableFor(const QString& outputFormat) const; // 可用于该输出格式的 pandoc，不可用时为空
     void createMenuBar(); // 创建菜单栏
+    void applyUploadSettings(); // 将上传编码配置应用到 OllamaClient
+    void applyGenerationSettings(); // 将生成参数配置应用到 OllamaClient
+    void applyLayoutSettings(); // 将版面分析配置应用到 OllamaClient
+    void applyTransportSettings(); // 将传输层配置应用到 OllamaClient
+    void applyCaptureSettings(); // 将截图后端与选区吸附配置应用到 ScreenshotOverlay
+    void applyCacheSettings(); // 将转换缓存配置应用到 ConversionCache
+    void applyWatchSettings(); // 将监视区域配置应用到 RegionWatcher
+    void applyCascadeSettings(); // 将分级识别配置应用到 OllamaClient
+    void applyLlamaSettings(); // 将进程内推理配置应用到 OllamaClient
+    void applyRuntimeOptions(); // 将当前端点的运行参数应用到 OllamaClient
+    void applySchedulerSettings(); // 将各优先级的并发上限应用到 RecognitionScheduler
+    void applyQueueSettings(); // 打开持久任务队列并重放上次未完成的任务
+    // 显示截图并按优先级提交识别：框选截图为 Interactive，监视区域为 Background
+    void showCapture(const QPixmap &pixmap, RecognitionScheduler::Priority priority);
+
+    void setRecognitionPending(bool pending); // 识别进行中时可以取消
+
+    RecognitionMetrics lastMetrics; // 最近一次请求的耗时统计
+    quint64 currentJobId = 0;       // 界面上正在等待结果的识别任务
+    bool currentJobDeferred = false; // 当前任务因服务端不可用已保存，不弹出错误对话框
+    QPixmap lastCapturedPixmap;     // 最近一次截图，识别成功后写入历史
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,550 @@
+#include "mockollamaserver.h"
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QDateTime>
+#include <QPointer>
+#include <QTimer>
+#include <QDebug>
+
+MockOllamaServer::MockOllamaServer(QObject *parent)
+    : QObject(parent), random(20240601), requests(0), errors(0), connections(0), abandoned(0)
+{
+    connect(&server, &QTcpServer::newConnection, this, &MockOllamaServer::onNewConnection);
+}
+
+bool MockOllamaServer::start(quint16 port)
+{
+    if (!server.listen(QHostAddress::LocalHost, port)) {
+        qWarning() << "MockOllamaServer: listen failed:" << server.errorString();
+        return false;
+    }
+    return true;
+}
+
+void MockOllamaServer::stop()
+{
+    server.close();
+    const QList<QTcpSocket *> sockets = buffers.keys();
+    for (QTcpSocket *socket : sockets) {
+        socket->disconnectFromHost();
+    }
+}
+
+quint16 MockOllamaServer::port() const
+{
+    return server.serverPort();
+}
+
+QString MockOllamaServer::baseUrl() const
+{
+    return QString("http://127.0.0.1:%1").arg(port());
+}
+
+QString MockOllamaServer::generateUrl() const
+{
+    return baseUrl() + "/api/generate";
+}
+
+QString MockOllamaServer::chatUrl() const
+{
+    return baseUrl() + "/api/chat";
+}
+
+QString MockOllamaServer::openAiUrl() const
+{
+    return baseUrl() + "/v1/chat/completions";
+}
+
+MockOllamaServer::Options MockOllamaServer::options() const
+{
+    return opts;
+}
+
+void MockOllamaServer::setOptions(const Options &options)
+{
+    opts = options;
+}
+
+int MockOllamaServer::requestCount() const
+{
+    return requests;
+}
+
+int MockOllamaServer::errorCount() const
+{
+    return errors;
+}
+
+int MockOllamaServer::connectionCount() const
+{
+    return connections;
+}
+
+int MockOllamaServer::abandonedCount() const
+{
+    return abandoned;
+}
+
+QByteArray MockOllamaServer::lastRequestBody() const
+{
+    return lastBody;
+}
+
+void MockOllamaServer::resetStats()
+{
+    requests = 0;
+    errors = 0;
+    connections = 0;
+    abandoned = 0;
+    lastBody.clear();
+}
+
+void MockOllamaServer::onNewConnection()
+{
+    while (QTcpSocket *socket = server.nextPendingConnection()) {
+        ++connections;
+        buffers.insert(socket, QByteArray());
+        connect(socket, &QTcpSocket::readyRead, this, &MockOllamaServer::onReadyRead);
+        connect(socket, &QTcpSocket::disconnected, this, &MockOllamaServer::onDisconnected);
+    }
+}
+
+void MockOllamaServer::onDisconnected()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    if (!socket) {
+        return;
+    }
+    buffers.remove(socket);
+    abandoned += generating.take(socket);
+    socket->deleteLater();
+}
+
+void MockOllamaServer::onReadyRead()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    if (!socket || !buffers.contains(socket)) {
+        return;
+    }
+
+    QByteArray &buffer = buffers[socket];
+    buffer += socket->readAll();
+
+    // 一个连接上可能有多个 keep-alive 请求，逐个解析
+    for (;;) {
+        int headerEnd = buffer.indexOf("\r\n\r\n");
+        if (headerEnd < 0) {
+            return;
+        }
+
+        QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+        QList<QByteArray> requestLine = lines.value(0).trimmed().split(' ');
+        if (requestLine.size() < 2) {
+            socket->disconnectFromHost();
+            return;
+        }
+
+        int contentLength = 0;
+        bool closeAfter = !opts.keepAlive;
+        for (int i = 1; i < lines.size(); ++i) {
+            QByteArray line = lines[i].trimmed();
+            int colon = line.indexOf(':');
+            if (colon <= 0) {
+                continue;
+            }
+            const QByteArray name = line.left(colon).trimmed().toLower();
+            if (name == "content-length") {
+                contentLength = line.mid(colon + 1).trimmed().toInt();
+            } else if (name == "connection" && line.mid(colon + 1).trimmed().toLower() == "close") {
+                closeAfter = true;
+            }
+        }
+
+        int requestSize = headerEnd + 4 + contentLength;
+        if (buffer.size() < requestSize) {
+            return; // 请求体尚未收全
+        }
+
+        QByteArray body = buffer.mid(headerEnd + 4, contentLength);
+        buffer.remove(0, requestSize);
+        handleRequest(socket, requestLine[0], requestLine[1], body, closeAfter);
+        if (closeAfter) {
+            // 之后的数据不再处理，响应发出后关闭连接
+            buffer.clear();
+            return;
+        }
+    }
+}
+
+void MockOllamaServer::handleRequest(QTcpSocket *socket, const QByteArray &method,
+                                     const QByteArray &path, const QByteArray &body, bool closeAfter)
+{
+    ++requests;
+    lastBody = body;
+    emit requestReceived(QString::fromLatin1(path), body.size());
+
+    QPointer<QTcpSocket> guard(socket);
+    const QString pathString = QString::fromLatin1(path);
+
+    if (method == "GET" && path == "/api/tags") {
+        QJsonObject model;
+        model["name"] = "mock-vl:latest";
+        QJsonObject tags;
+        tags["models"] = QJsonArray{model};
+        sendJson(socket, 200, tags, closeAfter);
+        return;
+    }
+    // 健康检查
+    if (method == "GET" && path == "/api/version") {
+        QJsonObject version;
+        version["version"] = "0.0.0-mock";
+        sendJson(socket, 200, version, closeAfter);
+        return;
+    }
+    if (method == "GET" && path == "/v1/models") {
+        QJsonObject model;
+        model["id"] = "mock-vl";
+        model["object"] = "model";
+        QJsonObject models;
+        models["object"] = "list";
+        models["data"] = QJsonArray{model};
+        sendJson(socket, 200, models, closeAfter);
+        return;
+    }
+
+    const bool openAi = path == "/v1/chat/completions";
+    if (method != "POST" || (path != "/api/generate" && path != "/api/chat" && !openAi)) {
+        QJsonObject error;
+        error["error"] = QString("unknown endpoint %1 %2").arg(QString::fromLatin1(method), pathString);
+        sendJson(socket, 404, error, closeAfter);
+        return;
+    }
+
+    QJsonObject request = QJsonDocument::fromJson(body).object();
+    const QString model = request["model"].toString();
+    // Ollama 默认流式，OpenAI 兼容接口默认一次返回
+    const bool stream = request["stream"].toBool(!openAi);
+    const bool injectError = opts.errorRate > 0.0 && random.generateDouble() < opts.errorRate;
+    const auto profile = opts.models.constFind(model);
+    const bool profiled = profile != opts.models.constEnd();
+    const QString text = opts.echoPayload ? echoText(request, body.size())
+                                          : (profiled ? profile->responseText : opts.responseText);
+    QJsonObject options = request["options"].toObject();
+    if (openAi) {
+        // 生成参数在请求体顶层：max_tokens 对应 num_predict
+        if (request.contains("max_tokens")) {
+            options["num_predict"] = request["max_tokens"];
+        }
+        options["stop"] = request["stop"];
+    }
+    const Generation generation = generate(text, options);
+    const int latencyMs = profiled ? profile->latencyMs : opts.latencyMs;
+    const bool includeUsage = request["stream_options"].toObject()["include_usage"].toBool();
+    int delayMs = latencyMs + int(generation.evalCount * opts.evalMsPerToken);
+    if (opts.optimalThreads > 0) {
+        const int threads = options["num_thread"].toInt(opts.defaultThreads);
+        delayMs += qAbs(threads - opts.optimalThreads) * opts.threadPenaltyMs;
+    }
+    if (!opts.models.isEmpty() && !profiled) {
+        // 与 Ollama 相同：请求未下载的模型返回 404
+        const QString message = QString("model \"%1\" not found, try pulling it first").arg(model);
+        sendJson(socket, 404, errorBody(openAi, message), closeAfter);
+        return;
+    }
+
+    ++generating[socket];
+    QTimer::singleShot(delayMs, this, [this, guard, injectError, stream, openAi, pathString, model, generation,
+                                       latencyMs, includeUsage, closeAfter]() {
+        if (!guard) {
+            return;
+        }
+        auto pending = generating.find(guard);
+        if (pending == generating.end()) {
+            return; // 客户端已断开，已计入 abandoned
+        }
+        if (--pending.value() == 0) {
+            generating.erase(pending);
+        }
+        if (injectError) {
+            ++errors;
+            sendJson(guard, opts.errorStatus, errorBody(openAi, "injected error"), closeAfter);
+        } else if (openAi && stream) {
+            sendEvents(guard, model, generation, latencyMs, includeUsage, closeAfter);
+        } else if (openAi) {
+            sendJson(guard, 200, buildCompletion(model, generation, latencyMs), closeAfter);
+        } else if (stream) {
+            sendStream(guard, pathString, model, generation, closeAfter);
+        } else {
+            sendJson(guard, 200, buildChunk(pathString, model, generation.text, true, generation), closeAfter);
+        }
+    });
+}
+
+QJsonObject MockOllamaServer::errorBody(bool openAi, const QString &message)
+{
+    QJsonObject body;
+    if (openAi) {
+        QJsonObject error;
+        error["message"] = message;
+        error["type"] = "invalid_request_error";
+        body["error"] = error;
+    } else {
+        body["error"] = message;
+    }
+    return body;
+}
+
+MockOllamaServer::Generation MockOllamaServer::generate(const QString &text, const QJsonObject &options)
+{
+    Generation generation;
+    generation.text = text;
+    for (const QJsonValue &stop : options["stop"].toArray()) {
+        const int at = generation.text.indexOf(stop.toString());
+        if (at >= 0) {
+            generation.text.truncate(at);
+        }
+    }
+    const int numPredict = options["num_predict"].toInt(-1);
+    if (numPredict > 0 && generation.text.size() > numPredict * 4) {
+        generation.text.truncate(numPredict * 4);
+        generation.doneReason = "length";
+    }
+    generation.evalCount = (generation.text.size() + 3) / 4;
+    return generation;
+}
+
+QString MockOllamaServer::echoText(const QJsonObject &request, int bodyBytes) const
+{
+    QJsonArray images = request["images"].toArray();
+    QString prompt = request["prompt"].toString();
+    if (request.contains("messages")) {
+        QJsonObject message = request["messages"].toArray().last().toObject();
+        images = message["images"].toArray();
+        prompt = message["content"].toString();
+        if (message["content"].isArray()) {
+            // OpenAI 兼容格式：文本和图像（data URL）是 content 中的片段
+            for (const QJsonValue &part : message["content"].toArray()) {
+                const QJsonObject object = part.toObject();
+                if (object["type"].toString() == "text") {
+                    prompt = object["text"].toString();
+                } else if (object["type"].toString() == "image_url") {
+                    const QString url = object["image_url"].toObject()["url"].toString();
+                    images.append(url.mid(url.indexOf(',') + 1));
+                }
+            }
+        }
+    }
+
+    int imageChars = 0;
+    for (const QJsonValue &image : images) {
+        imageChars += image.toString().size();
+    }
+
+    return QString("model=%1 bodyBytes=%2 promptChars=%3 images=%4 imageBase64Chars=%5")
+        .arg(request["model"].toString())
+        .arg(bodyBytes)
+        .arg(prompt.size())
+        .arg(images.size())
+        .arg(imageChars);
+}
+
+QJsonObject MockOllamaServer::buildChunk(const QString &path, const QString &model,
+                                         const QString &text, bool done, const Generation &generation) const
+{
+    QJsonObject chunk;
+    chunk["model"] = model;
+    chunk["created_at"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs);
+    if (path == "/api/chat") {
+        QJsonObject message;
+        message["role"] = "assistant";
+        message["content"] = text;
+        chunk["message"] = message;
+    } else {
+        chunk["response"] = text;
+    }
+    chunk["done"] = done;
+    if (done) {
+        // 与 Ollama 相同的计时字段（纳秒），数值为模拟值
+        const double evalMs = generation.evalCount * opts.evalMsPerToken;
+        chunk["done_reason"] = generation.doneReason;
+        chunk["total_duration"] = (opts.latencyMs + evalMs) * 1e6;
+        chunk["load_duration"] = 0;
+        chunk["prompt_eval_count"] = 1;
+        chunk["prompt_eval_duration"] = double(opts.latencyMs) * 1e6;
+        chunk["eval_count"] = generation.evalCount;
+        chunk["eval_duration"] = evalMs * 1e6;
+    }
+    return chunk;
+}
+
+QByteArray MockOllamaServer::statusLine(int status)
+{
+    QByteArray reason;
+    switch (status) {
+    case 200: reason = "OK"; break;
+    case 400: reason = "Bad Request"; break;
+    case 404: reason = "Not Found"; break;
+    case 429: reason = "Too Many Requests"; break;
+    case 503: reason = "Service Unavailable"; break;
+    default: reason = "Internal Server Error"; break;
+    }
+    return "HTTP/1.1 " + QByteArray::number(status) + " " + reason + "\r\n";
+}
+
+void MockOllamaServer::sendJson(QTcpSocket *socket, int status, const QJsonObject &obj, bool closeAfter)
+{
+    QByteArray body = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+    QByteArray response = statusLine(status);
+    response += "Content-Type: application/json; charset=utf-8\r\n";
+    response += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    response += closeAfter ? "Connection: close\r\n\r\n" : "Connection: keep-alive\r\n\r\n";
+    response += body;
+    socket->write(response);
+    if (closeAfter) {
+        socket->disconnectFromHost();
+    }
+}
+
+QStringList MockOllamaServer::splitText(const QString &text) const
+{
+    // 将文本均分为 chunkCount 片
+    const int pieces = qMax(1, opts.chunkCount);
+    const int pieceSize = (text.size() + pieces - 1) / pieces;
+    QStringList result;
+    for (int i = 0; i < pieces; ++i) {
+        result << text.mid(i * pieceSize, pieceSize);
+    }
+    return result;
+}
+
+void MockOllamaServer::sendStream(QTcpSocket *socket, const QString &path, const QString &model,
+                                  const Generation &generation, bool closeAfter)
+{
+    // 各片之后追加一个 done=true 的空片
+    QList<QByteArray> lines;
+    for (const QString &piece : splitText(generation.text)) {
+        lines.append(QJsonDocument(buildChunk(path, model, piece, false, generation)).toJson(QJsonDocument::Compact) + "\n");
+    }
+    lines.append(QJsonDocument(buildChunk(path, model, QString(), true, generation)).toJson(QJsonDocument::Compact) + "\n");
+    sendChunked(socket, "application/x-ndjson", lines, closeAfter);
+}
+
+QJsonObject MockOllamaServer::buildCompletion(const QString &model, const Generation &generation, int latencyMs) const
+{
+    QJsonObject message;
+    message["role"] = "assistant";
+    message["content"] = generation.text;
+    QJsonObject choice;
+    choice["index"] = 0;
+    choice["message"] = message;
+    choice["finish_reason"] = generation.doneReason;
+
+    QJsonObject completion;
+    completion["id"] = "chatcmpl-mock";
+    completion["object"] = "chat.completion";
+    completion["created"] = QDateTime::currentSecsSinceEpoch();
+    completion["model"] = model;
+    completion["choices"] = QJsonArray{choice};
+    completion["usage"] = buildUsage(generation);
+    completion["timings"] = buildTimings(generation, latencyMs);
+    return completion;
+}
+
+QJsonObject MockOllamaServer::buildUsage(const Generation &generation)
+{
+    QJsonObject usage;
+    usage["prompt_tokens"] = 1;
+    usage["completion_tokens"] = generation.evalCount;
+    usage["total_tokens"] = 1 + generation.evalCount;
+    return usage;
+}
+
+QJsonObject MockOllamaServer::buildTimings(const Generation &generation, int latencyMs) const
+{
+    // 与 llama-server 相同的扩展字段（毫秒），数值为模拟值
+    QJsonObject timings;
+    timings["prompt_n"] = 1;
+    timings["prompt_ms"] = double(latencyMs);
+    timings["predicted_n"] = generation.evalCount;
+    timings["predicted_ms"] = generation.evalCount * opts.evalMsPerToken;
+    return timings;
+}
+
+void MockOllamaServer::sendEvents(QTcpSocket *socket, const QString &model, const Generation &generation,
+                                  int latencyMs, bool includeUsage, bool closeAfter)
+{
+    auto event = [](const QJsonObject &object) {
+        return "data: " + QJsonDocument(object).toJson(QJsonDocument::Compact) + "\n\n";
+    };
+    auto chunk = [&](const QJsonObject &delta, const QJsonValue &finishReason) {
+        QJsonObject choice;
+        choice["index"] = 0;
+        choice["delta"] = delta;
+        choice["finish_reason"] = finishReason;
+        QJsonObject object;
+        object["id"] = "chatcmpl-mock";
+        object["object"] = "chat.completion.chunk";
+        object["created"] = QDateTime::currentSecsSinceEpoch();
+        object["model"] = model;
+        object["choices"] = QJsonArray{choice};
+        return object;
+    };
+
+    // 首个事件只带 role，随后是内容片段，再是带 finish_reason 的空片段；
+    // 请求 include_usage 时另有一个 choices 为空、带 usage 的事件，最后是 [DONE]
+    QList<QByteArray> events;
+    QJsonObject role;
+    role["role"] = "assistant";
+    events.append(event(chunk(role, QJsonValue::Null)));
+    for (const QString &piece : splitText(generation.text)) {
+        QJsonObject delta;
+        delta["content"] = piece;
+        events.append(event(chunk(delta, QJsonValue::Null)));
+    }
+    QJsonObject last = chunk(QJsonObject(), generation.doneReason);
+    last["timings"] = buildTimings(generation, latencyMs);
+    events.append(event(last));
+    if (includeUsage) {
+        QJsonObject usage = chunk(QJsonObject(), QJsonValue::Null);
+        usage["choices"] = QJsonArray();
+        usage["usage"] = buildUsage(generation);
+        events.append(event(usage));
+    }
+    events.append("data: [DONE]\n\n");
+    sendChunked(socket, "text/event-stream", events, closeAfter);
+}
+
+void MockOllamaServer::sendChunked(QTcpSocket *socket, const QByteArray &contentType,
+                                   const QList<QByteArray> &lines, bool closeAfter)
+{
+    QByteArray header = statusLine(200);
+    header += "Content-Type: " + contentType + "\r\n";
+    header += "Transfer-Encoding: chunked\r\n";
+    header += closeAfter ? "Connection: close\r\n\r\n" : "Connection: keep-alive\r\n\r\n";
+    socket->write(header);
+
+    QPointer<QTcpSocket> guard(socket);
+    for (int i = 0; i < lines.size(); ++i) {
+        const bool last = (i == lines.size() - 1);
+        QByteArray frame = QByteArray::number(lines[i].size(), 16) + "\r\n" + lines[i] + "\r\n";
+        if (last) {
+            frame += "0\r\n\r\n";
+        }
+        const bool close = last && closeAfter;
+        if (opts.chunkIntervalMs <= 0) {
+            socket->write(frame);
+            if (close) {
+                socket->disconnectFromHost();
+            }
+            continue;
+        }
+        QTimer::singleShot(i * opts.chunkIntervalMs, this, [guard, frame, close]() {
+            if (guard) {
+                guard->write(frame);
+                if (close) {
+                    guard->disconnectFromHost();
+                }
+            }
+        });
+    }
+}
@@ -0,0 +1,127 @@
+#ifndef MOCKOLLAMASERVER_H
+#define MOCKOLLAMASERVER_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QHash>
+#include <QJsonObject>
+#include <QStringList>
+#include <QRandomGenerator>
+
+// 进程内的 Ollama 模拟服务器，用于基准测试和集成测试
+// 支持 /api/generate、/api/chat、/api/tags、/api/version 以及 OpenAI 兼容的 /v1/chat/completions（SSE 流式）
+// 和 /v1/models，
+// 可配置延迟、流式分片、错误注入、请求回显和是否保持连接，统计客户端中途断开而放弃的请求，
+// 也可以按模型名分别设置延迟和响应；
+// 请求中的 options.stop 和 options.num_predict 会像真实服务端一样截断生成的文本
+class MockOllamaServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 某个模型的延迟和响应，覆盖 Options 中的 latencyMs 和 responseText
+    struct ModelProfile
+    {
+        int latencyMs = 0;
+        QString responseText;
+    };
+
+    struct Options
+    {
+        int latencyMs = 0;          // 首字节前的固定延迟
+        int chunkCount = 4;         // stream 模式下 response 的分片数（SSE 为内容事件数）
+        int chunkIntervalMs = 0;    // stream 模式下相邻分片的间隔
+        double errorRate = 0.0;     // 注入错误的概率 [0, 1]
+        int errorStatus = 500;      // 注入错误时返回的 HTTP 状态码
+        bool echoPayload = false;   // 在 response 中回显请求摘要而非固定文本
+        double evalMsPerToken = 0;  // 模拟解码耗时：每个生成 token 的毫秒数（按 4 字符一个 token 计）
+        bool keepAlive = true;      // false 时每个响应后关闭连接（模拟不支持持久连接的代理）
+        // 模拟 CPU 推理的线程数影响（用于校准）：optimalThreads 非 0 时，options.num_thread 每偏离一个线程
+        // 延迟增加 threadPenaltyMs；请求未指定 num_thread 时按 defaultThreads 计
+        int optimalThreads = 0;
+        int defaultThreads = 0;
+        int threadPenaltyMs = 0;
+        QString responseText = "$$E = mc^2$$";
+        // 模型名 -> 延迟和响应（用于分级识别：小模型快但可能出错）；非空时请求其他模型返回 404
+        QHash<QString, ModelProfile> models;
+    };
+
+    explicit MockOllamaServer(QObject *parent = nullptr);
+
+    // 在 127.0.0.1 上监听；port 为 0 时由系统分配
+    bool start(quint16 port = 0);
+    void stop();
+
+    quint16 port() const;
+    QString generateUrl() const;
+    QString chatUrl() const;
+    QString openAiUrl() const;
+
+    Options options() const;
+    void setOptions(const Options &options);
+
+    // 统计信息
+    int requestCount() const;
+    int errorCount() const;
+    int connectionCount() const;
+    // 响应发出前客户端就断开的请求数：真实服务端此时取消请求的上下文，停止生成
+    int abandonedCount() const;
+    QByteArray lastRequestBody() const;
+    void resetStats();
+
+signals:
+    void requestReceived(const QString &path, int bodyBytes);
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+    void onDisconnected();
+
+private:
+    QString baseUrl() const;
+    // closeAfter：客户端要求 Connection: close 或服务端不保持连接，响应后关闭
+    void handleRequest(QTcpSocket *socket, const QByteArray &method,
+                       const QByteArray &path, const QByteArray &body, bool closeAfter);
+    void sendJson(QTcpSocket *socket, int status, const QJsonObject &obj, bool closeAfter = false);
+    // Ollama 的错误为 {"error":"..."}，OpenAI 兼容接口为 {"error":{"message":...}}
+    static QJsonObject errorBody(bool openAi, const QString &message);
+    // 一次模拟生成的结果
+    struct Generation
+    {
+        QString text;
+        int evalCount = 0;
+        QString doneReason = "stop";
+    };
+    static Generation generate(const QString &text, const QJsonObject &options);
+
+    QStringList splitText(const QString &text) const;
+    void sendStream(QTcpSocket *socket, const QString &path, const QString &model,
+                    const Generation &generation, bool closeAfter);
+    // OpenAI 兼容接口的 SSE 响应
+    void sendEvents(QTcpSocket *socket, const QString &model, const Generation &generation,
+                    int latencyMs, bool includeUsage, bool closeAfter);
+    // 以 chunked 编码依次发送各片，相邻两片间隔 chunkIntervalMs
+    void sendChunked(QTcpSocket *socket, const QByteArray &contentType,
+                     const QList<QByteArray> &lines, bool closeAfter);
+    QJsonObject buildCompletion(const QString &model, const Generation &generation, int latencyMs) const;
+    static QJsonObject buildUsage(const Generation &generation);
+    QJsonObject buildTimings(const Generation &generation, int latencyMs) const;
+    QJsonObject buildChunk(const QString &path, const QString &model,
+                           const QString &text, bool done, const Generation &generation) const;
+    QString echoText(const QJsonObject &request, int bodyBytes) const;
+    static QByteArray statusLine(int status);
+
+    QTcpServer server;
+    QHash<QTcpSocket *, QByteArray> buffers;
+    Options opts;
+    QRandomGenerator random;
+    int requests;
+    int errors;
+    int connections;
+    int abandoned;
+    QHash<QTcpSocket *, int> generating; // 连接 -> 尚未发出响应的请求数
+    QByteArray lastBody;
+};
+
+#endif // MOCKOLLAMASERVER_H
@@ -0,0 +1,177 @@
+#include "ollamabackend.h"
+#include "formulajsonreader.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QUrl>
+
+namespace {
+
+// 非流式响应整体缓存，结束时一次解析；流式响应按行（NDJSON）解析
+class OllamaDecoder : public InferenceBackend::Decoder
+{
+public:
+    explicit OllamaDecoder(bool streaming) : streaming(streaming) {}
+
+    QString feed(const QByteArray &data) override
+    {
+        buffer += data;
+        if (!streaming) {
+            return QString();
+        }
+        QString text;
+        int start = 0;
+        int newline;
+        while ((newline = buffer.indexOf('\n', start)) >= 0) {
+            text += feedLine(buffer.mid(start, newline - start));
+            start = newline + 1;
+        }
+        buffer.remove(0, start);
+        return text;
+    }
+
+    QString finish() override
+    {
+        QString text;
+        if (!streaming) {
+            if (OllamaBackend::parseResponse(buffer, &text, &error, &stats)) {
+                decoded = text;
+            }
+        } else if (!buffer.trimmed().isEmpty()) {
+            text = feedLine(buffer);
+        }
+        buffer.clear();
+        return text;
+    }
+
+private:
+    QString feedLine(const QByteArray &line)
+    {
+        const QJsonObject chunk = QJsonDocument::fromJson(line).object();
+        if (chunk.contains("error")) {
+            error = "Ollama API Error: " + chunk["error"].toString();
+            return QString();
+        }
+        QString text;
+        if (chunk.contains("response")) {
+            text = chunk["response"].toString();
+        } else if (chunk["message"].isObject()) {
+            text = chunk["message"].toObject()["content"].toString();
+        }
+        decoded += text;
+        if (chunk["done"].toBool()) {
+            stats = OllamaBackend::readUsage(chunk);
+        }
+        return text;
+    }
+
+    bool streaming;
+    QByteArray buffer;
+};
+
+} // namespace
+
+QString OllamaBackend::name() const
+{
+    return "ollama";
+}
+
+QString OllamaBackend::healthUrl() const
+{
+    // 反向代理下保留 /api 之前的前缀
+    QUrl url(endpoint);
+    const QString path = url.path();
+    const int api = path.lastIndexOf("/api/");
+    url.setPath((api >= 0 ? path.left(api) : QString()) + "/api/version");
+    url.setQuery(QString());
+    return url.toString();
+}
+
+bool OllamaBackend::isChatApi() const
+{
+    return QUrl(endpoint).path().endsWith("/api/chat");
+}
+
+QByteArray OllamaBackend::buildPayload(const Request &request) const
+{
+    return buildPayload(request.model, request.prompt, request.base64Image, isChatApi(),
+                        request.structured, request.options);
+}
+
+InferenceBackend::Decoder *OllamaBackend::createDecoder(const Request &request) const
+{
+    return new OllamaDecoder(request.structured);
+}
+
+QByteArray OllamaBackend::buildPayload(const QString &modelName, const QString &prompt,
+                                       const QByteArray &base64Image, bool chatApi,
+                                       bool structured, const QJsonObject &options)
+{
+    QJsonArray imagesArray;
+    imagesArray.append(QString::fromLatin1(base64Image));
+
+    QJsonObject jsonPayload;
+    jsonPayload["model"] = modelName;
+    jsonPayload["stream"] = false; // Get response in one go
+    if (structured) {
+        // 模型输出受 Schema 约束，不会再有说明文字；流式返回以便边收边解析
+        jsonPayload["format"] = FormulaJsonReader::schema();
+        jsonPayload["stream"] = true;
+    }
+    if (!options.isEmpty()) {
+        jsonPayload["options"] = options;
+    }
+
+    if (chatApi) {
+        QJsonObject message;
+        message["role"] = "user";
+        message["content"] = prompt;
+        message["images"] = imagesArray;
+        jsonPayload["messages"] = QJsonArray{message};
+    } else {
+        jsonPayload["prompt"] = prompt;
+        jsonPayload["images"] = imagesArray;
+    }
+
+    return QJsonDocument(jsonPayload).toJson(QJsonDocument::Compact);
+}
+
+bool OllamaBackend::parseResponse(const QByteArray &data, QString *text, QString *errorString,
+                                  Usage *usage)
+{
+    QJsonDocument jsonDoc = QJsonDocument::fromJson(data);
+    QJsonObject jsonObj = jsonDoc.object();
+
+    if (jsonObj.contains("response")) {
+        *text = jsonObj["response"].toString();
+        if (usage) {
+            *usage = readUsage(jsonObj);
+        }
+        return true;
+    }
+    if (jsonObj.contains("message") && jsonObj["message"].isObject()) {
+        *text = jsonObj["message"].toObject()["content"].toString();
+        if (usage) {
+            *usage = readUsage(jsonObj);
+        }
+        return true;
+    }
+    if (jsonObj.contains("error")) {
+        *errorString = "Ollama API Error: " + jsonObj["error"].toString();
+        return false;
+    }
+    *errorString = "Failed to parse Ollama response or 'response' field missing. Response: " + QString(data);
+    return false;
+}
+
+InferenceBackend::Usage OllamaBackend::readUsage(const QJsonObject &chunk)
+{
+    // Ollama 的耗时字段单位为纳秒
+    Usage usage;
+    usage.promptTokens = chunk["prompt_eval_count"].toInt();
+    usage.promptMs = qint64(chunk["prompt_eval_duration"].toDouble() / 1e6);
+    usage.completionTokens = chunk["eval_count"].toInt();
+    usage.completionMs = qint64(chunk["eval_duration"].toDouble() / 1e6);
+    usage.loadMs = qint64(chunk["load_duration"].toDouble() / 1e6);
+    usage.doneReason = chunk["done_reason"].toString();
+    return usage;
+}
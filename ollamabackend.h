@@ -0,0 +1,33 @@
+#ifndef OLLAMABACKEND_H
+#define OLLAMABACKEND_H
+
+#include "inferencebackend.h"
+
+// Ollama 的 /api/generate 与 /api/chat（按 URL 的路径区分）。
+// 结构化输出通过 format 字段附带 JSON Schema，并以 NDJSON 流式返回；其余请求一次返回
+class OllamaBackend : public InferenceBackend
+{
+public:
+    QString name() const override;
+    // /api/version
+    QString healthUrl() const override;
+    QByteArray buildPayload(const Request &request) const override;
+    Decoder *createDecoder(const Request &request) const override;
+
+    bool isChatApi() const;
+
+    // 以下静态方法单独暴露以便基准测试
+    // 构造请求体；chatApi 为 true 时使用 /api/chat 的 messages 格式，
+    // structured 为 true 时附带 format 字段的 JSON Schema 并使用流式响应
+    static QByteArray buildPayload(const QString &modelName, const QString &prompt,
+                                   const QByteArray &base64Image, bool chatApi,
+                                   bool structured = false,
+                                   const QJsonObject &options = QJsonObject());
+    // 解析 /api/generate 或 /api/chat 的非流式响应；usage 不为空时读取其中的计时字段
+    static bool parseResponse(const QByteArray &data, QString *text, QString *errorString,
+                              Usage *usage = nullptr);
+    // 读取最后一个响应分片中的 eval_count、eval_duration 等字段
+    static Usage readUsage(const QJsonObject &chunk);
+};
+
+#endif // OLLAMABACKEND_H
@@ -1,22 +1,47 @@
 #include "ollamaclient.h"
-#include <QBuffer>
+#include "responsepostprocessor.h"
 #include <QByteArray>
-#include <QJsonDocument>
 #include <QJsonObject>
-#include <QJsonArray>
-#include <QFileInfo>
-#include <QMimeDatabase> // For guessing MIME type, though PNG is good.
+#include <QCryptographicHash>
+#include <QThread>
+#include <QTimer>
+#include <QDebug>
 
 OllamaClient::OllamaClient(QObject *parent)
-    : QObject(parent), networkManager(new QNetworkAccessManager(this))
+    : QObject(parent), transport(new OllamaTransport(this)), backend(InferenceBackend::create("ollama")),
+      reaskOnInvalid(true), outputMode("markdown"), healthReply(nullptr), local(false), engineThread(nullptr), engine(nullptr),
+      nextCallId(0), nextRequestId(0), latestId(0)
 {
+    qRegisterMetaType<RecognitionMetrics>("RecognitionMetrics");
+
     // Default values
     ollamaApiUrl = "http://localhost:11434/api/generate";
     currentModelName = "qwen2.5vl:7b";
+    backend->setUrl(ollamaApiUrl);
+}
+
+OllamaClient::~OllamaClient()
+{
+    // 关闭窗口时中止所有调用，服务端不再为已无人接收的结果继续生成；
+    // 析构期间不再发射信号
+    blockSignals(true);
+    const QList<QByteArray> keys = inFlight.keys();
+    for (const QByteArray &key : keys) {
+        abortCall(key);
+    }
+    if (healthReply) {
+        healthReply->abort();
+    }
+    // 进程内推理在下一个 token 处停止，之后线程退出，引擎随之释放
+    if (engineThread) {
+        engineThread->quit();
+        engineThread->wait();
+    }
 }
 
 void OllamaClient::setOllamaUrl(const QString &url) {
     ollamaApiUrl = url;
+    backend->setUrl(ollamaApiUrl);
     qDebug() << "ollamaApiUrl:"<< ollamaApiUrl;
 }
 
@@ -30,64 +55,893 @@ void OllamaClient::updateSettings(const QString &url, const QString &modelName)
     setModelName(modelName);
 }
 
-void OllamaClient::recognizeFormula(const QPixmap &pixmap)
+void OllamaClient::setApi(const QString &api) {
+    const QString previous = this->api();
+    if (api == "llama") {
+        if (!LlamaEngine::isAvailable()) {
+            qWarning() << "Local inference is not compiled in (qmake CONFIG+=llama) - keeping" << previous;
+            return;
+        }
+        if (!local) {
+            local = true;
+            startEngine();
+            qDebug() << "inference api: llama";
+        }
+    } else {
+        if (local) {
+            // 离开进程内推理时释放模型占用的内存
+            local = false;
+            LlamaEngine *target = engine;
+            QMetaObject::invokeMethod(engine, [target]() { target->unload(); }, Qt::QueuedConnection);
+            qDebug() << "inference api:" << backend->name();
+        }
+        if (api != backend->name()) {
+            InferenceBackend *created = InferenceBackend::create(api);
+            if (created) {
+                backend.reset(created);
+                backend->setUrl(ollamaApiUrl);
+                qDebug() << "inference api:" << backend->name();
+            } else {
+                qWarning() << "Unknown inference API" << api << "- keeping" << backend->name();
+            }
+        }
+    }
+    if (this->api() != previous) {
+        failInFlight(QString("Inference API changed from %1 to %2.").arg(previous, this->api()));
+    }
+}
+
+QString OllamaClient::api() const
+{
+    return local ? QString("llama") : backend->name();
+}
+
+void OllamaClient::setLlamaSettings(const LlamaEngine::Settings &settings) {
+    llamaSettings = settings;
+    qDebug() << "llama model:" << llamaSettings.modelPath << "threads:" << llamaSettings.threads
+             << "mmap:" << llamaSettings.mmap;
+    if (local) {
+        startEngine();
+    }
+}
+
+void OllamaClient::startEngine()
+{
+    if (!engineThread) {
+        engineThread = new QThread(this);
+        engineThread->setObjectName("LlamaEngine");
+        engine = new LlamaEngine;
+        engine->moveToThread(engineThread);
+        connect(engineThread, &QThread::finished, engine, &QObject::deleteLater);
+        connect(engine, &LlamaEngine::finished, this, &OllamaClient::onLocalFinished);
+        connect(engine, &LlamaEngine::loaded, this, [](bool ok, const QString &errorString) {
+            if (!ok) {
+                qWarning() << "Failed to load local model:" << errorString;
+            }
+        });
+        engineThread->start();
+    }
+    // 设置未变且已加载时引擎不会重新加载
+    LlamaEngine *target = engine;
+    const LlamaEngine::Settings settings = llamaSettings;
+    QMetaObject::invokeMethod(engine, [target, settings]() { target->load(settings); }, Qt::QueuedConnection);
+}
+
+void OllamaClient::setEncoderSettings(const ImageEncoder::Settings &settings) {
+    encoderSettings = settings;
+    qDebug() << "upload codec:" << encoderSettings.codec;
+}
+
+void OllamaClient::setReaskOnInvalid(bool enabled) {
+    reaskOnInvalid = enabled;
+}
+
+void OllamaClient::setOutputMode(const QString &mode) {
+    outputMode = mode;
+    qDebug() << "output mode:" << outputMode;
+}
+
+void OllamaClient::setGenerationSettings(const GenerationOptions::Settings &settings) {
+    generationSettings = settings;
+    qDebug() << "generation mode:" << generationSettings.mode;
+}
+
+void OllamaClient::setRuntimeOptions(const RuntimeOptions::Settings &settings) {
+    runtimeSettings = settings;
+    qDebug() << "runtime options:" << RuntimeOptions::describe(runtimeSettings);
+}
+
+void OllamaClient::setLayoutSettings(const LayoutAnalyzer::Settings &settings) {
+    layoutSettings = settings;
+    qDebug() << "layout segmentation:" << layoutSettings.enabled << "max segments:" << layoutSettings.maxSegments;
+}
+
+void OllamaClient::setCascadeSettings(const CascadePolicy::Settings &settings) {
+    cascadeSettings = settings;
+    qDebug() << "cascade:" << cascadeSettings.enabled << "fast model:" << cascadeSettings.fastModel;
+}
+
+CascadePolicy::Stats OllamaClient::cascadeStats() const
 {
+    return cascade;
+}
+
+void OllamaClient::setTransportSettings(const OllamaTransport::Settings &settings) {
+    transport->setSettings(settings);
+}
+
+void OllamaClient::warmUp() {
+    if (local) {
+        return; // 进程内推理没有连接需要建立
+    }
+    transport->preconnect(QUrl(ollamaApiUrl));
+}
+
+QString OllamaClient::recognitionPrompt()
+{
+    // IMPORTANT: Adjust the prompt to get Markdown.
+    // This prompt is a suggestion. You might need to experiment for best results.
+    return "focusing on any mathematical formulas in this image. Present the formulas in Markdown format (e.g., $...$ for inline, $$...$$ for display). output formulas only";
+}
+
+QString OllamaClient::structuredPrompt()
+{
+    return "Transcribe every mathematical formula in this image, in reading order. "
+           "Answer in JSON: \"latex\" is the LaTeX source without $ delimiters, "
+           "\"display\" is true for a standalone formula and false for a formula inside running text, "
+           "\"confidence\" is your confidence from 0 to 1.";
+}
+
+void OllamaClient::checkHealth()
+{
+    if (local) {
+        emit healthChecked(true, QString());
+        return;
+    }
+    if (healthReply) {
+        return;
+    }
+    QNetworkReply *reply = transport->get(QUrl(backend->healthUrl()));
+    healthReply = reply;
+    // 服务端主机关机时连接要等系统超时才失败，这里不等那么久
+    QTimer::singleShot(HealthTimeoutMs, reply, [reply]() { reply->abort(); });
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        healthReply = nullptr;
+        reply->deleteLater();
+        const bool ok = reply->error() == QNetworkReply::NoError;
+        emit healthChecked(ok, ok ? QString() : reply->errorString());
+    });
+}
+
+bool OllamaClient::isConnectionError(QNetworkReply::NetworkError error)
+{
+    switch (error) {
+    case QNetworkReply::ConnectionRefusedError:
+    case QNetworkReply::RemoteHostClosedError:
+    case QNetworkReply::HostNotFoundError:
+    case QNetworkReply::TimeoutError:
+    case QNetworkReply::TemporaryNetworkFailureError:
+    case QNetworkReply::NetworkSessionFailedError:
+    case QNetworkReply::ProxyConnectionRefusedError:
+    case QNetworkReply::ProxyConnectionClosedError:
+    case QNetworkReply::ProxyNotFoundError:
+    case QNetworkReply::ProxyTimeoutError:
+        return true;
+    default:
+        return false;
+    }
+}
+
+quint64 OllamaClient::latestRequestId() const
+{
+    return latestId;
+}
+
+int OllamaClient::inFlightCount() const
+{
+    return inFlight.size();
+}
+
+QByteArray OllamaClient::requestKey(const QByteArray &imageHash, const QString &model, const QString &prompt,
+                                    const QString &url) const
+{
+    // 图像内容 + 模型 + 提示词；URL 和接口格式也计入，切换服务器后不与旧请求合并
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(imageHash);
+    hash.addData(model.toUtf8());
+    hash.addData(QByteArray(1, '\0'));
+    hash.addData(prompt.toUtf8());
+    hash.addData(QByteArray(1, '\0'));
+    hash.addData(url.toUtf8());
+    hash.addData(QByteArray(1, '\0'));
+    hash.addData(api().toUtf8());
+    return hash.result();
+}
+
+quint64 OllamaClient::recognizeFormula(const QPixmap &pixmap)
+{
+    return startRecognition(pixmap, false, Target());
+}
+
+quint64 OllamaClient::recognizeInBackground(const QPixmap &pixmap, const Target &target)
+{
+    return startRecognition(pixmap, true, target);
+}
+
+OllamaClient::Target OllamaClient::currentTarget() const
+{
+    Target target;
+    target.url = ollamaApiUrl;
+    target.model = currentModelName;
+    target.outputMode = outputMode;
+    return target;
+}
+
+OllamaClient::Target OllamaClient::resolveTarget(quint64 requestId) const
+{
+    const quint64 owner = segmentOwner.contains(requestId) ? segmentOwner.value(requestId).parentId : requestId;
+    Target target = targets.value(owner);
+    if (target.url.isEmpty()) {
+        target.url = ollamaApiUrl;
+    }
+    if (target.model.isEmpty()) {
+        target.model = currentModelName;
+    }
+    if (target.outputMode.isEmpty()) {
+        target.outputMode = outputMode;
+    }
+    return target;
+}
+
+quint64 OllamaClient::startRecognition(const QPixmap &pixmap, bool background, const Target &target)
+{
+    const quint64 requestId = ++nextRequestId;
+    if (!target.url.isEmpty() || !target.model.isEmpty() || !target.outputMode.isEmpty()) {
+        targets.insert(requestId, target);
+    }
+    if (background) {
+        backgroundIds.insert(requestId);
+    } else {
+        latestId = requestId;
+    }
+
     if (pixmap.isNull()) {
-        emit recognitionError("Input image is empty.");
+        finishRequest(requestId, false, QString(), "Input image is empty.", nullptr);
+        return requestId;
+    }
+
+    const QImage image = pixmap.toImage();
+    QElapsedTimer layoutTimer;
+    layoutTimer.start();
+    const QList<QRect> segments = LayoutAnalyzer::segment(image, layoutSettings);
+    if (segments.size() < 2) {
+        submit(requestId, image);
+        return requestId;
+    }
+
+    // 整页截图：各行作为子请求同时发出，总耗时取决于最慢的一行而不是整页
+    TiledRequest job;
+    job.parts.resize(segments.size());
+    job.remaining = segments.size();
+    job.metrics.requestId = requestId;
+    job.metrics.segments = segments.size();
+    job.metrics.layoutUs = layoutTimer.nsecsElapsed() / 1000;
+    job.timer.start();
+    tiled.insert(requestId, job);
+    qDebug() << "Request" << requestId << "split into" << segments.size() << "segments";
+
+    for (int i = 0; i < segments.size(); ++i) {
+        const quint64 segmentId = ++nextRequestId;
+        segmentOwner.insert(segmentId, {requestId, i});
+        submit(segmentId, image.copy(segments.at(i)));
+    }
+    return requestId;
+}
+
+bool OllamaClient::cancelRequest(quint64 requestId, bool keepShared)
+{
+    return cancel(requestId, keepShared);
+}
+
+bool OllamaClient::cancel(quint64 requestId, bool exclusiveOnly)
+{
+    // 切分识别的请求由各行尚未返回的子请求组成
+    QSet<quint64> ids;
+    const bool isTiled = tiled.contains(requestId);
+    if (isTiled) {
+        for (auto it = segmentOwner.cbegin(); it != segmentOwner.cend(); ++it) {
+            if (it->parentId == requestId) {
+                ids.insert(it.key());
+            }
+        }
+    } else {
+        ids.insert(requestId);
+    }
+
+    QList<QByteArray> keys;
+    for (auto it = inFlight.cbegin(); it != inFlight.cend(); ++it) {
+        bool serves = false;
+        bool shared = false;
+        for (quint64 id : it->requestIds) {
+            if (ids.contains(id)) {
+                serves = true;
+            } else {
+                shared = true;
+            }
+        }
+        if (!serves) {
+            continue;
+        }
+        if (shared && exclusiveOnly) {
+            return false;
+        }
+        keys << it.key();
+    }
+    if (keys.isEmpty() && !isTiled) {
+        return false;
+    }
+
+    for (const QByteArray &key : keys) {
+        auto it = inFlight.find(key);
+        for (quint64 id : ids) {
+            if (it->requestIds.removeAll(id) > 0 && it->metrics.coalesced > 0) {
+                it->metrics.coalesced--;
+            }
+        }
+        if (it->requestIds.isEmpty()) {
+            abortCall(key);
+        }
+    }
+    for (quint64 id : ids) {
+        segmentOwner.remove(id);
+    }
+    tiled.remove(requestId);
+    backgroundIds.remove(requestId);
+    targets.remove(requestId);
+    qDebug() << "Request" << requestId << "cancelled," << keys.size() << "calls affected";
+    emit requestCancelled(requestId);
+    return true;
+}
+
+void OllamaClient::abortCall(const QByteArray &key)
+{
+    InFlightRequest call = inFlight.take(key);
+    if (call.reply) {
+        // abort 会同步发射 finished，先断开，避免按失败处理
+        disconnect(call.reply, nullptr, this, nullptr);
+        // HTTP/1.1 下关闭这条连接，HTTP/2 下重置这个流；Ollama 随即取消请求的上下文，停止预填充或解码
+        call.reply->abort();
+        call.reply->deleteLater();
+    } else if (call.localCall != 0) {
+        localCalls.remove(call.localCall);
+        if (engine) {
+            engine->cancel(call.localCall);
+        }
+    }
+}
+
+void OllamaClient::failInFlight(const QString &errorString)
+{
+    // 先全部中止再逐个结束：结束时的信号可能同步发起新请求，新请求不能挂到正要中止的调用上
+    QList<InFlightRequest> calls;
+    const QList<QByteArray> keys = inFlight.keys();
+    for (const QByteArray &key : keys) {
+        calls << inFlight.value(key);
+        abortCall(key);
+    }
+    if (!calls.isEmpty()) {
+        qDebug() << calls.size() << "in-flight calls failed:" << errorString;
+    }
+    for (const InFlightRequest &call : calls) {
+        for (quint64 requestId : call.requestIds) {
+            if (segmentOwner.contains(requestId)) {
+                segmentFinished(requestId, false, QString(), errorString, call.metrics);
+            } else {
+                finishRequest(requestId, false, QString(), errorString, &call.metrics);
+            }
+        }
+    }
+}
+
+void OllamaClient::submit(quint64 requestId, const QImage &image)
+{
+    RecognitionMetrics metrics;
+    metrics.requestId = requestId;
+    QElapsedTimer stageTimer;
+    stageTimer.start();
+
+    const Target target = resolveTarget(requestId);
+    const bool structured = target.outputMode == "json";
+    const QString prompt = structured ? structuredPrompt() : recognitionPrompt();
+    // 分级识别先交给小模型；小模型与大模型相同时没有意义，直接用大模型。
+    // 进程内推理只加载了一个模型，不分级
+    const bool fastTier = !local && cascadeSettings.enabled && !cascadeSettings.fastModel.isEmpty()
+            && cascadeSettings.fastModel != target.model;
+    const QString model = local ? llamaSettings.modelPath
+                                : fastTier ? cascadeSettings.fastModel : target.model;
+    const QByteArray key = requestKey(ImageEncoder::contentHash(image), model, prompt, target.url);
+    metrics.hashUs = stageTimer.nsecsElapsed() / 1000;
+    if (fastTier) {
+        metrics.tier = "fast";
+    }
+
+    // 相同的请求正在进行中：挂到已有的网络调用上，不再重复推理
+    auto existing = inFlight.find(key);
+    if (existing != inFlight.end()) {
+        existing->requestIds.append(requestId);
+        existing->metrics.coalesced++;
+        qDebug() << "Request" << requestId << "coalesced with in-flight request" << existing->requestIds.first();
         return;
     }
 
-    QByteArray byteArray;
-    QBuffer buffer(&byteArray);
-    buffer.open(QIODevice::WriteOnly);
-    if (!pixmap.save(&buffer, "PNG")) { // Save pixmap as PNG into byte array
-        emit recognitionError("Failed to convert QPixmap to PNG byte array.");
+    InferenceBackend::Request request;
+    request.model = model;
+    request.prompt = prompt;
+    request.structured = structured;
+    request.options = GenerationOptions::build(generationSettings, image.size(), structured);
+    metrics.numPredict = request.options["num_predict"].toInt();
+    metrics.numCtx = request.options["num_ctx"].toInt();
+    if (!local) {
+        RuntimeOptions::apply(runtimeSettings, target.url, HardwareInfo::detect(), &request.options);
+    }
+
+    InFlightRequest call;
+    call.requestIds.append(requestId);
+    call.fastTier = fastTier;
+    call.imageSize = image.size();
+    call.url = target.url;
+    call.fullModel = target.model;
+
+    if (local) {
+        // 图像直接交给引擎：没有编码、base64 和 JSON 序列化；上下文长度在加载时确定
+        metrics.codec = "raw";
+        metrics.numCtx = llamaSettings.contextSize;
+        call.metrics = metrics;
+        call.request = request;
+        call.image = image;
+        call.networkTimer.start();
+        sendLocal(key, call);
         return;
     }
-    QString base64Image = QString::fromLatin1(byteArray.toBase64().data());
 
-    QJsonObject jsonPayload;
-    jsonPayload["model"] = currentModelName;
-    // IMPORTANT: Adjust the prompt to get Markdown.
-    // This prompt is a suggestion. You might need to experiment for best results.
-    jsonPayload["prompt"] = "focusing on any mathematical formulas in this image. Present the formulas in Markdown format (e.g., $...$ for inline, $$...$$ for display). output formulas only";
-    jsonPayload["stream"] = false; // Get response in one go
+    stageTimer.restart();
+    ImageEncoder::Result encoded = ImageEncoder::encode(image, encoderSettings);
+    if (!encoded.ok) {
+        const QString error = QString("Failed to encode image as %1.").arg(encoded.format.toUpper());
+        if (segmentOwner.contains(requestId)) {
+            segmentFinished(requestId, false, QString(), error, metrics);
+        } else {
+            finishRequest(requestId, false, QString(), error, nullptr);
+        }
+        return;
+    }
+    metrics.encodeUs = stageTimer.nsecsElapsed() / 1000;
+    metrics.imageBytes = encoded.data.size();
+    metrics.codec = encoded.codec;
 
-    QJsonArray imagesArray;
-    imagesArray.append(base64Image);
-    jsonPayload["images"] = imagesArray;
+    stageTimer.restart();
+    QByteArray base64Image = encoded.data.toBase64();
+    metrics.base64Us = stageTimer.nsecsElapsed() / 1000;
 
-    QJsonDocument doc(jsonPayload);
-    QByteArray jsonData = doc.toJson();
+    request.base64Image = base64Image;
+    request.mimeType = "image/" + encoded.format;
 
-    QNetworkRequest request;
-    request.setUrl(QUrl(ollamaApiUrl));
-    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    stageTimer.restart();
+    QByteArray jsonData = backend->buildPayload(request);
+    metrics.serializeUs = stageTimer.nsecsElapsed() / 1000;
+    metrics.payloadBytes = jsonData.size();
 
-    QNetworkReply *reply = networkManager->post(request, jsonData);
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
-        onReplyFinished(reply);
-    });
+    call.metrics = metrics;
+    call.request = request;
+    call.networkTimer.start();
+    sendRequest(key, call, jsonData);
 }
 
-void OllamaClient::onReplyFinished(QNetworkReply *reply)
+void OllamaClient::sendRequest(const QByteArray &key, const InFlightRequest &call, const QByteArray &jsonData)
 {
-    if (reply->error() == QNetworkReply::NoError) {
-        QByteArray responseData = reply->readAll();
-        QJsonDocument jsonDoc = QJsonDocument::fromJson(responseData);
-        QJsonObject jsonObj = jsonDoc.object();
+    InFlightRequest pending = call;
+    pending.reply = transport->post(QUrl(pending.url), jsonData);
 
-        if (jsonObj.contains("response")) {
-            QString formula = jsonObj["response"].toString();
-            emit recognitionSuccess(formula);
-        } else if (jsonObj.contains("error")) {
-            emit recognitionError("Ollama API Error: " + jsonObj["error"].toString());
+    // 请求体开始上传之前的时间：QNetworkAccessManager 每个主机只开有限的连接，并发的分段和批量请求
+    // 在这里排队，新建连接时还有 TCP 连接和 TLS 握手，两者无法区分，只作为发出首字节的耗时报告
+    QElapsedTimer firstByteTimer;
+    firstByteTimer.start();
+    QNetworkReply *uploading = pending.reply;
+    auto measured = QSharedPointer<bool>::create(false);
+    connect(uploading, &QNetworkReply::uploadProgress, this,
+            [this, key, uploading, firstByteTimer, measured](qint64 bytesSent, qint64) {
+        if (*measured || bytesSent <= 0) {
+            return;
+        }
+        *measured = true;
+        auto it = inFlight.find(key);
+        if (it != inFlight.end() && it->reply == uploading) {
+            it->metrics.firstByteMs += firstByteTimer.elapsed();
+        }
+    });
+    // 响应边收边解码；结构化模式下解码出的文本再交给 FormulaJsonReader，公式一闭合即解析
+    pending.decoder.reset(backend->createDecoder(pending.request));
+    pending.reader.reset(pending.request.structured ? new FormulaJsonReader : nullptr);
+    QSharedPointer<InferenceBackend::Decoder> decoder = pending.decoder;
+    QSharedPointer<FormulaJsonReader> reader = pending.reader;
+    QNetworkReply *reply = pending.reply;
+    connect(reply, &QNetworkReply::readyRead, this, [this, key, decoder, reader, reply]() {
+        QElapsedTimer parseTimer;
+        parseTimer.start();
+        const QString text = decoder->feed(reply->readAll());
+        if (reader) {
+            reader->feed(text);
         }
-        else {
-            emit recognitionError("Failed to parse Ollama response or 'response' field missing. Response: " + QString(responseData));
+        auto it = inFlight.find(key);
+        if (it != inFlight.end() && it->reply == reply) {
+            it->metrics.parseUs += parseTimer.nsecsElapsed() / 1000;
         }
+    });
+    inFlight.insert(key, pending);
+
+    connect(pending.reply, &QNetworkReply::finished, this, [this, key]() {
+        onReplyFinished(key);
+    });
+}
+
+void OllamaClient::sendLocal(const QByteArray &key, const InFlightRequest &call)
+{
+    InFlightRequest pending = call;
+    pending.reply = nullptr;
+    pending.decoder.reset();
+    pending.reader.reset(pending.request.structured ? new FormulaJsonReader : nullptr);
+    pending.localCall = ++nextCallId;
+    localCalls.insert(pending.localCall, key);
+    inFlight.insert(key, pending);
+
+    // 引擎在自己的线程上按顺序执行；QImage 隐式共享，跨线程传递不拷贝像素
+    LlamaEngine *target = engine;
+    const quint64 callId = pending.localCall;
+    const QImage image = pending.image;
+    const QString prompt = pending.request.prompt;
+    const QJsonObject options = pending.request.options;
+    QMetaObject::invokeMethod(engine, [target, callId, image, prompt, options]() {
+        target->run(callId, image, prompt, options);
+    }, Qt::QueuedConnection);
+}
+
+void OllamaClient::dispatch(const QByteArray &key, const InFlightRequest &call)
+{
+    if (local) {
+        sendLocal(key, call);
     } else {
-        emit recognitionError("Network Error: " + reply->errorString() + " | Details: " + reply->readAll());
+        sendRequest(key, call, backend->buildPayload(call.request));
+    }
+}
+
+void OllamaClient::onLocalFinished(quint64 callId, const QString &text, const QString &errorString,
+                                   const InferenceBackend::Usage &usage)
+{
+    const QByteArray key = localCalls.take(callId);
+    auto it = inFlight.find(key);
+    if (it == inFlight.end() || it->localCall != callId) {
+        return;
     }
+    InFlightRequest call = *it;
+    inFlight.erase(it);
+
+    RecognitionMetrics metrics = call.metrics;
+    metrics.networkMs = call.networkTimer.elapsed();
+    metrics.reasked = call.reasked;
+    addUsage(usage, &metrics);
+    if (call.reader) {
+        QElapsedTimer parseTimer;
+        parseTimer.start();
+        call.reader->feed(text);
+        metrics.parseUs += parseTimer.nsecsElapsed() / 1000;
+    }
+    completeCall(key, call, metrics, text, errorString);
+}
+
+void OllamaClient::onReplyFinished(const QByteArray &key)
+{
+    auto it = inFlight.find(key);
+    if (it == inFlight.end() || !it->reply) {
+        return;
+    }
+    InFlightRequest call = *it;
+    inFlight.erase(it);
+    QNetworkReply *reply = call.reply;
+    RecognitionMetrics metrics = call.metrics;
+    metrics.networkMs = call.networkTimer.elapsed();
+    metrics.reasked = call.reasked;
+    metrics.http2 = reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool();
+
+    QString errorString;
+    QElapsedTimer parseTimer;
+    parseTimer.start();
+    InferenceBackend::Decoder &decoder = *call.decoder;
+    QString tail = decoder.feed(reply->readAll());
+    tail += decoder.finish();
+    if (call.reader) {
+        call.reader->feed(tail);
+    }
+    addUsage(decoder.usage(), &metrics);
+
+    if (reply->error() != QNetworkReply::NoError) {
+        errorString = "Network Error: " + reply->errorString() + " | Details: "
+                + (decoder.hasError() ? decoder.errorString() : decoder.text());
+        if (isConnectionError(reply->error())) {
+            QSet<quint64> owners;
+            for (quint64 requestId : call.requestIds) {
+                owners.insert(segmentOwner.contains(requestId) ? segmentOwner.value(requestId).parentId : requestId);
+            }
+            for (quint64 requestId : owners) {
+                emit endpointUnreachable(requestId);
+            }
+        }
+    } else if (decoder.hasError()) {
+        errorString = decoder.errorString();
+    }
+    metrics.parseUs += parseTimer.nsecsElapsed() / 1000;
     reply->deleteLater();
+
+    completeCall(key, call, metrics, decoder.text(), errorString);
+}
+
+void OllamaClient::completeCall(const QByteArray &key, const InFlightRequest &call, RecognitionMetrics metrics,
+                                const QString &text, QString errorString)
+{
+    QString formula;
+    bool ok = false;
+    QElapsedTimer parseTimer;
+    parseTimer.start();
+    // errorString 非空时为网络错误、服务端返回的错误或进程内推理的错误
+    if (errorString.isEmpty() && call.reader) {
+        const FormulaJsonReader &reader = *call.reader;
+        const QList<FormulaJsonReader::Formula> formulas = reader.formulas();
+        if (!formulas.isEmpty() || reader.isComplete()) {
+            ok = true;
+            formula = FormulaJsonReader::toMarkdown(formulas);
+            for (const FormulaJsonReader::Formula &f : formulas) {
+                if (f.confidence >= 0 && (metrics.confidence < 0 || f.confidence < metrics.confidence)) {
+                    metrics.confidence = f.confidence;
+                }
+            }
+        } else if (!reader.text().trimmed().isEmpty()) {
+            // 服务端不支持结构化输出时模型仍按自由文本回答，交给后处理按 Markdown 清理
+            ok = true;
+            formula = reader.text();
+        } else {
+            errorString = "Failed to parse streaming response.";
+        }
+    } else if (errorString.isEmpty()) {
+        ok = true;
+        formula = text;
+    }
+    metrics.parseUs += parseTimer.nsecsElapsed() / 1000;
+
+    if (ok) {
+        QElapsedTimer postTimer;
+        postTimer.start();
+        ResponsePostProcessor::Result cleaned = ResponsePostProcessor::process(formula);
+        metrics.postProcessUs += postTimer.nsecsElapsed() / 1000;
+        formula = cleaned.markdown;
+        metrics.validationError = cleaned.error;
+        // 达到 num_predict 被截断的输出即使配对也可能缺了后面的公式
+        const bool truncated = metrics.doneReason == "length";
+        if (cleaned.valid && truncated) {
+            metrics.validationError = "output truncated at num_predict";
+        }
+
+        if (call.fastTier) {
+            // 小模型的输出不重新提问：未通过检查直接交给大模型
+            const CascadePolicy::Verdict verdict = CascadePolicy::check(cascadeSettings, cleaned, call.imageSize,
+                                                                        metrics.confidence, metrics.doneReason);
+            if (!verdict.accept) {
+                escalate(key, call, metrics, verdict.reason);
+                return;
+            }
+        }
+
+        if ((!cleaned.valid || truncated) && reaskOnInvalid && !call.reasked) {
+            // 带着问题描述再问一次；请求 id 和去重键不变，期间的重复请求仍会合并到这里
+            qDebug() << "Response failed validation (" << metrics.validationError << "), re-asking";
+            InFlightRequest retry = call;
+            retry.reply = nullptr;
+            retry.reasked = true;
+            retry.firstResult = formula;
+            retry.firstError = metrics.validationError;
+            retry.metrics = metrics;
+            retry.metrics.confidence = -1;
+            QJsonObject &options = retry.request.options;
+            if (truncated && options["num_predict"].toInt() > 0) {
+                // 上限估小了：放宽一倍，上下文不够时同样按档位放大
+                const int numPredict = options["num_predict"].toInt() * 2;
+                options["num_predict"] = numPredict;
+                if (options.contains("num_ctx")) {
+                    const int needed = metrics.promptEvalCount + numPredict;
+                    options["num_ctx"] = qMax(options["num_ctx"].toInt(),
+                                              GenerationOptions::estimateNumCtx(0, needed));
+                }
+                retry.metrics.numPredict = numPredict;
+                retry.metrics.numCtx = options["num_ctx"].toInt();
+            }
+            ResponsePostProcessor::Result problem = cleaned;
+            problem.error = metrics.validationError;
+            retry.request.prompt = call.request.structured
+                    ? structuredPrompt() + " The previous answer was malformed (" + problem.error
+                      + "); make sure every latex value has balanced braces and matching \\begin/\\end environments."
+                    : ResponsePostProcessor::reaskPrompt(problem);
+            dispatch(key, retry);
+            return;
+        }
+        if (!cleaned.valid && call.reasked) {
+            // 重新提问仍未通过：保留第一次的结果
+            formula = call.firstResult;
+            metrics.validationError = call.firstError;
+        }
+    } else if (call.fastTier) {
+        // 小模型请求失败（如模型未下载）：交给大模型
+        escalate(key, call, metrics, errorString);
+        return;
+    } else if (call.reasked) {
+        // 重新提问失败时退回第一次的结果，而不是报错
+        ok = true;
+        formula = call.firstResult;
+        metrics.validationError = call.firstError;
+    }
+
+    if (call.fastTier) {
+        cascade.recordAccepted(metrics.networkMs);
+        qDebug() << "Cascade:" << cascade.summary();
+    } else if (metrics.escalated) {
+        cascade.recordEscalated(call.fastMs, metrics.networkMs - call.fastMs);
+        qDebug() << "Cascade:" << cascade.summary();
+    }
+
+    for (quint64 requestId : call.requestIds) {
+        if (segmentOwner.contains(requestId)) {
+            segmentFinished(requestId, ok, formula, errorString, metrics);
+        } else {
+            finishRequest(requestId, ok, formula, errorString, &metrics);
+        }
+    }
+}
+
+void OllamaClient::escalate(const QByteArray &key, const InFlightRequest &call,
+                            const RecognitionMetrics &metrics, const QString &reason)
+{
+    qDebug() << "Fast model" << call.request.model << "rejected (" << reason << "), escalating to" << call.fullModel;
+    InFlightRequest next = call;
+    next.reply = nullptr;
+    next.fastTier = false;
+    next.request.model = call.fullModel;
+    next.fastMs = call.networkTimer.elapsed();
+    // networkTimer 不重新开始：networkMs 为两级的总耗时；计时字段累加，结果相关的字段以大模型为准
+    next.metrics = metrics;
+    next.metrics.tier = "full";
+    next.metrics.escalated = true;
+    next.metrics.escalationReason = reason;
+    next.metrics.validationError.clear();
+    next.metrics.confidence = -1;
+    next.metrics.doneReason.clear();
+    dispatch(key, next);
+}
+
+void OllamaClient::segmentFinished(quint64 segmentId, bool ok, const QString &formula,
+                                   const QString &errorString, const RecognitionMetrics &metrics)
+{
+    const SegmentRef ref = segmentOwner.take(segmentId);
+    auto it = tiled.find(ref.parentId);
+    if (it == tiled.end()) {
+        return;
+    }
+
+    TiledRequest &job = *it;
+    if (ok) {
+        job.parts[ref.index] = formula.trimmed();
+        if (!metrics.validationError.isEmpty()) {
+            job.errors << QString("segment %1: %2").arg(ref.index + 1).arg(metrics.validationError);
+        }
+    } else {
+        job.errors << QString("segment %1: %2").arg(ref.index + 1).arg(errorString);
+    }
+
+    // 各行的编码、传输和生成统计累加；置信度取最小值
+    RecognitionMetrics &total = job.metrics;
+    total.coalesced += metrics.coalesced;
+    total.hashUs += metrics.hashUs;
+    total.encodeUs += metrics.encodeUs;
+    total.base64Us += metrics.base64Us;
+    total.serializeUs += metrics.serializeUs;
+    total.parseUs += metrics.parseUs;
+    total.postProcessUs += metrics.postProcessUs;
+    total.imageBytes += metrics.imageBytes;
+    total.payloadBytes += metrics.payloadBytes;
+    total.firstByteMs = qMax(total.firstByteMs, metrics.firstByteMs);
+    total.http2 = total.http2 || metrics.http2;
+    if (total.codec.isEmpty()) {
+        total.codec = metrics.codec;
+    }
+    total.reasked = total.reasked || metrics.reasked;
+    if (metrics.confidence >= 0 && (total.confidence < 0 || metrics.confidence < total.confidence)) {
+        total.confidence = metrics.confidence;
+    }
+    total.numPredict += metrics.numPredict;
+    total.numCtx = qMax(total.numCtx, metrics.numCtx);
+    total.promptEvalCount += metrics.promptEvalCount;
+    total.promptEvalMs += metrics.promptEvalMs;
+    total.evalCount += metrics.evalCount;
+    total.evalMs += metrics.evalMs;
+    total.loadMs += metrics.loadMs;
+    if (total.doneReason != "length") {
+        total.doneReason = metrics.doneReason;
+    }
+    if (total.tier != "full") {
+        total.tier = metrics.tier;
+    }
+    total.escalated = total.escalated || metrics.escalated;
+    if (total.escalationReason.isEmpty()) {
+        total.escalationReason = metrics.escalationReason;
+    }
+
+    if (--job.remaining > 0) {
+        return;
+    }
+
+    TiledRequest done = tiled.take(ref.parentId);
+    done.metrics.networkMs = done.timer.elapsed();
+    QStringList lines;
+    for (const QString &part : done.parts) {
+        if (!part.isEmpty()) {
+            lines << part;
+        }
+    }
+    // 部分行失败时仍给出其余行的结果，问题记录在 validationError 中
+    if (!done.errors.isEmpty()) {
+        done.metrics.validationError = done.errors.join("; ");
+    }
+    if (lines.isEmpty()) {
+        finishRequest(ref.parentId, false, QString(),
+                      done.errors.isEmpty() ? QString("No formulas recognized.") : done.errors.first(),
+                      &done.metrics);
+    } else {
+        finishRequest(ref.parentId, true, lines.join('\n'), QString(), &done.metrics);
+    }
+}
+
+void OllamaClient::addUsage(const InferenceBackend::Usage &usage, RecognitionMetrics *metrics)
+{
+    metrics->promptEvalCount += usage.promptTokens;
+    metrics->promptEvalMs += usage.promptMs;
+    metrics->evalCount += usage.completionTokens;
+    metrics->evalMs += usage.completionMs;
+    metrics->loadMs += usage.loadMs;
+    metrics->doneReason = usage.doneReason;
+}
+
+void OllamaClient::finishRequest(quint64 requestId, bool ok, const QString &formula,
+                                 const QString &errorString, const RecognitionMetrics *metrics)
+{
+    targets.remove(requestId);
+    if (ok) {
+        emit requestFinished(requestId, formula);
+    } else {
+        emit requestFailed(requestId, errorString);
+    }
+
+    // 批量请求的结果只交给发起方，不发到界面
+    if (backgroundIds.remove(requestId)) {
+        return;
+    }
+    // 期间用户又发起了新的识别：该结果已过时，不能覆盖界面上更新的结果
+    if (requestId != latestId) {
+        qDebug() << "Dropping stale result for request" << requestId << "(latest is" << latestId << ")";
+        return;
+    }
+
+    if (metrics) {
+        emit requestMetrics(*metrics);
+    }
+    if (ok) {
+        emit recognitionSuccess(formula);
+    } else {
+        emit recognitionError(errorString);
+    }
 }
@@ -2,16 +2,75 @@
 #define OLLAMACLIENT_H
 
 #include <QObject>
-#include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QPixmap>
 #include <QString>
+#include <QMetaType>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QSharedPointer>
+#include "imageencoder.h"
+#include "formulajsonreader.h"
+#include "generationoptions.h"
+#include "layoutanalyzer.h"
+#include "ollamatransport.h"
+#include "cascadepolicy.h"
+#include "inferencebackend.h"
+#include "llamaengine.h"
+#include "runtimeoptions.h"
+
+class QThread;
+
+// 单次识别请求各阶段的耗时统计（用于性能分析和回归跟踪）
+struct RecognitionMetrics
+{
+    quint64 requestId = 0;   // 发起该网络请求的请求 id
+    int coalesced = 0;       // 合并到该网络请求上的重复请求数
+    qint64 hashUs = 0;       // 图像内容哈希（请求去重键）
+    qint64 encodeUs = 0;     // QPixmap -> 上传编码（PNG/JPEG/WebP）
+    qint64 base64Us = 0;     // 编码结果 -> base64
+    qint64 serializeUs = 0;  // JSON 序列化
+    qint64 networkMs = 0;    // 发出请求到收到完整响应；进程内推理时为排队和推理的时间
+    qint64 firstByteMs = 0;  // 发出请求到请求体的第一个字节发出：含在 QNetworkAccessManager 中排队等待连接的时间，
+                             // 新建连接时另含 TCP 连接和 TLS 握手；不是单独的连接建立耗时。分段识别时取各段的最大值
+    bool http2 = false;      // 响应经由 HTTP/2 返回
+    qint64 parseUs = 0;      // 响应 JSON 解析
+    qint64 postProcessUs = 0; // 响应清理与配对检查（ResponsePostProcessor）
+    qint64 imageBytes = 0;   // 编码后的图像大小
+    qint64 payloadBytes = 0; // 请求体大小
+    QString codec;           // 实际使用的上传编码，auto 模式带 "auto:" 前缀；进程内推理为 "raw"
+    bool reasked = false;    // 因公式不配对而重新提问过
+    QString validationError; // 最终结果仍未通过配对检查时的问题描述
+    double confidence = -1;  // 结构化输出中各公式置信度的最小值，-1 表示未知
+    int numPredict = 0;      // 发送的 options.num_predict，0 表示未设置
+    int numCtx = 0;          // 发送的 options.num_ctx，0 表示未设置
+    // 以下取自响应的统计字段（重新提问时累加）；OpenAI 兼容接口只给出 token 数，llama-server 另有耗时
+    int promptEvalCount = 0; // 输入 token 数（含图像）
+    qint64 promptEvalMs = 0; // 预填充耗时
+    int evalCount = 0;       // 生成的 token 数
+    qint64 evalMs = 0;       // 解码耗时
+    qint64 loadMs = 0;       // 模型加载耗时（num_ctx 变化也会触发重新加载）
+    QString doneReason;      // "stop" 或 "length"（达到 num_predict）
+    // 整页截图按行切分后并行识别：以下字段为各行之和，networkMs 为从发出第一行到最后一行返回的时间
+    int segments = 0;        // 子请求数，0 表示未切分
+    qint64 layoutUs = 0;     // 版面分析耗时
+    // 分级识别：tier 为 "fast"（小模型的结果被采用）或 "full"（升级到大模型），未启用时为空；
+    // 切分识别时任一行升级即为 "full"
+    QString tier;
+    bool escalated = false;
+    QString escalationReason; // 小模型输出未通过检查的原因
+};
+Q_DECLARE_METATYPE(RecognitionMetrics)
 
 class OllamaClient : public QObject
 {
     Q_OBJECT
 public:
     explicit OllamaClient(QObject *parent = nullptr);
+    ~OllamaClient() override;
 
     // 设置API URL
     void setOllamaUrl(const QString &url);
@@ -21,22 +80,201 @@ public:
     // 更新API URL和模型名称
     void updateSettings(const QString &url, const QString &modelName);
 
-    // 识别公式
-    void recognizeFormula(const QPixmap &pixmap);
+    // 推理后端的接口格式："ollama"（默认）或 "openai"（/v1/chat/completions），见 InferenceBackend::create；
+    // "llama" 在工作线程上进程内推理（LlamaEngine），未以 CONFIG+=llama 编译时保持原来的接口；
+    // 接口变化时进行中的请求按失败结束（requestFailed）
+    void setApi(const QString &api);
+    QString api() const;
+    // 进程内推理的模型文件和线程数等；设置变化时在工作线程上重新加载
+    void setLlamaSettings(const LlamaEngine::Settings &settings);
+
+    // 设置上传图像的编码方式
+    void setEncoderSettings(const ImageEncoder::Settings &settings);
+
+    // 响应未通过配对检查时，是否带着问题描述自动重新提问一次
+    void setReaskOnInvalid(bool enabled);
+
+    // 输出模式："markdown"（自由文本）或 "json"（通过 format 字段约束为公式列表，流式读取）
+    void setOutputMode(const QString &mode);
+
+    // 生成参数（num_predict、num_ctx、temperature、stop）
+    void setGenerationSettings(const GenerationOptions::Settings &settings);
+    // 推理进程的运行参数（num_thread、num_batch、use_mmap、use_mlock），应为当前端点合并后的值
+    void setRuntimeOptions(const RuntimeOptions::Settings &settings);
+
+    // 版面分析：较高的选区按行切分，各行作为子请求并行识别
+    void setLayoutSettings(const LayoutAnalyzer::Settings &settings);
+
+    // 分级识别：先用小模型，输出未通过检查时升级到 setModelName 设置的模型
+    void setCascadeSettings(const CascadePolicy::Settings &settings);
+    // 启用分级识别以来各级的命中次数和节省的时间
+    CascadePolicy::Stats cascadeStats() const;
+
+    // 传输层设置（持久连接、HTTP/2、TLS 会话复用、预连接）
+    void setTransportSettings(const OllamaTransport::Settings &settings);
+    // 提前建立到当前 URL 的连接，截图期间完成连接建立，识别请求不再等待
+    void warmUp();
+
+    // 识别公式，返回本次请求的 id
+    // 图像、模型和提示词都相同的并发请求合并为一次网络调用；
+    // 只有最新一次请求的结果会通过 recognitionSuccess / recognitionError 发出，旧请求的结果被丢弃；
+    // 切分后的各行使用内部的子请求 id，不受上述规则影响，全部返回后按阅读顺序拼接为该请求的结果
+    quint64 recognizeFormula(const QPixmap &pixmap);
+    // 一次识别使用的服务端地址、模型和输出模式，空字段使用当前设置
+    struct Target
+    {
+        QString url;
+        QString model;
+        QString outputMode;
+    };
+    Target currentTarget() const;
+
+    // 批量识别：与 recognizeFormula 相同，但不成为最新请求，结果只通过 requestFinished / requestFailed 发出。
+    // target 用于重新识别之前保存的任务，与当时的服务端和模型一致
+    quint64 recognizeInBackground(const QPixmap &pixmap, const Target &target = Target());
+
+    // 取消请求：只服务于该请求的网络调用立即中止并关闭连接，服务端检测到断开后停止生成，
+    // 推理资源随即空出；与其他请求合并的调用继续进行。之后该请求只发射 requestCancelled。
+    // 请求已经结束时返回 false。keepShared 时请求的任一调用还服务于其他请求就不取消，返回 false
+    bool cancelRequest(quint64 requestId, bool keepShared = false);
+
+    // 探测服务端是否可用（Ollama 的 /api/version、OpenAI 兼容接口的 /models），结果经由 healthChecked 发出；
+    // 进程内推理总是可用。上一次探测尚未返回时不重复发出
+    void checkHealth();
+    // 连接不上服务端的错误（拒绝连接、找不到主机、超时等），与服务端返回的错误相对；
+    // 503 等 HTTP 状态是服务端的回答（如模型加载失败），不算在内
+    static bool isConnectionError(QNetworkReply::NetworkError error);
+
+    // 最近一次 recognizeFormula 返回的 id
+    quint64 latestRequestId() const;
+    // 正在进行的网络请求数（合并后的）
+    int inFlightCount() const;
+
+    // 请求体的构造和响应解析见 OllamaBackend / OpenAiBackend，图像编码见 ImageEncoder::encode
+    // 默认的识别提示词
+    static QString recognitionPrompt();
+    // 结构化输出模式的提示词，说明各字段的含义
+    static QString structuredPrompt();
 
 signals:
+    // 仅针对最新的请求发射
     void recognitionSuccess(const QString &markdownFormula);
     void recognitionError(const QString &errorString);
+    // 与最新请求的 recognitionSuccess / recognitionError 一起发射（在其之前）
+    void requestMetrics(const RecognitionMetrics &metrics);
 
-private slots:
-    void onReplyFinished(QNetworkReply *reply);
+    // 每个请求（包括被合并和已过时的）结束时都会发射
+    void requestFinished(quint64 requestId, const QString &markdownFormula);
+    void requestFailed(quint64 requestId, const QString &errorString);
+    // 请求被 cancelRequest 或新请求取消，不会再有 requestFinished / requestFailed
+    void requestCancelled(quint64 requestId);
+    // 请求因连接不上服务端而失败，在该请求的 requestFailed 之前发射；切分识别时为所属的请求 id
+    void endpointUnreachable(quint64 requestId);
+    void healthChecked(bool ok, const QString &errorString);
 
 private:
-    QNetworkAccessManager *networkManager;
+    OllamaTransport *transport;
+    QSharedPointer<InferenceBackend> backend;
     QString ollamaApiUrl;
     QString currentModelName;
+    ImageEncoder::Settings encoderSettings;
+    bool reaskOnInvalid;
+    QString outputMode;
+    GenerationOptions::Settings generationSettings;
+    RuntimeOptions::Settings runtimeSettings;
+    LayoutAnalyzer::Settings layoutSettings;
+    CascadePolicy::Settings cascadeSettings;
+    CascadePolicy::Stats cascade;
+    static const int HealthTimeoutMs = 5000;
+    QNetworkReply *healthReply;  // 进行中的 checkHealth
+    // 进程内推理：引擎在 engineThread 上运行，调用按 callId 对应回去重键
+    bool local;
+    QThread *engineThread;
+    LlamaEngine *engine;
+    LlamaEngine::Settings llamaSettings;
+    quint64 nextCallId;
+    QHash<quint64, QByteArray> localCalls;
+
+    // 一次实际的网络调用，可能服务于多个请求 id
+    struct InFlightRequest
+    {
+        QNetworkReply *reply = nullptr;
+        QList<quint64> requestIds;
+        RecognitionMetrics metrics;
+        QElapsedTimer networkTimer;
+        // 模型、提示词、图像和 options；重新提问和升级时复用，输出被截断后重新提问时放宽 options
+        InferenceBackend::Request request;
+        bool reasked = false;
+        QString firstResult;         // 重新提问前的结果
+        QString firstError;
+        QSharedPointer<InferenceBackend::Decoder> decoder;
+        QSharedPointer<FormulaJsonReader> reader; // 结构化模式下边收边解析
+        bool fastTier = false;       // 分级识别的第一级（小模型）
+        QSize imageSize;             // 选区大小，检查小模型输出长度时使用
+        qint64 fastMs = 0;           // 升级前花在小模型上的时间
+        QImage image;                // 进程内推理直接使用的图像
+        quint64 localCall = 0;       // 进程内推理的调用 id，0 表示网络调用
+        QString url;                 // 网络调用的服务端地址
+        QString fullModel;           // 分级识别升级时使用的大模型
+    };
+
+    QHash<QByteArray, InFlightRequest> inFlight; // 去重键 -> 网络调用
+
+    // 切分识别的请求：等待所有行返回
+    struct TiledRequest
+    {
+        QVector<QString> parts;      // 各行的结果，按阅读顺序
+        QStringList errors;          // 失败或未通过检查的行
+        int remaining = 0;
+        RecognitionMetrics metrics;
+        QElapsedTimer timer;
+    };
+    struct SegmentRef
+    {
+        quint64 parentId;
+        int index;
+    };
+    QHash<quint64, TiledRequest> tiled;      // 请求 id -> 切分识别
+    QHash<quint64, SegmentRef> segmentOwner; // 子请求 id -> 所属请求和行号
+    quint64 nextRequestId;
+    quint64 latestId;
+    QSet<quint64> backgroundIds; // recognizeInBackground 发起、尚未结束的请求
+    QHash<quint64, Target> targets; // 指定了 Target 的请求，未指定的使用当前设置
+
+    quint64 startRecognition(const QPixmap &pixmap, bool background, const Target &target);
+    // 请求（切分识别时为所属的请求）实际使用的地址、模型和输出模式
+    Target resolveTarget(quint64 requestId) const;
+    // exclusiveOnly：请求的任一调用还服务于其他请求时不取消
+    bool cancel(quint64 requestId, bool exclusiveOnly);
+    // 从 inFlight 中移除并中止：网络调用 abort，进程内调用交给 LlamaEngine::cancel
+    void abortCall(const QByteArray &key);
+    // 中止所有进行中的调用，它们服务的请求按失败结束
+    void failInFlight(const QString &errorString);
 
-    void sendRequest(const QString &base64Image);
+    QByteArray requestKey(const QByteArray &imageHash, const QString &model, const QString &prompt,
+                          const QString &url) const;
+    // 编码并发送一张图像（整张选区或切分后的一行）
+    void submit(quint64 requestId, const QImage &image);
+    void sendRequest(const QByteArray &key, const InFlightRequest &call, const QByteArray &jsonData);
+    // 重新提问和升级：按当前接口发出网络请求或交给进程内引擎
+    void dispatch(const QByteArray &key, const InFlightRequest &call);
+    void sendLocal(const QByteArray &key, const InFlightRequest &call);
+    void startEngine();
+    void onReplyFinished(const QByteArray &key);
+    void onLocalFinished(quint64 callId, const QString &text, const QString &errorString,
+                         const InferenceBackend::Usage &usage);
+    // 一次调用的输出已完整：结构化解析、后处理、重新提问或升级，最后分发给各请求 id
+    void completeCall(const QByteArray &key, const InFlightRequest &call, RecognitionMetrics metrics,
+                      const QString &text, QString errorString);
+    // 小模型的输出未通过检查：同一张图交给大模型，请求 id 和去重键不变
+    void escalate(const QByteArray &key, const InFlightRequest &call,
+                  const RecognitionMetrics &metrics, const QString &reason);
+    void segmentFinished(quint64 segmentId, bool ok, const QString &formula,
+                         const QString &errorString, const RecognitionMetrics &metrics);
+    // 请求的最终结果：发射 requestFinished / requestFailed，最新请求另外发到界面
+    void finishRequest(quint64 requestId, bool ok, const QString &formula,
+                       const QString &errorString, const RecognitionMetrics *metrics);
+    static void addUsage(const InferenceBackend::Usage &usage, RecognitionMetrics *metrics);
 };
 
 #endif // OLLAMACLIENT_H
@@ -0,0 +1,1346 @@
+#include <QTest>
+#include <QSignalSpy>
+#include <QEventLoop>
+#include <QTimer>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QTextStream>
+#include <QPainter>
+#include <QTemporaryDir>
+#include "ollamaclient.h"
+#include "ollamabackend.h"
+#include "mockollamaserver.h"
+#include "tuningcalibrator.h"
+#include "recognitionscheduler.h"
+#include "benchmarkutils.h"
+
+class OllamaClientBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+
+    // 各阶段的微基准
+    void benchEncode_data();
+    void benchEncode();
+    void benchBase64();
+    void benchSerialize();
+    void benchParse();
+
+    // 端到端：不同并发度下的请求吞吐
+    void benchRoundTrip_data();
+    void benchRoundTrip();
+    // 进程内推理（需要 CONFIG+=llama，并用 LLAMA_MODEL、LLAMA_MMPROJ 指定模型文件）
+    void benchLocalRoundTrip();
+
+    // 模拟服务器行为校验
+    void testPayloadEcho();
+    void testChatEndpoint();
+    void testErrorInjection();
+    void testStreamingChunks();
+    void testMetricsEmitted();
+    void testCoalescing();
+    void testStaleResultDropped();
+    void testResponseCleaned();
+    void testReaskOnInvalid();
+    void testStructuredOutput();
+    void testGenerationOptions();
+    void testTruncatedOutputReasked();
+    void testTiledRecognition();
+    void testConnectionReuse();
+    void testPreconnect();
+    void testCascade();
+    void testOpenAiEndpoint();
+    void testOpenAiStructuredOutput();
+    void testOpenAiError();
+    void testApiSwitchFailsInFlight();
+    void testLocalUnavailable();
+    void testRuntimeOptionsSent();
+    void testCalibration();
+    void testSchedulerPriority();
+    void testSchedulerSupersedesQueued();
+    void testCancelRequest();
+    void testCancelCoalesced();
+    void testSupersededCancelled();
+    void testSchedulerSynchronousFailures();
+    void testSchedulerIgnoresForeignRequests();
+    void testSchedulerPreemptBulk();
+    void testSchedulerDefersWhenUnreachable();
+    void testSchedulerReplaysJournal();
+
+    // 生成参数对解码 token 数和耗时的影响
+    void reportDecodeReduction();
+    // 分级识别与只用大模型的总耗时对比
+    void reportCascade();
+
+private:
+    // 等待 client 产生 count 个结果（成功或失败），超时返回 false
+    bool waitForResults(OllamaClient &client, int count, int timeoutMs = 10000);
+
+    MockOllamaServer server;
+    QVector<QPixmap> variants;
+    QByteArray samplePng;
+    QByteArray sampleBase64;
+    QByteArray sampleResponse;
+};
+
+void OllamaClientBenchmark::initTestCase()
+{
+    QVERIFY(server.start());
+
+    // 预先渲染内容不同的图像，保证并发请求之间互不相同
+    for (int i = 0; i < 16; ++i) {
+        variants.append(QPixmap::fromImage(BenchmarkUtils::renderFormulaImage(QSize(640, 160), i)));
+    }
+
+    samplePng = ImageEncoder::encode(variants.first(), ImageEncoder::Settings()).data;
+    QVERIFY(!samplePng.isEmpty());
+    sampleBase64 = samplePng.toBase64();
+
+    QJsonObject response;
+    response["model"] = "mock-vl";
+    response["response"] = "$$\\int_0^\\infty e^{-x^2} dx = \\frac{\\sqrt{\\pi}}{2}$$";
+    response["done"] = true;
+    sampleResponse = QJsonDocument(response).toJson(QJsonDocument::Compact);
+}
+
+void OllamaClientBenchmark::cleanupTestCase()
+{
+    server.stop();
+}
+
+void OllamaClientBenchmark::init()
+{
+    server.setOptions(MockOllamaServer::Options());
+    server.resetStats();
+}
+
+bool OllamaClientBenchmark::waitForResults(OllamaClient &client, int count, int timeoutMs)
+{
+    int received = 0;
+    QEventLoop loop;
+    auto onResult = [&]() {
+        if (++received >= count) {
+            loop.quit();
+        }
+    };
+    // 按请求 id 统计：recognitionSuccess 只针对最新请求发射
+    QMetaObject::Connection c1 = connect(&client, &OllamaClient::requestFinished, &loop, onResult);
+    QMetaObject::Connection c2 = connect(&client, &OllamaClient::requestFailed, &loop, onResult);
+    QTimer::singleShot(timeoutMs, &loop, &QEventLoop::quit);
+    if (received < count) {
+        loop.exec();
+    }
+    disconnect(c1);
+    disconnect(c2);
+    return received >= count;
+}
+
+void OllamaClientBenchmark::benchEncode_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::newRow("320x80") << QSize(320, 80);
+    QTest::newRow("800x200") << QSize(800, 200);
+    QTest::newRow("1920x1080") << QSize(1920, 1080);
+}
+
+void OllamaClientBenchmark::benchEncode()
+{
+    QFETCH(QSize, size);
+    QPixmap pixmap = QPixmap::fromImage(BenchmarkUtils::renderFormulaImage(size));
+
+    QBENCHMARK {
+        ImageEncoder::Result encoded = ImageEncoder::encode(pixmap, ImageEncoder::Settings());
+        Q_UNUSED(encoded);
+    }
+}
+
+void OllamaClientBenchmark::benchBase64()
+{
+    QBENCHMARK {
+        QByteArray encoded = samplePng.toBase64();
+        Q_UNUSED(encoded);
+    }
+}
+
+void OllamaClientBenchmark::benchSerialize()
+{
+    const QString prompt = OllamaClient::recognitionPrompt();
+    QBENCHMARK {
+        QByteArray payload = OllamaBackend::buildPayload("mock-vl", prompt, sampleBase64, false);
+        Q_UNUSED(payload);
+    }
+}
+
+void OllamaClientBenchmark::benchParse()
+{
+    QBENCHMARK {
+        QString formula;
+        QString error;
+        OllamaBackend::parseResponse(sampleResponse, &formula, &error);
+    }
+}
+
+void OllamaClientBenchmark::benchRoundTrip_data()
+{
+    QTest::addColumn<QString>("api");
+    QTest::addColumn<int>("concurrency");
+    QTest::addColumn<int>("latencyMs");
+    QTest::newRow("c1-0ms") << "ollama" << 1 << 0;
+    QTest::newRow("c4-0ms") << "ollama" << 4 << 0;
+    QTest::newRow("c1-50ms") << "ollama" << 1 << 50;
+    QTest::newRow("c4-50ms") << "ollama" << 4 << 50;
+    QTest::newRow("c8-50ms") << "ollama" << 8 << 50;
+    QTest::newRow("c16-50ms") << "ollama" << 16 << 50;
+    // OpenAI 兼容接口：SSE 解码的额外开销
+    QTest::newRow("openai-c1-0ms") << "openai" << 1 << 0;
+    QTest::newRow("openai-c8-50ms") << "openai" << 8 << 50;
+}
+
+void OllamaClientBenchmark::benchRoundTrip()
+{
+    QFETCH(QString, api);
+    QFETCH(int, concurrency);
+    QFETCH(int, latencyMs);
+
+    MockOllamaServer::Options options;
+    options.latencyMs = latencyMs;
+    server.setOptions(options);
+
+    OllamaClient client;
+    client.updateSettings(api == "openai" ? server.openAiUrl() : server.generateUrl(), "mock-vl");
+    client.setApi(api);
+
+    QBENCHMARK {
+        for (int i = 0; i < concurrency; ++i) {
+            client.recognizeFormula(variants.at(i % variants.size()));
+        }
+        QVERIFY(waitForResults(client, concurrency));
+    }
+}
+
+void OllamaClientBenchmark::benchLocalRoundTrip()
+{
+    const QString modelPath = qEnvironmentVariable("LLAMA_MODEL");
+    const QString mmprojPath = qEnvironmentVariable("LLAMA_MMPROJ");
+    if (!LlamaEngine::isAvailable() || modelPath.isEmpty() || mmprojPath.isEmpty()) {
+        QSKIP("needs CONFIG+=llama and LLAMA_MODEL / LLAMA_MMPROJ");
+    }
+
+    OllamaClient client;
+    LlamaEngine::Settings settings;
+    settings.modelPath = modelPath;
+    settings.mmprojPath = mmprojPath;
+    client.setLlamaSettings(settings);
+    client.setApi("llama");
+    QCOMPARE(client.api(), QString("llama"));
+    QSignalSpy metricsSpy(&client, &OllamaClient::requestMetrics);
+
+    // 第一次调用包含模型加载，不计入
+    client.recognizeFormula(variants.first());
+    QVERIFY(waitForResults(client, 1, 300000));
+
+    int i = 1;
+    QBENCHMARK {
+        client.recognizeFormula(variants.at(i++ % variants.size()));
+        QVERIFY(waitForResults(client, 1, 300000));
+    }
+
+    const RecognitionMetrics metrics = metricsSpy.last().at(0).value<RecognitionMetrics>();
+    QCOMPARE(metrics.codec, QString("raw"));
+    QCOMPARE(metrics.payloadBytes, qint64(0));
+    QVERIFY(metrics.promptEvalCount > 0);
+}
+
+void OllamaClientBenchmark::testPayloadEcho()
+{
+    MockOllamaServer::Options options;
+    options.echoPayload = true;
+    server.setOptions(options);
+
+    OllamaClient client;
+    client.updateSettings(server.generateUrl(), "echo-model");
+    QSignalSpy spy(&client, &OllamaClient::recognitionSuccess);
+
+    client.recognizeFormula(variants.first());
+    QVERIFY(spy.wait(5000));
+
+    QString echoed = spy.takeFirst().at(0).toString();
+    QVERIFY(echoed.contains("model=echo-model"));
+    QVERIFY(echoed.contains("images=1"));
+    QVERIFY(echoed.contains(QString("imageBase64Chars=%1").arg(sampleBase64.size())));
+}
+
+void OllamaClientBenchmark::testChatEndpoint()
+{
+    OllamaClient client;
+    client.updateSettings(server.chatUrl(), "mock-vl");
+    QSignalSpy spy(&client, &OllamaClient::recognitionSuccess);
+
+    client.recognizeFormula(variants.first());
+    QVERIFY(spy.wait(5000));
+    QCOMPARE(spy.takeFirst().at(0).toString(), QString("$$E = mc^2$$"));
+
+    QJsonObject request = QJsonDocument::fromJson(server.lastRequestBody()).object();
+    QVERIFY(request.contains("messages"));
+    QVERIFY(!request.contains("prompt"));
+}
+
+void OllamaClientBenchmark::testErrorInjection()
+{
+    MockOllamaServer::Options options;
+    options.errorRate = 1.0;
+    options.errorStatus = 503;
+    server.setOptions(options);
+
+    OllamaClient client;
+    client.updateSettings(server.generateUrl(), "mock-vl");
+    QSignalSpy errorSpy(&client, &OllamaClient::recognitionError);
+    QSignalSpy successSpy(&client, &OllamaClient::recognitionSuccess);
+
+    client.recognizeFormula(variants.first());
+    QVERIFY(errorSpy.wait(5000));
+    QCOMPARE(successSpy.count(), 0);
+    QCOMPARE(server.errorCount(), 1);
+}
+
+void OllamaClientBenchmark::testStreamingChunks()
+{
+    MockOllamaServer::Options options;
+    options.chunkCount = 3;
+    options.responseText = "$$a^2 + b^2 = c^2$$";
+    server.setOptions(options);
+
+    QNetworkAccessManager manager;
+    QNetworkRequest request(QUrl(server.generateUrl()));
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    QByteArray body = R"({"model":"mock-vl","prompt":"x","stream":true})";
+
+    QNetworkReply *reply = manager.post(request, body);
+    QSignalSpy finished(reply, &QNetworkReply::finished);
+    QVERIFY(finished.wait(5000));
+
+    // 3 个内容分片 + 1 个 done 分片，拼接后还原完整文本
+    QList<QByteArray> lines = reply->readAll().trimmed().split('\n');
+    QCOMPARE(lines.size(), 4);
+    QString text;
+    for (const QByteArray &line : lines) {
+        text += QJsonDocument::fromJson(line).object()["response"].toString();
+    }
+    QCOMPARE(text, options.responseText);
+    QVERIFY(QJsonDocument::fromJson(lines.last()).object()["done"].toBool());
+    reply->deleteLater();
+}
+
+void OllamaClientBenchmark::testMetricsEmitted()
+{
+    OllamaClient client;
+    client.updateSettings(server.generateUrl(), "mock-vl");
+    QSignalSpy metricsSpy(&client, &OllamaClient::requestMetrics);
+    QSignalSpy successSpy(&client, &OllamaClient::recognitionSuccess);
+
+    client.recognizeFormula(variants.first());
+    QVERIFY(successSpy.wait(5000));
+    QCOMPARE(metricsSpy.count(), 1);
+
+    RecognitionMetrics metrics = metricsSpy.takeFirst().at(0).value<RecognitionMetrics>();
+    QCOMPARE(metrics.imageBytes, qint64(samplePng.size()));
+    QVERIFY(metrics.payloadBytes > metrics.imageBytes);
+    QCOMPARE(metrics.codec, QString("png-default"));
+}
+
+void OllamaClientBenchmark::testCoalescing()
+{
+    MockOllamaServer::Options options;
+    options.latencyMs = 100;
+    server.setOptions(options);
+
+    OllamaClient client;
+    client.updateSettings(server.generateUrl(), "mock-vl");
+    QSignalSpy finishedSpy(&client, &OllamaClient::requestFinished);
+    QSignalSpy successSpy(&client, &OllamaClient::recognitionSuccess);
+    QSignalSpy metricsSpy(&client, &OllamaClient::requestMetrics);
+
+    // 同一张图连续提交两次：共用一次网络调用
+    quint64 first = client.recognizeFormula(variants.first());
+    quint64 second = client.recognizeFormula(variants.first());
+    QVERIFY(second > first);
+    QCOMPARE(client.inFlightCount(), 1);
+
+    QVERIFY(waitForResults(client, 2));
+    QCOMPARE(server.requestCount(), 1);
+    QCOMPARE(finishedSpy.count(), 2);
+    QCOMPARE(successSpy.count(), 1);
+    QCOMPARE(metricsSpy.takeFirst().at(0).value<RecognitionMetrics>().coalesced, 1);
+
+    // 完成后再提交相同的图会重新请求（只合并进行中的请求）
+    client.recognizeFormula(variants.first());
+    QVERIFY(waitForResults(client, 1));
+    QCOMPARE(server.requestCount(), 2);
+}
+
+void OllamaClientBenchmark::testStaleResultDropped()
+{
+    MockOllamaServer::Options options;
+    options.latencyMs = 50;
+    server.setOptions(options);
+
+    OllamaClient client;
+    client.updateSettings(server.generateUrl(), "mock-vl");
+    QSignalSpy finishedSpy(&client, &OllamaClient::requestFinished);
+    QSignalSpy successSpy(&client, &OllamaClient::recognitionSuccess);
+
+    quint64 stale = client.recognizeFormula(variants.at(0));
+    quint64 latest = client.recognizeFormula(variants.at(1));
+    QCOMPARE(client.latestRequestId(), latest);
+
+    QVERIFY(waitForResults(client, 2));
+    QCOMPARE(server.requestCount(), 2);
+    QCOMPARE(finishedSpy.count(), 2);
+    // 旧请求的结果不会发到界面上
+    QCOMPARE(successSpy.count(), 1);
+
+    QList<quint64> finishedIds;
+    for (const QList<QVariant> &args : finishedSpy) {
+        finishedIds << args.at(0).value<quint64>();
+    }
+    QVERIFY(finishedIds.contains(stale));
+    QVERIFY(finishedIds.contains(latest));
+}
+
+void OllamaClientBenchmark::testResponseCleaned()
+{
+    MockOllamaServer::Options options;
+    options.responseText = "Here is the formula:\n```latex\nE = mc^2\n```";
+    server.setOptions(options);
+
+    OllamaClient client;
+    client.updateSettings(server.generateUrl(), "mock-vl");
+    QSignalSpy spy(&client, &OllamaClient::recognitionSuccess);
+
+    client.recognizeFormula(variants.first());
+    QVERIFY(spy.wait(5000));
+    QCOMPARE(spy.takeFirst().at(0).toString(), QString("$$E = mc^2$$"));
+    QCOMPARE(server.requestCount(), 1);
+}
+
+void OllamaClientBenchmark::testReaskOnInvalid()
+{
+    // 模拟服务器总是返回同样不配对的结果
+    MockOllamaServer::Options options;
+    options.responseText = "$$\\frac{a}{b$$";
+    server.setOptions(options);
+
+    OllamaClient client;
+    client.updateSettings(server.generateUrl(), "mock-vl");
+    QSignalSpy successSpy(&client, &OllamaClient::recognitionSuccess);
+    QSignalSpy metricsSpy(&client, &OllamaClient::requestMetrics);
+
+    client.recognizeFormula(variants.first());
+    QVERIFY(successSpy.wait(5000));
+    // 只重新提问一次，之后保留第一次的结果并给出问题描述
+    QCOMPARE(server.requestCount(), 2);
+    QCOMPARE(successSpy.takeFirst().at(0).toString(), options.responseText);
+    QVERIFY(QJsonDocument::fromJson(server.lastRequestBody()).object()["prompt"].toString().contains("malformed"));
+    RecognitionMetrics metrics = metricsSpy.takeFirst().at(0).value<RecognitionMetrics>();
+    QVERIFY(metrics.reasked);
+    QVERIFY(!metrics.validationError.isEmpty());
+
+    // 关闭后不再重新提问
+    server.resetStats();
+    client.setReaskOnInvalid(false);
+    client.recognizeFormula(variants.at(1));
+    QVERIFY(successSpy.wait(5000));
+    QCOMPARE(server.requestCount(), 1);
+}
+
+void OllamaClientBenchmark::testStructuredOutput()
+{
+    MockOllamaServer::Options options;
+    options.chunkCount = 6;
+    options.responseText = "{\"formulas\":[{\"latex\":\"E = mc^2\",\"display\":true,\"confidence\":0.8},"
+                           "{\"latex\":\"x\",\"display\":false,\"confidence\":0.5}]}";
+    server.setOptions(options);
+
+    OllamaClient client;
+    client.updateSettings(server.generateUrl(), "mock-vl");
+    client.setOutputMode("json");
+    QSignalSpy successSpy(&client, &OllamaClient::recognitionSuccess);
+    QSignalSpy metricsSpy(&client, &OllamaClient::requestMetrics);
+
+    client.recognizeFormula(variants.first());
+    QVERIFY(successSpy.wait(5000));
+    QCOMPARE(successSpy.takeFirst().at(0).toString(), QString("$$E = mc^2$$\n$x$"));
+    QCOMPARE(metricsSpy.takeFirst().at(0).value<RecognitionMetrics>().confidence, 0.5);
+
+    // 请求体带 Schema 并要求流式返回
+    QJsonObject request = QJsonDocument::fromJson(server.lastRequestBody()).object();
+    QVERIFY(request["format"].isObject());
+    QVERIFY(request["stream"].toBool());
+}
+
+void OllamaClientBenchmark::testGenerationOptions()
+{
+    OllamaClient client;
+    client.updateSettings(server.generateUrl(), "mock-vl");
+    QSignalSpy successSpy(&client, &OllamaClient::recognitionSuccess);
+    QSignalSpy metricsSpy(&client, &OllamaClient::requestMetrics);
+
+    // 默认 auto 模式：按 640×160 的选区估算
+    client.recognizeFormula(variants.first());
+    QVERIFY(successSpy.wait(5000));
+    QJsonObject options = QJsonDocument::fromJson(server.lastRequestBody()).object()["options"].toObject();
+    const QSize size = variants.first().size();
+    QCOMPARE(options["num_predict"].toInt(), GenerationOptions::estimateNumPredict(size, false));
+    QCOMPARE(options["num_ctx"].toInt(), 2048);
+    QCOMPARE(options["temperature"].toDouble(), 0.0);
+    QVERIFY(options.contains("stop"));
+
+    RecognitionMetrics metrics = metricsSpy.takeFirst().at(0).value<RecognitionMetrics>();
+    QCOMPARE(metrics.numPredict, options["num_predict"].toInt());
+    QCOMPARE(metrics.doneReason, QString("stop"));
+    QCOMPARE(metrics.evalCount, 3);   // "$$E = mc^2$$"，4 字符一个 token
+
+    // off 模式不发送 options
+    GenerationOptions::Settings settings;
+    settings.mode = "off";
+    client.setGenerationSettings(settings);
+    client.recognizeFormula(variants.at(1));
+    QVERIFY(successSpy.wait(5000));
+    QVERIFY(!QJsonDocument::fromJson(server.lastRequestBody()).object().contains("options"));
+}
+
+void OllamaClientBenchmark::testTruncatedOutputReasked()
+{
+    // 输出远超估算的上限：第一次在 num_predict 处截断，重新提问时上限放宽一倍
+    MockOllamaServer::Options options;
+    options.responseText = "$$" + QString("x+").repeated(2000) + "1$$";
+    server.setOptions(options);
+
+    OllamaClient client;
+    client.updateSettings(server.generateUrl(), "mock-vl");
+    QSignalSpy successSpy(&client, &OllamaClient::recognitionSuccess);
+    QSignalSpy metricsSpy(&client, &OllamaClient::requestMetrics);
+
+    client.recognizeFormula(variants.first());
+    QVERIFY(successSpy.wait(5000));
+    QCOMPARE(server.requestCount(), 2);
+
+    const int firstLimit = GenerationOptions::estimateNumPredict(variants.first().size(), false);
+    QJsonObject retryOptions = QJsonDocument::fromJson(server.lastRequestBody()).object()["options"].toObject();
+    QCOMPARE(retryOptions["num_predict"].toInt(), firstLimit * 2);
+
+    RecognitionMetrics metrics = metricsSpy.takeFirst().at(0).value<RecognitionMetrics>();
+    QVERIFY(metrics.reasked);
+    QCOMPARE(metrics.doneReason, QString("length"));
+    QCOMPARE(metrics.evalCount, firstLimit * 3);
+    QVERIFY(!metrics.validationError.isEmpty());
+}
+
+void OllamaClientBenchmark::testTiledRecognition()
+{
+    // 每个请求 200 ms：三行并行识别，总耗时接近一行而不是三行
+    MockOllamaServer::Options options;
+    options.latencyMs = 200;
+    server.setOptions(options);
+
+    // 三行宽度不同的横条，切分后的子图内容互不相同
+    QImage page(640, 400, QImage::Format_RGB32);
+    page.fill(Qt::white);
+    QPainter painter(&page);
+    for (int i = 0; i < 3; ++i) {
+        painter.fillRect(40, 40 + i * 120, 200 + i * 100, 40, Qt::black);
+    }
+    painter.end();
+
+    OllamaClient client;
+    client.updateSettings(server.generateUrl(), "mock-vl");
+    QSignalSpy finishedSpy(&client, &OllamaClient::requestFinished);
+    QSignalSpy successSpy(&client, &OllamaClient::recognitionSuccess);
+    QSignalSpy metricsSpy(&client, &OllamaClient::requestMetrics);
+
+    const quint64 requestId = client.recognizeFormula(QPixmap::fromImage(page));
+    QCOMPARE(client.inFlightCount(), 3);
+    QVERIFY(successSpy.wait(5000));
+    QCOMPARE(server.requestCount(), 3);
+    QCOMPARE(successSpy.takeFirst().at(0).toString(), QString("$$E = mc^2$$\n$$E = mc^2$$\n$$E = mc^2$$"));
+
+    // 子请求不单独报告结果
+    QCOMPARE(finishedSpy.count(), 1);
+    QCOMPARE(finishedSpy.first().at(0).value<quint64>(), requestId);
+    RecognitionMetrics metrics = metricsSpy.takeFirst().at(0).value<RecognitionMetrics>();
+    QCOMPARE(metrics.requestId, requestId);
+    QCOMPARE(metrics.segments, 3);
+    QCOMPARE(metrics.evalCount, 9);
+    QVERIFY(metrics.networkMs < 3 * options.latencyMs);
+
+    // 关闭版面分析后整张图一次请求
+    LayoutAnalyzer::Settings settings;
+    settings.enabled = false;
+    client.setLayoutSettings(settings);
+    server.resetStats();
+    client.recognizeFormula(QPixmap::fromImage(page));
+    QVERIFY(successSpy.wait(5000));
+    QCOMPARE(server.requestCount(), 1);
+    QCOMPARE(metricsSpy.takeFirst().at(0).value<RecognitionMetrics>().segments, 0);
+}
+
+void OllamaClientBenchmark::testConnectionReuse()
+{
+    OllamaClient client;
+    client.updateSettings(server.generateUrl(), "mock-vl");
+    QSignalSpy metricsSpy(&client, &OllamaClient::requestMetrics);
+
+    // 依次发出的请求复用同一个连接
+    for (int i = 0; i < 4; ++i) {
+        client.recognizeFormula(variants.at(i));
+        QVERIFY(waitForResults(client, 1));
+    }
+    QCOMPARE(server.connectionCount(), 1);
+    QCOMPARE(metricsSpy.count(), 4);
+    const RecognitionMetrics metrics = metricsSpy.last().at(0).value<RecognitionMetrics>();
+    QVERIFY(metrics.firstByteMs >= 0);
+    QVERIFY(!metrics.http2);   // 明文端点不协商 HTTP/2
+
+    // 关闭持久连接后每个请求都新建连接（新的客户端，不复用上面已建立的连接）
+    server.resetStats();
+    OllamaClient closing;
+    closing.updateSettings(server.generateUrl(), "mock-vl");
+    OllamaTransport::Settings settings;
+    settings.keepAlive = false;
+    closing.setTransportSettings(settings);
+    for (int i = 0; i < 4; ++i) {
+        closing.recognizeFormula(variants.at(i));
+        QVERIFY(waitForResults(closing, 1));
+    }
+    QCOMPARE(server.requestCount(), 4);
+    QCOMPARE(server.connectionCount(), 4);
+}
+
+void OllamaClientBenchmark::testPreconnect()
+{
+    OllamaClient client;
+    client.updateSettings(server.generateUrl(), "mock-vl");
+
+    // 预连接只建立连接，不发请求；之后的识别请求使用这个连接
+    client.warmUp();
+    QTRY_COMPARE(server.connectionCount(), 1);
+    QCOMPARE(server.requestCount(), 0);
+
+    client.recognizeFormula(variants.first());
+    QVERIFY(waitForResults(client, 1));
+    QCOMPARE(server.requestCount(), 1);
+    QCOMPARE(server.connectionCount(), 1);
+
+    // 关闭预连接时 warmUp 不做任何事
+    server.resetStats();
+    OllamaClient cold;
+    cold.updateSettings(server.generateUrl(), "mock-vl");
+    OllamaTransport::Settings settings;
+    settings.preconnect = false;
+    cold.setTransportSettings(settings);
+    cold.warmUp();
+    QTest::qWait(100);
+    QCOMPARE(server.connectionCount(), 0);
+}
+
+void OllamaClientBenchmark::testCascade()
+{
+    // 小模型 50 ms，大模型 300 ms
+    MockOllamaServer::Options options;
+    options.models["mock-small"] = {50, "$$x^2 + 1$$"};
+    options.models["mock-large"] = {300, "$$x^{2} + 1$$"};
+    server.setOptions(options);
+
+    OllamaClient client;
+    client.updateSettings(server.generateUrl(), "mock-large");
+    CascadePolicy::Settings cascade;
+    cascade.enabled = true;
+    cascade.fastModel = "mock-small";
+    client.setCascadeSettings(cascade);
+    QSignalSpy successSpy(&client, &OllamaClient::recognitionSuccess);
+    QSignalSpy metricsSpy(&client, &OllamaClient::requestMetrics);
+
+    // 小模型的输出通过检查：直接采用
+    client.recognizeFormula(variants.at(0));
+    QVERIFY(successSpy.wait(5000));
+    QCOMPARE(successSpy.takeFirst().at(0).toString(), QString("$$x^2 + 1$$"));
+    RecognitionMetrics metrics = metricsSpy.takeFirst().at(0).value<RecognitionMetrics>();
+    QCOMPARE(metrics.tier, QString("fast"));
+    QVERIFY(!metrics.escalated);
+    QVERIFY(metrics.networkMs < 300);
+    QCOMPARE(server.requestCount(), 1);
+    QVERIFY(server.lastRequestBody().contains("\"model\":\"mock-small\""));
+
+    // 括号不配对：不重新提问，升级到大模型
+    options.models["mock-small"].responseText = "$$\\frac{a}{b$$";
+    server.setOptions(options);
+    server.resetStats();
+    client.recognizeFormula(variants.at(1));
+    QVERIFY(successSpy.wait(5000));
+    QCOMPARE(successSpy.takeFirst().at(0).toString(), QString("$$x^{2} + 1$$"));
+    metrics = metricsSpy.takeFirst().at(0).value<RecognitionMetrics>();
+    QCOMPARE(metrics.tier, QString("full"));
+    QVERIFY(metrics.escalated);
+    QVERIFY(!metrics.escalationReason.isEmpty());
+    QVERIFY(metrics.networkMs >= 350);
+    QCOMPARE(server.requestCount(), 2);
+    QVERIFY(server.lastRequestBody().contains("\"model\":\"mock-large\""));
+
+    // 未知模型（小模型未下载）同样升级
+    options.models.remove("mock-small");
+    server.setOptions(options);
+    cascade.fastModel = "mock-missing";
+    client.setCascadeSettings(cascade);
+    client.recognizeFormula(variants.at(2));
+    QVERIFY(successSpy.wait(5000));
+    QCOMPARE(metricsSpy.takeFirst().at(0).value<RecognitionMetrics>().tier, QString("full"));
+
+    const CascadePolicy::Stats stats = client.cascadeStats();
+    QCOMPARE(stats.fastAccepted, 1);
+    QCOMPARE(stats.escalated, 2);
+}
+
+void OllamaClientBenchmark::testOpenAiEndpoint()
+{
+    MockOllamaServer::Options options;
+    options.chunkCount = 3;
+    options.responseText = "$$a^2 + b^2 = c^2$$";
+    server.setOptions(options);
+
+    OllamaClient client;
+    client.updateSettings(server.openAiUrl(), "mock-vl");
+    client.setApi("openai");
+    QCOMPARE(client.api(), QString("openai"));
+    QSignalSpy successSpy(&client, &OllamaClient::recognitionSuccess);
+    QSignalSpy metricsSpy(&client, &OllamaClient::requestMetrics);
+
+    client.recognizeFormula(variants.first());
+    QVERIFY(successSpy.wait(5000));
+    // SSE 各内容片段按顺序拼接
+    QCOMPARE(successSpy.takeFirst().at(0).toString(), QString("$$a^2 + b^2 = c^2$$"));
+
+    // 图像是 content 中的 data URL 片段，生成参数在顶层
+    const QJsonObject request = QJsonDocument::fromJson(server.lastRequestBody()).object();
+    QVERIFY(request["stream"].toBool());
+    QVERIFY(request["stream_options"].toObject()["include_usage"].toBool());
+    QVERIFY(!request.contains("options"));
+    QVERIFY(request["max_tokens"].toInt() > 0);
+    const QJsonArray content = request["messages"].toArray().first().toObject()["content"].toArray();
+    QCOMPARE(content.size(), 2);
+    const QString url = content.at(0).toObject()["image_url"].toObject()["url"].toString();
+    QVERIFY(url.startsWith("data:image/png;base64,"));
+    QCOMPARE(url.size() - url.indexOf(',') - 1, sampleBase64.size());
+
+    // usage 事件与 timings 中的统计字段
+    const RecognitionMetrics metrics = metricsSpy.takeFirst().at(0).value<RecognitionMetrics>();
+    QCOMPARE(metrics.evalCount, (options.responseText.size() + 3) / 4);
+    QCOMPARE(metrics.promptEvalCount, 1);
+    QCOMPARE(metrics.doneReason, QString("stop"));
+}
+
+void OllamaClientBenchmark::testOpenAiStructuredOutput()
+{
+    MockOllamaServer::Options options;
+    options.chunkCount = 6;
+    options.responseText = "{\"formulas\":[{\"latex\":\"E = mc^2\",\"display\":true,\"confidence\":0.8},"
+                           "{\"latex\":\"x\",\"display\":false,\"confidence\":0.5}]}";
+    server.setOptions(options);
+
+    OllamaClient client;
+    client.updateSettings(server.openAiUrl(), "mock-vl");
+    client.setApi("openai");
+    client.setOutputMode("json");
+    QSignalSpy successSpy(&client, &OllamaClient::recognitionSuccess);
+    QSignalSpy metricsSpy(&client, &OllamaClient::requestMetrics);
+
+    client.recognizeFormula(variants.first());
+    QVERIFY(successSpy.wait(5000));
+    QCOMPARE(successSpy.takeFirst().at(0).toString(), QString("$$E = mc^2$$\n$x$"));
+    QCOMPARE(metricsSpy.takeFirst().at(0).value<RecognitionMetrics>().confidence, 0.5);
+
+    const QJsonObject format = QJsonDocument::fromJson(server.lastRequestBody()).object()["response_format"].toObject();
+    QCOMPARE(format["type"].toString(), QString("json_schema"));
+    QCOMPARE(format["json_schema"].toObject()["schema"].toObject(), FormulaJsonReader::schema());
+}
+
+void OllamaClientBenchmark::testOpenAiError()
+{
+    MockOllamaServer::Options options;
+    options.models.insert("mock-vl", MockOllamaServer::ModelProfile());
+    server.setOptions(options);
+
+    OllamaClient client;
+    client.updateSettings(server.openAiUrl(), "missing-model");
+    client.setApi("openai");
+    QSignalSpy errorSpy(&client, &OllamaClient::recognitionError);
+
+    client.recognizeFormula(variants.first());
+    QVERIFY(errorSpy.wait(5000));
+    // {"error":{"message":...}} 中的消息带到错误描述里
+    QVERIFY(errorSpy.takeFirst().at(0).toString().contains("model \"missing-model\" not found"));
+
+    // 未知的接口格式保持原来的后端
+    client.setApi("grpc");
+    QCOMPARE(client.api(), QString("openai"));
+}
+
+void OllamaClientBenchmark::testApiSwitchFailsInFlight()
+{
+    MockOllamaServer::Options options;
+    options.latencyMs = 300;
+    server.setOptions(options);
+
+    OllamaClient client;
+    client.updateSettings(server.generateUrl(), "mock-vl");
+    QSignalSpy finishedSpy(&client, &OllamaClient::requestFinished);
+    QSignalSpy failedSpy(&client, &OllamaClient::requestFailed);
+
+    const quint64 id = client.recognizeFormula(variants.first());
+    QTRY_COMPARE(server.requestCount(), 1);
+    // 进行中的调用按旧接口准备了请求，切换后不再等待它的结果
+    client.setApi("openai");
+    QCOMPARE(client.inFlightCount(), 0);
+    QCOMPARE(failedSpy.count(), 1);
+    QCOMPARE(failedSpy.first().at(0).toULongLong(), id);
+    QVERIFY(failedSpy.first().at(1).toString().contains("Inference API changed"));
+    QTRY_COMPARE(server.abandonedCount(), 1);
+
+    // 接口没有变化时不影响进行中的请求
+    client.updateSettings(server.openAiUrl(), "mock-vl");
+    client.recognizeFormula(variants.at(1));
+    client.setApi("openai");
+    QVERIFY(waitForResults(client, 1));
+    QCOMPARE(finishedSpy.count(), 1);
+    QCOMPARE(failedSpy.count(), 1);
+}
+
+void OllamaClientBenchmark::testLocalUnavailable()
+{
+    if (LlamaEngine::isAvailable()) {
+        QSKIP("built with llama.cpp");
+    }
+    // 未编译进程内推理时保持原来的接口，识别照常走网络
+    OllamaClient client;
+    client.updateSettings(server.generateUrl(), "mock-vl");
+    client.setApi("llama");
+    QCOMPARE(client.api(), QString("ollama"));
+    QSignalSpy successSpy(&client, &OllamaClient::recognitionSuccess);
+    client.recognizeFormula(variants.first());
+    QVERIFY(successSpy.wait(5000));
+}
+
+void OllamaClientBenchmark::testRuntimeOptionsSent()
+{
+    OllamaClient client;
+    client.updateSettings(server.generateUrl(), "mock-vl");
+    RuntimeOptions::Settings settings;
+    settings.numThread = 6;
+    settings.numBatch = 1024;
+    client.setRuntimeOptions(settings);
+    QSignalSpy successSpy(&client, &OllamaClient::recognitionSuccess);
+
+    client.recognizeFormula(variants.first());
+    QVERIFY(successSpy.wait(5000));
+    const QJsonObject options = QJsonDocument::fromJson(server.lastRequestBody()).object()["options"].toObject();
+    QCOMPARE(options["num_thread"].toInt(), 6);
+    QCOMPARE(options["num_batch"].toInt(), 1024);
+    // 生成参数不受影响
+    QVERIFY(options.contains("num_predict"));
+}
+
+void OllamaClientBenchmark::testCalibration()
+{
+    // 服务端默认 12 线程，6 线程最快
+    MockOllamaServer::Options options;
+    options.optimalThreads = 6;
+    options.defaultThreads = 12;
+    options.threadPenaltyMs = 25;
+    server.setOptions(options);
+
+    TuningCalibrator calibrator;
+    calibrator.setEndpoint(server.generateUrl(), "mock-vl");
+    calibrator.setImages({variants.first().toImage()});
+    calibrator.setRepetitions(1);
+    calibrator.setThreadCandidates({4, 6, 8, 12});
+    calibrator.setBatchCandidates({256});
+    QSignalSpy finishedSpy(&calibrator, &TuningCalibrator::finished);
+
+    calibrator.start();
+    QVERIFY(finishedSpy.wait(30000));
+    const TuningCalibrator::Result result = finishedSpy.takeFirst().at(0).value<TuningCalibrator::Result>();
+    QVERIFY2(result.ok, qPrintable(result.errorString));
+    // 默认值 + 4 个线程数 + 1 个批大小 + mmap/mlock 两项
+    QCOMPARE(result.trials.size(), 8);
+    QCOMPARE(result.best.numThread, 6);
+    QVERIFY(result.bestMs < result.baselineMs);
+    // 每组参数一个预热请求加一个计时请求
+    QCOMPARE(server.requestCount(), 16);
+    QVERIFY(TuningCalibrator::report(result).contains("best: threads=6"));
+
+    // 没有指定候选时只有本机端点按本机拓扑扫描线程数，远程端点跳过
+    HardwareInfo::Info hardware;
+    hardware.logicalCpus = 32;
+    hardware.physicalCores = 16;
+    QCOMPARE(TuningCalibrator::defaultThreadCandidates("http://localhost:11434/api/generate", hardware),
+             TuningCalibrator::threadCandidates(hardware));
+    QVERIFY(TuningCalibrator::defaultThreadCandidates("http://cpu-box:11434/api/generate", hardware).isEmpty());
+}
+
+void OllamaClientBenchmark::testSchedulerPriority()
+{
+    MockOllamaServer::Options options;
+    options.latencyMs = 100;
+    server.setOptions(options);
+
+    OllamaClient client;
+    client.updateSettings(server.generateUrl(), "mock-vl");
+    RecognitionScheduler scheduler(&client);
+    RecognitionScheduler::Settings settings;
+    settings.bulkLimit = 1;
+    scheduler.setSettings(settings);
+    QSignalSpy successSpy(&client, &OllamaClient::recognitionSuccess);
+    QSignalSpy finishedSpy(&scheduler, &RecognitionScheduler::jobFinished);
+
+    QStringList events;
+    connect(&scheduler, &RecognitionScheduler::jobStarted, this, [&](quint64 jobId) {
+        events << QString("start %1").arg(jobId);
+    });
+    connect(&scheduler, &RecognitionScheduler::jobFinished, this, [&](quint64 jobId) {
+        events << QString("finish %1").arg(jobId);
+    });
+
+    // 批量任务占满上限后排队，交互截图不必等它们
+    QList<quint64> bulk;
+    for (int i = 0; i < 4; ++i) {
+        bulk << scheduler.submit(variants.at(i), RecognitionScheduler::Bulk);
+    }
+    QCOMPARE(scheduler.runningCount(RecognitionScheduler::Bulk), 1);
+    QCOMPARE(scheduler.queuedCount(RecognitionScheduler::Bulk), 3);
+    const quint64 interactive = scheduler.submit(variants.at(4), RecognitionScheduler::Interactive);
+    QCOMPARE(scheduler.runningCount(RecognitionScheduler::Interactive), 1);
+    QCOMPARE(scheduler.stats(RecognitionScheduler::Interactive).maxWaitMs, 0);
+    QCOMPARE(client.inFlightCount(), 2);
+
+    QTRY_COMPARE_WITH_TIMEOUT(finishedSpy.count(), 5, 10000);
+    // 交互任务进行中时第二个批量任务不会发出
+    QVERIFY(events.indexOf(QString("finish %1").arg(interactive))
+            < events.indexOf(QString("start %1").arg(bulk.at(1))));
+    // 批量任务的结果不发到界面上，也不会让交互截图的结果被当作过时丢弃
+    QCOMPARE(successSpy.count(), 1);
+
+    const RecognitionScheduler::ClassStats bulkStats = scheduler.stats(RecognitionScheduler::Bulk);
+    QCOMPARE(bulkStats.started, 4);
+    QCOMPARE(bulkStats.finished, 4);
+    QVERIFY(bulkStats.maxWaitMs >= 150);
+    QVERIFY(scheduler.statsSummary().contains("bulk 4 started"));
+}
+
+void OllamaClientBenchmark::testSchedulerSupersedesQueued()
+{
+    MockOllamaServer::Options options;
+    options.latencyMs = 100;
+    server.setOptions(options);
+
+    OllamaClient client;
+    client.updateSettings(server.generateUrl(), "mock-vl");
+    RecognitionScheduler scheduler(&client);
+    RecognitionScheduler::Settings settings;
+    settings.interactiveLimit = 1;
+    scheduler.setSettings(settings);
+    QSignalSpy finishedSpy(&scheduler, &RecognitionScheduler::jobFinished);
+    QSignalSpy cancelledSpy(&scheduler, &RecognitionScheduler::jobCancelled);
+
+    // 第二次截图还在排队时又截了一次：只有最新的会发出
+    scheduler.submit(variants.at(0), RecognitionScheduler::Interactive);
+    const quint64 superseded = scheduler.submit(variants.at(1), RecognitionScheduler::Interactive);
+    const quint64 latest = scheduler.submit(variants.at(2), RecognitionScheduler::Interactive);
+    QCOMPARE(cancelledSpy.count(), 1);
+    QCOMPARE(cancelledSpy.takeFirst().at(0).value<quint64>(), superseded);
+
+    QTRY_COMPARE_WITH_TIMEOUT(finishedSpy.count(), 2, 10000);
+    QCOMPARE(finishedSpy.at(1).at(0).value<quint64>(), latest);
+    QCOMPARE(server.requestCount(), 2);
+    QCOMPARE(scheduler.stats(RecognitionScheduler::Interactive).cancelled, 1);
+}
+
+void OllamaClientBenchmark::testCancelRequest()
+{
+    MockOllamaServer::Options options;
+    options.latencyMs = 300;
+    server.setOptions(options);
+
+    OllamaClient client;
+    client.updateSettings(server.generateUrl(), "mock-vl");
+    QSignalSpy finishedSpy(&client, &OllamaClient::requestFinished);
+    QSignalSpy failedSpy(&client, &OllamaClient::requestFailed);
+    QSignalSpy cancelledSpy(&client, &OllamaClient::requestCancelled);
+
+    const quint64 id = client.recognizeFormula(variants.first());
+    QTRY_COMPARE(server.requestCount(), 1);
+    QVERIFY(client.cancelRequest(id));
+    QCOMPARE(cancelledSpy.count(), 1);
+    QCOMPARE(client.inFlightCount(), 0);
+    // 连接被关闭：服务端在生成完成之前就得知请求已被放弃
+    QTRY_COMPARE(server.abandonedCount(), 1);
+
+    QTest::qWait(400);
+    QCOMPARE(finishedSpy.count(), 0);
+    QCOMPARE(failedSpy.count(), 0);
+    QVERIFY(!client.cancelRequest(id));
+
+    // 取消之后的请求正常完成
+    client.recognizeFormula(variants.at(1));
+    QVERIFY(waitForResults(client, 1));
+    QCOMPARE(finishedSpy.count(), 1);
+}
+
+void OllamaClientBenchmark::testCancelCoalesced()
+{
+    MockOllamaServer::Options options;
+    options.latencyMs = 100;
+    server.setOptions(options);
+
+    OllamaClient client;
+    client.updateSettings(server.generateUrl(), "mock-vl");
+    QSignalSpy finishedSpy(&client, &OllamaClient::requestFinished);
+
+    // 合并在同一次调用上的另一个请求仍需要结果：调用不中止
+    const quint64 first = client.recognizeFormula(variants.first());
+    const quint64 second = client.recognizeFormula(variants.first());
+    QVERIFY(client.cancelRequest(first));
+    QCOMPARE(client.inFlightCount(), 1);
+
+    QVERIFY(waitForResults(client, 1));
+    QCOMPARE(finishedSpy.count(), 1);
+    QCOMPARE(finishedSpy.takeFirst().at(0).value<quint64>(), second);
+    QCOMPARE(server.abandonedCount(), 0);
+}
+
+void OllamaClientBenchmark::testSupersededCancelled()
+{
+    MockOllamaServer::Options options;
+    options.latencyMs = 200;
+    server.setOptions(options);
+
+    OllamaClient client;
+    client.updateSettings(server.generateUrl(), "mock-vl");
+    RecognitionScheduler scheduler(&client);
+    RecognitionScheduler::Settings settings;
+    settings.backgroundLimit = 2;
+    settings.cancelSuperseded = true;
+    scheduler.setSettings(settings);
+    QSignalSpy finishedSpy(&scheduler, &RecognitionScheduler::jobFinished);
+    QSignalSpy cancelledSpy(&scheduler, &RecognitionScheduler::jobCancelled);
+
+    const quint64 stale = scheduler.submit(variants.at(0), RecognitionScheduler::Interactive);
+    QTRY_COMPARE(server.requestCount(), 1);
+    scheduler.submit(variants.at(1), RecognitionScheduler::Interactive);
+    QCOMPARE(cancelledSpy.count(), 1);
+    QCOMPARE(cancelledSpy.takeFirst().at(0).value<quint64>(), stale);
+    QTRY_COMPARE(server.abandonedCount(), 1);
+    QTRY_COMPARE(finishedSpy.count(), 1);
+
+    // 监视区域的新帧只取代监视区域的任务，不中止用户的截图
+    const quint64 interactive = scheduler.submit(variants.at(2), RecognitionScheduler::Interactive);
+    const quint64 frame = scheduler.submit(variants.at(3), RecognitionScheduler::Background);
+    scheduler.submit(variants.at(4), RecognitionScheduler::Background);
+    QCOMPARE(cancelledSpy.count(), 1);
+    QCOMPARE(cancelledSpy.takeFirst().at(0).value<quint64>(), frame);
+    QTRY_COMPARE(finishedSpy.count(), 3);
+    QVERIFY(finishedSpy.at(1).at(0).value<quint64>() == interactive
+            || finishedSpy.at(2).at(0).value<quint64>() == interactive);
+
+    // 与新请求是同一张图时合并，不取消
+    scheduler.submit(variants.at(2), RecognitionScheduler::Interactive);
+    scheduler.submit(variants.at(2), RecognitionScheduler::Interactive);
+    QTRY_COMPARE(finishedSpy.count(), 5);
+    QCOMPARE(cancelledSpy.count(), 0);
+}
+
+void OllamaClientBenchmark::testSchedulerSynchronousFailures()
+{
+    OllamaClient client;
+    client.updateSettings(server.generateUrl(), "mock-vl");
+    RecognitionScheduler scheduler(&client);
+    RecognitionScheduler::Settings settings;
+    settings.bulkLimit = 1;
+    scheduler.setSettings(settings);
+    QSignalSpy startedSpy(&scheduler, &RecognitionScheduler::jobStarted);
+    QSignalSpy failedSpy(&scheduler, &RecognitionScheduler::jobFailed);
+    // 失败的信号中再提交任务：嵌套的 dispatch 不能在 start 返回之前发出下一个任务
+    connect(&scheduler, &RecognitionScheduler::jobFailed, &scheduler, [&scheduler, &failedSpy]() {
+        if (failedSpy.count() < 3) {
+            scheduler.submit(QPixmap(), RecognitionScheduler::Bulk);
+        }
+    });
+
+    // 空图像在 OllamaClient 返回请求 id 之前就失败
+    scheduler.submit(QPixmap(), RecognitionScheduler::Bulk);
+    QCOMPARE(startedSpy.count(), 3);
+    QCOMPARE(failedSpy.count(), 3);
+    QCOMPARE(scheduler.runningCount(RecognitionScheduler::Bulk), 0);
+    QCOMPARE(scheduler.queuedCount(RecognitionScheduler::Bulk), 0);
+    QCOMPARE(scheduler.stats(RecognitionScheduler::Bulk).finished, 3);
+}
+
+void OllamaClientBenchmark::testSchedulerIgnoresForeignRequests()
+{
+    OllamaClient client;
+    client.updateSettings(server.generateUrl(), "mock-vl");
+    RecognitionScheduler scheduler(&client);
+    QSignalSpy finishedSpy(&scheduler, &RecognitionScheduler::jobFinished);
+    QSignalSpy failedSpy(&scheduler, &RecognitionScheduler::jobFailed);
+
+    // 不是经由调度发出的请求：成功和失败都不影响调度的状态
+    emit client.requestFinished(999, "x");
+    emit client.requestFailed(999, "error");
+    QSignalSpy clientSpy(&client, &OllamaClient::requestFinished);
+    client.recognizeFormula(variants.first());
+    QTRY_COMPARE(clientSpy.count(), 1);
+    QCOMPARE(finishedSpy.count(), 0);
+    QCOMPARE(failedSpy.count(), 0);
+    QCOMPARE(scheduler.runningCount(RecognitionScheduler::Interactive), 0);
+
+    // 之后经由调度发出的任务照常完成
+    const quint64 job = scheduler.submit(variants.first(), RecognitionScheduler::Interactive);
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QCOMPARE(finishedSpy.at(0).at(0).value<quint64>(), job);
+    QCOMPARE(scheduler.stats(RecognitionScheduler::Interactive).finished, 1);
+}
+
+void OllamaClientBenchmark::testSchedulerPreemptBulk()
+{
+    MockOllamaServer::Options options;
+    options.latencyMs = 200;
+    server.setOptions(options);
+
+    OllamaClient client;
+    client.updateSettings(server.generateUrl(), "mock-vl");
+    RecognitionScheduler scheduler(&client);
+    RecognitionScheduler::Settings settings;
+    settings.bulkLimit = 1;
+    settings.preemptBulk = true;
+    scheduler.setSettings(settings);
+    QSignalSpy finishedSpy(&scheduler, &RecognitionScheduler::jobFinished);
+    QSignalSpy cancelledSpy(&scheduler, &RecognitionScheduler::jobCancelled);
+
+    const quint64 bulk = scheduler.submit(variants.at(0), RecognitionScheduler::Bulk);
+    QTRY_COMPARE(server.requestCount(), 1);
+    // 交互截图到达：进行中的批量请求被中止并重新排队，服务端的推理资源让给交互截图
+    const quint64 interactive = scheduler.submit(variants.at(1), RecognitionScheduler::Interactive);
+    QCOMPARE(scheduler.runningCount(RecognitionScheduler::Bulk), 0);
+    QCOMPARE(scheduler.queuedCount(RecognitionScheduler::Bulk), 1);
+    QCOMPARE(scheduler.stats(RecognitionScheduler::Bulk).preempted, 1);
+    QTRY_COMPARE(server.abandonedCount(), 1);
+
+    QTRY_COMPARE_WITH_TIMEOUT(finishedSpy.count(), 2, 10000);
+    QCOMPARE(finishedSpy.at(0).at(0).value<quint64>(), interactive);
+    QCOMPARE(finishedSpy.at(1).at(0).value<quint64>(), bulk);
+    QCOMPARE(cancelledSpy.count(), 0);
+    QCOMPARE(server.requestCount(), 3);
+
+    // 取消进行中的任务
+    const quint64 cancelled = scheduler.submit(variants.at(2), RecognitionScheduler::Interactive);
+    QVERIFY(scheduler.cancel(cancelled));
+    QCOMPARE(cancelledSpy.count(), 1);
+    QCOMPARE(scheduler.runningCount(RecognitionScheduler::Interactive), 0);
+    QVERIFY(!scheduler.cancel(cancelled));
+}
+
+void OllamaClientBenchmark::testSchedulerDefersWhenUnreachable()
+{
+    // 服务端停止：端口上没有监听，连接被拒绝
+    MockOllamaServer outage;
+    QVERIFY(outage.start());
+    const quint16 port = outage.port();
+    outage.stop();
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    JobJournal journal;
+    QVERIFY(journal.open(dir.filePath("jobs.journal")));
+
+    OllamaClient client;
+    client.updateSettings(QString("http://127.0.0.1:%1/api/generate").arg(port), "mock-vl");
+    RecognitionScheduler scheduler(&client);
+    RecognitionScheduler::Settings settings;
+    settings.healthIntervalMs = 100;
+    scheduler.setSettings(settings);
+    scheduler.setJournal(&journal);
+    QSignalSpy deferredSpy(&scheduler, &RecognitionScheduler::jobDeferred);
+    QSignalSpy failedSpy(&scheduler, &RecognitionScheduler::jobFailed);
+    QSignalSpy finishedSpy(&scheduler, &RecognitionScheduler::jobFinished);
+    QSignalSpy recoveredSpy(&scheduler, &RecognitionScheduler::jobRecovered);
+
+    // 交互截图连接失败：不报错，截图留在日志中
+    const quint64 interactive = scheduler.submit(variants.at(0), RecognitionScheduler::Interactive);
+    QTRY_COMPARE(deferredSpy.count(), 1);
+    QCOMPARE(deferredSpy.at(0).at(0).value<quint64>(), interactive);
+    QCOMPARE(failedSpy.count(), 0);
+    QCOMPARE(scheduler.deferredCount(), 1);
+    QCOMPARE(scheduler.stats(RecognitionScheduler::Interactive).deferred, 1);
+
+    // 服务端不可用期间批量任务不发出
+    const quint64 bulk = scheduler.submit(variants.at(1), RecognitionScheduler::Bulk);
+    QCOMPARE(scheduler.queuedCount(RecognitionScheduler::Bulk), 1);
+    // 截图在后台编码后才写入日志，推迟的交互任务也不例外
+    QTRY_COMPARE(journal.pendingCount(), 2);
+    QTest::qWait(300);
+    QCOMPARE(finishedSpy.count(), 0);
+
+    // 服务端在原端口恢复：探测通过后两个任务都完成，日志清空
+    MockOllamaServer restarted;
+    QVERIFY(restarted.start(port));
+    QTRY_COMPARE_WITH_TIMEOUT(finishedSpy.count(), 2, 10000);
+    QCOMPARE(failedSpy.count(), 0);
+    QCOMPARE(recoveredSpy.count(), 1);
+    QCOMPARE(recoveredSpy.at(0).at(0).value<quint64>(), interactive);
+    QVERIFY(!recoveredSpy.at(0).at(2).value<QImage>().isNull());
+    QVERIFY(finishedSpy.at(0).at(0).value<quint64>() == bulk || finishedSpy.at(1).at(0).value<quint64>() == bulk);
+    QCOMPARE(scheduler.deferredCount(), 0);
+    QCOMPARE(journal.pendingCount(), 0);
+    // 恢复的任务作为批量任务发出，不成为界面上的最新请求
+    QCOMPARE(client.latestRequestId(), quint64(1));
+
+    // 达到重试上限的任务不再推迟，按失败结束并从日志中移除
+    restarted.stop();
+    settings.maxRetries = 0;
+    scheduler.setSettings(settings);
+    const quint64 capped = scheduler.submit(variants.at(2), RecognitionScheduler::Interactive);
+    QTRY_COMPARE(failedSpy.count(), 1);
+    QCOMPARE(failedSpy.at(0).at(0).value<quint64>(), capped);
+    QVERIFY(failedSpy.at(0).at(1).toString().contains("gave up"));
+    QCOMPARE(deferredSpy.count(), 1);
+    QCOMPARE(scheduler.deferredCount(), 0);
+    QCOMPARE(journal.pendingCount(), 0);
+}
+
+void OllamaClientBenchmark::testSchedulerReplaysJournal()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("jobs.journal");
+    {
+        // 上次运行时留下的两个任务
+        JobJournal journal;
+        QVERIFY(journal.open(path));
+        JobJournal::Params params;
+        params.url = server.generateUrl();
+        params.model = "mock-vl";
+        params.outputMode = "markdown";
+        journal.append(JobJournal::encodeImage(variants.at(2).toImage()), RecognitionScheduler::Interactive, params);
+        journal.append(JobJournal::encodeImage(variants.at(3).toImage()), RecognitionScheduler::Bulk, params);
+    }
+
+    JobJournal journal;
+    QVERIFY(journal.open(path));
+    QCOMPARE(journal.pendingCount(), 2);
+
+    // 之后改了服务端和模型：重放的任务仍按入队时的参数识别
+    OllamaClient client;
+    client.updateSettings("http://127.0.0.1:1/api/generate", "other-model");
+    RecognitionScheduler scheduler(&client);
+    scheduler.setJournal(&journal);
+    QSignalSpy recoveredSpy(&scheduler, &RecognitionScheduler::jobRecovered);
+    QSignalSpy recognitionSpy(&client, &OllamaClient::recognitionSuccess);
+
+    QCOMPARE(scheduler.replay(), 2);
+    QTRY_COMPARE_WITH_TIMEOUT(recoveredSpy.count(), 2, 10000);
+    QVERIFY(recoveredSpy.at(0).at(1).toString().contains("mc^2"));
+    QCOMPARE(recoveredSpy.at(0).at(2).value<QImage>().size(), variants.at(2).size());
+    QCOMPARE(recoveredSpy.at(0).at(3).toString(), QString("mock-vl"));
+    QCOMPARE(QJsonDocument::fromJson(server.lastRequestBody()).object()["model"].toString(), QString("mock-vl"));
+    QCOMPARE(journal.pendingCount(), 0);
+    QCOMPARE(recognitionSpy.count(), 0);
+}
+
+void OllamaClientBenchmark::reportDecodeReduction()
+{
+    // 模型写完公式后继续解释：没有停止序列和生成上限时这些 token 都要解码
+    MockOllamaServer::Options options;
+    options.evalMsPerToken = 0.5;
+    options.responseText = "$$\\int_0^1 x^2 \\, dx = \\frac{1}{3}$$\n\nThis formula "
+            + QString("computes the area under the parabola between zero and one. ").repeated(20);
+    server.setOptions(options);
+
+    QTextStream out(stdout);
+    out << "\n";
+    out << QString("%1 %2 %3 %4 %5\n")
+               .arg("mode", -6).arg("num_pred", 9).arg("eval_tok", 9)
+               .arg("eval(ms)", 9).arg("total(ms)", 10);
+    int evalTokens[2] = {0, 0};
+    const QStringList modes = {"off", "auto"};
+    for (int i = 0; i < modes.size(); ++i) {
+        OllamaClient client;
+        client.updateSettings(server.generateUrl(), "mock-vl");
+        GenerationOptions::Settings settings;
+        settings.mode = modes.at(i);
+        client.setGenerationSettings(settings);
+        QSignalSpy metricsSpy(&client, &OllamaClient::requestMetrics);
+
+        client.recognizeFormula(variants.at(i));
+        QVERIFY(waitForResults(client, 1));
+        const RecognitionMetrics metrics = metricsSpy.takeFirst().at(0).value<RecognitionMetrics>();
+        evalTokens[i] = metrics.evalCount;
+        out << QString("%1 %2 %3 %4 %5\n")
+                   .arg(modes.at(i), -6).arg(metrics.numPredict, 9).arg(metrics.evalCount, 9)
+                   .arg(metrics.evalMs, 9).arg(metrics.networkMs, 10);
+    }
+    out.flush();
+    QVERIFY(evalTokens[1] < evalTokens[0]);
+}
+
+void OllamaClientBenchmark::reportCascade()
+{
+    // 9 张截图，其中每第三张小模型答错（括号不配对）需要升级
+    MockOllamaServer::Options options;
+    options.models["mock-large"] = {300, "$$x^{2} + 1$$"};
+    const int requests = 9;
+
+    QTextStream out(stdout);
+    out << "\n";
+    out << QString("%1 %2 %3 %4 %5\n")
+               .arg("mode", -11).arg("requests", 9).arg("fast_hit", 9)
+               .arg("escalated", 10).arg("total(ms)", 10);
+    qint64 totalMs[2] = {0, 0};
+    for (int mode = 0; mode < 2; ++mode) {
+        OllamaClient client;
+        client.updateSettings(server.generateUrl(), "mock-large");
+        CascadePolicy::Settings cascade;
+        cascade.enabled = mode == 1;
+        cascade.fastModel = "mock-small";
+        client.setCascadeSettings(cascade);
+        QSignalSpy metricsSpy(&client, &OllamaClient::requestMetrics);
+
+        for (int i = 0; i < requests; ++i) {
+            options.models["mock-small"] = {50, i % 3 == 0 ? "$$\\frac{a}{b$$" : "$$x^2 + 1$$"};
+            server.setOptions(options);
+            client.recognizeFormula(variants.at(i));
+            QVERIFY(waitForResults(client, 1));
+            totalMs[mode] += metricsSpy.takeFirst().at(0).value<RecognitionMetrics>().networkMs;
+        }
+
+        const CascadePolicy::Stats stats = client.cascadeStats();
+        out << QString("%1 %2 %3 %4 %5\n")
+                   .arg(mode == 0 ? "large-only" : "cascade", -11).arg(requests, 9)
+                   .arg(stats.fastAccepted, 9).arg(stats.escalated, 10).arg(totalMs[mode], 10);
+        if (mode == 1) {
+            out << "cascade stats: " << stats.summary() << "\n";
+            QCOMPARE(stats.fastAccepted, 6);
+            QCOMPARE(stats.escalated, 3);
+            QVERIFY(stats.savedMs() > 0);
+        }
+    }
+    out.flush();
+    QVERIFY(totalMs[1] < totalMs[0]);
+}
+
+QTEST_MAIN(OllamaClientBenchmark)
+#include "ollamaclient_benchmark.moc"
@@ -0,0 +1,82 @@
+#include "ollamatransport.h"
+#include <QDebug>
+
+OllamaTransport::OllamaTransport(QObject *parent)
+    : QObject(parent), networkManager(new QNetworkAccessManager(this))
+{
+}
+
+void OllamaTransport::setSettings(const Settings &settings)
+{
+    current = settings;
+    qDebug() << "transport: keep-alive" << current.keepAlive << "http2" << current.http2
+             << "tls session reuse" << current.tlsSessionReuse << "preconnect" << current.preconnect;
+}
+
+OllamaTransport::Settings OllamaTransport::settings() const
+{
+    return current;
+}
+
+QNetworkAccessManager *OllamaTransport::manager() const
+{
+    return networkManager;
+}
+
+#ifndef QT_NO_SSL
+QSslConfiguration OllamaTransport::sslConfiguration() const
+{
+    QSslConfiguration ssl = QSslConfiguration::defaultConfiguration();
+    // Qt 默认不保留会话票据；开启后同一主机的新连接可以恢复会话
+    ssl.setSslOption(QSsl::SslOptionDisableSessionPersistence, !current.tlsSessionReuse);
+    ssl.setSslOption(QSsl::SslOptionDisableSessionTickets, !current.tlsSessionReuse);
+    if (current.http2) {
+        ssl.setAllowedNextProtocols({QSslConfiguration::ALPNProtocolHTTP2,
+                                     QSslConfiguration::NextProtocolHttp1_1});
+    }
+    return ssl;
+}
+#endif
+
+QNetworkRequest OllamaTransport::buildRequest(const QUrl &url) const
+{
+    QNetworkRequest request(url);
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    // HTTP/1.1 默认就是持久连接；显式写出，避免中间的代理按 HTTP/1.0 处理
+    request.setRawHeader("Connection", current.keepAlive ? "keep-alive" : "close");
+
+    const bool https = url.scheme() == QLatin1String("https");
+    // 明文端点不尝试 h2c：带请求体的 Upgrade 请求在 Ollama（Go net/http）上不会升级，只会多一次往返
+    request.setAttribute(QNetworkRequest::Http2AllowedAttribute, current.http2 && https);
+#ifndef QT_NO_SSL
+    if (https) {
+        request.setSslConfiguration(sslConfiguration());
+    }
+#endif
+    return request;
+}
+
+QNetworkReply *OllamaTransport::post(const QUrl &url, const QByteArray &body)
+{
+    return networkManager->post(buildRequest(url), body);
+}
+
+QNetworkReply *OllamaTransport::get(const QUrl &url)
+{
+    return networkManager->get(buildRequest(url));
+}
+
+void OllamaTransport::preconnect(const QUrl &url)
+{
+    if (!current.preconnect || !current.keepAlive || !url.isValid() || url.host().isEmpty()) {
+        return;
+    }
+    if (url.scheme() == QLatin1String("https")) {
+#ifndef QT_NO_SSL
+        // 配置须与 buildRequest 一致，预先建立的连接才会被后续请求复用
+        networkManager->connectToHostEncrypted(url.host(), quint16(url.port(443)), sslConfiguration());
+#endif
+    } else {
+        networkManager->connectToHost(url.host(), quint16(url.port(80)));
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef OLLAMATRANSPORT_H
+#define OLLAMATRANSPORT_H
+
+#include <QObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QUrl>
+#ifndef QT_NO_SSL
+#include <QSslConfiguration>
+#endif
+
+// Ollama 请求的传输层：持久连接、HTTPS 端点的 HTTP/2 与 TLS 会话复用，以及预连接。
+// QNetworkAccessManager 按主机缓存连接；所有请求都经过同一个实例和同一套请求属性，
+// 否则 HTTP/2 与 HTTP/1.1 的请求会落在不同的连接池里
+class OllamaTransport : public QObject
+{
+    Q_OBJECT
+public:
+    struct Settings
+    {
+        bool keepAlive = true;        // false 时每个请求带 Connection: close（用于会错误复用连接的代理）
+        bool http2 = true;            // HTTPS 端点通过 ALPN 协商 HTTP/2，并发请求复用同一个连接
+        bool tlsSessionReuse = true;  // 新连接恢复之前的 TLS 会话，省去完整握手
+        bool preconnect = true;       // 启动和开始截图时提前建立连接
+    };
+
+    explicit OllamaTransport(QObject *parent = nullptr);
+
+    void setSettings(const Settings &settings);
+    Settings settings() const;
+
+    // 按当前设置构造请求：请求头、HTTP/2 属性和 TLS 配置
+    QNetworkRequest buildRequest(const QUrl &url) const;
+    QNetworkReply *post(const QUrl &url, const QByteArray &body);
+    QNetworkReply *get(const QUrl &url);
+
+    // 提前建立到 url 所在主机的连接（HTTPS 含 TLS 握手），关闭 preconnect 或 keepAlive 时不做任何事；
+    // 已有空闲连接时不会新建
+    void preconnect(const QUrl &url);
+
+    QNetworkAccessManager *manager() const;
+
+private:
+#ifndef QT_NO_SSL
+    QSslConfiguration sslConfiguration() const;
+#endif
+
+    QNetworkAccessManager *networkManager;
+    Settings current;
+};
+
+#endif // OLLAMATRANSPORT_H
@@ -0,0 +1,231 @@
+#include "openaibackend.h"
+#include "formulajsonreader.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QUrl>
+
+namespace {
+
+// 错误可能是 {"error":{"message":...}}（OpenAI、vLLM）或 {"error":"..."}
+QString errorMessage(const QJsonValue &error)
+{
+    if (error.isObject()) {
+        return error.toObject()["message"].toString();
+    }
+    return error.toString();
+}
+
+// SSE：以空行分隔事件，事件内的 data: 行拼接为一个 JSON 对象，data: [DONE] 表示结束。
+// 服务端返回错误或不支持流式时响应体是普通 JSON，结束时整体解析
+class SseDecoder : public InferenceBackend::Decoder
+{
+public:
+    QString feed(const QByteArray &data) override
+    {
+        buffer += data;
+        QString text;
+        int start = 0;
+        int newline;
+        while ((newline = buffer.indexOf('\n', start)) >= 0) {
+            text += feedLine(buffer.mid(start, newline - start));
+            start = newline + 1;
+        }
+        buffer.remove(0, start);
+        return text;
+    }
+
+    QString finish() override
+    {
+        QString text;
+        if (!buffer.isEmpty()) {
+            text += feedLine(buffer);
+            buffer.clear();
+        }
+        text += dispatch();
+
+        if (!sawEvent && error.isEmpty()) {
+            const QJsonObject body = QJsonDocument::fromJson(plain).object();
+            if (body.contains("error")) {
+                error = "API Error: " + errorMessage(body["error"]);
+            } else if (body["choices"].isArray()) {
+                const QJsonObject choice = body["choices"].toArray().at(0).toObject();
+                text = choice["message"].toObject()["content"].toString();
+                decoded += text;
+                readEvent(body, choice);
+            } else {
+                error = "Failed to parse chat completion response. Response: " + QString::fromUtf8(plain);
+            }
+        }
+        plain.clear();
+        return text;
+    }
+
+private:
+    QString feedLine(QByteArray line)
+    {
+        if (line.endsWith('\r')) {
+            line.chop(1);
+        }
+        if (line.isEmpty()) {
+            return dispatch();
+        }
+        if (line.startsWith(':')) {
+            return QString(); // 注释（保活）
+        }
+        if (line.startsWith("data:")) {
+            QByteArray value = line.mid(5);
+            if (value.startsWith(' ')) {
+                value.remove(0, 1);
+            }
+            if (!eventData.isEmpty()) {
+                eventData += '\n';
+            }
+            eventData += value;
+            return QString();
+        }
+        if (!sawEvent) {
+            plain += line + '\n';
+        }
+        return QString();
+    }
+
+    QString dispatch()
+    {
+        if (eventData.isEmpty()) {
+            return QString();
+        }
+        const QByteArray data = eventData;
+        eventData.clear();
+        sawEvent = true;
+        if (data == "[DONE]") {
+            return QString();
+        }
+
+        const QJsonObject event = QJsonDocument::fromJson(data).object();
+        if (event.contains("error")) {
+            error = "API Error: " + errorMessage(event["error"]);
+            return QString();
+        }
+        const QJsonArray choices = event["choices"].toArray();
+        const QJsonObject choice = choices.isEmpty() ? QJsonObject() : choices.first().toObject();
+        const QString text = choice["delta"].toObject()["content"].toString();
+        decoded += text;
+        readEvent(event, choice);
+        return text;
+    }
+
+    void readEvent(const QJsonObject &event, const QJsonObject &choice)
+    {
+        if (choice["finish_reason"].isString()) {
+            stats.doneReason = choice["finish_reason"].toString();
+        }
+        if (event["usage"].isObject()) {
+            const QJsonObject usage = event["usage"].toObject();
+            stats.promptTokens = usage["prompt_tokens"].toInt();
+            stats.completionTokens = usage["completion_tokens"].toInt();
+        }
+        // llama-server 的扩展字段，单位为毫秒
+        if (event["timings"].isObject()) {
+            const QJsonObject timings = event["timings"].toObject();
+            stats.promptMs = qint64(timings["prompt_ms"].toDouble());
+            stats.completionMs = qint64(timings["predicted_ms"].toDouble());
+            if (stats.promptTokens == 0) {
+                stats.promptTokens = timings["prompt_n"].toInt();
+            }
+            if (stats.completionTokens == 0) {
+                stats.completionTokens = timings["predicted_n"].toInt();
+            }
+        }
+    }
+
+    QByteArray buffer;
+    QByteArray eventData;
+    QByteArray plain;
+    bool sawEvent = false;
+};
+
+} // namespace
+
+QString OpenAiBackend::name() const
+{
+    return "openai";
+}
+
+QString OpenAiBackend::healthUrl() const
+{
+    QUrl url(endpoint);
+    QString path = url.path();
+    if (path.endsWith("/chat/completions")) {
+        path.chop(int(qstrlen("/chat/completions")));
+    } else {
+        path = "/v1";
+    }
+    url.setPath(path + "/models");
+    url.setQuery(QString());
+    return url.toString();
+}
+
+void OpenAiBackend::applyOptions(const QJsonObject &options, QJsonObject *payload)
+{
+    // num_predict 为 0（服务端默认）或 -1（不限制）时都不设置 max_tokens
+    const int numPredict = options["num_predict"].toInt();
+    if (numPredict > 0) {
+        (*payload)["max_tokens"] = numPredict;
+    }
+    if (options.contains("temperature")) {
+        (*payload)["temperature"] = options["temperature"];
+    }
+    if (options.contains("stop")) {
+        // OpenAI 兼容接口最多接受 MaxStop 个停止序列，多出的会让整个请求被拒绝
+        const QJsonArray stop = options["stop"].toArray();
+        QJsonArray kept;
+        for (int i = 0; i < stop.size() && i < MaxStop; ++i) {
+            kept.append(stop.at(i));
+        }
+        (*payload)["stop"] = kept;
+    }
+}
+
+QByteArray OpenAiBackend::buildPayload(const Request &request) const
+{
+    QJsonObject imageUrl;
+    imageUrl["url"] = "data:" + request.mimeType + ";base64," + QString::fromLatin1(request.base64Image);
+    QJsonObject image;
+    image["type"] = "image_url";
+    image["image_url"] = imageUrl;
+    QJsonObject text;
+    text["type"] = "text";
+    text["text"] = request.prompt;
+
+    QJsonObject message;
+    message["role"] = "user";
+    message["content"] = QJsonArray{image, text};
+
+    QJsonObject payload;
+    payload["model"] = request.model;
+    payload["messages"] = QJsonArray{message};
+    payload["stream"] = true;
+    QJsonObject streamOptions;
+    streamOptions["include_usage"] = true;
+    payload["stream_options"] = streamOptions;
+    if (request.structured) {
+        QJsonObject schema;
+        schema["name"] = "formulas";
+        // 不开启 strict：严格模式要求 additionalProperties:false 且所有属性都必填，
+        // 与 Ollama 共用的 Schema 中 confidence 是可选的
+        schema["schema"] = FormulaJsonReader::schema();
+        QJsonObject format;
+        format["type"] = "json_schema";
+        format["json_schema"] = schema;
+        payload["response_format"] = format;
+    }
+    applyOptions(request.options, &payload);
+
+    return QJsonDocument(payload).toJson(QJsonDocument::Compact);
+}
+
+InferenceBackend::Decoder *OpenAiBackend::createDecoder(const Request &request) const
+{
+    Q_UNUSED(request);
+    return new SseDecoder;
+}
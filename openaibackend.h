@@ -0,0 +1,27 @@
+#ifndef OPENAIBACKEND_H
+#define OPENAIBACKEND_H
+
+#include "inferencebackend.h"
+
+// OpenAI 兼容的 /v1/chat/completions（llama.cpp 的 llama-server、vLLM、SGLang 等）。
+// 图像作为 image_url 内容片段以 data URL 发送；响应始终以 SSE 流式返回，
+// 最后一个事件带 usage（stream_options.include_usage），llama-server 另外给出 timings。
+// 这类服务端对并发请求做连续批处理，切分识别的各行同时发出时吞吐明显高于逐个处理
+class OpenAiBackend : public InferenceBackend
+{
+public:
+    // OpenAI 接口允许的停止序列个数上限
+    static const int MaxStop = 4;
+
+    QString name() const override;
+    // 与 chat/completions 同一前缀下的 /models
+    QString healthUrl() const override;
+    QByteArray buildPayload(const Request &request) const override;
+    Decoder *createDecoder(const Request &request) const override;
+
+    // 把 GenerationOptions 的 Ollama 参数名映射到请求体：num_predict → max_tokens（仅正值），
+    // temperature 与 stop 同名，stop 只保留前 MaxStop 个；num_ctx 由服务端启动参数决定（llama-server -c），不随请求发送
+    static void applyOptions(const QJsonObject &options, QJsonObject *payload);
+};
+
+#endif // OPENAIBACKEND_H
@@ -0,0 +1,195 @@
+#include "pandocprobe.h"
+#include <QFileInfo>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QDebug>
+
+PandocProbe &PandocProbe::instance()
+{
+    static PandocProbe instance;
+    return instance;
+}
+
+PandocProbe::PandocProbe(QObject *parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<PandocCapabilities>("PandocCapabilities");
+}
+
+QString PandocProbe::resolveExecutable(const QString &path)
+{
+    if (path.trimmed().isEmpty()) {
+        return QString();
+    }
+
+    // 带目录的路径直接检查文件；命令名按 PATH 查找
+    if (path.contains('/') || path.contains('\\')) {
+        QFileInfo fileInfo(path);
+        if (fileInfo.isFile() && fileInfo.isExecutable()) {
+            return fileInfo.canonicalFilePath();
+        }
+        return QString();
+    }
+
+    QString found = QStandardPaths::findExecutable(path);
+    return found.isEmpty() ? QString() : QFileInfo(found).canonicalFilePath();
+}
+
+bool PandocProbe::lookup(const QString &path, PandocCapabilities *out) const
+{
+    const QString executable = resolveExecutable(path);
+    if (executable.isEmpty()) {
+        // 文件不存在时无需启动进程即可给出结论
+        *out = PandocCapabilities();
+        out->probed = true;
+        out->path = path;
+        out->error = "找不到可执行文件";
+        return true;
+    }
+
+    auto it = cache.constFind(executable);
+    if (it == cache.constEnd() || it->modified != QFileInfo(executable).lastModified()) {
+        return false;
+    }
+    *out = it.value();
+    out->path = path;
+    return true;
+}
+
+PandocCapabilities PandocProbe::capabilities(const QString &path)
+{
+    PandocCapabilities result;
+    if (lookup(path, &result)) {
+        return result;
+    }
+
+    probe(path);
+    result.path = path;
+    return result;
+}
+
+bool PandocProbe::isProbing(const QString &path) const
+{
+    return pending.contains(path);
+}
+
+void PandocProbe::clearCache()
+{
+    cache.clear();
+}
+
+void PandocProbe::probe(const QString &path)
+{
+    PandocCapabilities cached;
+    if (pending.contains(path) || lookup(path, &cached)) {
+        return;
+    }
+
+    Probe probe;
+    probe.result.path = path;
+    probe.result.executable = resolveExecutable(path);
+    probe.result.modified = QFileInfo(probe.result.executable).lastModified();
+    pending.insert(path, probe);
+    startStep(path);
+}
+
+void PandocProbe::startStep(const QString &path)
+{
+    Probe &probe = pending[path];
+    QProcess *process = new QProcess(this);
+    probe.process = process;
+
+    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, [this, path]() { onStepFinished(path); });
+    connect(process, &QProcess::errorOccurred, this, [this, path](QProcess::ProcessError error) {
+        // 启动失败时不会发出 finished 信号
+        if (error == QProcess::FailedToStart) {
+            onStepFinished(path);
+        }
+    });
+    // 卡住的进程超时后结束，kill 之后会照常走 finished
+    QTimer::singleShot(ProbeTimeoutMs, process, [process]() {
+        qWarning() << "Pandoc probe timed out:" << process->program();
+        process->kill();
+    });
+
+    const QStringList arguments = probe.step == 0
+            ? QStringList() << "--version"
+            : QStringList() << "--list-output-formats";
+    process->start(probe.result.executable, arguments);
+}
+
+void PandocProbe::onStepFinished(const QString &path)
+{
+    if (!pending.contains(path)) {
+        return;
+    }
+
+    Probe &probe = pending[path];
+    QProcess *process = probe.process;
+    probe.process = nullptr;
+    if (!process) {
+        return;
+    }
+    process->disconnect(this);
+    process->deleteLater();
+
+    const bool ok = process->error() != QProcess::FailedToStart
+            && process->exitStatus() == QProcess::NormalExit
+            && process->exitCode() == 0;
+    const QString output = QString::fromUtf8(process->readAllStandardOutput());
+
+    PandocCapabilities result = probe.result;
+    result.probed = true;
+
+    if (probe.step == 0) {
+        if (!ok) {
+            result.error = process->error() == QProcess::FailedToStart
+                    ? process->errorString()
+                    : QString("--version 执行失败 (退出码 %1)").arg(process->exitCode());
+            finish(path, result);
+            return;
+        }
+
+        // 第一行形如 "pandoc 3.1.2"（Windows 上为 "pandoc.exe 3.1.2"）
+        const QString firstLine = output.section('\n', 0, 0).trimmed();
+        result.version = QVersionNumber::fromString(firstLine.section(' ', -1));
+        result.available = !result.version.isNull();
+        if (!result.available) {
+            result.error = "无法识别的 --version 输出: " + firstLine;
+            finish(path, result);
+            return;
+        }
+        // 3.x 在 Features 行列出 +server；没有该行时按版本号判断
+        result.serverMode = output.contains("+server")
+                || (!output.contains("-server") && result.version >= QVersionNumber(3, 0));
+
+        probe.result = result;
+        probe.step = 1;
+        startStep(path);
+        return;
+    }
+
+    // --list-output-formats 自 1.18 起提供；更老的版本仍视为可用，只是格式列表为空
+    if (ok) {
+        for (const QString &line : output.split('\n', Qt::SkipEmptyParts)) {
+            result.outputFormats << line.trimmed();
+        }
+    }
+    finish(path, result);
+}
+
+void PandocProbe::finish(const QString &path, const PandocCapabilities &result)
+{
+    pending.remove(path);
+    if (!result.executable.isEmpty()) {
+        cache.insert(result.executable, result);
+    }
+
+    qDebug() << "Pandoc probe" << path << "available:" << result.available
+             << "version:" << result.version.toString()
+             << "formats:" << result.outputFormats.size()
+             << "server:" << result.serverMode;
+    emit capabilitiesReady(path, result);
+}
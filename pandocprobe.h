@@ -0,0 +1,81 @@
+#ifndef PANDOCPROBE_H
+#define PANDOCPROBE_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QHash>
+#include <QMetaType>
+#include <QString>
+#include <QStringList>
+#include <QVersionNumber>
+
+class QProcess;
+
+// 一次探测得到的 Pandoc 能力
+struct PandocCapabilities
+{
+    bool probed = false;          // false 表示尚未探测完成
+    bool available = false;
+    QString path;                 // 用户填写的路径或命令名
+    QString executable;           // 解析后的可执行文件绝对路径
+    QDateTime modified;           // 探测时可执行文件的修改时间
+    QVersionNumber version;
+    QStringList outputFormats;    // --list-output-formats 的结果
+    bool serverMode = false;      // pandoc 3.0 起内置 server 模式
+    QString error;
+
+    bool supportsOutput(const QString &format) const { return outputFormats.contains(format); }
+};
+
+Q_DECLARE_METATYPE(PandocCapabilities)
+
+// 后台探测 Pandoc 是否可用及其支持的功能。
+// 每个可执行文件只探测一次，结果按路径 + 修改时间缓存，之后的查询立即返回。
+class PandocProbe : public QObject
+{
+    Q_OBJECT
+
+public:
+    static PandocProbe &instance();
+
+    PandocProbe(const PandocProbe &) = delete;
+    PandocProbe &operator=(const PandocProbe &) = delete;
+
+    // 立即返回缓存结果；缓存缺失或已过期时返回 probed == false 的结果并在后台开始探测
+    PandocCapabilities capabilities(const QString &path);
+
+    // 开始后台探测（已有有效缓存或正在探测时不会重复启动）
+    void probe(const QString &path);
+
+    bool isProbing(const QString &path) const;
+    void clearCache();
+
+    // 将命令名解析为可执行文件绝对路径，找不到时返回空字符串
+    static QString resolveExecutable(const QString &path);
+
+signals:
+    // 探测完成，path 为调用方传入的原始路径
+    void capabilitiesReady(const QString &path, const PandocCapabilities &capabilities);
+
+private:
+    explicit PandocProbe(QObject *parent = nullptr);
+
+    struct Probe
+    {
+        PandocCapabilities result;
+        QProcess *process = nullptr;
+        int step = 0;   // 0: --version，1: --list-output-formats
+    };
+
+    bool lookup(const QString &path, PandocCapabilities *out) const;
+    void startStep(const QString &path);
+    void onStepFinished(const QString &path);
+    void finish(const QString &path, const PandocCapabilities &result);
+
+    static const int ProbeTimeoutMs = 5000;
+
+    QHash<QString, PandocCapabilities> cache;   // 以可执行文件绝对路径为键
+    QHash<QString, Probe> pending;              // 以原始路径为键
+};
+
+#endif // PANDOCPROBE_H
@@ -0,0 +1,479 @@
+#include "recognitionscheduler.h"
+#include <QFutureWatcher>
+#include <QStringList>
+#include <QtConcurrent>
+#include <QDebug>
+#include <algorithm>
+#include <functional>
+
+void RecognitionScheduler::ClassStats::recordWait(qint64 waitMs)
+{
+    ++started;
+    totalWaitMs += waitMs;
+    maxWaitMs = qMax(maxWaitMs, waitMs);
+}
+
+double RecognitionScheduler::ClassStats::meanWaitMs() const
+{
+    return started > 0 ? double(totalWaitMs) / started : 0;
+}
+
+RecognitionScheduler::RecognitionScheduler(OllamaClient *client, QObject *parent)
+    : QObject(parent), client(client), dispatching(false), nextJobId(0), journal(nullptr), healthFailures(0)
+{
+    for (int i = 0; i < PriorityCount; ++i) {
+        running[i] = 0;
+        latestRequest[i] = 0;
+    }
+    connect(client, &OllamaClient::requestFinished, this, [this](quint64 requestId, const QString &formula) {
+        onRequestDone(requestId, true, formula, QString());
+    });
+    connect(client, &OllamaClient::requestFailed, this, [this](quint64 requestId, const QString &errorString) {
+        onRequestDone(requestId, false, QString(), errorString);
+    });
+    connect(client, &OllamaClient::requestCancelled, this, &RecognitionScheduler::onRequestCancelled);
+    connect(client, &OllamaClient::endpointUnreachable, this, [this](quint64 requestId) {
+        if (active.contains(requestId)) {
+            unreachable.insert(requestId);
+        }
+    });
+    connect(client, &OllamaClient::healthChecked, this, [this](bool ok, const QString &) {
+        onHealthChecked(ok);
+    });
+    healthTimer.setSingleShot(true);
+    connect(&healthTimer, &QTimer::timeout, client, &OllamaClient::checkHealth);
+}
+
+void RecognitionScheduler::setSettings(const Settings &settings)
+{
+    config = settings;
+    if (healthTimer.isActive()) {
+        scheduleHealthCheck();
+    }
+    // 上限调高后排队的任务可以立即发出
+    dispatch();
+}
+
+RecognitionScheduler::Settings RecognitionScheduler::settings() const
+{
+    return config;
+}
+
+QString RecognitionScheduler::priorityName(Priority priority)
+{
+    switch (priority) {
+    case Interactive:
+        return "interactive";
+    case Background:
+        return "background";
+    case Bulk:
+        return "bulk";
+    }
+    return QString();
+}
+
+quint64 RecognitionScheduler::submit(const QPixmap &pixmap, Priority priority)
+{
+    Job job;
+    job.id = ++nextJobId;
+    job.priority = priority;
+    job.pixmap = pixmap;
+    job.queued.start();
+    job.target = client->currentTarget();
+
+    // 界面只显示最新的结果：同一类中还没发出的旧任务已经没有意义
+    if (priority != Bulk) {
+        QList<Job> &queue = queues[priority];
+        while (!queue.isEmpty()) {
+            const Job stale = queue.takeFirst();
+            retire(stale);
+            ++classStats[priority].cancelled;
+            emit jobCancelled(stale.id);
+        }
+    }
+
+    queues[priority].append(job);
+    if (priority == Interactive && config.preemptBulk) {
+        preemptBulk();
+    }
+    // 先发出请求，日志在后台写入：PNG 编码不拖慢截图到发出之间的时间
+    if (config.durable && journal && journal->isOpen() && priority != Background) {
+        journalInBackground(job);
+    }
+    dispatch();
+    return job.id;
+}
+
+void RecognitionScheduler::journalInBackground(const Job &job)
+{
+    const quint64 jobId = job.id;
+    const int priority = job.priority;
+    JobJournal::Params params;
+    params.url = job.target.url;
+    params.model = job.target.model;
+    params.outputMode = job.target.outputMode;
+    encoding.insert(jobId);
+
+    QFutureWatcher<QByteArray> *watcher = new QFutureWatcher<QByteArray>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, jobId, priority, params]() {
+        watcher->deleteLater();
+        encoding.remove(jobId);
+        Job *job = findJob(jobId);
+        // 编码期间已经结束或取消的任务不再写入
+        if (!job || !journal || !journal->isOpen()) {
+            return;
+        }
+        job->journalId = journal->append(watcher->result(), priority, params);
+        if (job->journalId != 0) {
+            // 推迟中的任务与其余推迟的任务一样，图像只保留在日志中
+            for (Job &waiting : parked) {
+                if (waiting.id == jobId) {
+                    waiting.pixmap = QPixmap();
+                }
+            }
+        }
+    });
+    // QPixmap 只能在 GUI 线程使用，转换后交给线程池编码
+    watcher->setFuture(QtConcurrent::run(JobJournal::encodeImage, job.pixmap.toImage()));
+}
+
+RecognitionScheduler::Job *RecognitionScheduler::findJob(quint64 jobId)
+{
+    for (QList<Job> &queue : queues) {
+        for (Job &job : queue) {
+            if (job.id == jobId) {
+                return &job;
+            }
+        }
+    }
+    for (Job &job : active) {
+        if (job.id == jobId) {
+            return &job;
+        }
+    }
+    for (Job &job : parked) {
+        if (job.id == jobId) {
+            return &job;
+        }
+    }
+    return nullptr;
+}
+
+void RecognitionScheduler::setJournal(JobJournal *journal)
+{
+    this->journal = journal;
+}
+
+int RecognitionScheduler::replay()
+{
+    if (!journal || !journal->isOpen()) {
+        return 0;
+    }
+    const QList<quint64> ids = journal->pendingIds();
+    for (quint64 journalId : ids) {
+        Job job;
+        job.id = ++nextJobId;
+        job.priority = Bulk;
+        job.journalId = journalId;
+        job.recovered = true;
+        job.queued.start();
+        queues[Bulk].append(job);
+    }
+    dispatch();
+    return ids.size();
+}
+
+int RecognitionScheduler::deferredCount() const
+{
+    return parked.size();
+}
+
+void RecognitionScheduler::retire(const Job &job)
+{
+    if (journal && job.journalId != 0) {
+        journal->markDone(job.journalId);
+    }
+}
+
+bool RecognitionScheduler::cancel(quint64 jobId)
+{
+    for (int i = 0; i < PriorityCount; ++i) {
+        QList<Job> &queue = queues[i];
+        for (int j = 0; j < queue.size(); ++j) {
+            if (queue.at(j).id == jobId) {
+                retire(queue.takeAt(j));
+                ++classStats[i].cancelled;
+                emit jobCancelled(jobId);
+                return true;
+            }
+        }
+    }
+    for (int j = 0; j < parked.size(); ++j) {
+        if (parked.at(j).id == jobId) {
+            const Job job = parked.takeAt(j);
+            retire(job);
+            ++classStats[job.priority].cancelled;
+            if (parked.isEmpty()) {
+                healthTimer.stop();
+                healthFailures = 0;
+            }
+            emit jobCancelled(jobId);
+            return true;
+        }
+    }
+    for (auto it = active.cbegin(); it != active.cend(); ++it) {
+        if (it->id == jobId) {
+            // 结果经由 requestCancelled 回到 onRequestCancelled
+            return client->cancelRequest(it.key());
+        }
+    }
+    return false;
+}
+
+void RecognitionScheduler::preemptBulk()
+{
+    QList<quint64> requestIds;
+    for (auto it = active.cbegin(); it != active.cend(); ++it) {
+        if (it->priority == Bulk && it.key() != 0) {
+            requestIds << it.key();
+        }
+    }
+    // 按发出的顺序放回队首，重新发出时顺序不变
+    std::sort(requestIds.begin(), requestIds.end(), std::greater<quint64>());
+    for (quint64 requestId : requestIds) {
+        Job job = active.take(requestId);
+        --running[Bulk];
+        ++classStats[Bulk].preempted;
+        job.queued.start();
+        queues[Bulk].prepend(job);
+        // 已从 active 中移除，随后的 requestCancelled 不再处理
+        client->cancelRequest(requestId);
+    }
+}
+
+int RecognitionScheduler::queuedCount(Priority priority) const
+{
+    return queues[priority].size();
+}
+
+int RecognitionScheduler::runningCount(Priority priority) const
+{
+    return running[priority];
+}
+
+RecognitionScheduler::ClassStats RecognitionScheduler::stats(Priority priority) const
+{
+    return classStats[priority];
+}
+
+QString RecognitionScheduler::statsSummary() const
+{
+    QStringList parts;
+    for (int i = 0; i < PriorityCount; ++i) {
+        const Priority priority = Priority(i);
+        const ClassStats &s = classStats[i];
+        parts << QString("%1 %2 started, wait avg %3 ms max %4 ms, %5 queued")
+                     .arg(priorityName(priority)).arg(s.started)
+                     .arg(s.meanWaitMs(), 0, 'f', 1).arg(s.maxWaitMs)
+                     .arg(queues[i].size());
+    }
+    return parts.join(" | ");
+}
+
+int RecognitionScheduler::limit(Priority priority) const
+{
+    switch (priority) {
+    case Interactive:
+        return qMax(1, config.interactiveLimit);
+    case Background:
+        return qMax(1, config.backgroundLimit);
+    case Bulk:
+        return qMax(1, config.bulkLimit);
+    }
+    return 1;
+}
+
+bool RecognitionScheduler::canStart(Priority priority) const
+{
+    if (queues[priority].isEmpty() || running[priority] >= limit(priority)) {
+        return false;
+    }
+    // 服务端不可用：批量任务发出也只会失败，等探测通过后再发出
+    if (priority == Bulk && !parked.isEmpty()) {
+        return false;
+    }
+    // 被中止的批量任务也要等交互任务结束，否则会立即重新发出
+    if (priority == Bulk && (config.deferBulk || config.preemptBulk)
+            && (running[Interactive] > 0 || !queues[Interactive].isEmpty())) {
+        return false;
+    }
+    return true;
+}
+
+void RecognitionScheduler::dispatch()
+{
+    // start 期间请求可能同步结束、被取代的请求被取消，或者信号的接收方提交新任务，都会再次调用 dispatch；
+    // 嵌套的调用直接返回，由这里的循环每次从最高优先级重新查找
+    if (dispatching) {
+        return;
+    }
+    dispatching = true;
+    for (;;) {
+        int next = -1;
+        for (int i = 0; i < PriorityCount; ++i) {
+            if (canStart(Priority(i))) {
+                next = i;
+                break;
+            }
+        }
+        if (next < 0) {
+            break;
+        }
+        start(queues[next].takeFirst());
+    }
+    dispatching = false;
+}
+
+void RecognitionScheduler::start(Job job)
+{
+    if (job.pixmap.isNull() && journal && job.journalId != 0) {
+        // 读取失败时图像为空，OllamaClient 随即报错，任务从日志中移除
+        const JobJournal::Record record = journal->record(job.journalId);
+        QImage image;
+        image.loadFromData(record.image, "PNG");
+        job.pixmap = QPixmap::fromImage(image);
+        job.target.url = record.params.url;
+        job.target.model = record.params.model;
+        job.target.outputMode = record.params.outputMode;
+    }
+    const qint64 waitMs = job.queued.elapsed();
+    classStats[job.priority].recordWait(waitMs);
+    ++running[job.priority];
+    emit jobStarted(job.id, job.priority, waitMs);
+
+    // 空图像、编码失败时 OllamaClient 在返回 id 之前就发出了结果，先挂在 id 0 上
+    active.insert(0, job);
+    // 推迟和重放的任务按入队时的参数识别；其余任务使用当前设置
+    const quint64 requestId = job.priority != Bulk ? client->recognizeFormula(job.pixmap)
+            : client->recognizeInBackground(job.pixmap, job.recovered ? job.target : OllamaClient::Target());
+    if (active.contains(0)) {
+        active.insert(requestId, active.take(0));
+    }
+
+    // 只取代同一类中的请求：监视区域的新帧不中止用户的截图
+    if (job.priority != Bulk) {
+        const quint64 previous = latestRequest[job.priority];
+        latestRequest[job.priority] = requestId;
+        if (config.cancelSuperseded && previous != 0 && active.contains(previous)) {
+            // 与新请求合并在同一次调用上时保留；取消经由 requestCancelled 回到 onRequestCancelled
+            client->cancelRequest(previous, true);
+        }
+    }
+}
+
+void RecognitionScheduler::onRequestCancelled(quint64 requestId)
+{
+    auto it = active.find(requestId);
+    if (it == active.end()) {
+        return;
+    }
+    const Job job = it.value();
+    active.erase(it);
+    --running[job.priority];
+    ++classStats[job.priority].cancelled;
+    retire(job);
+    emit jobCancelled(job.id);
+    dispatch();
+}
+
+void RecognitionScheduler::onRequestDone(quint64 requestId, bool ok, const QString &formula,
+                                         const QString &errorString)
+{
+    const bool lost = unreachable.remove(requestId);
+    auto it = active.find(requestId);
+    if (it == active.end() && !ok) {
+        // 返回 id 之前同步失败的请求挂在 id 0 上
+        it = active.find(0);
+    }
+    if (it == active.end()) {
+        return; // 不是经由调度发出的请求，或者已被中止、取消
+    }
+    const Job job = it.value();
+    active.erase(it);
+    --running[job.priority];
+
+    // 日志仍在后台写入的任务同样可以推迟，写入完成前图像留在内存中
+    const bool durable = job.journalId != 0 || encoding.contains(job.id);
+    if (!ok && lost && durable && job.attempts < config.maxRetries) {
+        // 图像已在日志中，内存里不再保留；重新发出时再读取
+        Job waiting = job;
+        if (job.journalId != 0) {
+            waiting.pixmap = QPixmap();
+        }
+        ++waiting.attempts;
+        parked.append(waiting);
+        ++classStats[job.priority].deferred;
+        if (!healthTimer.isActive()) {
+            scheduleHealthCheck();
+        }
+        emit jobDeferred(job.id, errorString);
+        dispatch();
+        return;
+    }
+
+    QString error = errorString;
+    if (!ok && lost && durable) {
+        error += QString(" (gave up after %1 retries)").arg(job.attempts);
+        qWarning() << "Job" << job.id << "still unreachable after" << job.attempts << "retries, giving up";
+    }
+    ++classStats[job.priority].finished;
+    // 服务端返回的错误（模型不存在等）重试也不会成功，与成功的任务一样从日志中移除
+    retire(job);
+    if (ok) {
+        emit jobFinished(job.id, formula);
+        if (job.recovered) {
+            const QString model = job.target.model.isEmpty() ? client->currentTarget().model : job.target.model;
+            emit jobRecovered(job.id, formula, job.pixmap.toImage(), model);
+        }
+    } else {
+        emit jobFailed(job.id, error);
+    }
+    dispatch();
+}
+
+void RecognitionScheduler::scheduleHealthCheck()
+{
+    // 服务端长时间不可用，或者探测通过但识别请求仍然连不上时，不以固定的间隔反复重试
+    int exponent = healthFailures;
+    for (const Job &job : qAsConst(parked)) {
+        exponent = qMax(exponent, healthFailures + job.attempts - 1);
+    }
+    const qint64 interval = qint64(qMax(100, config.healthIntervalMs)) << qBound(0, exponent, 16);
+    healthTimer.start(int(qMin<qint64>(interval, MaxHealthIntervalMs)));
+}
+
+void RecognitionScheduler::onHealthChecked(bool ok)
+{
+    if (parked.isEmpty()) {
+        healthTimer.stop();
+        healthFailures = 0;
+        return;
+    }
+    if (!ok) {
+        ++healthFailures;
+        scheduleHealthCheck();
+        return;
+    }
+    healthTimer.stop();
+    healthFailures = 0;
+    qDebug() << "Endpoint is back, resubmitting" << parked.size() << "deferred jobs";
+    // 恢复的任务作为批量任务发出，结果经由 jobRecovered 交给界面，不覆盖当前显示的结果
+    for (Job job : qAsConst(parked)) {
+        job.priority = Bulk;
+        job.recovered = true;
+        job.queued.start();
+        queues[Bulk].append(job);
+    }
+    parked.clear();
+    dispatch();
+}
@@ -0,0 +1,153 @@
+#ifndef RECOGNITIONSCHEDULER_H
+#define RECOGNITIONSCHEDULER_H
+
+#include <QObject>
+#include <QPixmap>
+#include <QList>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QSet>
+#include <QTimer>
+#include "ollamaclient.h"
+#include "jobjournal.h"
+
+// 识别调度：按优先级把截图交给 OllamaClient。三个优先级各有一个先进先出队列和并发上限，
+// 有空位时总是先发出优先级高的任务，交互截图不会排在批量任务后面：
+//   - Interactive：用户主动截图，结果显示在界面上；
+//   - Background：监视区域等自动触发的识别，结果也显示在界面上；
+//   - Bulk：批量识别，结果只通过 jobFinished / jobFailed 发出，不影响界面。
+// 前两类只有最新的结果会显示，新任务入队时同一类中仍在排队的旧任务直接取消；cancelSuperseded 时新任务发出后
+// 同一类中上一个仍在进行的请求也被中止（与新请求合并在同一次调用上时保留），监视区域的新帧不会中止用户的截图。
+// deferBulk 时有交互任务排队或进行中就不再发出新的批量任务；preemptBulk 时交互任务到达即中止
+// 进行中的批量请求（服务端随之停止生成），这些任务回到批量队列的最前面，稍后重新发出。
+// 设置了 JobJournal 时，交互和批量任务发出后在线程池中编码截图并写入日志，结束或取消后标记完成；因连接不上服务端而失败的任务
+// 不报错（jobDeferred），图像留在日志中，每隔 healthIntervalMs 探测一次服务端，恢复后作为批量任务重新发出；
+// 探测失败或任务再次推迟时间隔加倍，一个任务推迟 maxRetries 次后按失败结束。
+// 日志同时记录入队时的服务端、模型和输出模式，推迟和重放的任务按这些参数识别。
+// 服务端不可用期间不再发出新的批量任务。监视区域的任务只有最新一帧有意义，不写入日志
+class RecognitionScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    enum Priority { Interactive = 0, Background = 1, Bulk = 2 };
+    static const int PriorityCount = 3;
+
+    struct Settings
+    {
+        int interactiveLimit = 2;  // 各优先级同时进行的请求数上限
+        int backgroundLimit = 1;
+        int bulkLimit = 2;
+        bool deferBulk = true;     // 交互任务排队或进行中时暂停发出批量任务
+        bool preemptBulk = false;  // 交互任务到达时中止进行中的批量请求并重新排队
+        bool cancelSuperseded = false; // 新任务发出后中止同一类中上一个进行中的请求
+        bool durable = true;       // 设置了 JobJournal 时新任务写入日志；关闭后已在日志中的任务照常处理
+        int healthIntervalMs = 5000; // 服务端不可用时探测的间隔
+        int maxRetries = 5;        // 一个任务最多推迟几次，之后按失败结束
+    };
+
+    // 探测间隔加倍的上限
+    static const int MaxHealthIntervalMs = 600000;
+
+    // 各优先级的排队时间：从入队到交给 OllamaClient
+    struct ClassStats
+    {
+        int started = 0;
+        int finished = 0;   // 成功或失败
+        int cancelled = 0;  // 排队或进行中被取消
+        int preempted = 0;  // 被交互任务中止后重新排队的次数
+        int deferred = 0;   // 连接不上服务端，留在日志中等待恢复
+        qint64 totalWaitMs = 0;
+        qint64 maxWaitMs = 0;
+
+        void recordWait(qint64 waitMs);
+        double meanWaitMs() const;
+    };
+
+    explicit RecognitionScheduler(OllamaClient *client, QObject *parent = nullptr);
+
+    void setSettings(const Settings &settings);
+    Settings settings() const;
+
+    // 入队并尽快发出，返回任务 id
+    quint64 submit(const QPixmap &pixmap, Priority priority);
+
+    // 持久任务队列，调用方拥有；nullptr 时不写日志
+    void setJournal(JobJournal *journal);
+    // 启动时调用一次：日志中上次未完成的任务作为批量任务重新入队，返回任务数。
+    // 图像在发出时才从日志读取
+    int replay();
+    // 等待服务端恢复的任务数
+    int deferredCount() const;
+
+    // 取消排队中或进行中的任务：进行中的请求经由 OllamaClient::cancelRequest 中止。
+    // 成功时发射 jobCancelled；任务已经结束时返回 false
+    bool cancel(quint64 jobId);
+
+    int queuedCount(Priority priority) const;
+    int runningCount(Priority priority) const;
+    ClassStats stats(Priority priority) const;
+    // 各优先级的任务数和排队时间，用于日志
+    QString statsSummary() const;
+
+    // 配置和日志中使用的名称："interactive"、"background"、"bulk"
+    static QString priorityName(Priority priority);
+
+signals:
+    void jobStarted(quint64 jobId, int priority, qint64 waitMs);
+    void jobFinished(quint64 jobId, const QString &markdownFormula);
+    void jobFailed(quint64 jobId, const QString &errorString);
+    void jobCancelled(quint64 jobId);
+    // 连接不上服务端，任务已保存，服务端恢复后重新发出
+    void jobDeferred(quint64 jobId, const QString &errorString);
+    // 推迟或从日志重放的任务识别成功，在 jobFinished 之后发射；image 为原截图、model 为识别使用的模型，用于写入历史
+    void jobRecovered(quint64 jobId, const QString &markdownFormula, const QImage &image, const QString &model);
+
+private:
+    struct Job
+    {
+        quint64 id = 0;
+        Priority priority = Interactive;
+        QPixmap pixmap;            // 从日志重放或推迟的任务在发出时才读取
+        QElapsedTimer queued;
+        quint64 journalId = 0;     // 0 表示未写入日志
+        bool recovered = false;    // 推迟后重新发出或从日志重放
+        int attempts = 0;          // 已推迟的次数
+        OllamaClient::Target target; // 入队时的服务端、模型和输出模式，重新发出时使用
+    };
+
+    int limit(Priority priority) const;
+    bool canStart(Priority priority) const;
+    void dispatch();
+    void start(Job job);
+    void preemptBulk();
+    // 在线程池中编码截图，完成后任务仍未结束时写入日志
+    void journalInBackground(const Job &job);
+    // 排队、进行中或推迟中的任务；不存在时返回 nullptr
+    Job *findJob(quint64 jobId);
+    void onRequestCancelled(quint64 requestId);
+    void onRequestDone(quint64 requestId, bool ok, const QString &formula, const QString &errorString);
+    void onHealthChecked(bool ok);
+    // 按连续探测失败的次数和推迟最多的任务计算下一次探测的时间
+    void scheduleHealthCheck();
+    // 任务结束或取消：从日志中移除
+    void retire(const Job &job);
+
+    OllamaClient *client;
+    Settings config;
+    QList<Job> queues[PriorityCount];
+    int running[PriorityCount];
+    ClassStats classStats[PriorityCount];
+    QHash<quint64, Job> active;  // OllamaClient 的请求 id -> 已发出的任务
+    quint64 latestRequest[PriorityCount]; // 各类最近发出的请求 id，被新任务取代时中止
+    bool dispatching;            // dispatch 的循环进行中：start 期间同步到达的结果不再嵌套发出任务
+    quint64 nextJobId;
+    JobJournal *journal;
+    QSet<quint64> unreachable;   // endpointUnreachable 已报告、requestFailed 尚未到达的请求
+    QList<Job> parked;           // 等待服务端恢复的任务
+    QSet<quint64> encoding;      // 截图还在后台编码、尚未写入日志的任务 id
+    QTimer healthTimer;
+    int healthFailures;          // 连续失败的探测次数
+};
+
+#endif // RECOGNITIONSCHEDULER_H
@@ -0,0 +1,197 @@
+#include "regionwatcher.h"
+#include <QtAlgorithms>
+#include <QtMath>
+#include <QElapsedTimer>
+#include <QDebug>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+RegionWatcher::RegionWatcher(CaptureBackend *backend, QObject *parent)
+    : QObject(parent)
+    , backend(backend)
+{
+    timer.setSingleShot(true);
+    connect(&timer, &QTimer::timeout, this, &RegionWatcher::tick);
+}
+
+void RegionWatcher::setSettings(const Settings &settings)
+{
+    current = settings;
+    current.intervalMs = qMax(1, current.intervalMs);
+    current.maxIntervalMs = qMax(current.intervalMs, current.maxIntervalMs);
+    interval = qBound(current.intervalMs, interval, current.maxIntervalMs);
+}
+
+RegionWatcher::Settings RegionWatcher::settings() const
+{
+    return current;
+}
+
+void RegionWatcher::setBackend(CaptureBackend *backend)
+{
+    this->backend = backend;
+}
+
+void RegionWatcher::start(const QRect &region)
+{
+    watched = region;
+    previous = Signature();
+    reference = Signature();
+    interval = current.intervalMs;
+    tick();
+}
+
+void RegionWatcher::stop()
+{
+    timer.stop();
+    watched = QRect();
+    previous = Signature();
+    reference = Signature();
+}
+
+bool RegionWatcher::isActive() const
+{
+    return !watched.isNull();
+}
+
+QRect RegionWatcher::region() const
+{
+    return watched;
+}
+
+int RegionWatcher::currentIntervalMs() const
+{
+    return interval;
+}
+
+void RegionWatcher::schedule(int intervalMs)
+{
+    interval = intervalMs;
+    timer.start(interval);
+}
+
+void RegionWatcher::tick()
+{
+    if (!isActive() || !backend) {
+        return;
+    }
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+    const QImage frame = backend->grab(watched);
+    if (frame.isNull()) {
+        // 区域暂时不可抓取（如屏幕断开）：按最长间隔重试
+        schedule(current.maxIntervalMs);
+        return;
+    }
+    const qint64 grabUs = elapsed.nsecsElapsed() / 1000;
+    const Signature signature = RegionWatcher::signature(frame);
+
+    if (previous.isNull()) {
+        // 第一帧直接识别
+        previous = signature;
+        reference = signature;
+        emit regionChanged(frame);
+        schedule(current.intervalMs);
+        return;
+    }
+
+    // 与上一帧仍有差别说明还在变化（翻页动画、滚动），等稳定后再识别
+    const bool moving = differs(signature, previous);
+    previous = signature;
+    if (moving) {
+        schedule(current.intervalMs);
+        return;
+    }
+
+    if (differs(signature, reference)) {
+        qDebug() << "Watched region changed: grab" << grabUs << "us, compare"
+                 << elapsed.nsecsElapsed() / 1000 - grabUs << "us";
+        reference = signature;
+        emit regionChanged(frame);
+        schedule(current.intervalMs);
+    } else {
+        schedule(qMin(interval * 2, current.maxIntervalMs));
+    }
+}
+
+RegionWatcher::Signature RegionWatcher::signature(const QImage &frame)
+{
+    Signature result;
+    if (frame.isNull()) {
+        return result;
+    }
+    // 区域内容按面积平均缩小，与原图长宽比无关
+    result.thumbnail = frame.scaled(ThumbnailSize, ThumbnailSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation)
+                           .convertToFormat(QImage::Format_Grayscale8);
+    result.hash = dHash(result.thumbnail);
+    return result;
+}
+
+bool RegionWatcher::differs(const Signature &a, const Signature &b) const
+{
+    if (a.isNull() || b.isNull()) {
+        return a.isNull() != b.isNull();
+    }
+    if (hammingDistance(a.hash, b.hash) >= current.hashThreshold) {
+        return true;
+    }
+    const int total = ThumbnailSize * ThumbnailSize;
+    return changedPixels(a.thumbnail, b.thumbnail, PixelThreshold) >= qMax(1, qCeil(total * current.changeFraction));
+}
+
+quint64 RegionWatcher::dHash(const QImage &thumbnail)
+{
+    // 9×8 灰度图中每个像素与右侧像素比较，得到 64 位。
+    // 右侧明显更亮（超过 HashMargin）才记 1：幻灯片大片纯色背景上相邻像素几乎相等，
+    // 直接比较大小会随压缩噪声来回翻转
+    const QImage small = thumbnail.scaled(9, 8, Qt::IgnoreAspectRatio, Qt::SmoothTransformation)
+                             .convertToFormat(QImage::Format_Grayscale8);
+    quint64 hash = 0;
+    for (int y = 0; y < 8; ++y) {
+        const uchar *line = small.constScanLine(y);
+        for (int x = 0; x < 8; ++x) {
+            hash = (hash << 1) | (int(line[x]) + HashMargin < int(line[x + 1]) ? 1 : 0);
+        }
+    }
+    return hash;
+}
+
+int RegionWatcher::hammingDistance(quint64 a, quint64 b)
+{
+    return int(qPopulationCount(a ^ b));
+}
+
+int RegionWatcher::changedPixels(const QImage &a, const QImage &b, int threshold)
+{
+    if (a.size() != b.size() || a.format() != QImage::Format_Grayscale8 || b.format() != QImage::Format_Grayscale8) {
+        return a.width() * a.height();
+    }
+
+    const int width = a.width();
+    int changed = 0;
+    for (int y = 0; y < a.height(); ++y) {
+        const uchar *lineA = a.constScanLine(y);
+        const uchar *lineB = b.constScanLine(y);
+        int x = 0;
+#ifdef __SSE2__
+        // |a - b| 用两个方向的饱和减法之或求得；再减去阈值，结果为 0 的字节即未超过阈值
+        const __m128i limit = _mm_set1_epi8(char(qBound(0, threshold, 255)));
+        const __m128i zero = _mm_setzero_si128();
+        for (; x + 16 <= width; x += 16) {
+            const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(lineA + x));
+            const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(lineB + x));
+            const __m128i diff = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+            const __m128i within = _mm_cmpeq_epi8(_mm_subs_epu8(diff, limit), zero);
+            changed += 16 - int(qPopulationCount(quint32(_mm_movemask_epi8(within))));
+        }
+#endif
+        for (; x < width; ++x) {
+            if (qAbs(int(lineA[x]) - int(lineB[x])) > threshold) {
+                ++changed;
+            }
+        }
+    }
+    return changed;
+}
@@ -0,0 +1,84 @@
+#ifndef REGIONWATCHER_H
+#define REGIONWATCHER_H
+
+#include <QObject>
+#include <QImage>
+#include <QRect>
+#include <QTimer>
+#include "capturebackend.h"
+
+// 监视区域：定时只抓取固定的一块区域（如讲座录像、共享屏幕中的幻灯片），
+// 与上一帧比较，内容变化并稳定下来后发出 regionChanged 交给识别。
+// 每帧先缩成 64×64 灰度缩略图，比较两项：
+//   - dHash（9×8 亮度梯度的 64 位指纹）的汉明距离，对视频压缩噪声不敏感，捕捉整体变化；
+//   - 缩略图逐像素差超过 PixelThreshold 的比例（SSE2 每次比较 16 个像素），捕捉新增一行公式这类局部变化。
+// 内容不变时抓取间隔逐次翻倍直到 maxIntervalMs，空闲时几乎不占 CPU
+class RegionWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    struct Settings
+    {
+        int intervalMs = 500;         // 内容变化后的抓取间隔
+        int maxIntervalMs = 4000;     // 内容不变时间隔逐次翻倍的上限
+        int hashThreshold = 6;        // dHash 汉明距离达到该值视为变化（0–64）
+        qreal changeFraction = 0.01;  // 缩略图中变化像素的比例达到该值视为变化
+    };
+
+    // 帧的比较依据
+    struct Signature
+    {
+        QImage thumbnail;   // ThumbnailSize×ThumbnailSize，Format_Grayscale8
+        quint64 hash = 0;   // dHash
+        bool isNull() const { return thumbnail.isNull(); }
+    };
+
+    static const int ThumbnailSize = 64;
+    // 缩略图像素差超过该值才计入变化，滤掉压缩噪声和光标闪烁的边缘
+    static const int PixelThreshold = 24;
+    // dHash 中相邻像素亮度差超过该值才算“右侧更亮”
+    static const int HashMargin = 2;
+
+    // backend 由调用方持有，须在监视期间保持有效
+    explicit RegionWatcher(CaptureBackend *backend, QObject *parent = nullptr);
+
+    void setSettings(const Settings &settings);
+    Settings settings() const;
+    void setBackend(CaptureBackend *backend);
+
+    // region 为逻辑坐标；开始后立即抓取第一帧并发出 regionChanged
+    void start(const QRect &region);
+    void stop();
+    bool isActive() const;
+    QRect region() const;
+    // 下一次抓取前的等待时间
+    int currentIntervalMs() const;
+
+    static Signature signature(const QImage &frame);
+    bool differs(const Signature &a, const Signature &b) const;
+
+    static quint64 dHash(const QImage &thumbnail);
+    static int hammingDistance(quint64 a, quint64 b);
+    // 两张同样大小的 Grayscale8 图像中差值超过 threshold 的像素数
+    static int changedPixels(const QImage &a, const QImage &b, int threshold);
+
+signals:
+    // 内容变化并稳定后的一帧（设备像素）
+    void regionChanged(const QImage &frame);
+
+private slots:
+    void tick();
+
+private:
+    void schedule(int intervalMs);
+
+    CaptureBackend *backend;
+    Settings current;
+    QTimer timer;
+    QRect watched;
+    int interval = 0;
+    Signature previous;   // 上一次抓取的帧
+    Signature reference;  // 上一次发出 regionChanged 的帧
+};
+
+#endif // REGIONWATCHER_H
@@ -0,0 +1,219 @@
+#include <QTest>
+#include <QSignalSpy>
+#include <QPainter>
+#include "regionwatcher.h"
+#include "benchmarkutils.h"
+
+// 按脚本返回帧的截图后端：flicker 时每次抓取在两帧之间交替，模拟翻页动画
+class FakeCaptureBackend : public CaptureBackend
+{
+public:
+    QString name() const override { return "fake"; }
+    QImage grab(const QRect &region) override
+    {
+        Q_UNUSED(region);
+        ++grabs;
+        if (!alternate.isNull() && grabs % 2 == 0) {
+            return alternate;
+        }
+        return frame;
+    }
+
+    QImage frame;
+    QImage alternate;
+    int grabs = 0;
+};
+
+class RegionWatcherTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // 测试 SSE2 路径与逐像素比较的结果一致（含宽度不是 16 的倍数的尾部）
+    void testChangedPixels();
+
+    // 测试轻微噪声不改变指纹，换页和新增一行公式视为变化
+    void testNoiseIgnored();
+    void testSlideChangeDetected();
+    void testNewLineDetected();
+
+    // 测试只在内容变化并稳定后发出 regionChanged
+    void testEmitsOnlyOnChange();
+    void testWaitsForStableFrame();
+
+    // 测试内容不变时抓取间隔翻倍，停止后不再抓取
+    void testIdleBackoff();
+    void testStop();
+
+    // 一帧 1280×720 区域的指纹计算与比较耗时
+    void benchSignature();
+
+private:
+    static RegionWatcher::Settings fastSettings();
+    // 在图像上叠加 ±amplitude 的确定性噪声，模拟视频压缩
+    static QImage withNoise(const QImage &image, int amplitude);
+};
+
+RegionWatcher::Settings RegionWatcherTest::fastSettings()
+{
+    RegionWatcher::Settings settings;
+    settings.intervalMs = 10;
+    settings.maxIntervalMs = 80;
+    return settings;
+}
+
+QImage RegionWatcherTest::withNoise(const QImage &image, int amplitude)
+{
+    QImage noisy = image.convertToFormat(QImage::Format_RGB32);
+    for (int y = 0; y < noisy.height(); ++y) {
+        QRgb *line = reinterpret_cast<QRgb *>(noisy.scanLine(y));
+        for (int x = 0; x < noisy.width(); ++x) {
+            const int delta = (x * 7 + y * 13) % (2 * amplitude + 1) - amplitude;
+            const int r = qBound(0, qRed(line[x]) + delta, 255);
+            const int g = qBound(0, qGreen(line[x]) + delta, 255);
+            const int b = qBound(0, qBlue(line[x]) + delta, 255);
+            line[x] = qRgb(r, g, b);
+        }
+    }
+    return noisy;
+}
+
+void RegionWatcherTest::testChangedPixels()
+{
+    for (const QSize &size : {QSize(64, 64), QSize(70, 5)}) {
+        QImage a(size, QImage::Format_Grayscale8);
+        QImage b(size, QImage::Format_Grayscale8);
+        int expected = 0;
+        for (int y = 0; y < size.height(); ++y) {
+            for (int x = 0; x < size.width(); ++x) {
+                const int va = (x * 37 + y * 101) % 256;
+                const int vb = (x * 53 + y * 29) % 256;
+                a.scanLine(y)[x] = uchar(va);
+                b.scanLine(y)[x] = uchar(vb);
+                expected += qAbs(va - vb) > RegionWatcher::PixelThreshold ? 1 : 0;
+            }
+        }
+        QCOMPARE(RegionWatcher::changedPixels(a, b, RegionWatcher::PixelThreshold), expected);
+        QCOMPARE(RegionWatcher::changedPixels(a, a, RegionWatcher::PixelThreshold), 0);
+    }
+}
+
+void RegionWatcherTest::testNoiseIgnored()
+{
+    const QImage slide = BenchmarkUtils::renderFormulaImage(QSize(960, 540));
+    RegionWatcher watcher(nullptr);
+    const RegionWatcher::Signature clean = RegionWatcher::signature(slide);
+    const RegionWatcher::Signature noisy = RegionWatcher::signature(withNoise(slide, 3));
+    QVERIFY(RegionWatcher::hammingDistance(clean.hash, noisy.hash) < watcher.settings().hashThreshold);
+    QVERIFY(!watcher.differs(clean, noisy));
+}
+
+void RegionWatcherTest::testSlideChangeDetected()
+{
+    RegionWatcher watcher(nullptr);
+    const RegionWatcher::Signature first = RegionWatcher::signature(BenchmarkUtils::renderFormulaImage(QSize(960, 540), 0));
+    const RegionWatcher::Signature second = RegionWatcher::signature(BenchmarkUtils::renderFormulaImage(QSize(960, 540), 1));
+    QVERIFY(watcher.differs(first, second));
+}
+
+void RegionWatcherTest::testNewLineDetected()
+{
+    // 幻灯片下方逐步出现一行公式：整体布局不变，只有局部像素变化
+    QImage before(960, 540, QImage::Format_RGB32);
+    before.fill(Qt::white);
+    QImage after = before;
+    QPainter painter(&after);
+    painter.fillRect(QRect(80, 420, 400, 32), Qt::black);
+    painter.end();
+
+    RegionWatcher watcher(nullptr);
+    QVERIFY(watcher.differs(RegionWatcher::signature(before), RegionWatcher::signature(after)));
+}
+
+void RegionWatcherTest::testEmitsOnlyOnChange()
+{
+    FakeCaptureBackend backend;
+    backend.frame = BenchmarkUtils::renderFormulaImage(QSize(640, 360), 0);
+    RegionWatcher watcher(&backend);
+    watcher.setSettings(fastSettings());
+    QSignalSpy spy(&watcher, &RegionWatcher::regionChanged);
+
+    // 开始时立即识别第一帧
+    watcher.start(QRect(0, 0, 640, 360));
+    QCOMPARE(spy.count(), 1);
+    QTest::qWait(200);
+    QCOMPARE(spy.count(), 1);
+
+    backend.frame = BenchmarkUtils::renderFormulaImage(QSize(640, 360), 1);
+    QTRY_COMPARE(spy.count(), 2);
+    QCOMPARE(spy.last().first().value<QImage>(), backend.frame);
+    QTest::qWait(200);
+    QCOMPARE(spy.count(), 2);
+}
+
+void RegionWatcherTest::testWaitsForStableFrame()
+{
+    FakeCaptureBackend backend;
+    backend.frame = BenchmarkUtils::renderFormulaImage(QSize(640, 360), 0);
+    RegionWatcher watcher(&backend);
+    watcher.setSettings(fastSettings());
+    QSignalSpy spy(&watcher, &RegionWatcher::regionChanged);
+    watcher.start(QRect(0, 0, 640, 360));
+
+    // 两帧来回切换期间不识别
+    backend.alternate = BenchmarkUtils::renderFormulaImage(QSize(640, 360), 1);
+    QTest::qWait(200);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(watcher.currentIntervalMs(), fastSettings().intervalMs);
+
+    backend.frame = BenchmarkUtils::renderFormulaImage(QSize(640, 360), 2);
+    backend.alternate = QImage();
+    QTRY_COMPARE(spy.count(), 2);
+}
+
+void RegionWatcherTest::testIdleBackoff()
+{
+    FakeCaptureBackend backend;
+    backend.frame = BenchmarkUtils::renderFormulaImage(QSize(640, 360));
+    RegionWatcher watcher(&backend);
+    watcher.setSettings(fastSettings());
+    watcher.start(QRect(0, 0, 640, 360));
+
+    QTRY_COMPARE(watcher.currentIntervalMs(), fastSettings().maxIntervalMs);
+    // 间隔固定为 10 ms 时 800 ms 内约抓取 80 次，翻倍到 80 ms 后约 10 次
+    const int grabsBefore = backend.grabs;
+    QTest::qWait(800);
+    QVERIFY2(backend.grabs - grabsBefore <= 15, qPrintable(QString::number(backend.grabs - grabsBefore)));
+}
+
+void RegionWatcherTest::testStop()
+{
+    FakeCaptureBackend backend;
+    backend.frame = BenchmarkUtils::renderFormulaImage(QSize(640, 360));
+    RegionWatcher watcher(&backend);
+    watcher.setSettings(fastSettings());
+    watcher.start(QRect(0, 0, 640, 360));
+    QVERIFY(watcher.isActive());
+
+    watcher.stop();
+    QVERIFY(!watcher.isActive());
+    const int grabs = backend.grabs;
+    QTest::qWait(100);
+    QCOMPARE(backend.grabs, grabs);
+}
+
+void RegionWatcherTest::benchSignature()
+{
+    const QImage first = BenchmarkUtils::renderFormulaImage(QSize(1280, 720), 0);
+    const QImage second = withNoise(first, 3);
+    RegionWatcher watcher(nullptr);
+    const RegionWatcher::Signature reference = RegionWatcher::signature(first);
+    bool changed = true;
+    QBENCHMARK {
+        changed = watcher.differs(RegionWatcher::signature(second), reference);
+    }
+    QVERIFY(!changed);
+}
+
+QTEST_MAIN(RegionWatcherTest)
+#include "regionwatcher_test.moc"
@@ -0,0 +1,371 @@
+#include "responsepostprocessor.h"
+#include <QRegularExpression>
+#include <QStringList>
+#include <QVector>
+
+namespace {
+
+bool hasDelimiters(const QString &text)
+{
+    return text.contains('$') || text.contains("\\(") || text.contains("\\[");
+}
+
+bool containsMath(const QString &text)
+{
+    return hasDelimiters(text) || text.contains("\\begin{");
+}
+
+// 没有公式、只是模型的客套话或引导语的行
+bool isChatter(const QString &line)
+{
+    static const QRegularExpression pattern(
+            "^(sure|certainly|of course|here|the (formula|formulas|equation|equations|expression|math)|"
+            "this (image|formula|equation)|in the image|i hope|let me|note|以下|图中|图片中|这是|公式如下|希望)",
+            QRegularExpression::CaseInsensitiveOption);
+    const QString trimmed = line.trimmed();
+    if (trimmed.isEmpty() || containsMath(trimmed) || trimmed.contains('\\')) {
+        return false;
+    }
+    return trimmed.endsWith(':') || trimmed.endsWith(QChar(0xFF1A)) || pattern.match(trimmed).hasMatch();
+}
+
+bool isMathFence(const QString &language)
+{
+    return language == "latex" || language == "tex" || language == "math" || language == "katex";
+}
+
+bool isAsciiLetter(QChar c)
+{
+    const ushort u = c.unicode();
+    return (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z');
+}
+
+// 第一步（按行）：去掉代码块标记，以及代码块外或首尾的说明文字
+QString stripWrappers(const QString &response, bool *strippedFence, bool *strippedChatter)
+{
+    QStringList lines = response.split('\n');
+    for (QString &line : lines) {
+        if (line.endsWith('\r')) {
+            line.chop(1);
+        }
+    }
+
+    struct Piece
+    {
+        QString text;
+        bool fenced;
+    };
+    QVector<Piece> pieces;
+    QStringList block;
+    QString fenceLanguage;
+    bool inFence = false;
+    bool anyFence = false;
+
+    auto closeBlock = [&]() {
+        const QString content = block.join('\n').trimmed();
+        if (!content.isEmpty()) {
+            // latex 代码块里通常是不带定界符的公式
+            if (isMathFence(fenceLanguage) && !hasDelimiters(content)) {
+                pieces.append({"$$" + content + "$$", true});
+            } else {
+                pieces.append({content, true});
+            }
+        }
+        block.clear();
+    };
+
+    for (const QString &line : lines) {
+        const QString trimmed = line.trimmed();
+        if (trimmed.startsWith("```") || trimmed.startsWith("~~~")) {
+            if (inFence) {
+                closeBlock();
+                inFence = false;
+            } else {
+                inFence = true;
+                anyFence = true;
+                fenceLanguage = trimmed.mid(3).trimmed().toLower();
+            }
+            continue;
+        }
+        if (inFence) {
+            block << line;
+        } else {
+            pieces.append({line, false});
+        }
+    }
+    // 响应被截断时代码块可能没有结束标记
+    if (inFence) {
+        closeBlock();
+    }
+
+    if (anyFence) {
+        *strippedFence = true;
+        // 代码块外只保留含公式的行
+        QStringList kept;
+        for (const Piece &piece : pieces) {
+            if (piece.fenced || hasDelimiters(piece.text)) {
+                kept << piece.text;
+            } else if (!piece.text.trimmed().isEmpty()) {
+                *strippedChatter = true;
+            }
+        }
+        return kept.join("\n\n");
+    }
+
+    if (!containsMath(response)) {
+        return response.trimmed();
+    }
+
+    // 没有代码块：只去掉首尾的说明文字，公式之间的文字可能是内容的一部分
+    int first = 0;
+    int last = lines.size() - 1;
+    while (first <= last && (lines.at(first).trimmed().isEmpty() || isChatter(lines.at(first)))) {
+        *strippedChatter = *strippedChatter || !lines.at(first).trimmed().isEmpty();
+        ++first;
+    }
+    while (last >= first && (lines.at(last).trimmed().isEmpty() || isChatter(lines.at(last)))) {
+        *strippedChatter = *strippedChatter || !lines.at(last).trimmed().isEmpty();
+        --last;
+    }
+    return lines.mid(first, last - first + 1).join('\n').trimmed();
+}
+
+// 第二步（逐字符一遍）：统一定界符并检查配对
+class Scanner
+{
+public:
+    Scanner(const QString &input, ResponsePostProcessor::Result *result)
+        : in(input), result(result)
+    {
+        out.reserve(in.size() + 16);
+    }
+
+    QString run()
+    {
+        const int n = in.size();
+        int i = 0;
+        while (i < n) {
+            const QChar c = in.at(i);
+
+            if (c == '\\' && i + 1 < n) {
+                const QChar next = in.at(i + 1);
+                if (mode == NoMath && next == '(') {
+                    openMath(ParenInline, "$");
+                    i = skipSpaces(i + 2);
+                } else if (mode == NoMath && next == '[') {
+                    openMath(BracketDisplay, "$$");
+                    i += 2;
+                } else if (mode == ParenInline && next == ')') {
+                    closeMath("$");
+                    i += 2;
+                } else if (mode == BracketDisplay && next == ']') {
+                    closeMath("$$");
+                    i += 2;
+                } else if (isAsciiLetter(next)) {
+                    i = command(i);
+                } else {
+                    // \{ \} \\ \$ 等转义字符原样保留，不参与配对
+                    out += c;
+                    out += next;
+                    i += 2;
+                }
+                continue;
+            }
+
+            if (c == '$') {
+                const bool doubled = i + 1 < n && in.at(i + 1) == '$';
+                if (mode == NoMath) {
+                    if (doubled) {
+                        openMath(DollarDisplay, "$$");
+                        i += 2;
+                    } else {
+                        openMath(DollarInline, "$");
+                        i = skipSpaces(i + 1);
+                    }
+                } else if (mode == DollarDisplay && doubled) {
+                    closeMath("$$");
+                    i += 2;
+                } else if (mode == DollarInline) {
+                    // "$a$$b$" 是两个相邻的行内公式
+                    closeMath("$");
+                    i += 1;
+                } else {
+                    fail("unexpected '$' inside a formula");
+                    out += c;
+                    i += 1;
+                }
+                continue;
+            }
+
+            if (c == '{') {
+                ++braceDepth;
+            } else if (c == '}') {
+                if (braceDepth == (mode == NoMath ? 0 : braceAtOpen)) {
+                    fail(where() + "unmatched '}'");
+                } else {
+                    --braceDepth;
+                }
+            }
+            out += c;
+            ++i;
+        }
+
+        if (mode != NoMath) {
+            fail(where() + "missing closing delimiter");
+            checkBalance(where());
+            mode = NoMath;
+        }
+        // 公式之外（没有定界符的裸 LaTeX）
+        braceAtOpen = 0;
+        leftAtOpen = 0;
+        envAtOpen = 0;
+        checkBalance(QString());
+        return out;
+    }
+
+private:
+    enum MathMode { NoMath, DollarInline, DollarDisplay, ParenInline, BracketDisplay };
+
+    int skipSpaces(int i) const
+    {
+        while (i < in.size() && (in.at(i) == ' ' || in.at(i) == '\t')) {
+            ++i;
+        }
+        return i;
+    }
+
+    // 处理 \name，返回命令之后的位置
+    int command(int i)
+    {
+        const int n = in.size();
+        int end = i + 1;
+        while (end < n && isAsciiLetter(in.at(end))) {
+            ++end;
+        }
+        const QStringRef name = in.midRef(i + 1, end - i - 1);
+        out += in.midRef(i, end - i);
+
+        if (name == QLatin1String("begin") || name == QLatin1String("end")) {
+            const int open = skipSpaces(end);
+            const int close = open < n && in.at(open) == '{' ? in.indexOf('}', open) : -1;
+            if (close < 0) {
+                // 没有环境名，交给花括号检查
+                return end;
+            }
+            out += in.midRef(end, close + 1 - end);
+            const QString environment = in.mid(open + 1, close - open - 1).trimmed();
+            if (name == QLatin1String("begin")) {
+                environments.append(environment);
+            } else if (environments.size() <= (mode == NoMath ? 0 : envAtOpen)) {
+                fail(where() + "\\end{" + environment + "} without \\begin");
+            } else if (environments.last() != environment) {
+                fail(where() + "\\end{" + environment + "} does not match \\begin{" + environments.last() + "}");
+                environments.removeLast();
+            } else {
+                environments.removeLast();
+            }
+            return close + 1;
+        }
+
+        if (name == QLatin1String("left")) {
+            ++leftDepth;
+        } else if (name == QLatin1String("right")) {
+            if (leftDepth == (mode == NoMath ? 0 : leftAtOpen)) {
+                fail(where() + "\\right without \\left");
+            } else {
+                --leftDepth;
+            }
+        }
+        return end;
+    }
+
+    void openMath(MathMode m, const char *delimiter)
+    {
+        out += QLatin1String(delimiter);
+        mode = m;
+        mathStart = out.size();
+        braceAtOpen = braceDepth;
+        leftAtOpen = leftDepth;
+        envAtOpen = environments.size();
+    }
+
+    void closeMath(const char *delimiter)
+    {
+        // pandoc 要求行内公式的定界符内侧不能是空白
+        if (mode == DollarInline || mode == ParenInline) {
+            while (out.size() > mathStart && (out.at(out.size() - 1) == ' ' || out.at(out.size() - 1) == '\t')) {
+                out.chop(1);
+            }
+        }
+        out += QLatin1String(delimiter);
+        checkBalance(where());
+        mode = NoMath;
+        result->formulaCount++;
+    }
+
+    // 公式结束时检查其内部的配对，并恢复到公式开始前的状态，
+    // 一个公式的问题不会连累后面的公式
+    void checkBalance(const QString &prefix)
+    {
+        if (braceDepth > braceAtOpen) {
+            fail(prefix + "unclosed '{'");
+        }
+        if (leftDepth > leftAtOpen) {
+            fail(prefix + "\\left without \\right");
+        }
+        if (environments.size() > envAtOpen) {
+            fail(prefix + "\\begin{" + environments.last() + "} is not closed");
+        }
+        braceDepth = braceAtOpen;
+        leftDepth = leftAtOpen;
+        while (environments.size() > envAtOpen) {
+            environments.removeLast();
+        }
+    }
+
+    QString where() const
+    {
+        return mode == NoMath ? QString() : QString("formula %1: ").arg(result->formulaCount + 1);
+    }
+
+    void fail(const QString &message)
+    {
+        if (result->valid) {
+            result->valid = false;
+            result->error = message;
+        }
+    }
+
+    const QString &in;
+    ResponsePostProcessor::Result *result;
+    QString out;
+    MathMode mode = NoMath;
+    int mathStart = 0;
+    int braceDepth = 0;
+    int leftDepth = 0;
+    QStringList environments;
+    int braceAtOpen = 0;
+    int leftAtOpen = 0;
+    int envAtOpen = 0;
+};
+
+} // namespace
+
+ResponsePostProcessor::Result ResponsePostProcessor::process(const QString &response)
+{
+    Result result;
+    const QString stripped = stripWrappers(response, &result.strippedFence, &result.strippedChatter);
+    Scanner scanner(stripped, &result);
+    result.markdown = scanner.run();
+    return result;
+}
+
+QString ResponsePostProcessor::reaskPrompt(const Result &result)
+{
+    return QString("Your previous transcription of this image is malformed (%1):\n%2\n\n"
+                   "Transcribe the mathematical formulas in this image again. "
+                   "Output only the formulas, using $...$ for inline and $$...$$ for display math, "
+                   "with balanced braces and matching \\begin/\\end environments. "
+                   "No explanations and no code fences.")
+            .arg(result.error, result.markdown);
+}
@@ -0,0 +1,28 @@
+#ifndef RESPONSEPOSTPROCESSOR_H
+#define RESPONSEPOSTPROCESSOR_H
+
+#include <QString>
+
+// 模型响应的后处理：去掉 ``` 代码块包裹和前后的说明文字，
+// 将 \(...\)、\[...\] 统一为 $...$、$$...$$，同时检查花括号、
+// \left/\right、\begin/\end 环境和 $ 定界符是否配对。
+class ResponsePostProcessor
+{
+public:
+    struct Result
+    {
+        QString markdown;          // 清理后的 Markdown
+        bool valid = true;         // 全部配对
+        QString error;             // 第一个配对问题（英文，用于日志和重新提问）
+        int formulaCount = 0;      // 带定界符的公式数
+        bool strippedFence = false;
+        bool strippedChatter = false;
+    };
+
+    static Result process(const QString &response);
+
+    // 校验失败后重新提问使用的提示词：指出问题并要求只输出公式
+    static QString reaskPrompt(const Result &result);
+};
+
+#endif // RESPONSEPOSTPROCESSOR_H
@@ -0,0 +1,161 @@
+#include <QTest>
+#include <QElapsedTimer>
+#include "responsepostprocessor.h"
+
+class ResponsePostProcessorTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // 测试清理与定界符统一
+    void testNormalize_data();
+    void testNormalize();
+
+    // 测试配对检查
+    void testValidation_data();
+    void testValidation();
+
+    // 测试重新提问的提示词
+    void testReaskPrompt();
+
+    // 测试在响应样本集上的解析耗时
+    void benchCorpus();
+
+private:
+    static QStringList corpus();
+};
+
+// 模型实际输出的典型形态：裸公式、代码块、客套话、\( \) 与 \[ \]、多行环境、截断的响应
+QStringList ResponsePostProcessorTest::corpus()
+{
+    return {
+        "$$E = mc^2$$",
+        "$x^2 + y^2 = r^2$",
+        "```latex\n\\int_0^\\infty e^{-x^2} \\, dx = \\frac{\\sqrt{\\pi}}{2}\n```",
+        "```markdown\n$$\\sum_{n=1}^{\\infty} \\frac{1}{n^2} = \\frac{\\pi^2}{6}$$\n```",
+        "Here is the formula in the image:\n\n$$\\nabla \\times \\mathbf{B} = \\mu_0 \\mathbf{J} + \\mu_0 \\varepsilon_0 \\frac{\\partial \\mathbf{E}}{\\partial t}$$",
+        "Sure! The formula is:\n\\[ f(x) = a_0 + \\sum_{n=1}^{\\infty} \\left( a_n \\cos nx + b_n \\sin nx \\right) \\]\nI hope this helps!",
+        "The quadratic formula \\( x = \\frac{-b \\pm \\sqrt{b^2 - 4ac}}{2a} \\) gives both roots.",
+        "$$\n\\begin{aligned}\n\\det(A - \\lambda I) &= 0 \\\\\n\\lambda^2 - \\operatorname{tr}(A) \\lambda + \\det A &= 0\n\\end{aligned}\n$$",
+        "$$\nf(x) = \\begin{cases} x^2 & x \\ge 0 \\\\ -x & x < 0 \\end{cases}\n$$",
+        "$$\\begin{pmatrix} a & b \\\\ c & d \\end{pmatrix}^{-1} = \\frac{1}{ad - bc} \\begin{pmatrix} d & -b \\\\ -c & a \\end{pmatrix}$$",
+        "$\\lim_{n \\to \\infty} \\left(1 + \\frac{1}{n}\\right)^n = e$ and $\\sum_{k=0}^{n} \\binom{n}{k} = 2^n$",
+        "以下是图中的公式：\n$$\\oint_C \\mathbf{F} \\cdot d\\mathbf{r} = \\iint_S (\\nabla \\times \\mathbf{F}) \\cdot d\\mathbf{S}$$",
+        "$$\\frac{\\partial^2 u}{\\partial t^2} = c^2 \\nabla^2 u$$\n\n$$\\frac{\\partial u}{\\partial t} = \\alpha \\nabla^2 u$$",
+        "```latex\n\\begin{equation}\n\\hat{H} \\psi = E \\psi\n\\end{equation}\n```",
+        "$$P(A \\mid B) = \\frac{P(B \\mid A) P(A)}{P(B)}$$",
+        "$$\\frac{a}{b$$",
+        "$$\\left( \\frac{1}{2}$$",
+        "```latex\n\\begin{bmatrix} 1 & 0 \\\\ 0 & 1\n```",
+    };
+}
+
+void ResponsePostProcessorTest::testNormalize_data()
+{
+    QTest::addColumn<QString>("response");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("plain") << "$$E = mc^2$$" << "$$E = mc^2$$";
+    QTest::newRow("latex fence") << "```latex\nE = mc^2\n```" << "$$E = mc^2$$";
+    QTest::newRow("markdown fence") << "```markdown\n$x$ and $y$\n```" << "$x$ and $y$";
+    QTest::newRow("fence with chatter") << "Here it is:\n```latex\nx^2\n```\nLet me know!" << "$$x^2$$";
+    QTest::newRow("unterminated fence") << "```latex\nx^2" << "$$x^2$$";
+    QTest::newRow("leading chatter") << "The formula is:\n$$a+b$$" << "$$a+b$$";
+    QTest::newRow("trailing chatter") << "$$a+b$$\n\nI hope this helps!" << "$$a+b$$";
+    QTest::newRow("chinese chatter") << "图中的公式如下：\n$$a+b$$" << "$$a+b$$";
+    QTest::newRow("interior text kept") << "$a$\nwhere\n$b$" << "$a$\nwhere\n$b$";
+    QTest::newRow("paren") << "\\( x^2 \\)" << "$x^2$";
+    QTest::newRow("bracket") << "\\[ \\frac{1}{2} \\]" << "$$ \\frac{1}{2} $$";
+    QTest::newRow("inline spaces") << "$ x + 1 $" << "$x + 1$";
+    QTest::newRow("adjacent inline") << "$a$$b$" << "$a$$b$";
+    QTest::newRow("escaped dollar") << "costs \\$5" << "costs \\$5";
+    QTest::newRow("escaped braces") << "$\\{x\\}$" << "$\\{x\\}$";
+    QTest::newRow("crlf") << "Sure:\r\n$$x$$\r\n" << "$$x$$";
+    QTest::newRow("no math untouched") << "model=mock images=1" << "model=mock images=1";
+}
+
+void ResponsePostProcessorTest::testNormalize()
+{
+    QFETCH(QString, response);
+    QFETCH(QString, expected);
+
+    ResponsePostProcessor::Result result = ResponsePostProcessor::process(response);
+    QCOMPARE(result.markdown, expected);
+    QVERIFY2(result.valid, qPrintable(result.error));
+}
+
+void ResponsePostProcessorTest::testValidation_data()
+{
+    QTest::addColumn<QString>("response");
+    QTest::addColumn<bool>("valid");
+    QTest::addColumn<QString>("errorPart");
+
+    QTest::newRow("balanced") << "$$\\frac{a}{b}$$" << true << "";
+    QTest::newRow("unclosed brace") << "$$\\frac{a}{b$$" << false << "unclosed '{'";
+    QTest::newRow("extra brace") << "$$a}$$" << false << "unmatched '}'";
+    QTest::newRow("left without right") << "$$\\left( x$$" << false << "\\left without \\right";
+    QTest::newRow("right without left") << "$$x \\right)$$" << false << "\\right without \\left";
+    QTest::newRow("left right dot") << "$$\\left. x \\right|$$" << true << "";
+    QTest::newRow("env mismatch") << "$$\\begin{matrix} a \\end{pmatrix}$$" << false << "does not match";
+    QTest::newRow("env unclosed") << "$$\\begin{cases} a$$" << false << "is not closed";
+    QTest::newRow("bare env") << "\\begin{aligned} a &= b \\end{aligned}" << true << "";
+    QTest::newRow("missing delimiter") << "$$x" << false << "missing closing delimiter";
+    QTest::newRow("paren unclosed") << "\\( x" << false << "missing closing delimiter";
+    QTest::newRow("error numbered") << "$a$ $b{$" << false << "formula 2";
+    // 第一个公式的问题不影响后面的公式
+    QTest::newRow("isolated") << "$a{$ $b$" << false << "formula 1";
+}
+
+void ResponsePostProcessorTest::testValidation()
+{
+    QFETCH(QString, response);
+    QFETCH(bool, valid);
+    QFETCH(QString, errorPart);
+
+    ResponsePostProcessor::Result result = ResponsePostProcessor::process(response);
+    QCOMPARE(result.valid, valid);
+    QVERIFY2(result.error.contains(errorPart), qPrintable(result.error));
+}
+
+void ResponsePostProcessorTest::testReaskPrompt()
+{
+    ResponsePostProcessor::Result result = ResponsePostProcessor::process("$$\\frac{a}{b$$");
+    QVERIFY(!result.valid);
+    const QString prompt = ResponsePostProcessor::reaskPrompt(result);
+    QVERIFY(prompt.contains(result.error));
+    QVERIFY(prompt.contains("$$\\frac{a}{b$$"));
+}
+
+void ResponsePostProcessorTest::benchCorpus()
+{
+    const QStringList responses = corpus();
+    int chars = 0;
+    for (const QString &response : responses) {
+        chars += response.size();
+    }
+
+    int invalid = 0;
+    QElapsedTimer timer;
+    timer.start();
+    const int rounds = 1000;
+    for (int round = 0; round < rounds; ++round) {
+        for (const QString &response : responses) {
+            invalid += ResponsePostProcessor::process(response).valid ? 0 : 1;
+        }
+    }
+    const qint64 totalNs = timer.nsecsElapsed();
+    QCOMPARE(invalid, 3 * rounds);
+    qDebug("%d responses, %d chars: %.2f us per response, %.1f MB/s",
+           responses.size(), chars,
+           totalNs / 1000.0 / (rounds * responses.size()),
+           chars * rounds * 2.0 / (totalNs / 1e9) / (1024 * 1024));
+
+    QBENCHMARK {
+        for (const QString &response : responses) {
+            ResponsePostProcessor::process(response);
+        }
+    }
+}
+
+QTEST_MAIN(ResponsePostProcessorTest)
+#include "responsepostprocessor_test.moc"
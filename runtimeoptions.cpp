@@ -0,0 +1,97 @@
+#include "runtimeoptions.h"
+#include <QHostAddress>
+#include <QUrl>
+
+void RuntimeOptions::apply(const Settings &settings, const QString &url, const HardwareInfo::Info &hardware,
+                           QJsonObject *options)
+{
+    if (!settings.enabled) {
+        return;
+    }
+    if (settings.numThread > 0) {
+        (*options)["num_thread"] = settings.numThread;
+    } else if (isLocalEndpoint(url)) {
+        // 远程端点的核心数在这里无从得知，交给服务端或校准
+        (*options)["num_thread"] = recommendedThreads(hardware);
+    }
+    if (settings.numBatch > 0) {
+        (*options)["num_batch"] = settings.numBatch;
+    }
+    // 只发送与 Ollama 默认值不同的项
+    if (!settings.useMmap) {
+        (*options)["use_mmap"] = false;
+    }
+    if (settings.useMlock) {
+        (*options)["use_mlock"] = true;
+    }
+}
+
+int RuntimeOptions::recommendedThreads(const HardwareInfo::Info &hardware)
+{
+    // 解码受内存带宽限制：SMT 的两个线程共用一个核心的执行单元，多开只会互相争抢；
+    // 跨 NUMA 节点的线程访问远端内存，多数情况下比只用一个节点更慢
+    return hardware.coresPerNode();
+}
+
+QString RuntimeOptions::endpointKey(const QString &url)
+{
+    const QUrl parsed(url);
+    if (!parsed.isValid() || parsed.host().isEmpty()) {
+        return url;
+    }
+    const int port = parsed.port(parsed.scheme() == "https" ? 443 : 80);
+    return QString("%1://%2:%3").arg(parsed.scheme(), parsed.host().toLower()).arg(port);
+}
+
+bool RuntimeOptions::isLocalEndpoint(const QString &url)
+{
+    const QString host = QUrl(url).host().toLower();
+    if (host == "localhost") {
+        return true;
+    }
+    return QHostAddress(host).isLoopback();
+}
+
+RuntimeOptions::Settings RuntimeOptions::merge(const Settings &settings, const QJsonObject &overrides)
+{
+    Settings merged = settings;
+    if (overrides.contains("enabled")) {
+        merged.enabled = overrides["enabled"].toBool();
+    }
+    if (overrides.contains("numThread")) {
+        merged.numThread = overrides["numThread"].toInt();
+    }
+    if (overrides.contains("numBatch")) {
+        merged.numBatch = overrides["numBatch"].toInt();
+    }
+    if (overrides.contains("useMmap")) {
+        merged.useMmap = overrides["useMmap"].toBool();
+    }
+    if (overrides.contains("useMlock")) {
+        merged.useMlock = overrides["useMlock"].toBool();
+    }
+    return merged;
+}
+
+QJsonObject RuntimeOptions::toJson(const Settings &settings)
+{
+    QJsonObject object;
+    object["enabled"] = settings.enabled;
+    object["numThread"] = settings.numThread;
+    object["numBatch"] = settings.numBatch;
+    object["useMmap"] = settings.useMmap;
+    object["useMlock"] = settings.useMlock;
+    return object;
+}
+
+QString RuntimeOptions::describe(const Settings &settings)
+{
+    if (!settings.enabled) {
+        return "server defaults";
+    }
+    return QString("threads=%1 batch=%2 mmap=%3 mlock=%4")
+        .arg(settings.numThread > 0 ? QString::number(settings.numThread) : QString("auto"))
+        .arg(settings.numBatch > 0 ? QString::number(settings.numBatch) : QString("default"))
+        .arg(settings.useMmap ? "on" : "off")
+        .arg(settings.useMlock ? "on" : "off");
+}
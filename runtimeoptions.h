@@ -0,0 +1,40 @@
+#ifndef RUNTIMEOPTIONS_H
+#define RUNTIMEOPTIONS_H
+
+#include <QJsonObject>
+#include <QString>
+#include "hardwareinfo.h"
+
+// Ollama 推理进程的运行参数：num_thread、num_batch、use_mmap、use_mlock，随每个请求的 options 发送。
+// 这些参数与已加载的模型不一致时 Ollama 会重新加载模型，因此同一端点应始终使用同一组值；
+// 配置按端点（scheme://host:port）保存，校准结果（TuningCalibrator）也写到对应端点下
+class RuntimeOptions
+{
+public:
+    struct Settings
+    {
+        bool enabled = true;    // false 时不发送任何运行参数，使用服务端默认值
+        int numThread = 0;      // 0：端点在本机时按 HardwareInfo 推算，远程端点不发送
+        int numBatch = 0;       // 预填充的批大小，0 不发送
+        bool useMmap = true;    // false 时发送 use_mmap=false（权重完整读入内存）
+        bool useMlock = false;  // true 时发送 use_mlock=true（锁定在内存中，不被换出）
+    };
+
+    // 按设置写入 options；url 用于判断端点是否在本机
+    static void apply(const Settings &settings, const QString &url, const HardwareInfo::Info &hardware,
+                      QJsonObject *options);
+    // 本机上推荐的 num_thread：单个 NUMA 节点上的物理核心数
+    static int recommendedThreads(const HardwareInfo::Info &hardware);
+
+    // 端点的配置键：scheme://host:port（端口缺省时按协议补全），与接口路径无关
+    static QString endpointKey(const QString &url);
+    static bool isLocalEndpoint(const QString &url);
+
+    // 端点的覆盖值（与 Settings 字段同名的 JSON 对象，可以只含部分字段）合并到 settings 上
+    static Settings merge(const Settings &settings, const QJsonObject &overrides);
+    static QJsonObject toJson(const Settings &settings);
+    // 用于日志和校准报告，例如 "threads=8 batch=512 mmap=on mlock=off"
+    static QString describe(const Settings &settings);
+};
+
+#endif // RUNTIMEOPTIONS_H
@@ -0,0 +1,208 @@
+#include <QTest>
+#include <QTemporaryDir>
+#include <QDir>
+#include "runtimeoptions.h"
+
+class RuntimeOptionsTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    // 测试 /proc/cpuinfo 和 /proc/meminfo 的解析
+    void testParseCpuInfo_data();
+    void testParseCpuInfo();
+    void testParseMemInfo();
+    void testCountNumaNodes();
+
+    // 测试按端点写入 options
+    void testApply();
+    void testRecommendedThreads();
+    void testEndpointKey_data();
+    void testEndpointKey();
+    void testMerge();
+
+private:
+    static QByteArray cpuinfo(int sockets, int coresPerSocket, int threadsPerCore, bool topology = true);
+};
+
+// 按 Linux 的格式生成 cpuinfo：每个逻辑 CPU 一段
+QByteArray RuntimeOptionsTest::cpuinfo(int sockets, int coresPerSocket, int threadsPerCore, bool topology)
+{
+    QByteArray text;
+    int processor = 0;
+    for (int thread = 0; thread < threadsPerCore; ++thread) {
+        for (int socket = 0; socket < sockets; ++socket) {
+            for (int core = 0; core < coresPerSocket; ++core) {
+                text += "processor\t: " + QByteArray::number(processor++) + "\n";
+                text += "model name\t: Test CPU @ 3.00GHz\n";
+                if (topology) {
+                    text += "physical id\t: " + QByteArray::number(socket) + "\n";
+                    text += "core id\t\t: " + QByteArray::number(core) + "\n";
+                }
+                text += "\n";
+            }
+        }
+    }
+    return text;
+}
+
+void RuntimeOptionsTest::testParseCpuInfo_data()
+{
+    QTest::addColumn<QByteArray>("cpuinfo");
+    QTest::addColumn<int>("logical");
+    QTest::addColumn<int>("physical");
+    QTest::addColumn<int>("sockets");
+    QTest::addColumn<bool>("smt");
+
+    QTest::newRow("laptop-smt") << cpuinfo(1, 4, 2) << 8 << 4 << 1 << true;
+    QTest::newRow("server-2s-smt") << cpuinfo(2, 16, 2) << 64 << 32 << 2 << true;
+    QTest::newRow("no-smt") << cpuinfo(1, 6, 1) << 6 << 6 << 1 << false;
+    // ARM 的 cpuinfo 没有 physical id / core id：按逻辑 CPU 计
+    QTest::newRow("no-topology") << cpuinfo(1, 8, 1, false) << 8 << 8 << 1 << false;
+}
+
+void RuntimeOptionsTest::testParseCpuInfo()
+{
+    QFETCH(QByteArray, cpuinfo);
+    QFETCH(int, logical);
+    QFETCH(int, physical);
+    QFETCH(int, sockets);
+    QFETCH(bool, smt);
+
+    HardwareInfo::Info info;
+    HardwareInfo::parseCpuInfo(cpuinfo, &info);
+    QCOMPARE(info.logicalCpus, logical);
+    QCOMPARE(info.physicalCores, physical);
+    QCOMPARE(info.sockets, sockets);
+    QCOMPARE(info.smt(), smt);
+
+    // 空输入保留原值
+    HardwareInfo::Info unchanged;
+    unchanged.logicalCpus = 3;
+    HardwareInfo::parseCpuInfo(QByteArray(), &unchanged);
+    QCOMPARE(unchanged.logicalCpus, 3);
+}
+
+void RuntimeOptionsTest::testParseMemInfo()
+{
+    HardwareInfo::Info info;
+    HardwareInfo::parseMemInfo("MemTotal:       65843712 kB\n"
+                               "MemFree:         1234567 kB\n"
+                               "MemAvailable:   43008000 kB\n", &info);
+    QCOMPARE(info.totalMemoryBytes, 65843712LL * 1024);
+    QCOMPARE(info.availableMemoryBytes, 43008000LL * 1024);
+    QVERIFY(info.summary().contains("62.8 GiB"));
+}
+
+void RuntimeOptionsTest::testCountNumaNodes()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QCOMPARE(HardwareInfo::countNumaNodes(dir.filePath("missing")), 1);
+
+    QDir(dir.path()).mkpath("node0");
+    QDir(dir.path()).mkpath("node1");
+    QDir(dir.path()).mkpath("power");
+    QCOMPARE(HardwareInfo::countNumaNodes(dir.path()), 2);
+}
+
+void RuntimeOptionsTest::testApply()
+{
+    HardwareInfo::Info hardware;
+    hardware.logicalCpus = 32;
+    hardware.physicalCores = 16;
+
+    // 本机端点：按物理核心数发送 num_thread，其余保持服务端默认值
+    RuntimeOptions::Settings settings;
+    QJsonObject options;
+    RuntimeOptions::apply(settings, "http://localhost:11434/api/generate", hardware, &options);
+    QCOMPARE(options["num_thread"].toInt(), 16);
+    QVERIFY(!options.contains("num_batch"));
+    QVERIFY(!options.contains("use_mmap"));
+    QVERIFY(!options.contains("use_mlock"));
+
+    // 远程端点：本机的核心数不适用
+    options = QJsonObject();
+    RuntimeOptions::apply(settings, "http://gpu-box:11434/api/generate", hardware, &options);
+    QVERIFY(options.isEmpty());
+
+    settings.numThread = 12;
+    settings.numBatch = 1024;
+    settings.useMmap = false;
+    settings.useMlock = true;
+    RuntimeOptions::apply(settings, "http://gpu-box:11434/api/generate", hardware, &options);
+    QCOMPARE(options["num_thread"].toInt(), 12);
+    QCOMPARE(options["num_batch"].toInt(), 1024);
+    QCOMPARE(options["use_mmap"].toBool(true), false);
+    QCOMPARE(options["use_mlock"].toBool(), true);
+
+    options = QJsonObject();
+    settings.enabled = false;
+    RuntimeOptions::apply(settings, "http://127.0.0.1:11434/api/generate", hardware, &options);
+    QVERIFY(options.isEmpty());
+}
+
+void RuntimeOptionsTest::testRecommendedThreads()
+{
+    HardwareInfo::Info hardware;
+    hardware.logicalCpus = 64;
+    hardware.physicalCores = 32;
+    hardware.sockets = 2;
+    QCOMPARE(RuntimeOptions::recommendedThreads(hardware), 32);
+
+    // 两个 NUMA 节点：只用一个节点上的核心
+    hardware.numaNodes = 2;
+    QCOMPARE(RuntimeOptions::recommendedThreads(hardware), 16);
+}
+
+void RuntimeOptionsTest::testEndpointKey_data()
+{
+    QTest::addColumn<QString>("url");
+    QTest::addColumn<QString>("key");
+    QTest::addColumn<bool>("local");
+
+    QTest::newRow("generate") << "http://localhost:11434/api/generate" << "http://localhost:11434" << true;
+    QTest::newRow("chat") << "http://localhost:11434/api/chat" << "http://localhost:11434" << true;
+    QTest::newRow("loopback") << "http://127.0.0.1:11434/api/generate" << "http://127.0.0.1:11434" << true;
+    QTest::newRow("ipv6") << "http://[::1]:11434/api/generate" << "http://::1:11434" << true;
+    QTest::newRow("default-port") << "https://Ollama.Example.com/api/generate" << "https://ollama.example.com:443" << false;
+    QTest::newRow("remote") << "http://10.0.0.5:11434/api/generate" << "http://10.0.0.5:11434" << false;
+}
+
+void RuntimeOptionsTest::testEndpointKey()
+{
+    QFETCH(QString, url);
+    QFETCH(QString, key);
+    QFETCH(bool, local);
+
+    QCOMPARE(RuntimeOptions::endpointKey(url), key);
+    QCOMPARE(RuntimeOptions::isLocalEndpoint(url), local);
+}
+
+void RuntimeOptionsTest::testMerge()
+{
+    RuntimeOptions::Settings defaults;
+    defaults.numBatch = 256;
+
+    // 端点只覆盖给出的字段
+    QJsonObject overrides;
+    overrides["numThread"] = 8;
+    overrides["useMlock"] = true;
+    overrides["calibratedMs"] = 1234;
+    const RuntimeOptions::Settings merged = RuntimeOptions::merge(defaults, overrides);
+    QCOMPARE(merged.numThread, 8);
+    QCOMPARE(merged.numBatch, 256);
+    QVERIFY(merged.useMmap);
+    QVERIFY(merged.useMlock);
+
+    // toJson 与 merge 互逆
+    const RuntimeOptions::Settings roundTrip = RuntimeOptions::merge(RuntimeOptions::Settings(),
+                                                                     RuntimeOptions::toJson(merged));
+    QCOMPARE(roundTrip.numThread, merged.numThread);
+    QCOMPARE(roundTrip.numBatch, merged.numBatch);
+    QCOMPARE(roundTrip.useMlock, merged.useMlock);
+    QCOMPARE(RuntimeOptions::describe(merged), QString("threads=8 batch=256 mmap=on mlock=on"));
+}
+
+QTEST_MAIN(RuntimeOptionsTest)
+#include "runtimeoptions_test.moc"
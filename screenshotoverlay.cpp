@@ -1,26 +1,56 @@
 #include "screenshotoverlay.h"
 #include <QApplication> // For QApplication::desktop() in older Qt, or QGuiApplication::primaryScreen()
+#include <QElapsedTimer>
 
 ScreenshotOverlay* ScreenshotOverlay::instance = nullptr;
+QString ScreenshotOverlay::backendPreference = "auto";
+bool ScreenshotOverlay::snapEnabled = true;
+QSharedPointer<CaptureBackend> ScreenshotOverlay::backend;
+
+void ScreenshotOverlay::setCaptureBackend(const QString &preference)
+{
+    if (preference != backendPreference) {
+        backendPreference = preference;
+        backend.reset();
+    }
+}
+
+void ScreenshotOverlay::setSnapEnabled(bool enabled)
+{
+    snapEnabled = enabled;
+}
+
+CaptureBackend *ScreenshotOverlay::captureBackend()
+{
+    // 后端（xcb-shm 的连接和共享内存段）在多次截图之间复用
+    if (!backend) {
+        backend.reset(CaptureBackend::create(backendPreference));
+        qDebug() << "Capture backend:" << backend->name();
+    }
+    return backend.data();
+}
 
 ScreenshotOverlay::ScreenshotOverlay(QWidget *parent) : QWidget(parent), selecting(false)
 {
     setWindowFlags(Qt::FramelessWindowHint | Qt::WindowStaysOnTopHint | Qt::Tool);
     setAttribute(Qt::WA_TranslucentBackground);
     setCursor(Qt::CrossCursor);
+    setMouseTracking(snapEnabled); // 未按下鼠标时也要跟踪光标下的公式块
 
     // Grab the entire desktop
     QScreen *screen = QGuiApplication::primaryScreen();
-//    if (screen) {
-//        desktopPixmap = screen->grabWindow(0); // 0 captures the whole screen
-//    }
     if (screen) {
-        desktopPixmap = screen->grabWindow(0); // 0 captures the whole screen
-        qDebug() << "ScreenshotOverlay Constructor: desktopPixmap.isNull():" << desktopPixmap.isNull()
-                 << "Size:" << desktopPixmap.size()
-                 << "Depth:" << desktopPixmap.depth();
-        if (desktopPixmap.isNull()) {
-            qWarning() << "!!! CRITICAL: screen->grabWindow(0) returned a NULL pixmap!";
+        QElapsedTimer grabTimer;
+        grabTimer.start();
+        CaptureBackend *capture = captureBackend();
+        screenOrigin = screen->geometry().topLeft();
+        desktopImage = capture->grab(screen->geometry()); // 覆盖层所在屏幕的全部内容
+        qDebug() << "ScreenshotOverlay Constructor: desktopImage.isNull():" << desktopImage.isNull()
+                 << "Size:" << desktopImage.size()
+                 << "Backend:" << capture->name()
+                 << "Grab:" << grabTimer.nsecsElapsed() / 1000 << "us";
+        if (desktopImage.isNull()) {
+            qWarning() << "!!! CRITICAL: capture backend" << capture->name() << "returned a NULL image!";
         } else {
             // Optional: Save the full desktop grab for initial check
             // QString savePath = QStandardPaths::writableLocation(QStandardPaths::DesktopLocation);
@@ -30,8 +60,14 @@ ScreenshotOverlay::ScreenshotOverlay(QWidget *parent) : QWidget(parent), selecti
     } else {
         qDebug() << "!!! CRITICAL: ScreenshotOverlay Constructor: No primary screen found!";
     }
-    if (!desktopPixmap.isNull()) {
-        resize(desktopPixmap.size());
+    if (!desktopImage.isNull() && snapEnabled) {
+        QElapsedTimer inkTimer;
+        inkTimer.start();
+        inkMap = InkMap(desktopImage);
+        qDebug() << "Ink map:" << inkMap.cellGridSize() << "cells in" << inkTimer.nsecsElapsed() / 1000 << "us";
+    }
+    if (!desktopImage.isNull()) {
+        resize(desktopImage.size() / desktopImage.devicePixelRatio());
     } else {
         qWarning("Failed to grab desktop image in ScreenshotOverlay constructor. Overlay might not work correctly.");
         // Fallback size if grab failed, though functionality will be impaired
@@ -39,14 +75,14 @@ ScreenshotOverlay::ScreenshotOverlay(QWidget *parent) : QWidget(parent), selecti
     }
 }
 
-QPixmap ScreenshotOverlay::takeScreenshot() {
+QPixmap ScreenshotOverlay::takeScreenshot(QRect *selection) {
     if (instance) {
         instance->disconnect(); // Disconnect any previous connections
         instance->deleteLater();
     }
     instance = new ScreenshotOverlay(); // This will call the constructor and grab the screen
-    if (instance->desktopPixmap.isNull()) {
-        qWarning() << "takeScreenshot: Instance created, but its desktopPixmap is null. Aborting.";
+    if (instance->desktopImage.isNull()) {
+        qWarning() << "takeScreenshot: Instance created, but its desktopImage is null. Aborting.";
         instance->deleteLater();
         instance = nullptr;
         return QPixmap(); // Return empty pixmap
@@ -67,12 +103,38 @@ QPixmap ScreenshotOverlay::takeScreenshot() {
     loop.exec(); // This blocks until loop.quit() is called
 
     if (instance) {
+       if (selection) {
+           *selection = capturedPixmap.isNull() ? QRect()
+                                                : instance->capturedRect.translated(instance->screenOrigin);
+       }
        instance->deleteLater();
        instance = nullptr;
+    } else if (selection) {
+       *selection = QRect();
     }
     return capturedPixmap;
 }
 
+QPixmap ScreenshotOverlay::cropSelection(const QPixmap &desktop, const QRect &selection)
+{
+    return desktop.copy(selection);
+}
+
+QPixmap ScreenshotOverlay::cropSelection(const QImage &desktop, const QRect &selection)
+{
+    const qreal dpr = desktop.devicePixelRatio();
+    const QRect device(qRound(selection.x() * dpr), qRound(selection.y() * dpr),
+                       qRound(selection.width() * dpr), qRound(selection.height() * dpr));
+    // 只复制选区，整屏图像（可能是共享内存）随覆盖层一起释放
+    QPixmap cropped = QPixmap::fromImage(desktop.copy(device));
+    cropped.setDevicePixelRatio(1.0);
+    return cropped;
+}
+
+bool ScreenshotOverlay::snapActive(Qt::KeyboardModifiers modifiers) const
+{
+    return !inkMap.isNull() && !(modifiers & Qt::AltModifier);
+}
 
 void ScreenshotOverlay::paintEvent(QPaintEvent *event)
 {
@@ -86,12 +148,20 @@ void ScreenshotOverlay::paintEvent(QPaintEvent *event)
     if (selecting && !selectionRect.isNull()) {
         // Clear the selected area to show what's underneath
         painter.setCompositionMode(QPainter::CompositionMode_Clear);
-        painter.fillRect(selectionRect, Qt::transparent);
+        painter.fillRect(snappedRect, Qt::transparent);
         painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
 
-        // Draw a border around the selection
+        // 吸附后的选区画实线，鼠标实际拖出的范围画虚线
+        if (snappedRect != selectionRect) {
+            painter.setPen(QPen(QColor(255, 255, 255, 160), 1, Qt::DashLine));
+            painter.drawRect(selectionRect);
+        }
         painter.setPen(QPen(Qt::red, 2));
-        painter.drawRect(selectionRect);
+        painter.drawRect(snappedRect);
+    } else if (!selecting && !hoverRect.isNull()) {
+        // 光标下的公式块：单击即按此区域截图
+        painter.setPen(QPen(Qt::red, 1, Qt::DashLine));
+        painter.drawRect(hoverRect);
     }
 }
 
@@ -101,6 +171,7 @@ void ScreenshotOverlay::mousePressEvent(QMouseEvent *event)
         selecting = true;
         startPoint = event->pos();
         selectionRect = QRect(startPoint, QSize());
+        snappedRect = selectionRect;
         update();
     }
 }
@@ -109,7 +180,15 @@ void ScreenshotOverlay::mouseMoveEvent(QMouseEvent *event)
 {
     if (selecting) {
         selectionRect = QRect(startPoint, event->pos()).normalized();
+        snappedRect = snapActive(event->modifiers()) ? inkMap.snap(selectionRect) : selectionRect;
         update();
+    } else {
+        // 积分图上的查询只有几微秒；公式块不变时不重绘
+        const QRect block = snapActive(event->modifiers()) ? inkMap.blockAt(event->pos()) : QRect();
+        if (block != hoverRect) {
+            hoverRect = block;
+            update();
+        }
     }
 }
 
@@ -117,8 +196,14 @@ void ScreenshotOverlay::mouseReleaseEvent(QMouseEvent *event)
 {
     if (event->button() == Qt::LeftButton && selecting) {
         selecting = false;
-        if (!selectionRect.isNull() && selectionRect.width() > 5 && selectionRect.height() > 5) {
-            QPixmap captured = desktopPixmap.copy(selectionRect);
+        // 没有拖动（单击）时使用光标下的公式块
+        QRect target = snappedRect;
+        if ((selectionRect.width() <= 5 || selectionRect.height() <= 5) && !hoverRect.isNull()) {
+            target = hoverRect;
+        }
+        if (!target.isNull() && target.width() > 5 && target.height() > 5) {
+            capturedRect = target;
+            QPixmap captured = cropSelection(desktopImage, target);
             emit screenshotTaken(captured); // Emit the signal
         } else {
             emit screenshotTaken(QPixmap()); // Emit empty pixmap if selection is too small or invalid
@@ -8,14 +8,29 @@
 #include <QScreen>
 #include <QGuiApplication>
 #include <QPainter>
+#include <QSharedPointer>
 #include <QDebug>
+#include "capturebackend.h"
+#include "inkmap.h"
 
 class ScreenshotOverlay : public QWidget
 {
     Q_OBJECT
 public:
     explicit ScreenshotOverlay(QWidget *parent = nullptr);
-    static QPixmap takeScreenshot(); // Static method to initiate and return screenshot
+    // Static method to initiate and return screenshot
+    // selection 不为空时返回选区在虚拟桌面上的逻辑坐标（监视区域模式用它定时重新抓取）
+    static QPixmap takeScreenshot(QRect *selection = nullptr);
+    // 从冻结的桌面截图中裁剪选区（基准测试也直接调用此方法）
+    static QPixmap cropSelection(const QPixmap &desktop, const QRect &selection);
+    // selection 为逻辑坐标，按图像的 devicePixelRatio 换算后裁剪
+    static QPixmap cropSelection(const QImage &desktop, const QRect &selection);
+
+    // 截图后端："auto"、"qt" 或 "xcb-shm"，下一次截图时生效
+    static void setCaptureBackend(const QString &preference);
+    static CaptureBackend *captureBackend();
+    // 选区吸附到公式的笔迹边界，下一次截图时生效
+    static void setSnapEnabled(bool enabled);
 
 signals:
     void screenshotTaken(const QPixmap &pixmap);
@@ -31,9 +46,20 @@ private:
     QRect selectionRect;
     QPoint startPoint;
     bool selecting;
-    QPixmap desktopPixmap;
+    QImage desktopImage; // 打开时冻结的屏幕内容，由截图后端抓取
+    InkMap inkMap;       // desktopImage 的笔迹积分图，截图后建立一次
+    QRect snappedRect;   // 拖动时 selectionRect 收缩到笔迹边界后的结果
+    QRect hoverRect;     // 未拖动时光标下的公式块，单击即选中
+    QPoint screenOrigin; // 覆盖层所在屏幕在虚拟桌面中的位置
+    QRect capturedRect;  // 最终截取的区域（覆盖层坐标）
+
+    // 按住 Alt 时临时关闭吸附
+    bool snapActive(Qt::KeyboardModifiers modifiers) const;
 
     static ScreenshotOverlay* instance; // For the static method
+    static QString backendPreference;
+    static bool snapEnabled;
+    static QSharedPointer<CaptureBackend> backend;
 };
 
 #endif // SCREENSHOTOVERLAY_H
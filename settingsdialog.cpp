@@ -1,10 +1,10 @@
 #include "settingsdialog.h"
 #include "ui_settingsdialog.h"
 #include "configmanager.h"
+#include "pandocprobe.h"
 #include <QMessageBox>
 #include <QFileDialog>
 #include <QFileInfo>
-#include <QProcess>
 #include <QDesktopServices>
 #include <QUrl>
 #include <QDir>
@@ -42,6 +42,13 @@ void SettingsDialog::initializeUI()
     connect(ui->pandocTimeoutSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), 
             this, &SettingsDialog::onPandocTimeoutChanged);
     connect(ui->browsePandocButton, &QPushButton::clicked, this, &SettingsDialog::onBrowsePandocPath);
+    // 后台探测完成后刷新状态（路径可能已被继续修改）
+    connect(&PandocProbe::instance(), &PandocProbe::capabilitiesReady, this,
+            [this](const QString &path, const PandocCapabilities &capabilities) {
+                if (path == ui->pandocPathEdit->text()) {
+                    showPandocStatus(capabilities);
+                }
+            });
     
     // 连接日志标签页信号
     connect(ui->loggingLevelComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), 
@@ -210,7 +217,9 @@ bool SettingsDialog::validateSettings()
             return false;
         }
         
-        if (!isPandocAvailable(tempPandocPath)) {
+        // 只在已确认不可用时询问；探测尚未完成时不阻塞保存
+        PandocCapabilities capabilities = PandocProbe::instance().capabilities(tempPandocPath);
+        if (capabilities.probed && !capabilities.available) {
             QMessageBox::StandardButton reply = QMessageBox::question(
                 this, "Pandoc 不可用",
                 "指定的 Pandoc 路径似乎不可用。是否仍要保存此设置？",
@@ -251,26 +260,30 @@ void SettingsDialog::markAsModified()
     // 目前我们让按钮始终可用
 }
 
-bool SettingsDialog::isPandocAvailable(const QString &path) const
+void SettingsDialog::showPandocStatus(const PandocCapabilities &capabilities)
 {
-    // 如果是绝对路径，检查文件是否存在
-    QFileInfo fileInfo(path);
-    if (fileInfo.isAbsolute()) {
-        return fileInfo.exists() && fileInfo.isExecutable();
-    }
-    
-    // 如果是命令名称，尝试执行 --version
-    QProcess process;
-    process.start(path, QStringList() << "--version");
-    if (!process.waitForStarted(1000)) {
-        return false;
+    if (!capabilities.probed) {
+        ui->pandocStatusValueLabel->setText("检测中…");
+        ui->pandocStatusValueLabel->setStyleSheet("color: gray;");
+        ui->pandocStatusValueLabel->setToolTip(QString());
+        return;
     }
-    if (!process.waitForFinished(3000)) {
-        process.kill();
-        return false;
+
+    if (capabilities.available) {
+        QString text = QString("✓ 可用 (%1)").arg(capabilities.version.toString());
+        if (capabilities.serverMode) {
+            text += "，支持 server 模式";
+        }
+        ui->pandocStatusValueLabel->setText(text);
+        ui->pandocStatusValueLabel->setStyleSheet("color: #2ecc71;");
+        ui->pandocStatusValueLabel->setToolTip(QString("%1\n输出格式: %2")
+                                               .arg(QDir::toNativeSeparators(capabilities.executable))
+                                               .arg(capabilities.outputFormats.join(", ")));
+    } else {
+        ui->pandocStatusValueLabel->setText("✗ 不可用");
+        ui->pandocStatusValueLabel->setStyleSheet("color: #e74c3c;");
+        ui->pandocStatusValueLabel->setToolTip(capabilities.error);
     }
-    
-    return process.exitCode() == 0;
 }
 
 void SettingsDialog::validatePandocPath()
@@ -279,16 +292,12 @@ void SettingsDialog::validatePandocPath()
     if (path.isEmpty()) {
         ui->pandocStatusValueLabel->setText("未设置");
         ui->pandocStatusValueLabel->setStyleSheet("color: gray;");
+        ui->pandocStatusValueLabel->setToolTip(QString());
         return;
     }
-    
-    if (isPandocAvailable(path)) {
-        ui->pandocStatusValueLabel->setText("✓ 可用");
-        ui->pandocStatusValueLabel->setStyleSheet("color: #2ecc71;");
-    } else {
-        ui->pandocStatusValueLabel->setText("✗ 不可用");
-        ui->pandocStatusValueLabel->setStyleSheet("color: #e74c3c;");
-    }
+
+    // 有缓存时立即显示；否则先显示"检测中"，探测完成后由 capabilitiesReady 刷新
+    showPandocStatus(PandocProbe::instance().capabilities(path));
 }
 
 // Ollama 标签页槽函数
@@ -3,6 +3,8 @@
 
 #include <QDialog>
 
+struct PandocCapabilities;
+
 namespace Ui {
     class SettingsDialog;
 }
@@ -75,7 +77,7 @@ private:
     void markAsModified();
     
     // 辅助方法
-    bool isPandocAvailable(const QString &path) const;
+    void showPandocStatus(const PandocCapabilities &capabilities);
 };
 
 #endif // SETTINGSDIALOG_H
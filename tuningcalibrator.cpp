@@ -0,0 +1,294 @@
+#include "tuningcalibrator.h"
+#include "generationoptions.h"
+#include <QFont>
+#include <QPainter>
+#include <QTimer>
+#include <algorithm>
+
+namespace {
+
+// 白底黑字逐行绘制公式文本，宽图上横向重复，近似整页推导的截图
+QImage renderSample(const QSize &size, int variant)
+{
+    static const QStringList formulas = {
+        QString::fromUtf8("E = mc² + ∑ᵢ pᵢ²/2mᵢ"),
+        QString::fromUtf8("∫₀^∞ e^(−x²) dx = √π / 2"),
+        QString::fromUtf8("∇ × B = μ₀J + μ₀ε₀ ∂E/∂t"),
+        QString::fromUtf8("det(A − λI) = 0"),
+    };
+
+    QImage image(size, QImage::Format_RGB32);
+    image.fill(Qt::white);
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::TextAntialiasing);
+    painter.setPen(Qt::black);
+    const int lineHeight = qBound(20, size.height() / 6, 96);
+    QFont font("Serif");
+    font.setPixelSize(qMax(12, lineHeight * 2 / 3));
+    painter.setFont(font);
+
+    const int margin = qMin(lineHeight / 2, size.width() / 10);
+    int line = 0;
+    for (int y = margin + lineHeight; y <= size.height() - margin / 2; y += lineHeight, ++line) {
+        const QString &text = formulas.at((line + variant) % formulas.size());
+        for (int x = margin; x < size.width() - margin;
+             x += painter.fontMetrics().horizontalAdvance(text) + lineHeight) {
+            painter.drawText(x, y, text);
+        }
+    }
+    painter.end();
+    return image;
+}
+
+} // namespace
+
+TuningCalibrator::TuningCalibrator(QObject *parent)
+    : QObject(parent), client(new OllamaClient(this)), images(defaultImages()), batches(batchCandidates()),
+      repetitions(2), stage(Done), submitted(0), running(false)
+{
+    qRegisterMetaType<TuningCalibrator::Result>("TuningCalibrator::Result");
+
+    // 只测推理本身：不切分、不重新提问，每张图一个请求
+    LayoutAnalyzer::Settings layout;
+    layout.enabled = false;
+    client->setLayoutSettings(layout);
+    client->setReaskOnInvalid(false);
+
+    connect(client, &OllamaClient::requestMetrics, this, [this](const RecognitionMetrics &metrics) {
+        lastMetrics = metrics;
+    });
+    // 结果在信号发射期间到达，下一个请求推迟到事件循环中发出
+    connect(client, &OllamaClient::recognitionSuccess, this, [this](const QString &) {
+        QTimer::singleShot(0, this, [this]() { onResult(true, QString()); });
+    });
+    connect(client, &OllamaClient::recognitionError, this, [this](const QString &errorString) {
+        QTimer::singleShot(0, this, [this, errorString]() { onResult(false, errorString); });
+    });
+}
+
+void TuningCalibrator::setEndpoint(const QString &url, const QString &model, const QString &api)
+{
+    this->url = url;
+    client->updateSettings(url, model);
+    client->setApi(api);
+}
+
+void TuningCalibrator::setImages(const QList<QImage> &images)
+{
+    this->images = images.isEmpty() ? defaultImages() : images;
+}
+
+void TuningCalibrator::setRepetitions(int repetitions)
+{
+    this->repetitions = qMax(1, repetitions);
+}
+
+void TuningCalibrator::setThreadCandidates(const QList<int> &threads)
+{
+    this->threads = threads;
+}
+
+void TuningCalibrator::setBatchCandidates(const QList<int> &batches)
+{
+    this->batches = batches;
+}
+
+QList<int> TuningCalibrator::threadCandidates(const HardwareInfo::Info &hardware)
+{
+    QList<int> candidates = {qMax(1, hardware.physicalCores / 2), hardware.coresPerNode(),
+                             hardware.physicalCores, hardware.logicalCpus};
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    return candidates;
+}
+
+QList<int> TuningCalibrator::defaultThreadCandidates(const QString &url, const HardwareInfo::Info &hardware)
+{
+    // 客户端的核心数与远程服务端无关，按它扫描得到的线程数会一直发给远程端点
+    return RuntimeOptions::isLocalEndpoint(url) ? threadCandidates(hardware) : QList<int>();
+}
+
+QList<int> TuningCalibrator::batchCandidates()
+{
+    // Ollama 默认 512；图像 token 多时更大的批能减少预填充的次数
+    return {128, 256, 512, 1024};
+}
+
+QList<QImage> TuningCalibrator::defaultImages()
+{
+    return {renderSample(QSize(480, 72), 0), renderSample(QSize(640, 240), 1), renderSample(QSize(1280, 720), 2)};
+}
+
+bool TuningCalibrator::isRunning() const
+{
+    return running;
+}
+
+void TuningCalibrator::start()
+{
+    if (running) {
+        return;
+    }
+    running = true;
+    result = Result();
+    stage = Baseline;
+
+    // num_ctx 变化会让 Ollama 重新加载模型：所有图像使用同一组生成参数，按最大的图像估算，
+    // 各组试验之间只有运行参数不同
+    GenerationOptions::Settings generation;
+    generation.mode = "fixed";
+    for (const QImage &image : images) {
+        const int numPredict = GenerationOptions::estimateNumPredict(image.size(), false);
+        generation.numPredict = qMax(generation.numPredict, numPredict);
+        generation.numCtx = qMax(generation.numCtx, GenerationOptions::estimateNumCtx(
+                                     GenerationOptions::imageTokens(image.size()), numPredict));
+    }
+    client->setGenerationSettings(generation);
+    RuntimeOptions::Settings defaults;
+    defaults.enabled = false;
+    pending = {defaults};
+    emit progress(QString("Calibrating %1 with %2 images x %3").arg(url).arg(images.size()).arg(repetitions));
+    runTrial();
+}
+
+void TuningCalibrator::nextStage()
+{
+    // 在目前最快的参数上试验下一项；服务端默认值最快时从默认的 Settings 出发
+    RuntimeOptions::Settings base = result.best.enabled ? result.best : RuntimeOptions::Settings();
+    pending.clear();
+    switch (stage) {
+    case Baseline: {
+        stage = Threads;
+        // 没有候选时 pending 为空，runTrial 直接进入批大小的扫描
+        const QList<int> counts = threads.isEmpty() ? defaultThreadCandidates(url, HardwareInfo::detect()) : threads;
+        for (int count : counts) {
+            RuntimeOptions::Settings candidate = base;
+            candidate.numThread = count;
+            pending << candidate;
+        }
+        break;
+    }
+    case Threads:
+        stage = Batch;
+        for (int size : batches) {
+            RuntimeOptions::Settings candidate = base;
+            candidate.numBatch = size;
+            pending << candidate;
+        }
+        break;
+    case Batch: {
+        stage = Memory;
+        RuntimeOptions::Settings noMmap = base;
+        noMmap.useMmap = false;
+        RuntimeOptions::Settings mlock = base;
+        mlock.useMlock = true;
+        pending << noMmap << mlock;
+        break;
+    }
+    case Memory:
+    case Done:
+        stage = Done;
+        running = false;
+        result.ok = result.bestMs >= 0;
+        if (!result.ok && result.errorString.isEmpty()) {
+            result.errorString = "All calibration trials failed.";
+        }
+        emit finished(result);
+        return;
+    }
+    runTrial();
+}
+
+void TuningCalibrator::runTrial()
+{
+    if (pending.isEmpty()) {
+        nextStage();
+        return;
+    }
+    current = Trial();
+    current.settings = pending.takeFirst();
+    samples.clear();
+    submitted = 0;
+    client->setRuntimeOptions(current.settings);
+    emit progress("Trying " + RuntimeOptions::describe(current.settings));
+    submitNext();
+}
+
+void TuningCalibrator::submitNext()
+{
+    // 第 0 个请求为预热（参数变化后的模型重新加载），之后每张图各 repetitions 次
+    const int index = submitted == 0 ? 0 : (submitted - 1) % images.size();
+    ++submitted;
+    lastMetrics = RecognitionMetrics();
+    client->recognizeFormula(QPixmap::fromImage(images.at(index)));
+}
+
+void TuningCalibrator::onResult(bool ok, const QString &errorString)
+{
+    if (!running) {
+        return;
+    }
+    if (!ok) {
+        current.errorString = errorString;
+        finishTrial();
+        return;
+    }
+    if (submitted > 1) {
+        samples << lastMetrics.networkMs;
+        current.evalMs += lastMetrics.evalMs;
+        current.evalCount += lastMetrics.evalCount;
+    }
+    if (submitted < 1 + images.size() * repetitions) {
+        submitNext();
+    } else {
+        finishTrial();
+    }
+}
+
+void TuningCalibrator::finishTrial()
+{
+    if (current.errorString.isEmpty() && !samples.isEmpty()) {
+        std::sort(samples.begin(), samples.end());
+        current.medianMs = samples.at(samples.size() / 2);
+    }
+    result.trials << current;
+    emit progress(current.medianMs >= 0
+                  ? QString("  median %1 ms").arg(current.medianMs)
+                  : "  failed: " + current.errorString);
+
+    if (stage == Baseline) {
+        result.baselineMs = current.medianMs;
+        if (current.medianMs < 0) {
+            // 默认参数都无法识别：端点或模型不可用，不再继续
+            stage = Done;
+            running = false;
+            result.errorString = current.errorString;
+            emit finished(result);
+            return;
+        }
+    }
+    if (current.medianMs >= 0 && (result.bestMs < 0 || current.medianMs < result.bestMs)) {
+        result.best = current.settings;
+        result.bestMs = current.medianMs;
+    }
+    runTrial();
+}
+
+QString TuningCalibrator::report(const Result &result)
+{
+    QString text = QString("%1 %2 %3\n").arg("settings", -44).arg("median(ms)", 11).arg("tok/s", 8);
+    for (const Trial &trial : result.trials) {
+        const QString median = trial.medianMs >= 0 ? QString::number(trial.medianMs) : QString("failed");
+        const QString rate = trial.evalMs > 0 ? QString::number(trial.evalCount * 1000.0 / trial.evalMs, 'f', 1)
+                                              : QString("-");
+        text += QString("%1 %2 %3\n").arg(RuntimeOptions::describe(trial.settings), -44)
+                    .arg(median, 11).arg(rate, 8);
+    }
+    if (result.ok) {
+        text += QString("best: %1 (%2 ms, server defaults %3 ms)\n")
+                    .arg(RuntimeOptions::describe(result.best)).arg(result.bestMs).arg(result.baselineMs);
+    } else {
+        text += "calibration failed: " + result.errorString + "\n";
+    }
+    return text;
+}
@@ -0,0 +1,95 @@
+#ifndef TUNINGCALIBRATOR_H
+#define TUNINGCALIBRATOR_H
+
+#include <QObject>
+#include <QImage>
+#include <QList>
+#include <QVector>
+#include "ollamaclient.h"
+#include "runtimeoptions.h"
+
+// 运行参数校准：用一组固定的图像依次试验 num_thread、num_batch、use_mmap/use_mlock，
+// 取识别耗时中位数最小的一组。逐项扫描（先线程数，再批大小，最后 mmap/mlock），
+// 每一项在前面选出的最优值上试验，试验次数随候选数线性增长而不是相乘。
+// 每组参数的第一个请求会触发 Ollama 重新加载模型，只用于预热，不计入耗时。
+// 远程端点的核心数在这里无从得知：没有指定线程数候选时跳过线程数的扫描
+class TuningCalibrator : public QObject
+{
+    Q_OBJECT
+public:
+    struct Trial
+    {
+        RuntimeOptions::Settings settings;
+        qint64 medianMs = -1;  // 识别耗时的中位数，-1 表示有请求失败
+        qint64 evalMs = 0;     // 解码耗时之和（服务端给出）
+        int evalCount = 0;     // 生成 token 数之和
+        QString errorString;
+    };
+
+    struct Result
+    {
+        bool ok = false;
+        RuntimeOptions::Settings best;
+        qint64 bestMs = -1;
+        qint64 baselineMs = -1;  // 不发送运行参数（服务端默认值）时的耗时
+        QVector<Trial> trials;
+        QString errorString;
+    };
+
+    explicit TuningCalibrator(QObject *parent = nullptr);
+
+    void setEndpoint(const QString &url, const QString &model, const QString &api = "ollama");
+    // 固定的图像集，默认为 defaultImages()
+    void setImages(const QList<QImage> &images);
+    // 每张图像在每组参数下识别的次数
+    void setRepetitions(int repetitions);
+    // 线程数候选；为空（默认）时本机端点按 defaultThreadCandidates 推算
+    void setThreadCandidates(const QList<int> &threads);
+    void setBatchCandidates(const QList<int> &batches);
+
+    // 按 CPU 拓扑推算的线程数候选：一半物理核心、单个 NUMA 节点、全部物理核心和全部逻辑 CPU
+    static QList<int> threadCandidates(const HardwareInfo::Info &hardware);
+    // 端点在本机时为 threadCandidates(hardware)，远程端点为空
+    static QList<int> defaultThreadCandidates(const QString &url, const HardwareInfo::Info &hardware);
+    static QList<int> batchCandidates();
+    // 合成的公式截图：单行、多行和整页各一张
+    static QList<QImage> defaultImages();
+
+    void start();
+    bool isRunning() const;
+    // 每组参数的结果（对齐的文本表格），用于命令行报告
+    static QString report(const Result &result);
+
+signals:
+    void progress(const QString &message);
+    void finished(const TuningCalibrator::Result &result);
+
+private:
+    enum Stage { Baseline, Threads, Batch, Memory, Done };
+
+    void nextStage();
+    void runTrial();
+    void submitNext();
+    void onResult(bool ok, const QString &errorString);
+    void finishTrial();
+
+    OllamaClient *client;
+    QList<QImage> images;
+    QList<int> threads;
+    QList<int> batches;
+    int repetitions;
+    QString url;
+
+    Stage stage;
+    QList<RuntimeOptions::Settings> pending;  // 当前阶段尚未试验的参数
+    Trial current;
+    QList<qint64> samples;
+    int submitted;       // 当前参数下已发出的请求数（含预热）
+    RecognitionMetrics lastMetrics;
+    Result result;
+    bool running;
+};
+
+Q_DECLARE_METATYPE(TuningCalibrator::Result)
+
+#endif // TUNINGCALIBRATOR_H
@@ -0,0 +1,248 @@
+#include "xcbcapturebackend.h"
+#include <QGuiApplication>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QScreen>
+#include <QVector>
+#include <QDebug>
+#include <cstdlib>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <xcb/xcb.h>
+#include <xcb/shm.h>
+
+// 与 X 服务器的独立连接以及可复用的共享内存段。
+// 截图返回的 QImage 持有对池的引用，后端先于图像销毁时连接仍然有效
+class XcbShmCaptureBackend::SegmentPool
+{
+public:
+    struct Segment
+    {
+        xcb_shm_seg_t id = 0;
+        int shmid = -1;
+        uchar *data = nullptr;
+        size_t size = 0;
+    };
+
+    // QImage 的清理函数参数
+    struct ImageRef
+    {
+        QSharedPointer<SegmentPool> pool;
+        Segment *segment;
+    };
+
+    // 空闲段最多保留几个：预览和识别通常只同时持有一两张截图
+    static const int MaxFreeSegments = 2;
+
+    SegmentPool()
+    {
+        int screenNumber = 0;
+        connection = xcb_connect(nullptr, &screenNumber);
+        if (xcb_connection_has_error(connection)) {
+            return;
+        }
+
+        const xcb_setup_t *setup = xcb_get_setup(connection);
+        xcb_screen_iterator_t it = xcb_setup_roots_iterator(setup);
+        for (int i = 0; i < screenNumber && it.rem; ++i) {
+            xcb_screen_next(&it);
+        }
+        screen = it.data;
+        if (!screen) {
+            return;
+        }
+
+        const xcb_query_extension_reply_t *shm = xcb_get_extension_data(connection, &xcb_shm_id);
+        if (!shm || !shm->present) {
+            return;
+        }
+
+        // 只处理 32 位像素、低字节在前的格式，内存布局与 QImage::Format_RGB32 相同
+        bool pixels32 = false;
+        xcb_format_iterator_t format = xcb_setup_pixmap_formats_iterator(setup);
+        for (; format.rem; xcb_format_next(&format)) {
+            if (format.data->depth == screen->root_depth) {
+                pixels32 = format.data->bits_per_pixel == 32;
+            }
+        }
+        if (!pixels32 || (screen->root_depth != 24 && screen->root_depth != 32)
+                || setup->image_byte_order != XCB_IMAGE_ORDER_LSB_FIRST
+                || Q_BYTE_ORDER != Q_LITTLE_ENDIAN) {
+            return;
+        }
+
+        // 远程 X 连接（如 ssh 转发）无法附加共享内存：先试一个小段
+        Segment *probe = create(4096);
+        if (!probe) {
+            return;
+        }
+        destroy(probe);
+        valid = true;
+    }
+
+    ~SegmentPool()
+    {
+        for (Segment *segment : freeSegments) {
+            destroy(segment);
+        }
+        if (connection) {
+            xcb_disconnect(connection);
+        }
+    }
+
+    // 复用足够大的空闲段，没有时新建
+    Segment *acquire(size_t size)
+    {
+        {
+            QMutexLocker locker(&mutex);
+            for (int i = 0; i < freeSegments.size(); ++i) {
+                if (freeSegments.at(i)->size >= size) {
+                    return freeSegments.takeAt(i);
+                }
+            }
+        }
+        return create(size);
+    }
+
+    // 图像释放时调用，可能在其他线程（如后台编码）
+    void release(Segment *segment)
+    {
+        QMutexLocker locker(&mutex);
+        freeSegments.append(segment);
+        if (freeSegments.size() > MaxFreeSegments) {
+            // 丢弃最小的段：截图尺寸变大后小段不再有用
+            int smallest = 0;
+            for (int i = 1; i < freeSegments.size(); ++i) {
+                if (freeSegments.at(i)->size < freeSegments.at(smallest)->size) {
+                    smallest = i;
+                }
+            }
+            destroy(freeSegments.takeAt(smallest));
+        }
+    }
+
+    static void releaseImage(void *info)
+    {
+        ImageRef *ref = static_cast<ImageRef *>(info);
+        ref->pool->release(ref->segment);
+        delete ref;
+    }
+
+    xcb_connection_t *connection = nullptr;
+    xcb_screen_t *screen = nullptr;
+    bool valid = false;
+
+private:
+    Segment *create(size_t size)
+    {
+        Segment *segment = new Segment;
+        segment->size = size;
+        segment->shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+        if (segment->shmid < 0) {
+            delete segment;
+            return nullptr;
+        }
+        void *address = shmat(segment->shmid, nullptr, 0);
+        if (address == reinterpret_cast<void *>(-1)) {
+            shmctl(segment->shmid, IPC_RMID, nullptr);
+            delete segment;
+            return nullptr;
+        }
+        segment->data = static_cast<uchar *>(address);
+        segment->id = xcb_generate_id(connection);
+        xcb_generic_error_t *error = xcb_request_check(
+                connection, xcb_shm_attach_checked(connection, segment->id, segment->shmid, 0));
+        // 服务器已附加（或已失败）：先标记删除，双方都分离后由内核回收，进程异常退出也不会泄漏
+        shmctl(segment->shmid, IPC_RMID, nullptr);
+        if (error) {
+            std::free(error);
+            shmdt(address);
+            delete segment;
+            return nullptr;
+        }
+        return segment;
+    }
+
+    void destroy(Segment *segment)
+    {
+        xcb_shm_detach(connection, segment->id);
+        xcb_flush(connection);
+        shmdt(segment->data);
+        delete segment;
+    }
+
+    QMutex mutex;
+    QVector<Segment *> freeSegments;
+};
+
+XcbShmCaptureBackend::XcbShmCaptureBackend()
+    : pool(new SegmentPool)
+{
+}
+
+XcbShmCaptureBackend::~XcbShmCaptureBackend() = default;
+
+bool XcbShmCaptureBackend::isValid() const
+{
+    return pool->valid;
+}
+
+QString XcbShmCaptureBackend::name() const
+{
+    return "xcb-shm";
+}
+
+QImage XcbShmCaptureBackend::grab(const QRect &region)
+{
+    if (!isValid()) {
+        return QImage();
+    }
+
+    // X 的根窗口覆盖所有屏幕，坐标为设备像素
+    QScreen *primary = QGuiApplication::primaryScreen();
+    const qreal dpr = primary ? primary->devicePixelRatio() : 1.0;
+    const QRect root(0, 0, pool->screen->width_in_pixels, pool->screen->height_in_pixels);
+    const QRect device = QRect(qRound(region.x() * dpr), qRound(region.y() * dpr),
+                               qRound(region.width() * dpr), qRound(region.height() * dpr)).intersected(root);
+    if (device.isEmpty()) {
+        return QImage();
+    }
+
+    const int stride = device.width() * 4;
+    SegmentPool::Segment *segment = pool->acquire(size_t(stride) * size_t(device.height()));
+    if (!segment) {
+        return QImage();
+    }
+
+    xcb_connection_t *connection = pool->connection;
+    xcb_generic_error_t *error = nullptr;
+    xcb_shm_get_image_reply_t *reply = xcb_shm_get_image_reply(
+            connection,
+            xcb_shm_get_image(connection, pool->screen->root,
+                              int16_t(device.x()), int16_t(device.y()),
+                              uint16_t(device.width()), uint16_t(device.height()),
+                              ~0u, XCB_IMAGE_FORMAT_Z_PIXMAP, segment->id, 0),
+            &error);
+    if (!reply) {
+        qWarning() << "xcb_shm_get_image failed, error code" << (error ? int(error->error_code) : -1);
+        std::free(error);
+        pool->release(segment);
+        return QImage();
+    }
+    const bool needsAlpha = reply->depth == 24;
+    std::free(reply);
+
+    // 24 位色深时填充字节未定义，Format_RGB32 要求为 0xff
+    if (needsAlpha) {
+        quint32 *pixels = reinterpret_cast<quint32 *>(segment->data);
+        const size_t count = size_t(device.width()) * size_t(device.height());
+        for (size_t i = 0; i < count; ++i) {
+            pixels[i] |= 0xff000000u;
+        }
+    }
+
+    QImage image(segment->data, device.width(), device.height(), stride, QImage::Format_RGB32,
+                 &SegmentPool::releaseImage, new SegmentPool::ImageRef{pool, segment});
+    image.setDevicePixelRatio(dpr);
+    return image;
+}
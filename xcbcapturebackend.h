@@ -0,0 +1,28 @@
+#ifndef XCBCAPTUREBACKEND_H
+#define XCBCAPTUREBACKEND_H
+
+#include "capturebackend.h"
+#include <QSharedPointer>
+
+// X11 的 MIT-SHM 截图后端：xcb_shm_get_image 由 X 服务器直接写入共享内存段，
+// 返回的 QImage 直接引用这段内存，省去 XGetImage 经套接字传输像素以及 QPixmap 与 QImage 之间的转换。
+// 图像释放时内存段回到池中，下一次同样大小的截图直接复用。
+// 仅在 qmake CONFIG+=xcb_shm 时编译（需要 libxcb 与 libxcb-shm）
+class XcbShmCaptureBackend : public CaptureBackend
+{
+public:
+    XcbShmCaptureBackend();
+    ~XcbShmCaptureBackend() override;
+
+    // 已连接到本机 X 服务器，服务器支持 MIT-SHM，且根窗口为 32 位像素的 24/32 位色深
+    bool isValid() const;
+
+    QString name() const override;
+    QImage grab(const QRect &region) override;
+
+private:
+    class SegmentPool;
+    QSharedPointer<SegmentPool> pool;
+};
+
+#endif // XCBCAPTUREBACKEND_H